@@ -0,0 +1,312 @@
+// Pangaea2_0_bench: scripted headless scenarios with fixed frame counts, reported as JSON.
+//
+//   Pangaea2_0_bench [--frames=N] [--warmup=N] [--size=WxH] [--frames-in-flight=N]
+//                    [--scenario=name,name,...] [--output=bench.json] [--mesh=file.pmesh] [--list]
+//
+// Every scenario gets a fresh Renderer with an empty pipeline cache directory, a fixed scene
+// timestep and the same frame counts, so runs on one machine compare across builds. CPU frame
+// time is the wall time of drawFrame() (GPU waits included); GPU frame time is the profiler's
+// root scope, read back framesInFlight frames later.
+#include "Renderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Scenario {
+    const char*              name;
+    const char*              description;
+    Renderer::WorkloadConfig workload;
+    uint32_t                 resizeEvery = 0;   // frames between offscreen resizes; 0 = never
+};
+
+std::vector<Scenario> scenarios() {
+    auto instances = [](const char* name, const char* description, uint32_t n) {
+        Scenario s{ name, description, {} };
+        s.workload.instances = n;
+        return s;
+    };
+    std::vector<Scenario> list = {
+        instances("instances_1", "one mesh: fixed per-frame overhead", 1),
+        instances("instances_1k", "1,000 instances", 1000),
+        instances("instances_10k", "10,000 instances", 10000),
+        instances("instances_100k", "100,000 instances", 100000),
+        instances("instances_1m", "1,000,000 instances", 1000000),
+    };
+
+    // Static scenes should cost little more than the moving part: transforms only re-upload
+    // when they change
+    Scenario staticScene{ "instances_100k_static", "100,000 instances, 1% of them moving", {} };
+    staticScene.workload.instances = 100000;
+    staticScene.workload.animatedFraction = 0.01f;
+    list.push_back(staticScene);
+
+    Scenario upload{ "upload_streaming", "1k instances + 4 MB/frame streamed into the geometry pool", {} };
+    upload.workload.instances = 1000;
+    upload.workload.uploadBytesPerFrame = 4ull << 20;
+    list.push_back(upload);
+
+    Scenario storm{ "pipeline_storm", "1k instances + 8 new pipelines requested per frame", {} };
+    storm.workload.instances = 1000;
+    storm.workload.pipelineVariantsPerFrame = 8;
+    list.push_back(storm);
+
+    Scenario resize{ "resize_storm", "1k instances, render targets rebuilt every 4 frames", {} };
+    resize.workload.instances = 1000;
+    resize.resizeEvery = 4;
+    list.push_back(resize);
+
+    for (Scenario& s : list) s.workload.fixedTimestep = 1.f / 60.f;
+    return list;
+}
+
+struct Percentiles {
+    size_t samples = 0;
+    double avg = 0, min = 0, p50 = 0, p90 = 0, p95 = 0, p99 = 0, max = 0;
+};
+
+Percentiles percentiles(std::vector<double> v) {
+    Percentiles p;
+    p.samples = v.size();
+    if (v.empty()) return p;
+    std::sort(v.begin(), v.end());
+    auto at = [&](double q) { return v[std::min(v.size() - 1, static_cast<size_t>(q * static_cast<double>(v.size())))]; };
+    double sum = 0;
+    for (double x : v) sum += x;
+    p.avg = sum / static_cast<double>(v.size());
+    p.min = v.front();
+    p.p50 = at(0.50);
+    p.p90 = at(0.90);
+    p.p95 = at(0.95);
+    p.p99 = at(0.99);
+    p.max = v.back();
+    return p;
+}
+
+struct Result {
+    const Scenario* scenario = nullptr;
+    std::string     error;
+    double          wallSeconds = 0;
+    Percentiles     cpu, gpu;
+    FrameTimer::Stats phases[FrameTimer::kPhaseCount]{};
+    const char*     bottleneck = "";
+};
+
+struct Options {
+    uint32_t    frames = 1000;
+    uint32_t    warmup = 120;
+    VkExtent2D  extent{ 1280, 720 };
+    uint32_t    framesInFlight = 2;
+    std::string output = "bench.json";
+    std::string mesh;
+    std::string cacheRoot = "bench_cache";
+    std::vector<std::string> only;   // empty = all
+};
+
+Result run(const Scenario& s, const Options& opt, std::string& device) {
+    Result r;
+    r.scenario = &s;
+
+    // Cold pipeline cache every run: a warm cache from the last run would hide compile cost
+    const std::string cacheDir = opt.cacheRoot + "/" + s.name;
+    std::error_code ec;
+    std::filesystem::remove_all(cacheDir, ec);
+
+    auto renderer = std::make_unique<Renderer>();
+    Renderer::HeadlessConfig headless;
+    headless.extent = opt.extent;
+    renderer->setHeadless(std::move(headless));
+    Renderer::PresentConfig present;
+    present.framesInFlight = opt.framesInFlight;
+    renderer->setPresentConfig(present);
+    renderer->setWorkload(s.workload);
+    renderer->setCacheDirectory(cacheDir);
+    renderer->setGpuProfiling(true);
+    if (!opt.mesh.empty()) renderer->setMeshPath(opt.mesh);
+
+    try {
+        renderer->init(nullptr);
+        if (device.empty()) device = renderer->deviceName();
+
+        // Alternates between the requested size and a smaller one
+        uint64_t frame = 0;
+        auto step = [&] {
+            if (s.resizeEvery && frame > 0 && frame % s.resizeEvery == 0) {
+                const bool small = (frame / s.resizeEvery) % 2 == 1;
+                renderer->resizeHeadless(small ? VkExtent2D{ opt.extent.width / 2, opt.extent.height / 2 } : opt.extent);
+            }
+            renderer->drawFrame();
+            ++frame;
+        };
+
+        for (uint32_t i = 0; i < opt.warmup; ++i) step();
+
+        std::vector<double> cpu, gpu;
+        cpu.reserve(opt.frames);
+        gpu.reserve(opt.frames);
+        const GpuProfiler& profiler = renderer->profiler();
+        uint64_t gpuSeen = profiler.frameSampleCount();
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < opt.frames; ++i) {
+            const auto t0 = std::chrono::steady_clock::now();
+            step();
+            cpu.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            if (profiler.frameSampleCount() != gpuSeen) {
+                gpuSeen = profiler.frameSampleCount();
+                gpu.push_back(profiler.lastFrameMs());
+            }
+        }
+        r.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        r.cpu = percentiles(std::move(cpu));
+        r.gpu = percentiles(std::move(gpu));
+
+        const uint32_t window = std::min(opt.frames, FrameTimer::kCapacity);
+        for (uint32_t p = 0; p < FrameTimer::kPhaseCount; ++p)
+            r.phases[p] = renderer->frameTimes().stats(static_cast<FrameTimer::Phase>(p), window);
+        r.bottleneck = renderer->frameTimes().bottleneck(window);
+        renderer->cleanup();
+    }
+    catch (const std::exception& e) {
+        r.error = e.what();
+    }
+    return r;
+}
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+void writePercentiles(std::FILE* f, const char* key, const Percentiles& p) {
+    std::fprintf(f, "      \"%s\": { \"samples\": %zu, \"avg\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+        "\"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+        key, p.samples, p.avg, p.min, p.p50, p.p90, p.p95, p.p99, p.max);
+}
+
+bool writeJson(const std::string& path, const Options& opt, const std::string& device, const std::vector<Result>& results) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\n  \"schema\": 1,\n  \"device\": %s,\n", jsonString(device).c_str());
+    std::fprintf(f, "  \"extent\": [%u, %u],\n  \"frames\": %u,\n  \"warmup\": %u,\n  \"frames_in_flight\": %u,\n",
+        opt.extent.width, opt.extent.height, opt.frames, opt.warmup, opt.framesInFlight);
+    std::fprintf(f, "  \"scenarios\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const Scenario& s = *r.scenario;
+        std::fprintf(f, "    {\n      \"name\": \"%s\",\n", s.name);
+        std::fprintf(f, "      \"instances\": %u,\n      \"upload_bytes_per_frame\": %llu,\n"
+            "      \"pipeline_variants_per_frame\": %u,\n      \"resize_every\": %u,\n",
+            s.workload.instances, static_cast<unsigned long long>(s.workload.uploadBytesPerFrame),
+            s.workload.pipelineVariantsPerFrame, s.resizeEvery);
+        if (!r.error.empty()) {
+            std::fprintf(f, "      \"error\": %s\n    }%s\n", jsonString(r.error).c_str(), i + 1 < results.size() ? "," : "");
+            continue;
+        }
+        std::fprintf(f, "      \"wall_s\": %.4f,\n      \"fps\": %.2f,\n", r.wallSeconds,
+            r.wallSeconds > 0 ? opt.frames / r.wallSeconds : 0.0);
+        writePercentiles(f, "cpu_frame_ms", r.cpu);
+        writePercentiles(f, "gpu_frame_ms", r.gpu);
+        std::fprintf(f, "      \"phases_ms\": {");
+        for (uint32_t p = 0; p < FrameTimer::kPhaseCount; ++p) {
+            const FrameTimer::Stats& st = r.phases[p];
+            std::fprintf(f, "%s\n        \"%s\": { \"samples\": %u, \"avg\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+                p ? "," : "", FrameTimer::phaseName(static_cast<FrameTimer::Phase>(p)),
+                st.samples, st.avgMs, st.p50Ms, st.p99Ms, st.maxMs);
+        }
+        std::fprintf(f, "\n      },\n      \"bottleneck\": \"%s\"\n    }%s\n", r.bottleneck, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    return std::fclose(f) == 0;
+}
+
+bool parseArgs(int argc, char** argv, Options& opt, const std::vector<Scenario>& all) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&](const char* prefix) { return arg.substr(std::strlen(prefix)); };
+        if (arg.rfind("--frames=", 0) == 0) opt.frames = static_cast<uint32_t>(std::stoul(value("--frames=")));
+        else if (arg.rfind("--warmup=", 0) == 0) opt.warmup = static_cast<uint32_t>(std::stoul(value("--warmup=")));
+        else if (arg.rfind("--frames-in-flight=", 0) == 0)
+            opt.framesInFlight = static_cast<uint32_t>(std::stoul(value("--frames-in-flight=")));
+        else if (arg.rfind("--size=", 0) == 0) {
+            unsigned w = 0, h = 0;
+            if (std::sscanf(arg.c_str() + 7, "%ux%u", &w, &h) != 2 || !w || !h) {
+                std::cerr << "Bad size: " << arg << "\n";
+                return false;
+            }
+            opt.extent = { w, h };
+        }
+        else if (arg.rfind("--scenario=", 0) == 0) {
+            std::string names = value("--scenario=");
+            for (size_t pos = 0; pos <= names.size();) {
+                const size_t comma = std::min(names.find(',', pos), names.size());
+                if (comma > pos) opt.only.push_back(names.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+        }
+        else if (arg.rfind("--output=", 0) == 0) opt.output = value("--output=");
+        else if (arg.rfind("--mesh=", 0) == 0) opt.mesh = value("--mesh=");
+        else if (arg == "--list") {
+            for (const Scenario& s : all) std::printf("%-18s %s\n", s.name, s.description);
+            std::exit(0);
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return false;
+        }
+    }
+    for (const std::string& name : opt.only) {
+        if (std::none_of(all.begin(), all.end(), [&](const Scenario& s) { return name == s.name; })) {
+            std::cerr << "Unknown scenario: " << name << " (--list)\n";
+            return false;
+        }
+    }
+    opt.frames = std::max(opt.frames, 1u);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::vector<Scenario> all = scenarios();
+    Options opt;
+    if (!parseArgs(argc, argv, opt, all)) return 2;
+
+    std::string device;
+    std::vector<Result> results;
+    bool failed = false;
+    for (const Scenario& s : all) {
+        if (!opt.only.empty() && std::find(opt.only.begin(), opt.only.end(), s.name) == opt.only.end()) continue;
+        std::printf("[bench] %-18s ", s.name);
+        std::fflush(stdout);
+        results.push_back(run(s, opt, device));
+        const Result& r = results.back();
+        if (!r.error.empty()) {
+            std::printf("FAILED: %s\n", r.error.c_str());
+            failed = true;
+            continue;
+        }
+        std::printf("cpu p50 %.3f p99 %.3f ms | gpu p50 %.3f p99 %.3f ms | %.1f fps (%s)\n",
+            r.cpu.p50, r.cpu.p99, r.gpu.p50, r.gpu.p99, opt.frames / r.wallSeconds, r.bottleneck);
+    }
+
+    if (!writeJson(opt.output, opt, device, results)) {
+        std::cerr << "Failed to write " << opt.output << "\n";
+        return 1;
+    }
+    std::printf("[bench] results in %s\n", opt.output.c_str());
+    return failed ? 1 : 0;
+}
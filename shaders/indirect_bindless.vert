@@ -0,0 +1,30 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 vColor;
+
+// Per-frame UBO: view-projection
+layout(set = 0, binding = 0) uniform FrameUBO {
+    mat4 vp;
+} ubo;
+
+// Global descriptor set (BindlessDescriptors): every storage buffer, by slot
+struct InstanceData {
+    mat4 model;
+};
+layout(std430, set = 1, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+} buffers[];
+
+// Slot of this frame's instance buffer
+layout(push_constant) uniform PushConst {
+    uint instanceBuffer;
+} pc;
+
+void main() {
+    vColor = inColor;
+    gl_Position = ubo.vp * buffers[pc.instanceBuffer].instances[gl_InstanceIndex].model * vec4(inPos, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 450
+// Where the model matrix comes from is a specialization constant, so the per-draw push
+// constant pipeline and the indirect (instance buffer) pipeline share this one module.
+
+// false: push constant; true: instance buffer, indexed by the indirect command's firstInstance
+layout(constant_id = 0) const bool kInstanceBuffer = false;
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 vColor;
+
+// Per-frame UBO: view-projection
+layout(set = 0, binding = 0) uniform FrameUBO {
+    mat4 vp;
+} ubo;
+
+// Per-instance transforms
+struct InstanceData {
+    mat4 model;
+};
+layout(std430, set = 0, binding = 1) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+// Per-object push constant: model matrix
+layout(push_constant) uniform PushConst {
+    mat4 model;
+} pc;
+
+void main() {
+    vColor = inColor;
+    const mat4 model = kInstanceBuffer ? instances[gl_InstanceIndex].model : pc.model;
+    gl_Position = ubo.vp * model * vec4(inPos, 1.0);
+}
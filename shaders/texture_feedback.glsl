@@ -0,0 +1,36 @@
+// Streamed texture sampling + residency feedback (TextureStreamer). Fragment shaders only:
+// the level comes from textureQueryLod(), which needs derivatives.
+//
+//   #extension GL_EXT_nonuniform_qualifier : require
+//   #extension GL_GOOGLE_include_directive : require
+//   #include "texture_feedback.glsl"
+//
+// streamFeedback() records, for one pixel of every 4x2 block, the level this fragment
+// would like relative to the texture's resident mip 0, plus kFeedbackBias so finer levels
+// than resident stay positive. TextureStreamer::update() turns the frame's minimum per
+// texture into a promotion. feedbackBuffer is TextureStreamer::feedbackSlot(frame), textureId
+// is the Handle id, textureSlot / samplerSlot come from descriptorSlot() / samplerSlot().
+
+// Global descriptor set (BindlessDescriptors), set 1: binding = BindlessDescriptors::Kind
+layout(std430, set = 1, binding = 0) buffer StreamFeedback {
+    uint requestedLevel[];
+} streamFeedbackBuffers[];
+layout(set = 1, binding = 1) uniform sampler streamSamplers[];
+layout(set = 1, binding = 2) uniform texture2D streamTextures[];
+
+const uint kFeedbackBias = 16u;   // TextureStreamer::kFeedbackBias
+
+vec4 sampleStreamed(uint textureSlot, uint samplerSlot, vec2 uv) {
+    return texture(sampler2D(streamTextures[nonuniformEXT(textureSlot)], streamSamplers[samplerSlot]), uv);
+}
+
+void streamFeedback(uint feedbackBuffer, uint textureId, uint textureSlot, uint samplerSlot, vec2 uv) {
+    // Outside the branch: derivatives need the whole quad
+    const float lod = textureQueryLod(
+        sampler2D(streamTextures[nonuniformEXT(textureSlot)], streamSamplers[samplerSlot]), uv).y;
+    const uvec2 pixel = uvec2(gl_FragCoord.xy);
+    if ((pixel.x & 3u) != 0u || (pixel.y & 1u) != 0u) return;
+
+    const uint level = uint(clamp(floor(lod) + float(kFeedbackBias), 0.0, 63.0));
+    atomicMin(streamFeedbackBuffers[feedbackBuffer].requestedLevel[textureId], level);
+}
@@ -0,0 +1,169 @@
+#include "BindlessDescriptors.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static constexpr VkDescriptorType kTypes[BindlessDescriptors::kKindCount] = {
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+};
+
+BindlessDescriptors::Limits BindlessDescriptors::clampToDevice(VkPhysicalDevice phys, const Limits& wanted) {
+    VkPhysicalDeviceDescriptorIndexingProperties indexing{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+    VkPhysicalDeviceProperties2 props{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+    props.pNext = &indexing;
+    vkGetPhysicalDeviceProperties2(phys, &props);
+
+    // Both the per-set and the per-stage limit apply (every binding is visible to all stages)
+    Limits l;
+    l.storageBuffers = std::min({ wanted.storageBuffers,
+        indexing.maxDescriptorSetUpdateAfterBindStorageBuffers, indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+    l.samplers = std::min({ wanted.samplers,
+        indexing.maxDescriptorSetUpdateAfterBindSamplers, indexing.maxPerStageDescriptorUpdateAfterBindSamplers });
+    l.sampledImages = std::min({ wanted.sampledImages,
+        indexing.maxDescriptorSetUpdateAfterBindSampledImages, indexing.maxPerStageDescriptorUpdateAfterBindSampledImages });
+
+    // Per-stage resource total; images give way first
+    const uint64_t total = uint64_t(l.storageBuffers) + l.samplers + l.sampledImages;
+    if (total > indexing.maxPerStageUpdateAfterBindResources) {
+        const uint64_t over = total - indexing.maxPerStageUpdateAfterBindResources;
+        l.sampledImages -= static_cast<uint32_t>(std::min<uint64_t>(over, l.sampledImages));
+    }
+    return l;
+}
+
+void BindlessDescriptors::init(VkDevice dev, const Limits& limits) {
+    device = dev;
+    tables[0].capacity = limits.storageBuffers;
+    tables[1].capacity = limits.samplers;
+    tables[2].capacity = limits.sampledImages;
+
+    std::array<VkDescriptorSetLayoutBinding, kKindCount> bindings{};
+    std::array<VkDescriptorBindingFlags, kKindCount> flags{};
+    for (uint32_t i = 0; i < kKindCount; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = kTypes[i];
+        bindings[i].descriptorCount = std::max(1u, tables[i].capacity);
+        bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+        flags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    }
+    flags[kKindCount - 1] |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;   // last binding only
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+    bindingFlags.bindingCount = kKindCount;
+    bindingFlags.pBindingFlags = flags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layoutInfo.pNext = &bindingFlags;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = kKindCount;
+    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        throw std::runtime_error("BindlessDescriptors: failed to create set layout");
+
+    std::array<VkDescriptorPoolSize, kKindCount> sizes{};
+    for (uint32_t i = 0; i < kKindCount; ++i) sizes[i] = { kTypes[i], bindings[i].descriptorCount };
+
+    VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = kKindCount;
+    poolInfo.pPoolSizes = sizes.data();
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        throw std::runtime_error("BindlessDescriptors: failed to create descriptor pool");
+
+    const uint32_t variableCount = bindings[kKindCount - 1].descriptorCount;
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+    variable.descriptorSetCount = 1;
+    variable.pDescriptorCounts = &variableCount;
+
+    VkDescriptorSetAllocateInfo ai{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    ai.pNext = &variable;
+    ai.descriptorPool = pool;
+    ai.descriptorSetCount = 1;
+    ai.pSetLayouts = &setLayout;
+    if (vkAllocateDescriptorSets(device, &ai, &descriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("BindlessDescriptors: failed to allocate the set");
+}
+
+void BindlessDescriptors::destroy() {
+    if (pool) vkDestroyDescriptorPool(device, pool, nullptr);
+    if (setLayout) vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+    pool = VK_NULL_HANDLE;
+    setLayout = VK_NULL_HANDLE;
+    descriptorSet = VK_NULL_HANDLE;
+    tables = {};
+    retired.clear();
+    device = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessDescriptors::allocate(Kind kind) {
+    Table& t = tables[static_cast<uint32_t>(kind)];
+    if (!t.free.empty()) {
+        const uint32_t slot = t.free.back();
+        t.free.pop_back();
+        return slot;
+    }
+    if (t.next >= t.capacity) throw std::runtime_error("BindlessDescriptors: table full");
+    return t.next++;
+}
+
+void BindlessDescriptors::write(Kind kind, uint32_t slot, const VkDescriptorBufferInfo* buffer,
+    const VkDescriptorImageInfo* image) {
+    VkWriteDescriptorSet w{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    w.dstSet = descriptorSet;
+    w.dstBinding = static_cast<uint32_t>(kind);
+    w.dstArrayElement = slot;
+    w.descriptorCount = 1;
+    w.descriptorType = kTypes[static_cast<uint32_t>(kind)];
+    w.pBufferInfo = buffer;
+    w.pImageInfo = image;
+    vkUpdateDescriptorSets(device, 1, &w, 0, nullptr);
+}
+
+uint32_t BindlessDescriptors::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint32_t slot = allocate(Kind::StorageBuffer);
+    const VkDescriptorBufferInfo info{ buffer, offset, range };
+    write(Kind::StorageBuffer, slot, &info, nullptr);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addSampler(VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint32_t slot = allocate(Kind::Sampler);
+    VkDescriptorImageInfo info{};
+    info.sampler = sampler;
+    write(Kind::Sampler, slot, nullptr, &info);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::addSampledImage(VkImageView view, VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint32_t slot = allocate(Kind::SampledImage);
+    VkDescriptorImageInfo info{};
+    info.imageView = view;
+    info.imageLayout = layout;
+    write(Kind::SampledImage, slot, nullptr, &info);
+    return slot;
+}
+
+void BindlessDescriptors::release(Kind kind, uint32_t slot, uint64_t retireValue) {
+    if (slot == kInvalidSlot) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!retired.empty() && retireValue < retired.back().value)
+        throw std::runtime_error("BindlessDescriptors: retire values must not decrease");
+    retired.push_back({ retireValue, kind, slot });
+}
+
+void BindlessDescriptors::collect(uint64_t completedValue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!retired.empty() && retired.front().value <= completedValue) {
+        const Retired& r = retired.front();
+        tables[static_cast<uint32_t>(r.kind)].free.push_back(r.slot);
+        retired.pop_front();
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// One global descriptor set for every storage buffer, sampler and sampled image (descriptor
+// indexing). Resources are registered once and referenced from shaders by slot index, passed
+// in push constants or instance data, so draws never write or bind per-draw sets.
+//
+// The set is update-after-bind, partially bound and update-unused-while-pending: new slots can
+// be written while frames in flight read other ones. Released slots are reused only after the
+// FrameTimeline value of the last submit that may read them has completed.
+//
+// Shader side (set index chosen by the pipeline layout):
+//   binding 0: buffer  StorageBuffers { ... } buffers[];
+//   binding 1: uniform sampler         samplers[];
+//   binding 2: uniform texture2D       textures[];   (variable count)
+class BindlessDescriptors {
+public:
+    enum class Kind : uint8_t { StorageBuffer, Sampler, SampledImage };   // = binding
+    static constexpr uint32_t kKindCount = 3;
+    static constexpr uint32_t kInvalidSlot = ~0u;
+
+    struct Limits {
+        uint32_t storageBuffers = 4096;
+        uint32_t samplers = 64;
+        uint32_t sampledImages = 16384;
+    };
+
+    // wanted, clamped to the device's update-after-bind limits
+    static Limits clampToDevice(VkPhysicalDevice phys, const Limits& wanted);
+
+    void init(VkDevice dev, const Limits& limits);
+    // The device must be idle
+    void destroy();
+
+    // Registers a resource and returns its slot; thread-safe. Throws when the table is full.
+    uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    uint32_t addSampler(VkSampler sampler);
+    uint32_t addSampledImage(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // The slot is free for reuse once retireValue has completed (normally lastSubmitted())
+    void release(Kind kind, uint32_t slot, uint64_t retireValue);
+    void collect(uint64_t completedValue);
+
+    VkDescriptorSetLayout layout() const { return setLayout; }
+    VkDescriptorSet       set() const { return descriptorSet; }
+    uint32_t capacity(Kind kind) const { return tables[static_cast<uint32_t>(kind)].capacity; }
+
+private:
+    struct Table {
+        uint32_t              capacity = 0;
+        uint32_t              next = 0;    // slots below were handed out at least once
+        std::vector<uint32_t> free;        // retired and collected
+    };
+    struct Retired {
+        uint64_t value;
+        Kind     kind;
+        uint32_t slot;
+    };
+
+    VkDevice              device = VK_NULL_HANDLE;
+    VkDescriptorPool      pool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorSet       descriptorSet = VK_NULL_HANDLE;
+
+    std::mutex                    mutex;
+    std::array<Table, kKindCount> tables{};
+    std::deque<Retired>           retired;   // non-decreasing values, like DeletionQueue
+
+    // Called with the lock held
+    uint32_t allocate(Kind kind);
+    void write(Kind kind, uint32_t slot, const VkDescriptorBufferInfo* buffer, const VkDescriptorImageInfo* image);
+};
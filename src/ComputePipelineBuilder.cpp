@@ -0,0 +1 @@
+#include "ComputePipelineBuilder.hpp"
@@ -0,0 +1,70 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <cstdint>
+
+// Compute counterpart to PipelineBuilder: one shader stage + layout (+ optional cache).
+class ComputePipelineBuilder {
+public:
+    // ----- Lifecycle helpers -----
+    ComputePipelineBuilder& reset();
+
+    // ----- Shader Stage -----
+    ComputePipelineBuilder& setShader(VkShaderModule module, const char* entry = "main");
+    ComputePipelineBuilder& setSpecialization(const VkSpecializationInfo* info);
+
+    // ----- Layout / Cache -----
+    ComputePipelineBuilder& setLayout(VkPipelineLayout layout_);
+    ComputePipelineBuilder& setPipelineCache(VkPipelineCache cache_);
+    ComputePipelineBuilder& setFlags(VkPipelineCreateFlags flags_);
+
+    // ----- Final Build -----
+    VkPipeline build(VkDevice device) const;
+
+private:
+    VkPipelineShaderStageCreateInfo stage{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+    VkPipelineLayout      layout = VK_NULL_HANDLE;
+    VkPipelineCache       cache = VK_NULL_HANDLE;
+    VkPipelineCreateFlags flags = 0;
+};
+
+// ---------------- Inline definitions ----------------
+
+inline ComputePipelineBuilder& ComputePipelineBuilder::reset() {
+    stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+    layout = VK_NULL_HANDLE;
+    cache = VK_NULL_HANDLE;
+    flags = 0;
+    return *this;
+}
+
+inline ComputePipelineBuilder& ComputePipelineBuilder::setShader(VkShaderModule module, const char* entry) {
+    stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stage.module = module;
+    stage.pName = entry;
+    return *this;
+}
+
+inline ComputePipelineBuilder& ComputePipelineBuilder::setSpecialization(const VkSpecializationInfo* info) {
+    stage.pSpecializationInfo = info;
+    return *this;
+}
+
+inline ComputePipelineBuilder& ComputePipelineBuilder::setLayout(VkPipelineLayout layout_) { layout = layout_; return *this; }
+inline ComputePipelineBuilder& ComputePipelineBuilder::setPipelineCache(VkPipelineCache cache_) { cache = cache_; return *this; }
+inline ComputePipelineBuilder& ComputePipelineBuilder::setFlags(VkPipelineCreateFlags flags_) { flags = flags_; return *this; }
+
+inline VkPipeline ComputePipelineBuilder::build(VkDevice device) const {
+    if (stage.module == VK_NULL_HANDLE) throw std::runtime_error("ComputePipelineBuilder: no shader set (setShader())");
+    if (layout == VK_NULL_HANDLE) throw std::runtime_error("ComputePipelineBuilder: missing layout (setLayout())");
+
+    VkComputePipelineCreateInfo info{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    info.flags = flags;
+    info.stage = stage;
+    info.layout = layout;
+
+    VkPipeline pipe{};
+    if (vkCreateComputePipelines(device, cache, 1, &info, nullptr, &pipe) != VK_SUCCESS)
+        throw std::runtime_error("ComputePipelineBuilder: vkCreateComputePipelines failed");
+    return pipe;
+}
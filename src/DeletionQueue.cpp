@@ -0,0 +1,102 @@
+#include "DeletionQueue.hpp"
+#include "MemoryBudget.hpp"
+
+#include <algorithm>
+
+void DeletionQueue::init(VkDevice dev, VmaAllocator alloc, MemoryBudget* budget) {
+    device = dev;
+    allocator = alloc;
+    memory = budget;
+}
+
+void DeletionQueue::destroy() {
+    for (const auto& e : entries) release(e);
+    entries.clear();
+    device = VK_NULL_HANDLE;
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+    destroyShader = nullptr;
+}
+
+void DeletionQueue::push(Entry e) {
+    // Retiring later than necessary is always safe and keeps collect() FIFO
+    if (!entries.empty()) e.value = std::max(e.value, entries.back().value);
+    entries.push_back(e);
+}
+
+void DeletionQueue::deferBuffer(uint64_t retireValue, VkBuffer buffer, VmaAllocation alloc) {
+    if (!buffer) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Buffer; e.buffer = buffer; e.alloc = alloc;
+    push(e);
+}
+
+void DeletionQueue::deferImage(uint64_t retireValue, VkImage image, VmaAllocation alloc) {
+    if (!image) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Image; e.image = image; e.alloc = alloc;
+    push(e);
+}
+
+void DeletionQueue::deferImageView(uint64_t retireValue, VkImageView view) {
+    if (!view) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::ImageView; e.view = view;
+    push(e);
+}
+
+void DeletionQueue::deferSwapchain(uint64_t retireValue, VkSwapchainKHR swapchain) {
+    if (!swapchain) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Swapchain; e.swapchain = swapchain;
+    push(e);
+}
+
+void DeletionQueue::deferSemaphore(uint64_t retireValue, VkSemaphore semaphore) {
+    if (!semaphore) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Semaphore; e.semaphore = semaphore;
+    push(e);
+}
+
+void DeletionQueue::deferPipeline(uint64_t retireValue, VkPipeline pipeline) {
+    if (!pipeline) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Pipeline; e.pipeline = pipeline;
+    push(e);
+}
+
+void DeletionQueue::deferShader(uint64_t retireValue, VkShaderEXT shader) {
+    if (!shader) return;
+    if (!destroyShader) destroyShader = (PFN_vkDestroyShaderEXT)vkGetDeviceProcAddr(device, "vkDestroyShaderEXT");
+    Entry e{}; e.value = retireValue; e.kind = Kind::Shader; e.shader = shader;
+    push(e);
+}
+
+void DeletionQueue::deferDescriptorPool(uint64_t retireValue, VkDescriptorPool pool) {
+    if (!pool) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::DescriptorPool; e.descriptorPool = pool;
+    push(e);
+}
+
+void DeletionQueue::deferAllocation(uint64_t retireValue, VmaAllocation alloc) {
+    if (!alloc) return;
+    Entry e{}; e.value = retireValue; e.kind = Kind::Allocation; e.alloc = alloc;
+    push(e);
+}
+
+void DeletionQueue::collect(uint64_t completedValue) {
+    while (!entries.empty() && entries.front().value <= completedValue) {
+        release(entries.front());
+        entries.pop_front();
+    }
+}
+
+void DeletionQueue::release(const Entry& e) {
+    if (memory && e.alloc) memory->untrack(e.alloc);
+    switch (e.kind) {
+    case Kind::Buffer:         vmaDestroyBuffer(allocator, e.buffer, e.alloc); break;
+    case Kind::Image:          vmaDestroyImage(allocator, e.image, e.alloc); break;
+    case Kind::ImageView:      vkDestroyImageView(device, e.view, nullptr); break;
+    case Kind::Swapchain:      vkDestroySwapchainKHR(device, e.swapchain, nullptr); break;
+    case Kind::Semaphore:      vkDestroySemaphore(device, e.semaphore, nullptr); break;
+    case Kind::Pipeline:       vkDestroyPipeline(device, e.pipeline, nullptr); break;
+    case Kind::Shader:         destroyShader(device, e.shader, nullptr); break;
+    case Kind::DescriptorPool: vkDestroyDescriptorPool(device, e.descriptorPool, nullptr); break;
+    case Kind::Allocation:     vmaFreeMemory(allocator, e.alloc); break;
+    }
+}
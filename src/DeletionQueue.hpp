@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <deque>
+#include <cstdint>
+
+class MemoryBudget;
+
+// Deferred destruction keyed by FrameTimeline values.
+//
+// Instead of idling the device, callers hand a handle over together with the timeline value of
+// the last submit that may still reference it (normally FrameTimeline::lastSubmitted()).
+// collect() frees everything whose value has retired. A value lower than the last one pushed
+// is raised to it: the handle is freed a little later than it could be, the queue stays sorted
+// and collection only ever looks at the front, so callers need not order their values. Freed
+// allocations leave the MemoryBudget's accounting when one is attached.
+class DeletionQueue {
+public:
+    void init(VkDevice dev, VmaAllocator alloc, MemoryBudget* budget = nullptr);
+    // Frees everything immediately; the device must be idle.
+    void destroy();
+
+    void deferBuffer(uint64_t retireValue, VkBuffer buffer, VmaAllocation alloc);
+    void deferImage(uint64_t retireValue, VkImage image, VmaAllocation alloc);
+    void deferImageView(uint64_t retireValue, VkImageView view);
+    void deferSwapchain(uint64_t retireValue, VkSwapchainKHR swapchain);
+    void deferSemaphore(uint64_t retireValue, VkSemaphore semaphore);
+    void deferPipeline(uint64_t retireValue, VkPipeline pipeline);
+    void deferShader(uint64_t retireValue, VkShaderEXT shader);            // VK_EXT_shader_object
+    void deferDescriptorPool(uint64_t retireValue, VkDescriptorPool pool); // frees its sets too
+    void deferAllocation(uint64_t retireValue, VmaAllocation alloc);       // vmaAllocateMemory blocks
+
+    void collect(uint64_t completedValue);
+
+    size_t pending() const { return entries.size(); }
+
+private:
+    enum class Kind : uint8_t { Buffer, Image, ImageView, Swapchain, Semaphore, Pipeline, Shader, DescriptorPool, Allocation };
+
+    struct Entry {
+        uint64_t value;
+        Kind     kind;
+        union {
+            VkBuffer         buffer;
+            VkImage          image;
+            VkImageView      view;
+            VkSwapchainKHR   swapchain;
+            VkSemaphore      semaphore;
+            VkPipeline       pipeline;
+            VkShaderEXT      shader;
+            VkDescriptorPool descriptorPool;
+        };
+        VmaAllocation alloc;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    PFN_vkDestroyShaderEXT destroyShader = nullptr;   // loaded by the first deferShader()
+    std::deque<Entry> entries;
+
+    void push(Entry e);
+    void release(const Entry& e);
+};
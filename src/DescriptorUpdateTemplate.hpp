@@ -0,0 +1,66 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <utility>
+#include <cstdint>
+
+// vkUpdateDescriptorSetWithTemplate wrapper. Entries name a binding and where its
+// VkDescriptorBufferInfo / VkDescriptorImageInfo sits in a caller struct (offsetof), so per-frame
+// updates just fill the struct instead of filling VkWriteDescriptorSet arrays.
+class DescriptorUpdateTemplate {
+public:
+    DescriptorUpdateTemplate() = default;
+    ~DescriptorUpdateTemplate() { destroy(); }
+
+    DescriptorUpdateTemplate(const DescriptorUpdateTemplate&) = delete;
+    DescriptorUpdateTemplate& operator=(const DescriptorUpdateTemplate&) = delete;
+    DescriptorUpdateTemplate(DescriptorUpdateTemplate&& other) noexcept { moveFrom(other); }
+    DescriptorUpdateTemplate& operator=(DescriptorUpdateTemplate&& other) noexcept {
+        if (this != &other) { destroy(); moveFrom(other); }
+        return *this;
+    }
+
+    void create(VkDevice dev, VkDescriptorSetLayout layout,
+        const VkDescriptorUpdateTemplateEntry* entries, uint32_t entryCount);
+    void destroy();
+
+    // data: the struct the entries' offsets point into
+    void update(VkDescriptorSet set, const void* data) const;
+
+    VkDescriptorUpdateTemplate handle() const { return tmpl; }
+
+private:
+    VkDevice                   device = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate tmpl = VK_NULL_HANDLE;
+
+    void moveFrom(DescriptorUpdateTemplate& other) noexcept {
+        device = std::exchange(other.device, VK_NULL_HANDLE);
+        tmpl = std::exchange(other.tmpl, VK_NULL_HANDLE);
+    }
+};
+
+// ---------------- Inline definitions ----------------
+
+inline void DescriptorUpdateTemplate::create(VkDevice dev, VkDescriptorSetLayout layout,
+    const VkDescriptorUpdateTemplateEntry* entries, uint32_t entryCount) {
+    destroy();
+    device = dev;
+
+    VkDescriptorUpdateTemplateCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO };
+    info.descriptorUpdateEntryCount = entryCount;
+    info.pDescriptorUpdateEntries = entries;
+    info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    info.descriptorSetLayout = layout;
+    if (vkCreateDescriptorUpdateTemplate(device, &info, nullptr, &tmpl) != VK_SUCCESS)
+        throw std::runtime_error("DescriptorUpdateTemplate: vkCreateDescriptorUpdateTemplate failed");
+}
+
+inline void DescriptorUpdateTemplate::destroy() {
+    if (tmpl) vkDestroyDescriptorUpdateTemplate(device, tmpl, nullptr);
+    tmpl = VK_NULL_HANDLE;
+    device = VK_NULL_HANDLE;
+}
+
+inline void DescriptorUpdateTemplate::update(VkDescriptorSet set, const void* data) const {
+    vkUpdateDescriptorSetWithTemplate(device, set, tmpl, data);
+}
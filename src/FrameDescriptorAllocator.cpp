@@ -0,0 +1,105 @@
+#include "FrameDescriptorAllocator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void FrameDescriptorAllocator::init(VkDevice dev, uint32_t framesInFlight, const std::vector<PoolRatio>& ratios,
+    uint32_t initialSetsPerPool) {
+    device = dev;
+    poolRatios = ratios;
+    poolSets = std::clamp(initialSetsPerPool, 1u, kMaxSetsPerPool);
+    frames.assign(framesInFlight, Frame{});
+}
+
+void FrameDescriptorAllocator::destroy() {
+    for (Frame& f : frames) {
+        for (const Pool& p : f.ready) vkDestroyDescriptorPool(device, p.pool, nullptr);
+        for (const Pool& p : f.full) vkDestroyDescriptorPool(device, p.pool, nullptr);
+    }
+    frames.clear();
+    device = VK_NULL_HANDLE;
+}
+
+size_t FrameDescriptorAllocator::poolCount() const {
+    size_t n = 0;
+    for (const Frame& f : frames) n += f.ready.size() + f.full.size();
+    return n;
+}
+
+FrameDescriptorAllocator::Pool FrameDescriptorAllocator::createPool() {
+    std::vector<VkDescriptorPoolSize> sizes;
+    sizes.reserve(poolRatios.size());
+    for (const PoolRatio& r : poolRatios) {
+        const auto count = static_cast<uint32_t>(std::ceil(r.perSet * static_cast<float>(poolSets)));
+        sizes.push_back({ r.type, std::max(1u, count) });
+    }
+
+    VkDescriptorPoolCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    info.flags = 0;   // reset as a whole, never freed per set
+    info.maxSets = poolSets;
+    info.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    info.pPoolSizes = sizes.data();
+
+    Pool p;
+    p.sets = poolSets;
+    if (vkCreateDescriptorPool(device, &info, nullptr, &p.pool) != VK_SUCCESS)
+        throw std::runtime_error("FrameDescriptorAllocator: failed to create descriptor pool");
+    return p;
+}
+
+void FrameDescriptorAllocator::beginFrame(uint32_t frame) {
+    Frame& f = frames.at(frame);
+
+    // Overflowed last time: size new pools for the whole frame, plus a quarter headroom
+    if (!f.full.empty()) poolSets = std::min(kMaxSetsPerPool, std::max(poolSets, f.setsAllocated + f.setsAllocated / 4));
+
+    for (Pool& p : f.full) f.ready.push_back(p);
+    f.full.clear();
+
+    // Outgrown pools go; one pool per frame is the steady state
+    auto keep = f.ready.begin();
+    for (auto it = f.ready.begin(); it != f.ready.end(); ++it) {
+        if (it->sets < poolSets) {
+            vkDestroyDescriptorPool(device, it->pool, nullptr);
+            continue;
+        }
+        vkResetDescriptorPool(device, it->pool, 0);
+        *keep++ = *it;
+    }
+    f.ready.erase(keep, f.ready.end());
+    f.setsAllocated = 0;
+}
+
+VkDescriptorSet FrameDescriptorAllocator::allocate(uint32_t frame, VkDescriptorSetLayout layout,
+    const uint32_t* variableCount) {
+    Frame& f = frames.at(frame);
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variable{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+    variable.descriptorSetCount = 1;
+    variable.pDescriptorCounts = variableCount;
+
+    VkDescriptorSetAllocateInfo ai{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    ai.pNext = variableCount ? &variable : nullptr;
+    ai.descriptorSetCount = 1;
+    ai.pSetLayouts = &layout;
+
+    // Walk the ready pools, then one fresh pool: a set that doesn't fit an empty pool never will
+    for (;;) {
+        const bool fresh = f.ready.empty();
+        if (fresh) f.ready.push_back(createPool());
+        ai.descriptorPool = f.ready.back().pool;
+
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        const VkResult r = vkAllocateDescriptorSets(device, &ai, &set);
+        if (r == VK_SUCCESS) {
+            ++f.setsAllocated;
+            return set;
+        }
+        if (fresh || (r != VK_ERROR_OUT_OF_POOL_MEMORY && r != VK_ERROR_FRAGMENTED_POOL)) break;
+
+        f.full.push_back(f.ready.back());
+        f.ready.pop_back();
+    }
+    throw std::runtime_error("FrameDescriptorAllocator: vkAllocateDescriptorSets failed");
+}
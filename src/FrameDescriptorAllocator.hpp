@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// Transient descriptor sets that live for one frame in flight.
+//
+// Each frame slot owns its pools (created without FREE_DESCRIPTOR_SET_BIT, so allocation is a
+// bump) split into a ready list, still taking allocations, and a full list. beginFrame() resets
+// every pool of the slot at once after its previous submit has retired and moves them all back to
+// ready. Pools are sized from the per-set ratios given to init(); when a frame needs more
+// than one pool, later pools are created large enough for the busiest frame seen, and
+// smaller ones are dropped at reset.
+//
+// Not thread-safe: allocate from the thread that calls beginFrame().
+class FrameDescriptorAllocator {
+public:
+    // Pool capacity for type = ceil(perSet * sets per pool)
+    struct PoolRatio {
+        VkDescriptorType type;
+        float            perSet;
+    };
+
+    void init(VkDevice dev, uint32_t framesInFlight, const std::vector<PoolRatio>& ratios,
+        uint32_t initialSetsPerPool = 64);
+    // The device must be idle
+    void destroy();
+
+    // The slot's last submit has retired: its sets become invalid
+    void beginFrame(uint32_t frame);
+    // variableCount: descriptor count of a variable-count last binding, if the layout has one
+    VkDescriptorSet allocate(uint32_t frame, VkDescriptorSetLayout layout, const uint32_t* variableCount = nullptr);
+
+    uint32_t setsPerPool() const { return poolSets; }
+    size_t   poolCount() const;
+
+private:
+    static constexpr uint32_t kMaxSetsPerPool = 4096;
+
+    struct Pool {
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        uint32_t         sets = 0;   // capacity it was created with
+    };
+    struct Frame {
+        std::vector<Pool> ready;   // back() takes allocations
+        std::vector<Pool> full;
+        uint32_t          setsAllocated = 0;   // since beginFrame()
+    };
+
+    VkDevice               device = VK_NULL_HANDLE;
+    std::vector<PoolRatio> poolRatios;
+    uint32_t               poolSets = 64;
+    std::vector<Frame>     frames;
+
+    Pool createPool();
+};
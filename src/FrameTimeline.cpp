@@ -0,0 +1,48 @@
+#include "FrameTimeline.hpp"
+
+#include <stdexcept>
+
+void FrameTimeline::init(VkDevice dev) {
+    device = dev;
+
+    VkSemaphoreTypeCreateInfo type{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+    type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type.initialValue = 0;
+    VkSemaphoreCreateInfo si{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    si.pNext = &type;
+    if (vkCreateSemaphore(device, &si, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("FrameTimeline: failed to create timeline semaphore");
+    }
+    submitted = cachedCompleted = 0;
+}
+
+void FrameTimeline::destroy() {
+    if (!device) return;
+    if (timeline) {
+        vkDestroySemaphore(device, timeline, nullptr);
+        timeline = VK_NULL_HANDLE;
+    }
+    submitted = cachedCompleted = 0;
+    device = VK_NULL_HANDLE;
+}
+
+uint64_t FrameTimeline::completed() {
+    uint64_t v = 0;
+    if (vkGetSemaphoreCounterValue(device, timeline, &v) == VK_SUCCESS && v > cachedCompleted) {
+        cachedCompleted = v;
+    }
+    return cachedCompleted;
+}
+
+void FrameTimeline::wait(uint64_t value) {
+    if (value == 0 || value <= cachedCompleted) return;
+
+    VkSemaphoreWaitInfo wi{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+    wi.semaphoreCount = 1;
+    wi.pSemaphores = &timeline;
+    wi.pValues = &value;
+    if (vkWaitSemaphores(device, &wi, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("FrameTimeline: wait failed");
+    }
+    cachedCompleted = value;
+}
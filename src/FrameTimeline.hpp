@@ -0,0 +1,33 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// The engine's graphics-queue timeline.
+//
+// Every graphics submit signals the next value; anything that must outlive GPU use (per-frame
+// pools, uniforms, deferred deletions) remembers the value of the last submit that touched it
+// and checks isComplete() instead of owning a fence.
+class FrameTimeline {
+public:
+    void init(VkDevice dev);
+    void destroy();
+
+    // Value the upcoming submit will signal. Call once per submit.
+    uint64_t advance() { return ++submitted; }
+
+    uint64_t lastSubmitted() const { return submitted; }
+
+    // Refreshes the cached GPU value; cheap (no blocking).
+    uint64_t completed();
+    bool isComplete(uint64_t value) { return value <= cachedCompleted || value <= completed(); }
+
+    void wait(uint64_t value);
+
+    VkSemaphore semaphore() const { return timeline; }
+
+private:
+    VkDevice    device = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t    submitted = 0;
+    uint64_t    cachedCompleted = 0;
+};
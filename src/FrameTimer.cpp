@@ -0,0 +1,138 @@
+#include "FrameTimer.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+
+static const char* const kPhaseNames[FrameTimer::kPhaseCount] = {
+    "PresentWait", "FrameWait", "Acquire", "ImageWait", "Prepare", "Record", "Submit", "Present",
+};
+
+FrameTimer::FrameTimer() : epoch(Clock::now()), frameBegin(epoch), ring(kCapacity) {}
+
+const char* FrameTimer::phaseName(Phase p) {
+    const auto i = static_cast<uint32_t>(p);
+    return i < kPhaseCount ? kPhaseNames[i] : "";
+}
+
+void FrameTimer::beginFrame() {
+    frameBegin = Clock::now();
+    current.beginNs = std::chrono::duration_cast<std::chrono::nanoseconds>(frameBegin - epoch).count();
+    current.phaseBegin.fill(kNotRun);
+    current.phaseEnd.fill(kNotRun);
+    recording = true;
+}
+
+void FrameTimer::endFrame() {
+    if (!recording) return;
+    recording = false;
+    current.durationNs = sinceBegin();
+
+    // Single producer: the sequence goes odd, the sample is copied, then even again
+    const uint64_t n = published.load(std::memory_order_relaxed);
+    current.frame = n;
+    Slot& slot = ring[n % kCapacity];
+    const uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = current;
+    slot.sequence.store(seq + 2, std::memory_order_release);
+    published.store(n + 1, std::memory_order_release);
+}
+
+std::vector<FrameTimer::Sample> FrameTimer::snapshot(uint32_t frames) const {
+    const uint64_t end = published.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>({ frames, kCapacity, end });
+
+    std::vector<Sample> out;
+    out.reserve(count);
+    for (uint64_t i = end - count; i < end; ++i) {
+        const Slot& slot = ring[i % kCapacity];
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        Sample s = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before || s.frame != i) continue;   // overwritten
+        out.push_back(s);
+    }
+    return out;
+}
+
+template <class Fn>
+FrameTimer::Stats FrameTimer::collect(uint32_t frames, Fn&& durationNs) const {
+    std::vector<float> ms;
+    for (const Sample& s : snapshot(frames)) {
+        const uint32_t ns = durationNs(s);
+        if (ns != kNotRun) ms.push_back(static_cast<float>(ns) * 1e-6f);
+    }
+
+    Stats st;
+    st.samples = static_cast<uint32_t>(ms.size());
+    if (ms.empty()) return st;
+    std::sort(ms.begin(), ms.end());
+    auto pct = [&](float p) { return ms[static_cast<size_t>(p * static_cast<float>(ms.size() - 1) + 0.5f)]; };
+
+    double sum = 0.0;
+    for (float v : ms) sum += v;
+    st.avgMs = static_cast<float>(sum / static_cast<double>(ms.size()));
+    st.p50Ms = pct(0.50f);
+    st.p99Ms = pct(0.99f);
+    st.maxMs = ms.back();
+    return st;
+}
+
+FrameTimer::Stats FrameTimer::stats(Phase p, uint32_t frames) const {
+    const auto i = static_cast<uint32_t>(p);
+    return collect(frames, [i](const Sample& s) {
+        if (s.phaseBegin[i] == kNotRun || s.phaseEnd[i] == kNotRun) return kNotRun;
+        return s.phaseEnd[i] - s.phaseBegin[i];
+    });
+}
+
+FrameTimer::Stats FrameTimer::frameStats(uint32_t frames) const {
+    return collect(frames, [](const Sample& s) { return s.durationNs; });
+}
+
+const char* FrameTimer::bottleneck(uint32_t frames) const {
+    auto avg = [&](Phase p) { return stats(p, frames).avgMs; };
+    const float gpu = avg(Phase::FrameWait) + avg(Phase::ImageWait);
+    const float present = avg(Phase::PresentWait) + avg(Phase::Acquire) + avg(Phase::Present);
+    const float cpu = avg(Phase::Prepare) + avg(Phase::Record) + avg(Phase::Submit);
+    if (gpu >= present && gpu >= cpu) return "gpu";
+    if (present >= cpu) return "present";
+    return "cpu";
+}
+
+void FrameTimer::logReport(std::FILE* out, uint32_t frames) const {
+    const Stats total = frameStats(frames);
+    std::fprintf(out, "[FrameTimer] %u frames, %.3f ms avg, %.3f p99, %.3f max; bound: %s\n",
+        total.samples, total.avgMs, total.p99Ms, total.maxMs, bottleneck(frames));
+    for (uint32_t i = 0; i < kPhaseCount; ++i) {
+        const Stats s = stats(static_cast<Phase>(i), frames);
+        std::fprintf(out, "[FrameTimer]   %-10s p50 %8.3f  p99 %8.3f  max %8.3f ms\n",
+            kPhaseNames[i], s.p50Ms, s.p99Ms, s.maxMs);
+    }
+}
+
+bool FrameTimer::writeChromeTrace(const std::string& path) const {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    // Complete ("X") events in microseconds: one per frame, its phases nested inside
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    auto event = [&](const char* name, uint64_t frame, int64_t beginNs, uint32_t durationNs) {
+        std::fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%" PRIu64 "}}",
+            first ? "" : ",\n", name, static_cast<double>(beginNs) * 1e-3, static_cast<double>(durationNs) * 1e-3, frame);
+        first = false;
+    };
+    for (const Sample& s : snapshot(kCapacity)) {
+        event("Frame", s.frame, s.beginNs, s.durationNs);
+        for (uint32_t i = 0; i < kPhaseCount; ++i) {
+            if (s.phaseBegin[i] == kNotRun || s.phaseEnd[i] == kNotRun) continue;
+            event(kPhaseNames[i], s.frame, s.beginNs + s.phaseBegin[i], s.phaseEnd[i] - s.phaseBegin[i]);
+        }
+    }
+    std::fprintf(f, "\n]}\n");
+    return std::fclose(f) == 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// CPU timings of Renderer::drawFrame, split into the phases that can block.
+//
+// The render thread brackets each phase with beginPhase() / endPhase() between beginFrame() and
+// endFrame(); a frame abandoned before endFrame() (swapchain recreation) is dropped, and a phase
+// that didn't run counts as no sample. Finished frames go into a fixed ring, each slot guarded
+// by a sequence counter, so stats() / writeChromeTrace() may run on any thread without a lock:
+// a slot being rewritten while it is read is skipped. Recording costs two clock reads per
+// phase and no allocation.
+class FrameTimer {
+public:
+    enum class Phase : uint8_t {
+        PresentWait, // present pacing: an earlier frame reaching the display
+        FrameWait,   // frame slot's previous submit (the per-frame fence)
+        Acquire,     // vkAcquireNextImageKHR
+        ImageWait,   // another slot still owns the acquired image
+        Prepare,     // uniforms, draw list, indirect commands, upload flush
+        Record,      // command buffer recording, secondaries included
+        Submit,      // vkQueueSubmit2
+        Present,     // vkQueuePresentKHR
+        Count
+    };
+    static constexpr uint32_t kPhaseCount = static_cast<uint32_t>(Phase::Count);
+    static constexpr uint32_t kCapacity = 1024;   // frames kept
+
+    struct Stats {
+        uint32_t samples = 0;
+        float    avgMs = 0.f, p50Ms = 0.f, p99Ms = 0.f, maxMs = 0.f;
+    };
+
+    FrameTimer();
+
+    static const char* phaseName(Phase p);
+
+    void beginFrame();
+    void beginPhase(Phase p);
+    void endPhase(Phase p);
+    void endFrame();
+
+    // Over the newest `frames` finished frames (at most kCapacity)
+    Stats stats(Phase p, uint32_t frames = kCapacity) const;
+    Stats frameStats(uint32_t frames = kCapacity) const;
+    // "gpu" when the slot / image waits dominate, "present" for pacing + acquire + present, else "cpu"
+    const char* bottleneck(uint32_t frames = kCapacity) const;
+
+    void logReport(std::FILE* out, uint32_t frames = kCapacity) const;
+    // Chrome trace event JSON (chrome://tracing, ui.perfetto.dev); false if the file can't be written
+    bool writeChromeTrace(const std::string& path) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr uint32_t kNotRun = UINT32_MAX;
+
+    // Offsets in ns from the frame's begin
+    struct Sample {
+        uint64_t frame = 0;
+        int64_t  beginNs = 0;   // since epoch
+        uint32_t durationNs = 0;
+        std::array<uint32_t, kPhaseCount> phaseBegin{};
+        std::array<uint32_t, kPhaseCount> phaseEnd{};
+    };
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 };   // odd while being written
+        Sample                sample;
+    };
+
+    Clock::time_point     epoch;
+    Clock::time_point     frameBegin;
+    Sample                current;
+    bool                  recording = false;
+    std::vector<Slot>     ring;
+    std::atomic<uint64_t> published{ 0 };   // frames finished
+
+    uint32_t sinceBegin() const;
+    // Consistent copies of the newest frames, oldest first
+    std::vector<Sample> snapshot(uint32_t frames) const;
+    template <class Fn>
+    Stats collect(uint32_t frames, Fn&& durationNs) const;
+};
+
+// ---------------- Inline definitions ----------------
+
+inline uint32_t FrameTimer::sinceBegin() const {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frameBegin).count();
+    return static_cast<uint32_t>(std::min<int64_t>(ns, kNotRun - 1));
+}
+
+inline void FrameTimer::beginPhase(Phase p) {
+    if (recording) current.phaseBegin[static_cast<uint32_t>(p)] = sinceBegin();
+}
+
+inline void FrameTimer::endPhase(Phase p) {
+    if (recording) current.phaseEnd[static_cast<uint32_t>(p)] = sinceBegin();
+}
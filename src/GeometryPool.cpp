@@ -0,0 +1,346 @@
+#include "GeometryPool.hpp"
+#include "DeletionQueue.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static constexpr StagingUploader::BufferUse kVertexUse{
+    VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT };
+static constexpr StagingUploader::BufferUse kIndexUse{
+    VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT };
+
+void GeometryPool::init(VmaAllocator alloc, VkDevice dev, const VertexLayoutInfo& layout_,
+    uint32_t vertexCapacity, uint32_t indexCapacity, MemoryBudget* budget) {
+    allocator = alloc;
+    device = dev;
+    memory = budget;
+    layout = layout_;
+    vertexRanges.init(vertexCapacity);
+    indexRanges.init(indexCapacity);
+    createBuffers(vertices, vertexAllocs, indices, indexAlloc);
+}
+
+void GeometryPool::destroy() {
+    for (uint32_t s = 0; s < kMaxStreams; ++s) {
+        if (memory && vertexAllocs[s]) memory->untrack(vertexAllocs[s]);
+        if (vertices[s]) vmaDestroyBuffer(allocator, vertices[s], vertexAllocs[s]);
+    }
+    if (memory && indexAlloc) memory->untrack(indexAlloc);
+    if (indices) vmaDestroyBuffer(allocator, indices, indexAlloc);
+    vertices = {};
+    vertexAllocs = {};
+    indices = VK_NULL_HANDLE;
+    indexAlloc = VK_NULL_HANDLE;
+
+    slots.clear();
+    freeSlots.clear();
+    pendingFrees.clear();
+    vertexCopies.clear();
+    indexCopies.clear();
+    oldVertices = {};                            // owned by the deletion queue
+    oldIndices = VK_NULL_HANDLE;
+    allocator = VK_NULL_HANDLE;
+    device = VK_NULL_HANDLE;
+    memory = nullptr;
+}
+
+void GeometryPool::createBuffers(StreamBuffers& vb, StreamAllocs& va, VkBuffer& ib, VmaAllocation& ia) {
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    // TRANSFER_SRC so defragment() can copy out of them
+    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bi.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    for (uint32_t s = 0; s < layout.streamCount; ++s) {
+        bi.size = std::max<VkDeviceSize>(vertexRanges.capacity() * layout.streamStrides[s], 4);
+        if (vmaCreateBuffer(allocator, &bi, &aci, &vb[s], &va[s], nullptr) != VK_SUCCESS)
+            throw std::runtime_error("GeometryPool: failed to create vertex buffer");
+    }
+
+    bi.size = std::max<VkDeviceSize>(indexRanges.capacity() * sizeof(uint32_t), 4);
+    bi.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    if (vmaCreateBuffer(allocator, &bi, &aci, &ib, &ia, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("GeometryPool: failed to create index buffer");
+
+    if (memory) {
+        auto relocateFn = [this](const MemoryBudget::Relocation& r) { return relocate(r); };
+        for (uint32_t s = 0; s < layout.streamCount; ++s)
+            memory->track(va[s], MemoryBudget::Category::Geometry, relocateFn);
+        memory->track(ia, MemoryBudget::Category::Geometry, relocateFn);
+    }
+}
+
+bool GeometryPool::relocate(const MemoryBudget::Relocation& r) {
+    // A repack in flight still copies out of the current buffers
+    if (!vertexCopies.empty() || !indexCopies.empty()) return false;
+
+    VkBuffer* slot = nullptr;
+    VkBufferMemoryBarrier2 use{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    for (uint32_t s = 0; s < layout.streamCount && !slot; ++s) {
+        if (vertexAllocs[s] != r.allocation) continue;
+        slot = &vertices[s];
+        bi.size = std::max<VkDeviceSize>(vertexRanges.capacity() * layout.streamStrides[s], 4);
+        bi.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        use.srcStageMask = use.dstStageMask = kVertexUse.stage;
+        use.dstAccessMask = kVertexUse.access;
+    }
+    if (!slot && indexAlloc == r.allocation) {
+        slot = &indices;
+        bi.size = std::max<VkDeviceSize>(indexRanges.capacity() * sizeof(uint32_t), 4);
+        bi.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        use.srcStageMask = use.dstStageMask = kIndexUse.stage;
+        use.dstAccessMask = kIndexUse.access;
+    }
+    if (!slot) return false;
+
+    VkBuffer moved = VK_NULL_HANDLE;
+    if (vkCreateBuffer(device, &bi, nullptr, &moved) != VK_SUCCESS) return false;
+    if (vmaBindBufferMemory(allocator, r.target, moved) != VK_SUCCESS) {
+        vkDestroyBuffer(device, moved, nullptr);
+        return false;
+    }
+
+    // Earlier reads (and the uploader's acquires) -> copy -> vertex/index input again
+    std::array<VkBufferMemoryBarrier2, 2> pre{};
+    pre[0] = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+    pre[0].srcStageMask = use.srcStageMask;
+    pre[0].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    pre[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    pre[0].buffer = *slot;
+    pre[1] = pre[0];
+    pre[1].dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    pre[1].buffer = moved;
+    for (auto& x : pre) {
+        x.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.offset = 0;
+        x.size = VK_WHOLE_SIZE;
+    }
+    VkDependencyInfo preDep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    preDep.bufferMemoryBarrierCount = static_cast<uint32_t>(pre.size());
+    preDep.pBufferMemoryBarriers = pre.data();
+    vkCmdPipelineBarrier2(r.cmd, &preDep);
+
+    const VkBufferCopy whole{ 0, 0, bi.size };
+    vkCmdCopyBuffer(r.cmd, *slot, moved, 1, &whole);
+
+    use.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    use.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    use.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    use.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    use.buffer = moved;
+    use.offset = 0;
+    use.size = VK_WHOLE_SIZE;
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.bufferMemoryBarrierCount = 1;
+    dep.pBufferMemoryBarriers = &use;
+    vkCmdPipelineBarrier2(r.cmd, &dep);
+
+    // The allocation stays with us (VMA swaps its memory when the pass ends); only the old handle goes
+    r.deletion.deferBuffer(r.retireValue, *slot, VK_NULL_HANDLE);
+    *slot = moved;
+    return true;
+}
+
+GeometryPool::Handle GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount) {
+    const uint64_t v = vertexCount ? vertexRanges.allocate(vertexCount) : 0;
+    if (v == RangeAllocator::kInvalid) throw std::runtime_error("GeometryPool: out of vertex space");
+    const uint64_t i = indexCount ? indexRanges.allocate(indexCount) : 0;
+    if (i == RangeAllocator::kInvalid) {
+        vertexRanges.free(v, vertexCount);
+        throw std::runtime_error("GeometryPool: out of index space");
+    }
+
+    uint32_t id;
+    if (!freeSlots.empty()) { id = freeSlots.back(); freeSlots.pop_back(); }
+    else { id = static_cast<uint32_t>(slots.size()); slots.emplace_back(); }
+
+    Slot& s = slots[id];
+    s.range.vertexOffset = static_cast<int32_t>(v);
+    s.range.firstIndex = static_cast<uint32_t>(i);
+    s.range.vertexCount = vertexCount;
+    s.range.indexCount = indexCount;
+    s.live = true;
+    return Handle{ id };
+}
+
+void GeometryPool::free(Handle h, uint64_t retireValue) {
+    if (!h.valid() || h.id >= slots.size() || !slots[h.id].live)
+        throw std::runtime_error("GeometryPool: free of an invalid handle");
+    // Retiring later than necessary is always safe and keeps collect() FIFO (as DeletionQueue)
+    if (!pendingFrees.empty()) retireValue = std::max(retireValue, pendingFrees.back().value);
+
+    // In-flight frames may still draw from the ranges: keep them reserved until retired
+    slots[h.id].live = false;
+    pendingFrees.push_back({ retireValue, h.id });
+}
+
+void GeometryPool::collect(uint64_t completedValue) {
+    while (!pendingFrees.empty() && pendingFrees.front().value <= completedValue) {
+        releaseSlot(pendingFrees.front().slot);
+        pendingFrees.pop_front();
+    }
+}
+
+void GeometryPool::releaseSlot(uint32_t slot) {
+    Slot& s = slots[slot];
+    vertexRanges.free(static_cast<uint64_t>(s.range.vertexOffset), s.range.vertexCount);
+    indexRanges.free(s.range.firstIndex, s.range.indexCount);
+    s = Slot{};
+    freeSlots.push_back(slot);
+}
+
+StagingUploader::Ticket GeometryPool::upload(Handle h, StagingUploader& uploader,
+    const void* vertexData, const void* indexData, uint32_t indexSize) {
+    const Range& r = range(h);
+    StagingUploader::Ticket ticket{};
+
+    // Stream-major source: each stream is one contiguous run
+    const auto* src = static_cast<const unsigned char*>(vertexData);
+    for (uint32_t s = 0; s < layout.streamCount && r.vertexCount > 0; ++s) {
+        const VkDeviceSize stride = layout.streamStrides[s];
+        ticket = uploader.enqueue(src, VkDeviceSize(r.vertexCount) * stride,
+            vertices[s], VkDeviceSize(r.vertexOffset) * stride, kVertexUse);
+        src += VkDeviceSize(r.vertexCount) * stride;
+    }
+    if (r.indexCount == 0) return ticket;
+
+    const VkDeviceSize dstOffset = VkDeviceSize(r.firstIndex) * sizeof(uint32_t);
+    if (indexSize == 4) {
+        return uploader.enqueue(indexData, VkDeviceSize(r.indexCount) * sizeof(uint32_t), indices, dstOffset, kIndexUse);
+    }
+    if (indexSize != 2) throw std::runtime_error("GeometryPool: index size must be 2 or 4");
+
+    // Widen straight into ring memory, one chunk at a time
+    const auto* src16 = static_cast<const uint16_t*>(indexData);
+    const uint32_t perChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(uploader.maxChunkSize() / sizeof(uint32_t), ~0u));
+    for (uint32_t done = 0; done < r.indexCount; ) {
+        const uint32_t n = std::min(perChunk, r.indexCount - done);
+        StagingUploader::Allocation a = uploader.allocate(VkDeviceSize(n) * sizeof(uint32_t));
+        auto* dst = static_cast<uint32_t*>(a.ptr);
+        for (uint32_t k = 0; k < n; ++k) dst[k] = src16[done + k];
+        ticket = uploader.recordCopy(a, indices, dstOffset + VkDeviceSize(done) * sizeof(uint32_t), kIndexUse);
+        done += n;
+    }
+    return ticket;
+}
+
+float GeometryPool::fragmentation() const {
+    return std::max(vertexRanges.fragmentation(), indexRanges.fragmentation());
+}
+
+void GeometryPool::defragment(DeletionQueue& deletion, uint64_t retireValue) {
+    if (!vertexCopies.empty() || !indexCopies.empty()) return;   // previous pass not recorded yet
+
+    StreamBuffers newVertices{};
+    StreamAllocs newVertexAllocs{};
+    VkBuffer newIndices{};
+    VmaAllocation newIndexAlloc{};
+    createBuffers(newVertices, newVertexAllocs, newIndices, newIndexAlloc);
+
+    // Pack live meshes front to back in their current order (keeps locality)
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < slots.size(); ++i) if (slots[i].live) order.push_back(i);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return slots[a].range.vertexOffset < slots[b].range.vertexOffset;
+    });
+
+    vertexRanges.reset();
+    indexRanges.reset();
+    for (uint32_t id : order) {
+        Range& r = slots[id].range;
+        const uint64_t v = r.vertexCount ? vertexRanges.allocate(r.vertexCount) : 0;
+        const uint64_t i = r.indexCount ? indexRanges.allocate(r.indexCount) : 0;
+
+        if (r.vertexCount)
+            vertexCopies.push_back({ VkDeviceSize(r.vertexOffset), v, VkDeviceSize(r.vertexCount) });
+        if (r.indexCount)
+            indexCopies.push_back({ VkDeviceSize(r.firstIndex) * sizeof(uint32_t), i * sizeof(uint32_t),
+                VkDeviceSize(r.indexCount) * sizeof(uint32_t) });
+
+        r.vertexOffset = static_cast<int32_t>(v);
+        r.firstIndex = static_cast<uint32_t>(i);
+    }
+
+    // Meshes waiting to retire lived in the old buffers only: nothing left to free for them
+    for (const PendingFree& p : pendingFrees) slots[p.slot].range = Range{};
+
+    for (uint32_t s = 0; s < layout.streamCount; ++s) deletion.deferBuffer(retireValue, vertices[s], vertexAllocs[s]);
+    deletion.deferBuffer(retireValue, indices, indexAlloc);
+    oldVertices = vertices;
+    oldIndices = indices;
+    vertices = newVertices;   vertexAllocs = newVertexAllocs;
+    indices = newIndices;     indexAlloc = newIndexAlloc;
+}
+
+void GeometryPool::recordCopies(VkCommandBuffer cmd) {
+    if (vertexCopies.empty() && indexCopies.empty()) return;
+
+    // Chain onto the uploader's acquire barriers (vertex/index input scope) before reading
+    std::array<VkBufferMemoryBarrier2, kMaxStreams + 1> pre{};
+    for (auto& x : pre) {
+        x = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+        x.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        x.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+        x.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.offset = 0;
+        x.size = VK_WHOLE_SIZE;
+    }
+    for (uint32_t s = 0; s < layout.streamCount; ++s) {
+        pre[s].buffer = oldVertices[s];
+        pre[s].srcStageMask = kVertexUse.stage;
+    }
+    pre[layout.streamCount].buffer = oldIndices;
+    pre[layout.streamCount].srcStageMask = kIndexUse.stage;
+
+    VkDependencyInfo preDep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    preDep.bufferMemoryBarrierCount = layout.streamCount + 1;
+    preDep.pBufferMemoryBarriers = pre.data();
+    vkCmdPipelineBarrier2(cmd, &preDep);
+
+    // vertexCopies are in vertices; scale to bytes per stream
+    for (uint32_t s = 0; s < layout.streamCount && !vertexCopies.empty(); ++s) {
+        const VkDeviceSize stride = layout.streamStrides[s];
+        copyScratch.clear();
+        for (const VkBufferCopy& c : vertexCopies)
+            copyScratch.push_back({ c.srcOffset * stride, c.dstOffset * stride, c.size * stride });
+        vkCmdCopyBuffer(cmd, oldVertices[s], vertices[s], static_cast<uint32_t>(copyScratch.size()), copyScratch.data());
+    }
+    if (!indexCopies.empty())
+        vkCmdCopyBuffer(cmd, oldIndices, indices, static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+
+    std::array<VkBufferMemoryBarrier2, kMaxStreams + 1> b{};
+    for (auto& x : b) {
+        x = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+        x.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        x.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        x.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        x.offset = 0;
+        x.size = VK_WHOLE_SIZE;
+    }
+    for (uint32_t s = 0; s < layout.streamCount; ++s) {
+        b[s].buffer = vertices[s];
+        b[s].dstStageMask = kVertexUse.stage;
+        b[s].dstAccessMask = kVertexUse.access;
+    }
+    b[layout.streamCount].buffer = indices;
+    b[layout.streamCount].dstStageMask = kIndexUse.stage;
+    b[layout.streamCount].dstAccessMask = kIndexUse.access;
+
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.bufferMemoryBarrierCount = layout.streamCount + 1;
+    dep.pBufferMemoryBarriers = b.data();
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    vertexCopies.clear();
+    indexCopies.clear();
+    oldVertices = {};
+    oldIndices = VK_NULL_HANDLE;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <array>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+#include "MemoryBudget.hpp"
+#include "RangeAllocator.hpp"
+#include "StagingUploader.hpp"
+#include "VertexLayout.hpp"
+
+class DeletionQueue;
+
+// Shared device-local vertex + index buffers for every loaded mesh.
+//
+// Meshes get a vertex range and an index range from two RangeAllocators and are drawn with
+// vertexOffset/firstIndex into the shared buffers, so a frame binds geometry once. Indices
+// are always 32-bit in the pool; 16-bit sources are widened while being written to staging.
+// Each vertex stream of the layout (e.g. positions / attributes) has its own buffer; one
+// vertex range covers the same vertices in all of them.
+//
+// Handles stay stable across defragment(): it repacks every live mesh into fresh buffers
+// and only the offsets returned by range() change. With a MemoryBudget the buffers are tracked
+// as geometry and VMA defragmentation may move them whole (relocate()).
+class GeometryPool {
+public:
+    static constexpr VkIndexType kIndexType = VK_INDEX_TYPE_UINT32;
+
+    struct Handle {
+        uint32_t id = ~0u;
+        [[nodiscard]] bool valid() const { return id != ~0u; }
+    };
+
+    struct Range {
+        int32_t  vertexOffset = 0;  // in vertices (vkCmdDrawIndexed vertexOffset)
+        uint32_t firstIndex = 0;    // in indices
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    void init(VmaAllocator alloc, VkDevice dev, const VertexLayoutInfo& layout,
+        uint32_t vertexCapacity, uint32_t indexCapacity, MemoryBudget* budget = nullptr);
+    void destroy();   // immediate; the device must be idle
+
+    // Reserve space for a mesh. Throws if either buffer is out of space.
+    Handle allocate(uint32_t vertexCount, uint32_t indexCount);
+    // The ranges become reusable once retireValue (a FrameTimeline value) completes; a value
+    // lower than the last one freed is raised to it.
+    void free(Handle h, uint64_t retireValue);
+    void collect(uint64_t completedValue);
+
+    // Stream a mesh's data through the staging ring. vertices is stream-major (all of stream 0,
+    // then stream 1...), as in a .pmesh vertex blob. indexSize is 2 or 4.
+    StagingUploader::Ticket upload(Handle h, StagingUploader& uploader,
+        const void* vertices, const void* indices, uint32_t indexSize);
+
+    const Range& range(Handle h) const { return slots[h.id].range; }
+
+    uint32_t        streamCount() const { return layout.streamCount; }
+    const VkBuffer* vertexBuffers() const { return vertices.data(); }   // streamCount() entries
+    VkBuffer        indexBuffer() const { return indices; }
+
+    // Worse of the two buffers, see RangeAllocator::fragmentation()
+    float fragmentation() const;
+
+    // Repack all live meshes into new buffers. Offsets change immediately (CPU side); the
+    // copies are recorded by recordCopies() into the submit that signals retireValue, which is
+    // also when the old buffers are released. Uploads already queued into the old buffers are
+    // copied across too, so they must be flushed before that submit's recordAcquireBarriers().
+    void defragment(DeletionQueue& deletion, uint64_t retireValue);
+    // Records pending defragment copies + the barrier to vertex/index input (no-op if none).
+    void recordCopies(VkCommandBuffer cmd);
+
+private:
+    static constexpr uint32_t kMaxStreams = VertexLayoutInfo::kMaxStreams;
+    using StreamBuffers = std::array<VkBuffer, kMaxStreams>;
+    using StreamAllocs = std::array<VmaAllocation, kMaxStreams>;
+
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    VertexLayoutInfo layout{};
+
+    StreamBuffers vertices{};
+    StreamAllocs  vertexAllocs{};
+    VkBuffer      indices = VK_NULL_HANDLE;
+    VmaAllocation indexAlloc = VK_NULL_HANDLE;
+
+    RangeAllocator vertexRanges;   // in vertices
+    RangeAllocator indexRanges;    // in indices
+
+    struct Slot {
+        Range range;
+        bool  live = false;
+    };
+    std::vector<Slot>     slots;
+    std::vector<uint32_t> freeSlots;
+
+    struct PendingFree {
+        uint64_t value;
+        uint32_t slot;
+    };
+    std::deque<PendingFree> pendingFrees;   // non-decreasing values
+
+    // Defragment copies waiting for recordCopies(); vertex copies are in vertices
+    StreamBuffers oldVertices{};
+    VkBuffer      oldIndices = VK_NULL_HANDLE;
+    std::vector<VkBufferCopy> vertexCopies;
+    std::vector<VkBufferCopy> indexCopies;
+    std::vector<VkBufferCopy> copyScratch;
+
+    void createBuffers(StreamBuffers& vb, StreamAllocs& va, VkBuffer& ib, VmaAllocation& ia);
+    void releaseSlot(uint32_t slot);
+    // MemoryBudget move of one of the buffers: copy into a buffer on r.target, swap handles
+    bool relocate(const MemoryBudget::Relocation& r);
+};
@@ -0,0 +1,450 @@
+#include "GpuCulling.hpp"
+#include "ComputePipelineBuilder.hpp"
+#include "DeletionQueue.hpp"
+#include "MemoryBudget.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// std430 mirror of CullParams in cull.comp (112 bytes, within the guaranteed 128)
+struct CullPush {
+    float    planes[6][4];
+    float    pyramidSize[2];
+    uint32_t instanceCount;
+    uint32_t occlusion;
+};
+
+uint32_t previousPow2(uint32_t v) {
+    uint32_t r = 1;
+    while (r * 2 <= v) r *= 2;
+    return r;
+}
+
+// Gribb/Hartmann plane extraction from a column-major view-projection (depth 0..1).
+void extractFrustum(const float m[16], float planes[6][4]) {
+    auto row = [&](int r, float out[4]) {
+        for (int c = 0; c < 4; ++c) out[c] = m[c * 4 + r];
+    };
+    float r0[4], r1[4], r2[4], r3[4];
+    row(0, r0); row(1, r1); row(2, r2); row(3, r3);
+
+    for (int i = 0; i < 4; ++i) {
+        planes[0][i] = r3[i] + r0[i];  // left
+        planes[1][i] = r3[i] - r0[i];  // right
+        planes[2][i] = r3[i] + r1[i];  // bottom
+        planes[3][i] = r3[i] - r1[i];  // top
+        planes[4][i] = r2[i];          // near (z >= 0)
+        planes[5][i] = r3[i] - r2[i];  // far
+    }
+    for (int p = 0; p < 6; ++p) {
+        const float len = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if (len > 0.f) for (int i = 0; i < 4; ++i) planes[p][i] /= len;
+    }
+}
+
+VkBufferMemoryBarrier2 bufferBarrier(VkBuffer buffer,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+    VkBufferMemoryBarrier2 b{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+    b.srcStageMask = srcStage;
+    b.srcAccessMask = srcAccess;
+    b.dstStageMask = dstStage;
+    b.dstAccessMask = dstAccess;
+    b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.buffer = buffer;
+    b.offset = 0;
+    b.size = VK_WHOLE_SIZE;
+    return b;
+}
+
+VkImageMemoryBarrier2 imageBarrier(VkImage image, VkImageAspectFlags aspect,
+    uint32_t baseLevel, uint32_t levels,
+    VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkImageLayout oldLayout,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, VkImageLayout newLayout) {
+    VkImageMemoryBarrier2 b{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    b.srcStageMask = srcStage;
+    b.srcAccessMask = srcAccess;
+    b.dstStageMask = dstStage;
+    b.dstAccessMask = dstAccess;
+    b.oldLayout = oldLayout;
+    b.newLayout = newLayout;
+    b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.image = image;
+    b.subresourceRange.aspectMask = aspect;
+    b.subresourceRange.baseMipLevel = baseLevel;
+    b.subresourceRange.levelCount = levels;
+    b.subresourceRange.baseArrayLayer = 0;
+    b.subresourceRange.layerCount = 1;
+    return b;
+}
+
+} // namespace
+
+bool GpuCulling::supportsOcclusion(VkPhysicalDevice phys, VkFormat depthFormat, bool samplerFilterMinmax) {
+    if (!samplerFilterMinmax) return false;
+
+    const VkFormatFeatureFlags need = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_MINMAX_BIT;
+
+    VkFormatProperties depthProps{};
+    vkGetPhysicalDeviceFormatProperties(phys, depthFormat, &depthProps);
+    VkFormatProperties r32Props{};
+    vkGetPhysicalDeviceFormatProperties(phys, VK_FORMAT_R32_SFLOAT, &r32Props);
+
+    return (depthProps.optimalTilingFeatures & need) == need &&
+        (r32Props.optimalTilingFeatures & need) == need &&
+        (r32Props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+}
+
+void GpuCulling::init(VkDevice dev, VmaAllocator alloc, VkPipelineCache cache,
+    VkShaderModule cullModule, VkShaderModule hizModule,
+    uint32_t framesInFlight, bool occlusion_, MemoryBudget* budget, const QueueSharing& queueSharing) {
+    device = dev;
+    allocator = alloc;
+    memory = budget;
+    sharing = queueSharing;
+    occlusion = occlusion_ && hizModule != VK_NULL_HANDLE;
+    frames.assign(framesInFlight, FrameBuffers{});
+
+    // --- Cull set: frame UBO, instances, inputs, commands, count, pyramid ---
+    {
+        std::array<VkDescriptorSetLayoutBinding, 6> b{};
+        const VkDescriptorType types[6] = {
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+        };
+        for (uint32_t i = 0; i < b.size(); ++i) {
+            b[i].binding = i;
+            b[i].descriptorType = types[i];
+            b[i].descriptorCount = 1;
+            b[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        info.bindingCount = static_cast<uint32_t>(b.size());
+        info.pBindings = b.data();
+        if (vkCreateDescriptorSetLayout(device, &info, nullptr, &cullSetLayout) != VK_SUCCESS)
+            throw std::runtime_error("GpuCulling: failed to create cull set layout");
+
+        VkPushConstantRange pc{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush) };
+        VkPipelineLayoutCreateInfo li{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        li.setLayoutCount = 1;
+        li.pSetLayouts = &cullSetLayout;
+        li.pushConstantRangeCount = 1;
+        li.pPushConstantRanges = &pc;
+        if (vkCreatePipelineLayout(device, &li, nullptr, &cullLayout) != VK_SUCCESS)
+            throw std::runtime_error("GpuCulling: failed to create cull pipeline layout");
+
+        cullPipeline = ComputePipelineBuilder{}
+            .setShader(cullModule)
+            .setLayout(cullLayout)
+            .setPipelineCache(cache)
+            .build(device);
+    }
+
+    // --- Hi-Z set: source level (sampler), destination level (storage image) ---
+    if (occlusion) {
+        std::array<VkDescriptorSetLayoutBinding, 2> b{};
+        b[0].binding = 0; b[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        b[1].binding = 1; b[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        for (auto& x : b) { x.descriptorCount = 1; x.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT; }
+
+        VkDescriptorSetLayoutCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+        info.bindingCount = static_cast<uint32_t>(b.size());
+        info.pBindings = b.data();
+        if (vkCreateDescriptorSetLayout(device, &info, nullptr, &hizSetLayout) != VK_SUCCESS)
+            throw std::runtime_error("GpuCulling: failed to create hiz set layout");
+
+        VkPushConstantRange pc{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float) * 2 };
+        VkPipelineLayoutCreateInfo li{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+        li.setLayoutCount = 1;
+        li.pSetLayouts = &hizSetLayout;
+        li.pushConstantRangeCount = 1;
+        li.pPushConstantRanges = &pc;
+        if (vkCreatePipelineLayout(device, &li, nullptr, &hizLayout) != VK_SUCCESS)
+            throw std::runtime_error("GpuCulling: failed to create hiz pipeline layout");
+
+        hizPipeline = ComputePipelineBuilder{}
+            .setShader(hizModule)
+            .setLayout(hizLayout)
+            .setPipelineCache(cache)
+            .build(device);
+    }
+
+    // --- Pyramid sampler: max reduction so one fetch = farthest depth of the footprint ---
+    VkSamplerReductionModeCreateInfo reduction{ VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO };
+    reduction.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+
+    VkSamplerCreateInfo si{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    si.pNext = occlusion ? &reduction : nullptr;
+    si.magFilter = VK_FILTER_LINEAR;
+    si.minFilter = VK_FILTER_LINEAR;
+    si.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    si.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.minLod = 0.f;
+    si.maxLod = 16.f;
+    if (vkCreateSampler(device, &si, nullptr, &pyramidSampler) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to create pyramid sampler");
+}
+
+void GpuCulling::destroy() {
+    if (!device) return;
+
+    for (auto v : levelViews) vkDestroyImageView(device, v, nullptr);
+    levelViews.clear();
+    if (pyramidView) vkDestroyImageView(device, pyramidView, nullptr);
+    if (memory && pyramidAlloc) memory->untrack(pyramidAlloc);
+    if (pyramid) vmaDestroyImage(allocator, pyramid, pyramidAlloc);
+    pyramidView = VK_NULL_HANDLE;
+    pyramid = VK_NULL_HANDLE;
+    pyramidAlloc = VK_NULL_HANDLE;
+
+    if (setPool) vkDestroyDescriptorPool(device, setPool, nullptr);
+    setPool = VK_NULL_HANDLE;
+    cullSets.clear();
+    hizSets.clear();
+
+    if (pyramidSampler) vkDestroySampler(device, pyramidSampler, nullptr);
+    if (hizPipeline) vkDestroyPipeline(device, hizPipeline, nullptr);
+    if (cullPipeline) vkDestroyPipeline(device, cullPipeline, nullptr);
+    if (hizLayout) vkDestroyPipelineLayout(device, hizLayout, nullptr);
+    if (cullLayout) vkDestroyPipelineLayout(device, cullLayout, nullptr);
+    if (hizSetLayout) vkDestroyDescriptorSetLayout(device, hizSetLayout, nullptr);
+    if (cullSetLayout) vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+    pyramidSampler = VK_NULL_HANDLE;
+    hizPipeline = cullPipeline = VK_NULL_HANDLE;
+    hizLayout = cullLayout = VK_NULL_HANDLE;
+    hizSetLayout = cullSetLayout = VK_NULL_HANDLE;
+
+    frames.clear();
+    device = VK_NULL_HANDLE;
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+}
+
+void GpuCulling::setFrameBuffers(uint32_t frame, const FrameBuffers& buffers) {
+    frames.at(frame) = buffers;
+}
+
+void GpuCulling::createPyramid(VkExtent2D depthExtent) {
+    // Power-of-two base keeps every level an exact 2x2 reduction of the one above.
+    // Without occlusion a 1x1 placeholder satisfies the cull set's sampler binding.
+    if (occlusion) {
+        pyramidExtent = { previousPow2(std::max(depthExtent.width, 1u)), previousPow2(std::max(depthExtent.height, 1u)) };
+        levelCount = 1;
+        for (uint32_t s = std::max(pyramidExtent.width, pyramidExtent.height); s > 1; s /= 2) ++levelCount;
+    }
+    else {
+        pyramidExtent = { 1, 1 };
+        levelCount = 1;
+    }
+
+    VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.extent = { pyramidExtent.width, pyramidExtent.height, 1 };
+    info.mipLevels = levelCount;
+    info.arrayLayers = 1;
+    info.format = VK_FORMAT_R32_SFLOAT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    sharing.apply(info);
+
+    VmaAllocationCreateInfo ai{};
+    ai.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    if (vmaCreateImage(allocator, &info, &ai, &pyramid, &pyramidAlloc, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to create depth pyramid");
+    if (memory) memory->track(pyramidAlloc, MemoryBudget::Category::RenderTargets);
+
+    VkImageViewCreateInfo view{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    view.image = pyramid;
+    view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view.format = VK_FORMAT_R32_SFLOAT;
+    view.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view.subresourceRange.baseMipLevel = 0;
+    view.subresourceRange.levelCount = levelCount;
+    view.subresourceRange.baseArrayLayer = 0;
+    view.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(device, &view, nullptr, &pyramidView) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to create pyramid view");
+
+    levelViews.assign(occlusion ? levelCount : 0, VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < levelViews.size(); ++i) {
+        view.subresourceRange.baseMipLevel = i;
+        view.subresourceRange.levelCount = 1;
+        if (vkCreateImageView(device, &view, nullptr, &levelViews[i]) != VK_SUCCESS)
+            throw std::runtime_error("GpuCulling: failed to create pyramid level view");
+    }
+
+    pyramidValid = false;
+}
+
+void GpuCulling::writeSets(VkImageView depthView) {
+    const uint32_t frameCount = static_cast<uint32_t>(frames.size());
+    const uint32_t hizCount = static_cast<uint32_t>(levelViews.size());
+
+    std::array<VkDescriptorPoolSize, 4> sizes{ {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameCount },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         frameCount * 4 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount + hizCount },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          std::max(hizCount, 1u) },
+    } };
+    VkDescriptorPoolCreateInfo pi{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    pi.maxSets = frameCount + hizCount;
+    pi.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    pi.pPoolSizes = sizes.data();
+    if (vkCreateDescriptorPool(device, &pi, nullptr, &setPool) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to create descriptor pool");
+
+    // --- Cull sets ---
+    std::vector<VkDescriptorSetLayout> layouts(frameCount, cullSetLayout);
+    cullSets.assign(frameCount, VK_NULL_HANDLE);
+    VkDescriptorSetAllocateInfo ai{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    ai.descriptorPool = setPool;
+    ai.descriptorSetCount = frameCount;
+    ai.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(device, &ai, cullSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to allocate cull sets");
+
+    VkDescriptorImageInfo pyramidInfo{ pyramidSampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+    for (uint32_t f = 0; f < frameCount; ++f) {
+        const FrameBuffers& fb = frames[f];
+        const VkDescriptorBufferInfo bufs[5] = {
+            { fb.frameUbo,  0, fb.uboRange },
+            { fb.instances, 0, VK_WHOLE_SIZE },
+            { fb.inputs,    0, VK_WHOLE_SIZE },
+            { fb.commands,  0, VK_WHOLE_SIZE },
+            { fb.count,     0, VK_WHOLE_SIZE },
+        };
+        std::array<VkWriteDescriptorSet, 6> w{};
+        for (uint32_t i = 0; i < w.size(); ++i) {
+            w[i] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+            w[i].dstSet = cullSets[f];
+            w[i].dstBinding = i;
+            w[i].descriptorCount = 1;
+            if (i < 5) {
+                w[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                w[i].pBufferInfo = &bufs[i];
+            }
+            else {
+                w[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                w[i].pImageInfo = &pyramidInfo;
+            }
+        }
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(w.size()), w.data(), 0, nullptr);
+    }
+
+    // --- Hi-Z sets: level i reads level i-1 (level 0 reads the depth buffer) ---
+    hizSets.assign(hizCount, VK_NULL_HANDLE);
+    if (hizCount == 0) return;
+
+    layouts.assign(hizCount, hizSetLayout);
+    ai.descriptorSetCount = hizCount;
+    ai.pSetLayouts = layouts.data();
+    if (vkAllocateDescriptorSets(device, &ai, hizSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("GpuCulling: failed to allocate hiz sets");
+
+    for (uint32_t i = 0; i < hizCount; ++i) {
+        VkDescriptorImageInfo src{ pyramidSampler,
+            i == 0 ? depthView : levelViews[i - 1],
+            i == 0 ? VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL };
+        VkDescriptorImageInfo dst{ VK_NULL_HANDLE, levelViews[i], VK_IMAGE_LAYOUT_GENERAL };
+
+        std::array<VkWriteDescriptorSet, 2> w{};
+        w[0] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        w[0].dstSet = hizSets[i];
+        w[0].dstBinding = 0;
+        w[0].descriptorCount = 1;
+        w[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        w[0].pImageInfo = &src;
+        w[1] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        w[1].dstSet = hizSets[i];
+        w[1].dstBinding = 1;
+        w[1].descriptorCount = 1;
+        w[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        w[1].pImageInfo = &dst;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(w.size()), w.data(), 0, nullptr);
+    }
+}
+
+void GpuCulling::resize(VkImageView depthView, VkExtent2D depthExtent, DeletionQueue& deletion, uint64_t retireValue) {
+    // In-flight frames may still sample the old pyramid through the old sets
+    for (auto v : levelViews) deletion.deferImageView(retireValue, v);
+    levelViews.clear();
+    deletion.deferImageView(retireValue, pyramidView);
+    deletion.deferImage(retireValue, pyramid, pyramidAlloc);
+    deletion.deferDescriptorPool(retireValue, setPool);
+    pyramidView = VK_NULL_HANDLE;
+    pyramid = VK_NULL_HANDLE;
+    pyramidAlloc = VK_NULL_HANDLE;
+    setPool = VK_NULL_HANDLE;
+
+    createPyramid(depthExtent);
+    writeSets(depthView);
+}
+
+void GpuCulling::recordCull(VkCommandBuffer cmd, uint32_t frame, const float viewProj[16], uint32_t instanceCount,
+    uint32_t uboOffset) {
+    const FrameBuffers& fb = frames[frame];
+
+    // --- Reset the draw count ---
+    vkCmdFillBuffer(cmd, fb.count, 0, sizeof(uint32_t), 0);
+    {
+        VkBufferMemoryBarrier2 b = bufferBarrier(fb.count,
+            VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+        dep.bufferMemoryBarrierCount = 1;
+        dep.pBufferMemoryBarriers = &b;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    // --- Cull ---
+    CullPush push{};
+    extractFrustum(viewProj, push.planes);
+    push.pyramidSize[0] = static_cast<float>(pyramidExtent.width);
+    push.pyramidSize[1] = static_cast<float>(pyramidExtent.height);
+    push.instanceCount = instanceCount;
+    push.occlusion = (occlusion && pyramidValid) ? 1u : 0u;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &cullSets[frame], 1, &uboOffset);
+    vkCmdPushConstants(cmd, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    if (instanceCount > 0) vkCmdDispatch(cmd, (instanceCount + 63) / 64, 1, 1);
+}
+
+void GpuCulling::recordDepthPyramid(VkCommandBuffer cmd) {
+    if (!occlusion) return;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, hizPipeline);
+
+    uint32_t w = pyramidExtent.width, h = pyramidExtent.height;
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        const float size[2] = { static_cast<float>(w), static_cast<float>(h) };
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, hizLayout, 0, 1, &hizSets[i], 0, nullptr);
+        vkCmdPushConstants(cmd, hizLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(size), size);
+        vkCmdDispatch(cmd, (w + 7) / 8, (h + 7) / 8, 1);
+
+        // Level i becomes the next level's source (and next frame's cull input)
+        VkImageMemoryBarrier2 b = imageBarrier(pyramid, VK_IMAGE_ASPECT_COLOR_BIT, i, 1,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+        VkDependencyInfo d{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+        d.imageMemoryBarrierCount = 1;
+        d.pImageMemoryBarriers = &b;
+        vkCmdPipelineBarrier2(cmd, &d);
+
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    pyramidValid = true;
+}
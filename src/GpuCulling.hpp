@@ -0,0 +1,100 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include <cstdint>
+
+#include "QueueSharing.hpp"
+
+class DeletionQueue;
+class MemoryBudget;
+
+// Compute culling stage for the indirect path.
+//
+// recordCull() tests every instance's bounding sphere against the view frustum and, when the
+// depth pyramid is available, against last frame's depth (Hi-Z), then compacts the survivors
+// into the frame's indirect + count buffers. recordDepthPyramid() rebuilds the max-depth
+// pyramid from the depth buffer after the frame's rendering, for use by the next frame.
+// Barriers between the stages and the draw pass are the render graph's: cull writes commands +
+// count and samples the pyramid (GENERAL), the pyramid build samples depth
+// (DEPTH_READ_ONLY_OPTIMAL) and writes every pyramid level (GENERAL).
+class GpuCulling {
+public:
+    // std430 mirror of CullInput in cull.comp
+    struct CullInput {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t  vertexOffset;
+        uint32_t instance;    // transform index; becomes the command's firstInstance
+        float    sphere[4];   // object-space center xyz + radius
+    };
+
+    // Per-frame-in-flight buffers the cull shader binds
+    struct FrameBuffers {
+        VkBuffer     frameUbo = VK_NULL_HANDLE;   // bound UNIFORM_BUFFER_DYNAMIC, see recordCull()
+        VkDeviceSize uboRange = 0;
+        VkBuffer     instances = VK_NULL_HANDLE;
+        VkBuffer     inputs = VK_NULL_HANDLE;
+        VkBuffer     commands = VK_NULL_HANDLE;
+        VkBuffer     count = VK_NULL_HANDLE;
+    };
+
+    // Hi-Z needs min/max reduction sampling of the depth format and of R32_SFLOAT.
+    static bool supportsOcclusion(VkPhysicalDevice phys, VkFormat depthFormat, bool samplerFilterMinmax);
+
+    void init(VkDevice dev, VmaAllocator alloc, VkPipelineCache cache,
+        VkShaderModule cullModule, VkShaderModule hizModule,
+        uint32_t framesInFlight, bool occlusion, MemoryBudget* budget = nullptr, const QueueSharing& sharing = {});
+    void destroy();
+
+    void setFrameBuffers(uint32_t frame, const FrameBuffers& buffers);
+
+    // (Re)build the pyramid and all descriptor sets for the current depth buffer. Old objects are
+    // handed to the deletion queue at retireValue.
+    void resize(VkImageView depthView, VkExtent2D depthExtent, DeletionQueue& deletion, uint64_t retireValue);
+
+    // Before rendering: clear count, cull into commands + count.
+    // uboOffset: dynamic offset of this frame's UBO within frameUbo.
+    void recordCull(VkCommandBuffer cmd, uint32_t frame, const float viewProj[16], uint32_t instanceCount,
+        uint32_t uboOffset);
+
+    // After rendering: depth -> pyramid, level by level.
+    void recordDepthPyramid(VkCommandBuffer cmd);
+
+    bool     occlusionEnabled() const { return occlusion; }
+    VkImage  pyramidImage() const { return pyramid; }
+    uint32_t pyramidLevels() const { return levelCount; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;   // pyramid counts as a render target
+    QueueSharing  sharing;            // pyramid: cull may run on the compute queue
+    bool occlusion = false;
+
+    VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout hizSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout      cullLayout = VK_NULL_HANDLE;
+    VkPipelineLayout      hizLayout = VK_NULL_HANDLE;
+    VkPipeline            cullPipeline = VK_NULL_HANDLE;
+    VkPipeline            hizPipeline = VK_NULL_HANDLE;
+    VkSampler             pyramidSampler = VK_NULL_HANDLE;  // max reduction when occlusion is on
+
+    std::vector<FrameBuffers> frames;
+
+    // Swapchain-sized state, rebuilt by resize()
+    VkImage                  pyramid = VK_NULL_HANDLE;
+    VmaAllocation            pyramidAlloc = VK_NULL_HANDLE;
+    VkImageView              pyramidView = VK_NULL_HANDLE;   // all levels, sampled by cull
+    std::vector<VkImageView> levelViews;                     // one per level, hiz src/dst
+    VkExtent2D               pyramidExtent{};
+    uint32_t                 levelCount = 0;
+    bool                     pyramidValid = false;           // holds a previous frame's depth
+
+    VkDescriptorPool             setPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> cullSets;   // per frame in flight
+    std::vector<VkDescriptorSet> hizSets;    // per pyramid level
+
+    void createPyramid(VkExtent2D depthExtent);
+    void writeSets(VkImageView depthView);
+};
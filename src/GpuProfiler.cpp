@@ -0,0 +1,284 @@
+#include "GpuProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Result order follows the flag bits
+static constexpr VkQueryPipelineStatisticFlags kStatisticFlags =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+static const char* const kStatisticNames[GpuProfiler::kStatisticCount] = {
+    "ia_vertices", "ia_primitives", "vs_invocations", "clip_invocations", "clip_primitives",
+    "fs_invocations", "cs_invocations",
+};
+
+const char* GpuProfiler::statisticName(uint32_t i) {
+    return i < kStatisticCount ? kStatisticNames[i] : "";
+}
+
+void GpuProfiler::init(VkPhysicalDevice phys, VkDevice dev, uint32_t queueFamily, uint32_t framesInFlight,
+    const Config& cfg) {
+    if constexpr (!kCompiled) return;
+    device = dev;
+    config = cfg;
+    config.maxScopes = std::max(config.maxScopes, 1u);
+    config.historyFrames = std::max(config.historyFrames, 1u);
+    startTime = lastDump = std::chrono::steady_clock::now();
+
+    // Labels only exist with debug utils; null otherwise
+    pBeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetDeviceProcAddr(device, "vkCmdBeginDebugUtilsLabelEXT");
+    pEndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetDeviceProcAddr(device, "vkCmdEndDebugUtilsLabelEXT");
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(phys, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(phys, &familyCount, families.data());
+    timestampBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0u;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(phys, &props);
+    timestampPeriod = props.limits.timestampPeriod;
+
+    frames.assign(framesInFlight, FrameQueries{});
+    if (timestampBits == 0) return;   // labels still work
+
+    statisticFlags = config.statistics ? kStatisticFlags : 0;
+    for (FrameQueries& f : frames) {
+        VkQueryPoolCreateInfo qi{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+        qi.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        qi.queryCount = config.maxScopes * 2;
+        if (vkCreateQueryPool(device, &qi, nullptr, &f.timestamps) != VK_SUCCESS)
+            throw std::runtime_error("GpuProfiler: failed to create timestamp query pool");
+
+        if (statisticFlags) {
+            qi.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            qi.queryCount = config.maxScopes;
+            qi.pipelineStatistics = statisticFlags;
+            if (vkCreateQueryPool(device, &qi, nullptr, &f.statistics) != VK_SUCCESS)
+                throw std::runtime_error("GpuProfiler: failed to create pipeline statistics query pool");
+        }
+        f.records.reserve(config.maxScopes);
+    }
+}
+
+void GpuProfiler::destroy() {
+    for (FrameQueries& f : frames) {
+        if (f.timestamps) vkDestroyQueryPool(device, f.timestamps, nullptr);
+        if (f.statistics) vkDestroyQueryPool(device, f.statistics, nullptr);
+    }
+    frames.clear();
+    if (csv) std::fclose(csv);
+    csv = nullptr;
+    active = kNoFrame;
+    device = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::setDump(double intervalSeconds, const std::string& csvPath) {
+    if constexpr (!kCompiled) return;
+    dumpInterval = intervalSeconds;
+    if (csv) std::fclose(csv);
+    csv = nullptr;
+    if (csvPath.empty()) return;
+
+    csv = std::fopen(csvPath.c_str(), "w");
+    if (!csv) throw std::runtime_error("GpuProfiler: cannot open " + csvPath);
+    std::fprintf(csv, "time_s,scope,depth,samples,avg_ms,min_ms,max_ms,p50_ms,p95_ms,p99_ms");
+    for (uint32_t i = 0; i < kStatisticCount; ++i) std::fprintf(csv, ",%s", kStatisticNames[i]);
+    std::fprintf(csv, "\n");
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frame) {
+    if constexpr (!kCompiled) return;
+    FrameQueries& f = frames.at(frame);
+
+    // The slot's previous submit has retired: its queries are available
+    if (!f.records.empty()) readBack(f);
+    f.records.clear();
+    f.statisticsUsed = 0;
+
+    if (dumpInterval > 0.0 &&
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - lastDump).count() >= dumpInterval)
+        dump();
+
+    depth = 0;
+    statisticsOpen = false;
+    active = isEnabled() ? frame : kNoFrame;
+    if (active != kNoFrame) {
+        vkCmdResetQueryPool(cmd, f.timestamps, 0, config.maxScopes * 2);
+        if (f.statistics) vkCmdResetQueryPool(cmd, f.statistics, 0, config.maxScopes);
+    }
+    beginScope(cmd, "Frame", false);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer cmd) {
+    if constexpr (!kCompiled) return;
+    endScope(cmd, active != kNoFrame && !frames[active].records.empty() ? 0u : kNoScope);
+    active = kNoFrame;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char* name, bool statistics) {
+    if (pBeginLabel) {
+        VkDebugUtilsLabelEXT label{ VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT };
+        label.pLabelName = name;
+        pBeginLabel(cmd, &label);
+    }
+    if (active == kNoFrame) return kNoScope;
+
+    FrameQueries& f = frames[active];
+    if (f.records.size() >= config.maxScopes) return kNoScope;   // over budget: label only
+
+    const auto index = static_cast<uint32_t>(f.records.size());
+    Record r{ name, depth++, kNoScope };
+    if (statistics && f.statistics && !statisticsOpen) {
+        r.statisticsQuery = f.statisticsUsed++;
+        vkCmdBeginQuery(cmd, f.statistics, r.statisticsQuery, 0);
+        statisticsOpen = true;
+    }
+    f.records.push_back(r);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, f.timestamps, index * 2);
+    return index;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope) {
+    if (scope != kNoScope && active != kNoFrame) {
+        FrameQueries& f = frames[active];
+        const Record& r = f.records[scope];
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, f.timestamps, scope * 2 + 1);
+        if (r.statisticsQuery != kNoScope) {
+            vkCmdEndQuery(cmd, f.statistics, r.statisticsQuery);
+            statisticsOpen = false;
+        }
+        --depth;
+    }
+    if (pEndLabel) pEndLabel(cmd);
+}
+
+void GpuProfiler::readBack(FrameQueries& f) {
+    const auto n = static_cast<uint32_t>(f.records.size());
+    scratch.resize(static_cast<size_t>(n) * 2 + static_cast<size_t>(f.statisticsUsed) * kStatisticCount);
+    uint64_t* ts = scratch.data();
+    uint64_t* stats = ts + static_cast<size_t>(n) * 2;
+
+    // No WAIT bit: the submit has retired, so anything else means it never ran
+    if (vkGetQueryPoolResults(device, f.timestamps, 0, n * 2, sizeof(uint64_t) * n * 2, ts,
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return;
+    const bool haveStats = f.statisticsUsed > 0 &&
+        vkGetQueryPoolResults(device, f.statistics, 0, f.statisticsUsed,
+            sizeof(uint64_t) * kStatisticCount * f.statisticsUsed, stats,
+            sizeof(uint64_t) * kStatisticCount, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+
+    // Differences modulo the valid bits survive counter wrap
+    const uint64_t mask = timestampBits >= 64 ? ~0ull : (1ull << timestampBits) - 1;
+    for (uint32_t i = 0; i < n; ++i) {
+        const Record& r = f.records[i];
+        const uint64_t ticks = ((ts[i * 2 + 1] & mask) - (ts[i * 2] & mask)) & mask;
+        const auto ms = static_cast<float>(static_cast<double>(ticks) * timestampPeriod * 1e-6);
+
+        History& h = history(r.name, r.depth);
+        h.samples[h.next] = ms;
+        h.next = (h.next + 1) % config.historyFrames;
+        h.count = std::min(h.count + 1, config.historyFrames);
+        h.last = ms;
+        if (r.depth == 0) {
+            lastFrame = ms;
+            ++frameSamples;
+        }
+        if (haveStats && r.statisticsQuery != kNoScope) {
+            std::copy_n(stats + static_cast<size_t>(r.statisticsQuery) * kStatisticCount, kStatisticCount,
+                h.statistics.begin());
+            h.hasStatistics = true;
+        }
+    }
+}
+
+GpuProfiler::History& GpuProfiler::history(const char* name, uint32_t scopeDepth) {
+    auto it = historyIndex.find(name);
+    if (it != historyIndex.end()) return histories[it->second];
+
+    History& h = histories.emplace_back();
+    h.name = name;
+    h.depth = scopeDepth;
+    h.samples.assign(config.historyFrames, 0.f);
+    historyIndex.emplace(h.name, histories.size() - 1);
+    return h;
+}
+
+std::vector<GpuProfiler::ScopeReport> GpuProfiler::report() const {
+    std::vector<ScopeReport> out;
+    out.reserve(histories.size());
+
+    std::vector<float> sorted;
+    for (const History& h : histories) {
+        ScopeReport r;
+        r.name = h.name;
+        r.depth = h.depth;
+        r.samples = h.count;
+        r.lastMs = h.last;
+        r.hasStatistics = h.hasStatistics;
+        r.statistics = h.statistics;
+        if (h.count > 0) {
+            sorted.assign(h.samples.begin(), h.samples.begin() + h.count);
+            std::sort(sorted.begin(), sorted.end());
+            auto pct = [&](float p) { return sorted[static_cast<size_t>(p * static_cast<float>(h.count - 1) + 0.5f)]; };
+
+            double sum = 0.0;
+            for (float s : sorted) {
+                sum += s;
+                const auto bucket = static_cast<uint32_t>(s / config.histogramBucketMs);
+                ++r.histogram[std::min(bucket, kHistogramBuckets - 1)];
+            }
+            r.avgMs = static_cast<float>(sum / h.count);
+            r.minMs = sorted.front();
+            r.maxMs = sorted.back();
+            r.p50Ms = pct(0.50f);
+            r.p95Ms = pct(0.95f);
+            r.p99Ms = pct(0.99f);
+        }
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+void GpuProfiler::logReport(std::FILE* out) const {
+    std::fprintf(out, "[GpuProfiler] %-24s %8s %8s %8s %8s\n", "scope", "avg ms", "p95 ms", "max ms", "samples");
+    for (const ScopeReport& r : report()) {
+        std::fprintf(out, "[GpuProfiler] %*s%-*s %8.3f %8.3f %8.3f %8u\n",
+            static_cast<int>(r.depth * 2), "", static_cast<int>(24 - std::min(r.depth * 2, 24u)), r.name.c_str(),
+            r.avgMs, r.p95Ms, r.maxMs, r.samples);
+        if (r.hasStatistics) {
+            std::fprintf(out, "[GpuProfiler] %*s", static_cast<int>(r.depth * 2 + 2), "");
+            for (uint32_t i = 0; i < kStatisticCount; ++i)
+                std::fprintf(out, " %s=%llu", kStatisticNames[i], static_cast<unsigned long long>(r.statistics[i]));
+            std::fprintf(out, "\n");
+        }
+    }
+}
+
+void GpuProfiler::dump() {
+    const auto now = std::chrono::steady_clock::now();
+    lastDump = now;
+    if (histories.empty()) return;
+
+    logReport(stdout);
+    if (!csv) return;
+
+    const double t = std::chrono::duration<double>(now - startTime).count();
+    for (const ScopeReport& r : report()) {
+        std::fprintf(csv, "%.3f,%s,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f", t, r.name.c_str(), r.depth, r.samples,
+            r.avgMs, r.minMs, r.maxMs, r.p50Ms, r.p95Ms, r.p99Ms);
+        for (uint32_t i = 0; i < kStatisticCount; ++i) {
+            if (r.hasStatistics) std::fprintf(csv, ",%llu", static_cast<unsigned long long>(r.statistics[i]));
+            else std::fprintf(csv, ",");
+        }
+        std::fprintf(csv, "\n");
+    }
+    std::fflush(csv);
+}
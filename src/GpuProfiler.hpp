@@ -0,0 +1,160 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Compile the profiler out with -DPANGAEA_GPU_PROFILER=0 (CMake option of the same name)
+#ifndef PANGAEA_GPU_PROFILER
+#define PANGAEA_GPU_PROFILER 1
+#endif
+
+// GPU time per named scope, from timestamp queries.
+//
+// beginFrame() opens a root "Frame" scope, endFrame() closes it; Scope is the RAII child: a
+// debug-utils label plus a top-of-pipe / bottom-of-pipe vkCmdWriteTimestamp2 pair. Scopes asked
+// for statistics also wrap a pipeline-statistics query (not nested: an inner request while
+// one is open only gets timestamps). Each frame in flight owns its query pools, and
+// beginFrame() is called once the slot's previous submit has retired, so its results are read
+// back without waiting and the pools reset in the same command buffer.
+//
+// Samples go into a rolling window per scope name, summarized by report() and written to the
+// log / a CSV file every dump interval. Scope names must outlive the frame (string literals).
+// Record scopes on primary command buffers, outside rendering, from one thread.
+//
+// Compiled out, scopes and frames are empty inlines; disabled at run time (setEnabled(false),
+// the default) a scope is a branch plus its label when debug utils are loaded.
+class GpuProfiler {
+public:
+    static constexpr bool     kCompiled = PANGAEA_GPU_PROFILER != 0;
+    static constexpr uint32_t kStatisticCount = 7;
+    static constexpr uint32_t kHistogramBuckets = 16;
+
+    struct Config {
+        uint32_t maxScopes = 64;            // per frame, root included
+        uint32_t historyFrames = 240;       // rolling window per scope
+        float    histogramBucketMs = 0.25f;
+        bool     statistics = false;        // needs pipelineStatisticsQuery + inheritedQueries
+    };
+
+    struct ScopeReport {
+        std::string name;
+        uint32_t    depth = 0;     // 0 = frame
+        uint32_t    samples = 0;   // in the window
+        float       lastMs = 0.f, avgMs = 0.f, minMs = 0.f, maxMs = 0.f;
+        float       p50Ms = 0.f, p95Ms = 0.f, p99Ms = 0.f;
+        // Bucket i counts samples in [i, i+1) * histogramBucketMs; the last one is open-ended
+        std::array<uint32_t, kHistogramBuckets> histogram{};
+        bool                                    hasStatistics = false;
+        std::array<uint64_t, kStatisticCount>   statistics{};   // latest frame, see statisticName()
+    };
+
+    class Scope {
+    public:
+        Scope(GpuProfiler& p, VkCommandBuffer c, const char* name, bool statistics = false) : profiler(p), cmd(c) {
+            if constexpr (kCompiled) index = profiler.beginScope(cmd, name, statistics);
+        }
+        ~Scope() {
+            if constexpr (kCompiled) profiler.endScope(cmd, index);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler&    profiler;
+        VkCommandBuffer cmd;
+        uint32_t        index = kNoScope;
+    };
+
+    static const char* statisticName(uint32_t i);
+
+    // queueFamily: the family the profiled command buffers are submitted to
+    void init(VkPhysicalDevice phys, VkDevice dev, uint32_t queueFamily, uint32_t framesInFlight, const Config& cfg);
+    // The device must be idle
+    void destroy();
+
+    void setEnabled(bool on) { enabled = on; }
+    bool isEnabled() const { return kCompiled && enabled && timestampBits != 0; }
+    // Summary to stdout and rows to csvPath (truncated now; empty = log only) every intervalSeconds
+    void setDump(double intervalSeconds, const std::string& csvPath = {});
+
+    // Right after vkBeginCommandBuffer, once the slot has retired
+    void beginFrame(VkCommandBuffer cmd, uint32_t frame);
+    // Right before vkEndCommandBuffer
+    void endFrame(VkCommandBuffer cmd);
+
+    // pipelineStatistics for secondaries executed inside a statistics scope
+    VkQueryPipelineStatisticFlags inheritedStatistics() const { return isEnabled() ? statisticFlags : 0; }
+
+    std::vector<ScopeReport> report() const;
+    void                     logReport(std::FILE* out) const;
+
+    // Newest root ("Frame") sample and how many have been read back: poll once per frame for
+    // per-frame GPU times beyond the rolling window
+    float    lastFrameMs() const { return lastFrame; }
+    uint64_t frameSampleCount() const { return frameSamples; }
+
+private:
+    static constexpr uint32_t kNoScope = UINT32_MAX;
+    static constexpr uint32_t kNoFrame = UINT32_MAX;
+
+    struct Record {
+        const char* name;
+        uint32_t    depth;
+        uint32_t    statisticsQuery;   // kNoScope if none
+    };
+    struct FrameQueries {
+        VkQueryPool         timestamps = VK_NULL_HANDLE;   // 2 per scope
+        VkQueryPool         statistics = VK_NULL_HANDLE;   // 1 per statistics scope
+        std::vector<Record> records;                       // written since beginFrame()
+        uint32_t            statisticsUsed = 0;
+    };
+    struct History {
+        std::string        name;
+        uint32_t           depth = 0;
+        std::vector<float> samples;   // ring of historyFrames
+        uint32_t           next = 0;
+        uint32_t           count = 0;
+        float              last = 0.f;
+        bool               hasStatistics = false;
+        std::array<uint64_t, kStatisticCount> statistics{};
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    Config   config;
+    bool     enabled = false;
+    uint32_t timestampBits = 0;      // 0: the queue family can't write timestamps
+    double   timestampPeriod = 1.0;  // ns per tick
+    VkQueryPipelineStatisticFlags statisticFlags = 0;
+
+    std::vector<FrameQueries> frames;
+    uint32_t                  active = kNoFrame;   // frame being recorded
+    uint32_t                  depth = 0;
+    bool                      statisticsOpen = false;
+
+    std::deque<History>                         histories;      // first-seen order, stable names
+    std::unordered_map<std::string_view, size_t> historyIndex;
+    std::vector<uint64_t>                       scratch;
+    float                                       lastFrame = 0.f;
+    uint64_t                                    frameSamples = 0;
+
+    double                                dumpInterval = 0.0;
+    std::FILE*                            csv = nullptr;
+    std::chrono::steady_clock::time_point startTime{};
+    std::chrono::steady_clock::time_point lastDump{};
+
+    PFN_vkCmdBeginDebugUtilsLabelEXT pBeginLabel = nullptr;
+    PFN_vkCmdEndDebugUtilsLabelEXT   pEndLabel = nullptr;
+
+    uint32_t beginScope(VkCommandBuffer cmd, const char* name, bool statistics);
+    void     endScope(VkCommandBuffer cmd, uint32_t scope);
+    void     readBack(FrameQueries& f);
+    History& history(const char* name, uint32_t depth);
+    void     dump();
+};
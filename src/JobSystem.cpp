@@ -0,0 +1,88 @@
+#include "JobSystem.hpp"
+
+void JobSystem::init(uint32_t workerThreads) {
+    if (!workers.empty()) return;
+
+    if (workerThreads == 0) {
+        const uint32_t hw = std::thread::hardware_concurrency();
+        workerThreads = hw > 1 ? hw - 1 : 0;
+    }
+
+    quit = false;
+    workers.reserve(workerThreads);
+    for (uint32_t i = 0; i < workerThreads; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) if (t.joinable()) t.join();
+    workers.clear();
+}
+
+void JobSystem::runJobs(const std::function<void(uint32_t, uint32_t)>& fn, uint32_t count, uint32_t threadIndex) {
+    for (uint32_t i = nextJob.fetch_add(1, std::memory_order_relaxed); i < count;
+         i = nextJob.fetch_add(1, std::memory_order_relaxed)) {
+        fn(i, threadIndex);
+        doneJobs.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& fn) {
+    if (count == 0) return;
+
+    // Not worth waking anyone
+    if (workers.empty() || count == 1) {
+        for (uint32_t i = 0; i < count; ++i) fn(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        nextJob.store(0, std::memory_order_relaxed);
+        doneJobs.store(0, std::memory_order_relaxed);
+        ++generation;
+    }
+    wake.notify_all();
+
+    runJobs(fn, count, 0);
+
+    // Wait until every job ran and no worker still holds the batch, then retire it so
+    // late wakers don't pick up a dangling fn.
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return doneJobs.load(std::memory_order_acquire) == count && busyWorkers == 0; });
+    job = nullptr;
+    jobCount = 0;
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex) {
+    uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(uint32_t, uint32_t)>* fn = nullptr;
+        uint32_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || (generation != seen && job != nullptr); });
+            if (quit) return;
+            seen = generation;
+            fn = job;
+            count = jobCount;
+            ++busyWorkers;
+        }
+
+        runJobs(*fn, count, threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        idle.notify_one();
+    }
+}
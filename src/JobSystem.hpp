@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Small fork-join worker pool.
+//
+// parallelFor() hands out job indices to the workers and the calling thread, and returns once
+// every job has run. Thread index 0 is always the caller; workers are 1..threadCount()-1, so
+// callers can keep per-thread state (command pools, scratch arrays) in a plain array.
+class JobSystem {
+public:
+    JobSystem() = default;
+    ~JobSystem() { shutdown(); }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // workerThreads = 0 picks hardware_concurrency() - 1
+    void init(uint32_t workerThreads = 0);
+    void shutdown();
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    // fn(jobIndex, threadIndex). Blocks until all jobCount jobs are done.
+    void parallelFor(uint32_t jobCount, const std::function<void(uint32_t, uint32_t)>& fn);
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable wake;     // workers: new batch or shutdown
+    std::condition_variable idle;     // caller: batch drained
+
+    const std::function<void(uint32_t, uint32_t)>* job = nullptr;
+    uint32_t              jobCount = 0;
+    std::atomic<uint32_t> nextJob{ 0 };
+    std::atomic<uint32_t> doneJobs{ 0 };
+    uint32_t              busyWorkers = 0;  // workers inside the current batch (guarded by mutex)
+    uint64_t              generation = 0;
+    bool                  quit = false;
+
+    void workerLoop(uint32_t threadIndex);
+    void runJobs(const std::function<void(uint32_t, uint32_t)>& fn, uint32_t count, uint32_t threadIndex);
+};
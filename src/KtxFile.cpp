@@ -0,0 +1,111 @@
+#include "KtxFile.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+// Khronos Data Format descriptor values the loader looks at
+static constexpr uint8_t kDfdModelUastc = 166;     // KHR_DF_MODEL_UASTC
+static constexpr uint8_t kDfdTransferSrgb = 2;     // KHR_DF_TRANSFER_SRGB
+
+FormatBlock formatBlock(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:                 return { 1, 1, 1 };
+    case VK_FORMAT_R8G8_UNORM:               return { 1, 1, 2 };
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:            return { 1, 1, 4 };
+    case VK_FORMAT_R16G16B16A16_SFLOAT:      return { 1, 1, 8 };
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:          return { 4, 4, 8 };
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:           return { 4, 4, 16 };
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:      return { 4, 4, 16 };
+    case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:      return { 5, 5, 16 };
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:      return { 6, 6, 16 };
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:      return { 8, 8, 16 };
+    case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:    return { 10, 10, 16 };
+    case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:    return { 12, 12, 16 };
+    default:                                 return {};
+    }
+}
+
+void KtxFile::open(const std::string& path) {
+    close();
+    file.open(path);
+    const size_t size = file.size();
+    if (size < sizeof(KtxHeader)) throw std::runtime_error("KtxFile: truncated header: " + path);
+
+    const auto* h = reinterpret_cast<const KtxHeader*>(file.data());
+    if (std::memcmp(h->identifier, KtxHeader::kIdentifier, sizeof(h->identifier)) != 0)
+        throw std::runtime_error("KtxFile: not a KTX2 file: " + path);
+    if (h->pixelWidth == 0 || h->pixelHeight == 0 || h->pixelDepth > 1 || h->layerCount > 1 || h->faceCount != 1)
+        throw std::runtime_error("KtxFile: only single 2D images are supported: " + path);
+
+    const uint32_t count = std::max(h->levelCount, 1u);
+    if (sizeof(KtxHeader) + sizeof(KtxLevel) * size_t(count) > size)
+        throw std::runtime_error("KtxFile: truncated level index: " + path);
+    const auto* idx = reinterpret_cast<const KtxLevel*>(file.data() + sizeof(KtxHeader));
+    for (uint32_t i = 0; i < count; ++i) {
+        if (idx[i].byteOffset > size || idx[i].byteLength > size - idx[i].byteOffset)
+            throw std::runtime_error("KtxFile: level out of bounds: " + path);
+    }
+
+    // Basic descriptor block: totalSize, two header words, then model / primaries / transfer
+    if (h->dfdByteLength < 16 || h->dfdByteOffset > size || h->dfdByteLength > size - h->dfdByteOffset)
+        throw std::runtime_error("KtxFile: missing data format descriptor: " + path);
+    const unsigned char* dfd = file.data() + h->dfdByteOffset;
+    const uint8_t colorModel = dfd[12];
+    srgbTransfer = dfd[14] == kDfdTransferSrgb;
+
+    const auto scheme = static_cast<Supercompression>(h->supercompressionScheme);
+    if (h->vkFormat == VK_FORMAT_UNDEFINED) {
+        if (scheme == Supercompression::BasisLZ) kind = Payload::ETC1S;
+        else if (colorModel == kDfdModelUastc && (scheme == Supercompression::None || scheme == Supercompression::Zstd))
+            kind = Payload::UASTC;
+        else throw std::runtime_error("KtxFile: unsupported payload: " + path);
+    }
+    else {
+        if (scheme != Supercompression::None)
+            throw std::runtime_error("KtxFile: supercompressed GPU formats are not supported: " + path);
+        const FormatBlock block = formatBlock(static_cast<VkFormat>(h->vkFormat));
+        if (block.bytes == 0) throw std::runtime_error("KtxFile: unsupported format: " + path);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t w = std::max(1u, h->pixelWidth >> i), hh = std::max(1u, h->pixelHeight >> i);
+            if (idx[i].byteLength < block.levelBytes(w, hh))
+                throw std::runtime_error("KtxFile: level smaller than its extent: " + path);
+        }
+        kind = Payload::Native;
+    }
+
+    hdr = h;
+    index = idx;
+    levels = count;
+}
+
+void KtxFile::close() {
+    file.close();
+    hdr = nullptr;
+    index = nullptr;
+    levels = 0;
+    kind = Payload::Native;
+    srgbTransfer = false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "MappedFile.hpp"
+
+// KTX 2.0 texture container, read straight from a memory mapping.
+//
+// Layout: KtxHeader | KtxLevel[max(levelCount, 1)] | DFD | key/value data | supercompression
+// global data | mip levels (smallest last in the file, level 0 = full size). All little-endian.
+// Only what the texture streamer needs is interpreted: 2D, one layer, one face.
+//
+// Levels stored in a GPU format (vkFormat != UNDEFINED, no supercompression) can be uploaded
+// as-is. Basis Universal payloads (BasisLZ/ETC1S, or UASTC with optional Zstd) have
+// vkFormat == UNDEFINED and need transcoding first (TextureTranscoder).
+struct KtxHeader {
+    static constexpr unsigned char kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    unsigned char identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(KtxHeader) == 80, "KtxHeader layout is part of the file format");
+
+struct KtxLevel {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+static_assert(sizeof(KtxLevel) == 24, "KtxLevel layout is part of the file format");
+
+// Texel block of a format texture levels are stored in; bytes == 0 for unsupported formats
+struct FormatBlock {
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t bytes = 0;
+
+    uint32_t     blocksX(uint32_t texels) const { return (texels + width - 1) / width; }
+    uint32_t     blocksY(uint32_t texels) const { return (texels + height - 1) / height; }
+    VkDeviceSize levelBytes(uint32_t w, uint32_t h) const { return VkDeviceSize(blocksX(w)) * blocksY(h) * bytes; }
+};
+FormatBlock formatBlock(VkFormat format);
+
+class KtxFile {
+public:
+    enum class Supercompression : uint32_t { None = 0, BasisLZ = 1, Zstd = 2, Zlib = 3 };
+    enum class Payload : uint8_t {
+        Native,   // vkFormat blocks, upload directly
+        ETC1S,    // BasisLZ
+        UASTC,    // optionally Zstd-supercompressed
+    };
+
+    // Maps and validates the file; throws std::runtime_error("KtxFile: ...") on bad input.
+    void open(const std::string& path);
+    void close();
+
+    const KtxHeader& header() const { return *hdr; }
+    uint32_t         width() const { return hdr->pixelWidth; }
+    uint32_t         height() const { return hdr->pixelHeight; }
+    uint32_t         levelCount() const { return levels; }
+    VkFormat         format() const { return static_cast<VkFormat>(hdr->vkFormat); }
+    Payload          payload() const { return kind; }
+    bool             srgb() const { return srgbTransfer; }
+
+    // Level i's stored bytes (possibly supercompressed); valid until close()
+    const unsigned char* levelData(uint32_t i) const { return file.data() + index[i].byteOffset; }
+    VkDeviceSize         levelBytes(uint32_t i) const { return index[i].byteLength; }
+    uint32_t             levelWidth(uint32_t i) const { return std::max(1u, hdr->pixelWidth >> i); }
+    uint32_t             levelHeight(uint32_t i) const { return std::max(1u, hdr->pixelHeight >> i); }
+
+    // The whole file (transcoders parse the container themselves)
+    const unsigned char* data() const { return file.data(); }
+    size_t               size() const { return file.size(); }
+
+private:
+    MappedFile       file;
+    const KtxHeader* hdr = nullptr;
+    const KtxLevel*  index = nullptr;
+    uint32_t         levels = 0;
+    Payload          kind = Payload::Native;
+    bool             srgbTransfer = false;
+};
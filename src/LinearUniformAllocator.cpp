@@ -0,0 +1,74 @@
+#include "LinearUniformAllocator.hpp"
+#include "MemoryBudget.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize v, VkDeviceSize a) { return (v + a - 1) / a * a; }
+
+void LinearUniformAllocator::init(VmaAllocator alloc, VkPhysicalDevice phys, uint32_t framesInFlight,
+    VkDeviceSize bytesPerFrame, MemoryBudget* budget, const QueueSharing& sharing) {
+    allocator = alloc;
+    memory = budget;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(phys, &props);
+    alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 16);
+    frameSize = alignUp(bytesPerFrame, alignment);
+
+    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bi.size = frameSize * framesInFlight;
+    bi.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    sharing.apply(bi);
+
+    // Sequential-write mapping keeps it host-visible; prefer device-local coherent memory
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    aci.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VmaAllocationInfo info{};
+    if (vmaCreateBuffer(allocator, &bi, &aci, &buf, &allocation, &info) != VK_SUCCESS)
+        throw std::runtime_error("LinearUniformAllocator: failed to create buffer");
+    if (memory) memory->track(allocation, MemoryBudget::Category::FrameData);
+    mapped = static_cast<uint8_t*>(info.pMappedData);
+
+    VkMemoryPropertyFlags memFlags = 0;
+    vmaGetAllocationMemoryProperties(allocator, allocation, &memFlags);
+    isCoherent = (memFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    isDeviceLocal = (memFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+
+    frameBase = head = flushed = 0;
+}
+
+void LinearUniformAllocator::destroy() {
+    if (memory && allocation) memory->untrack(allocation);
+    if (buf) vmaDestroyBuffer(allocator, buf, allocation);
+    buf = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+    mapped = nullptr;
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+}
+
+void LinearUniformAllocator::beginFrame(uint32_t frame) {
+    frameBase = frameSize * frame;
+    head = flushed = frameBase;
+}
+
+LinearUniformAllocator::Allocation LinearUniformAllocator::allocate(VkDeviceSize size) {
+    const VkDeviceSize at = alignUp(head, alignment);
+    if (at + size > frameBase + frameSize) throw std::runtime_error("LinearUniformAllocator: frame budget exhausted");
+    head = at + size;
+
+    Allocation a;
+    a.data = mapped + at;
+    a.offset = static_cast<uint32_t>(at);
+    return a;
+}
+
+void LinearUniformAllocator::flush() {
+    if (head == flushed) return;
+    if (!isCoherent) vmaFlushAllocation(allocator, allocation, flushed, head - flushed);
+    flushed = head;
+}
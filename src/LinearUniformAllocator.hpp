@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <cstring>
+
+#include "QueueSharing.hpp"
+
+class MemoryBudget;
+
+// Per-frame bump allocator for uniform data.
+//
+// One persistently mapped buffer split into a region per frame in flight; beginFrame() rewinds
+// the slot's region once its submit has retired, and every allocate() hands out the next
+// aligned chunk. Shaders see it through UNIFORM_BUFFER_DYNAMIC descriptors pointing at
+// buffer() with a fixed range, the returned offset being the dynamic offset at bind time.
+//
+// The memory prefers DEVICE_LOCAL | HOST_COHERENT (ReBAR / UMA) and falls back to plain
+// host-visible memory; flush() only does work when the type isn't coherent.
+// Not thread-safe.
+class LinearUniformAllocator {
+public:
+    struct Allocation {
+        void*    data = nullptr;
+        uint32_t offset = 0;   // dynamic offset into buffer()
+    };
+
+    void init(VmaAllocator alloc, VkPhysicalDevice phys, uint32_t framesInFlight, VkDeviceSize bytesPerFrame,
+        MemoryBudget* budget = nullptr, const QueueSharing& sharing = {});
+    // The device must be idle
+    void destroy();
+
+    void beginFrame(uint32_t frame);
+    // Throws when the frame's region is exhausted
+    Allocation allocate(VkDeviceSize size);
+    template <class T>
+    uint32_t push(const T& value) {
+        Allocation a = allocate(sizeof(T));
+        std::memcpy(a.data, &value, sizeof(T));
+        return a.offset;
+    }
+    // Makes everything allocated since the last flush visible to the device
+    void flush();
+
+    VkBuffer     buffer() const { return buf; }
+    bool         coherent() const { return isCoherent; }
+    bool         deviceLocal() const { return isDeviceLocal; }
+    VkDeviceSize frameBytesUsed() const { return head - frameBase; }
+
+private:
+    VmaAllocator  allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    VkBuffer      buf = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    uint8_t*      mapped = nullptr;
+
+    VkDeviceSize alignment = 256;     // minUniformBufferOffsetAlignment
+    VkDeviceSize frameSize = 0;       // per region, a multiple of alignment
+    VkDeviceSize frameBase = 0;       // current region
+    VkDeviceSize head = 0;            // next free byte (absolute)
+    VkDeviceSize flushed = 0;         // flushed up to (absolute)
+    bool         isCoherent = false;
+    bool         isDeviceLocal = false;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+// Pages are faulted in on first touch; open() hints sequential access so the kernel reads ahead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { moveFrom(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) { close(); moveFrom(other); }
+        return *this;
+    }
+
+    // Throws std::runtime_error on failure (missing, empty or unmappable file).
+    void open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void moveFrom(MappedFile& other) noexcept {
+        bytes = other.bytes;   other.bytes = nullptr;
+        length = other.length; other.length = 0;
+#ifdef _WIN32
+        fileHandle = other.fileHandle;       other.fileHandle = nullptr;
+        mappingHandle = other.mappingHandle; other.mappingHandle = nullptr;
+#endif
+    }
+};
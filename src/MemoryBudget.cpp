@@ -0,0 +1,222 @@
+#include "MemoryBudget.hpp"
+#include "DeletionQueue.hpp"
+
+#include <algorithm>
+
+static const char* const kCategoryNames[MemoryBudget::kCategoryCount] = {
+    "geometry", "textures", "staging", "render targets", "frame data",
+};
+
+// Streamable first: textures give memory back cheapest
+static constexpr MemoryBudget::Category kEvictOrder[] = {
+    MemoryBudget::Category::Textures, MemoryBudget::Category::Geometry, MemoryBudget::Category::FrameData,
+    MemoryBudget::Category::Staging, MemoryBudget::Category::RenderTargets,
+};
+
+static constexpr double kMiB = 1.0 / (1024.0 * 1024.0);
+
+const char* MemoryBudget::categoryName(Category c) {
+    const auto i = static_cast<uint32_t>(c);
+    return i < kCategoryCount ? kCategoryNames[i] : "";
+}
+
+void MemoryBudget::init(VmaAllocator alloc, DeletionQueue* deletion, const Config& cfg) {
+    allocator = alloc;
+    deletionQueue = deletion;
+    config = cfg;
+    totals = {};
+
+    const VkPhysicalDeviceMemoryProperties* props = nullptr;
+    vmaGetMemoryProperties(allocator, &props);
+    heapStats.assign(props->memoryHeapCount, Heap{});
+    for (uint32_t h = 0; h < props->memoryHeapCount; ++h)
+        heapStats[h].deviceLocal = (props->memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    pollBudgets();
+}
+
+void MemoryBudget::destroy() {
+    if (context) {
+        if (pending) vmaEndDefragmentationPass(allocator, context, &pass);
+        endDefragmentation();
+    }
+    movable.clear();
+    for (auto& e : evictors) e.clear();
+    categoryUsage = {};
+    heapStats.clear();
+    allocator = VK_NULL_HANDLE;
+    deletionQueue = nullptr;
+}
+
+void MemoryBudget::track(VmaAllocation a, Category c, RelocateFn relocate) {
+    if (!a) return;
+    vmaSetAllocationUserData(allocator, a, reinterpret_cast<void*>(static_cast<uintptr_t>(c) + 1));
+
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator, a, &info);
+    categoryUsage[static_cast<uint32_t>(c)] += info.size;
+    if (relocate) movable[a] = std::move(relocate);
+}
+
+void MemoryBudget::untrack(VmaAllocation a) {
+    if (!a || !allocator) return;
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator, a, &info);
+    const auto tag = reinterpret_cast<uintptr_t>(info.pUserData);
+    if (tag == 0 || tag > kCategoryCount) return;
+
+    VkDeviceSize& used = categoryUsage[tag - 1];
+    used -= std::min(used, info.size);
+    vmaSetAllocationUserData(allocator, a, nullptr);
+    movable.erase(a);
+}
+
+void MemoryBudget::addEvictor(Category c, EvictFn fn) {
+    evictors[static_cast<uint32_t>(c)].push_back(std::move(fn));
+}
+
+VmaAllocationCreateFlags MemoryBudget::allocationFlags(Category c) const {
+    // Streamed data can always come back later at a lower mip; everything else must succeed
+    return c == Category::Textures ? VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT : 0;
+}
+
+void MemoryBudget::reserve(VkDeviceSize bytes, uint64_t retireValue) {
+    if (!allocator) return;
+    if (overBudget(config.highWater, bytes) > 0) evict(overBudget(config.lowWater, bytes), retireValue);
+}
+
+void MemoryBudget::pollBudgets() {
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(allocator, budgets.data());
+    for (size_t h = 0; h < heapStats.size(); ++h) {
+        heapStats[h].budget = budgets[h].budget;
+        heapStats[h].usage = budgets[h].usage;
+        heapStats[h].blockBytes = budgets[h].statistics.blockBytes;
+        heapStats[h].allocationBytes = budgets[h].statistics.allocationBytes;
+    }
+}
+
+// Largest overshoot of fraction * budget on a device-local heap, counting extra new bytes
+VkDeviceSize MemoryBudget::overBudget(float fraction, VkDeviceSize extra) const {
+    VkDeviceSize worst = 0;
+    for (const Heap& h : heapStats) {
+        if (!h.deviceLocal) continue;
+        const auto limit = static_cast<VkDeviceSize>(static_cast<double>(h.budget) * fraction);
+        if (h.usage + extra > limit) worst = std::max(worst, h.usage + extra - limit);
+    }
+    return worst;
+}
+
+VkDeviceSize MemoryBudget::evict(VkDeviceSize bytes, uint64_t retireValue) {
+    VkDeviceSize freed = 0;
+    for (Category c : kEvictOrder) {
+        for (const EvictFn& fn : evictors[static_cast<uint32_t>(c)]) {
+            if (freed >= bytes) break;
+            freed += fn(bytes - freed, retireValue);
+        }
+    }
+    totals.evictedBytes += freed;
+    return freed;
+}
+
+void MemoryBudget::update(uint32_t frameIndex, uint64_t completedValue, uint64_t nextRetireValue) {
+    vmaSetCurrentFrameIndex(allocator, frameIndex);
+
+    // The pass's copies have executed: VMA can free the old memory now
+    if (pending && completedValue >= passRetire) {
+        pending = false;
+        if (vmaEndDefragmentationPass(allocator, context, &pass) == VK_SUCCESS) endDefragmentation();
+    }
+
+    pollBudgets();
+    const bool wasUnderPressure = pressure;
+    pressure = overBudget(config.highWater, 0) > 0;
+    if (pressure) {
+        if (!wasUnderPressure) {
+            ++totals.pressureEvents;
+            defragRequested = true;   // emptied blocks go back to the driver
+        }
+        evict(overBudget(config.lowWater, 0), nextRetireValue);
+    }
+
+    if (++framesSinceStatistics >= config.statisticsInterval) {
+        framesSinceStatistics = 0;
+        if (!context && shouldDefragment()) defragRequested = true;
+    }
+
+    if (defragRequested && !context) {
+        VmaDefragmentationInfo info{};
+        info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+        info.maxBytesPerPass = config.maxBytesPerPass;
+        info.maxAllocationsPerPass = config.maxMovesPerPass;
+        if (vmaBeginDefragmentation(allocator, &info, &context) != VK_SUCCESS) context = VK_NULL_HANDLE;
+    }
+    defragRequested = false;
+}
+
+bool MemoryBudget::shouldDefragment() {
+    VmaTotalStatistics stats{};
+    vmaCalculateStatistics(allocator, &stats);
+    const VkDeviceSize blocks = stats.total.statistics.blockBytes;
+    const VkDeviceSize unused = blocks - std::min(blocks, stats.total.statistics.allocationBytes);
+    return unused >= config.defragMinUnused &&
+        static_cast<double>(unused) >= static_cast<double>(blocks) * config.defragUnusedRatio;
+}
+
+void MemoryBudget::recordDefragmentation(VkCommandBuffer cmd, uint64_t retireValue) {
+    if (!context || pending) return;
+
+    pass = {};
+    if (vmaBeginDefragmentationPass(allocator, context, &pass) != VK_INCOMPLETE) {
+        endDefragmentation();   // VK_SUCCESS: nothing left to move
+        return;
+    }
+
+    uint32_t moved = 0;
+    for (uint32_t i = 0; i < pass.moveCount; ++i) {
+        VmaDefragmentationMove& m = pass.pMoves[i];
+        auto it = movable.find(m.srcAllocation);
+        const bool ok = it != movable.end() &&
+            it->second(Relocation{ m.srcAllocation, m.dstTmpAllocation, cmd, *deletionQueue, retireValue });
+        if (ok) ++moved;
+        else m.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+    }
+
+    // Nothing this pass could move is ever going to move: stop here
+    if (moved == 0) {
+        vmaEndDefragmentationPass(allocator, context, &pass);
+        endDefragmentation();
+        return;
+    }
+    pending = true;
+    passRetire = retireValue;
+}
+
+void MemoryBudget::endDefragmentation() {
+    VmaDefragmentationStats run{};
+    vmaEndDefragmentation(allocator, context, &run);
+    context = VK_NULL_HANDLE;
+    pending = false;
+    if (run.allocationsMoved > 0) {
+        ++totals.defragmentations;
+        totals.allocationsMoved += run.allocationsMoved;
+        totals.bytesMoved += run.bytesMoved;
+        totals.bytesFreed += run.bytesFreed;
+    }
+}
+
+void MemoryBudget::logReport(std::FILE* out) const {
+    for (size_t h = 0; h < heapStats.size(); ++h) {
+        const Heap& heap = heapStats[h];
+        std::fprintf(out, "[MemoryBudget] heap %zu%s: %.1f / %.1f MiB (VMA blocks %.1f, allocations %.1f)\n",
+            h, heap.deviceLocal ? " (device)" : "", static_cast<double>(heap.usage) * kMiB,
+            static_cast<double>(heap.budget) * kMiB, static_cast<double>(heap.blockBytes) * kMiB,
+            static_cast<double>(heap.allocationBytes) * kMiB);
+    }
+    for (uint32_t c = 0; c < kCategoryCount; ++c)
+        std::fprintf(out, "[MemoryBudget]   %-14s %.1f MiB\n", kCategoryNames[c], static_cast<double>(categoryUsage[c]) * kMiB);
+    std::fprintf(out, "[MemoryBudget] pressure: %s, entered %u times, %.1f MiB evicted\n",
+        pressure ? "yes" : "no", totals.pressureEvents, static_cast<double>(totals.evictedBytes) * kMiB);
+    std::fprintf(out, "[MemoryBudget] defragmentation: %u runs, %u moves, %.1f MiB moved, %.1f MiB freed\n",
+        totals.defragmentations, totals.allocationsMoved, static_cast<double>(totals.bytesMoved) * kMiB,
+        static_cast<double>(totals.bytesFreed) * kMiB);
+}
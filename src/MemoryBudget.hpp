@@ -0,0 +1,136 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class DeletionQueue;
+
+// Heap budgets, per-category usage and incremental VMA defragmentation.
+//
+// Owners tag their allocations with track() (the category rides in the allocation's
+// pUserData, so untrack() needs nothing else); DeletionQueue untracks what it frees. update()
+// polls vmaGetHeapBudgets once per frame. When a device-local heap passes highWater of its
+// budget, the evictors of streamable categories are asked to free down to lowWater, and
+// reserve() does the same ahead of a new allocation. Optional categories allocate with
+// WITHIN_BUDGET (allocationFlags()) and so fail instead of over-committing.
+//
+// Defragmentation runs one bounded pass at a time. recordDefragmentation() begins a pass and
+// each move's owner records its copy into the frame's command buffer (Relocation). The pass
+// ends in the first update() after that submit retires, which is when VMA frees the old
+// memory; old handles retire through the deletion queue at the same value. Allocations
+// without a relocate callback are never moved. Defragmentation starts on request, on entering
+// pressure, or when the periodic statistics show enough unused block space.
+//
+// Main thread only.
+class MemoryBudget {
+public:
+    enum class Category : uint8_t {
+        Geometry,        // shared vertex / index buffers
+        Textures,        // streamable images
+        Staging,         // upload rings
+        RenderTargets,   // depth, Hi-Z pyramid, attachments
+        FrameData,       // uniforms, instance / indirect buffers
+        Count
+    };
+    static constexpr uint32_t kCategoryCount = static_cast<uint32_t>(Category::Count);
+
+    // One defragmentation move handed to the allocation's owner
+    struct Relocation {
+        VmaAllocation   allocation;    // keeps its handle; refers to the new memory once the pass ends
+        VmaAllocation   target;        // bind the replacement here (vmaBindBufferMemory / vmaBindImageMemory)
+        VkCommandBuffer cmd;           // record old -> new copy and barriers here
+        DeletionQueue&  deletion;      // old handle, without its allocation, at retireValue
+        uint64_t        retireValue;
+    };
+    // Swap in a resource bound to target; false leaves the allocation where it is
+    using RelocateFn = std::function<bool(const Relocation&)>;
+    // Free up to bytes from a streamable category (evict, drop mips) with retirement at
+    // retireValue; returns the bytes that will be released
+    using EvictFn = std::function<VkDeviceSize(VkDeviceSize bytes, uint64_t retireValue)>;
+
+    struct Config {
+        float        highWater = 0.90f;        // of a device-local heap's budget: start evicting
+        float        lowWater = 0.80f;         // evict down to this
+        float        defragUnusedRatio = 0.25f;   // unused / block bytes that triggers a pass
+        VkDeviceSize defragMinUnused = 64ull << 20;
+        VkDeviceSize maxBytesPerPass = 32ull << 20;
+        uint32_t     maxMovesPerPass = 16;
+        uint32_t     statisticsInterval = 240;  // frames between vmaCalculateStatistics
+    };
+
+    struct Heap {
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;            // whole process, as the driver reports it
+        VkDeviceSize blockBytes = 0;       // VMA's share
+        VkDeviceSize allocationBytes = 0;
+        bool         deviceLocal = false;
+    };
+
+    // Running totals since init(), for logReport() and callers that want to react
+    struct Stats {
+        uint32_t     pressureEvents = 0;     // device-local heap went above highWater
+        VkDeviceSize evictedBytes = 0;       // released by evictors (pressure and reserve())
+        uint32_t     defragmentations = 0;   // finished runs that moved anything
+        uint32_t     allocationsMoved = 0;
+        VkDeviceSize bytesMoved = 0;
+        VkDeviceSize bytesFreed = 0;
+    };
+
+    static const char* categoryName(Category c);
+
+    void init(VmaAllocator alloc, DeletionQueue* deletion, const Config& cfg);
+    // Abandons an active defragmentation; the device must be idle
+    void destroy();
+
+    void track(VmaAllocation a, Category c, RelocateFn relocate = {});
+    void untrack(VmaAllocation a);
+    void addEvictor(Category c, EvictFn fn);
+    VmaAllocationCreateFlags allocationFlags(Category c) const;
+    // Make room for an allocation of bytes on device-local memory (best effort)
+    void reserve(VkDeviceSize bytes, uint64_t retireValue);
+
+    // Once per frame, after the frame slot's wait. nextRetireValue: this frame's submit
+    void update(uint32_t frameIndex, uint64_t completedValue, uint64_t nextRetireValue);
+    // Into the frame's command buffer, after queued uploads were flushed
+    void recordDefragmentation(VkCommandBuffer cmd, uint64_t retireValue);
+    void requestDefragmentation() { defragRequested = true; }
+    bool defragmenting() const { return context != VK_NULL_HANDLE; }
+    // A pass moved allocations that haven't retired yet; owners must not free or replace them
+    bool passPending() const { return pending; }
+
+    const std::vector<Heap>& heaps() const { return heapStats; }
+    VkDeviceSize categoryBytes(Category c) const { return categoryUsage[static_cast<uint32_t>(c)]; }
+    bool         underPressure() const { return pressure; }
+    const Stats& stats() const { return totals; }
+    void         logReport(std::FILE* out) const;
+
+private:
+    VmaAllocator   allocator = VK_NULL_HANDLE;
+    DeletionQueue* deletionQueue = nullptr;
+    Config         config;
+
+    std::vector<Heap>                                heapStats;
+    std::array<VkDeviceSize, kCategoryCount>         categoryUsage{};
+    std::array<std::vector<EvictFn>, kCategoryCount> evictors;
+    std::unordered_map<VmaAllocation, RelocateFn>    movable;
+    bool                                             pressure = false;
+    uint32_t                                         framesSinceStatistics = 0;
+
+    VmaDefragmentationContext      context = VK_NULL_HANDLE;
+    VmaDefragmentationPassMoveInfo pass{};
+    bool                           pending = false;
+    uint64_t                       passRetire = 0;
+    bool                           defragRequested = false;
+    Stats                          totals;
+
+    void         pollBudgets();
+    VkDeviceSize overBudget(float fraction, VkDeviceSize extra) const;
+    VkDeviceSize evict(VkDeviceSize bytes, uint64_t retireValue);
+    bool         shouldDefragment();
+    void         endDefragmentation();
+};
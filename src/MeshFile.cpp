@@ -0,0 +1,138 @@
+#include "MeshFile.hpp"
+
+#include <stdexcept>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static uint64_t alignUp(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+
+// [offset, offset + bytes) lies inside a file of `size` bytes (overflow-safe)
+static bool inRange(uint64_t offset, uint64_t bytes, uint64_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+void MeshFile::open(const std::string& path) {
+    close();
+    file.open(path);
+
+    const uint64_t size = file.size();
+    if (size < sizeof(MeshFileHeader)) throw std::runtime_error("MeshFile: truncated header: " + path);
+
+    // Mapping is page-aligned, so the header and every blob offset below are suitably aligned
+    const auto* h = reinterpret_cast<const MeshFileHeader*>(file.data());
+    if (h->magic != MeshFileHeader::kMagic) throw std::runtime_error("MeshFile: bad magic: " + path);
+    if (h->version != MeshFileHeader::kVersion) throw std::runtime_error("MeshFile: unsupported version: " + path);
+    if (h->indexSize != 2 && h->indexSize != 4) throw std::runtime_error("MeshFile: bad index size: " + path);
+    if (h->vertexFormat > static_cast<uint32_t>(VertexFormat::Half16))
+        throw std::runtime_error("MeshFile: unknown vertex format: " + path);
+    if (h->vertexStride != vertexLayoutInfo(static_cast<VertexFormat>(h->vertexFormat)).vertexBytes())
+        throw std::runtime_error("MeshFile: vertex stride does not match its format: " + path);
+
+    if (h->vertexBytes != uint64_t(h->vertexCount) * h->vertexStride ||
+        h->indexBytes != uint64_t(h->indexCount) * h->indexSize)
+        throw std::runtime_error("MeshFile: blob sizes do not match counts: " + path);
+
+    if (h->vertexOffset % kPageAlignment || h->indexOffset % kPageAlignment || h->submeshOffset % alignof(MeshSubmesh))
+        throw std::runtime_error("MeshFile: misaligned section: " + path);
+
+    if (!inRange(h->submeshOffset, uint64_t(h->submeshCount) * sizeof(MeshSubmesh), size) ||
+        !inRange(h->vertexOffset, h->vertexBytes, size) ||
+        !inRange(h->indexOffset, h->indexBytes, size))
+        throw std::runtime_error("MeshFile: section out of bounds: " + path);
+
+    // Vertex fetches on the GPU are unchecked: every index a submesh draws, plus its vertexOffset,
+    // must land inside the vertex blob. One pass over the (already mapped) indices.
+    const auto* s = reinterpret_cast<const MeshSubmesh*>(file.data() + h->submeshOffset);
+    const unsigned char* indices = file.data() + h->indexOffset;
+    for (uint32_t i = 0; i < h->submeshCount; ++i) {
+        if (uint64_t(s[i].firstIndex) + s[i].indexCount > h->indexCount)
+            throw std::runtime_error("MeshFile: submesh index range out of bounds: " + path);
+        if (s[i].indexCount == 0) continue;
+
+        uint32_t lo = std::numeric_limits<uint32_t>::max(), hi = 0;
+        for (uint32_t k = s[i].firstIndex; k < s[i].firstIndex + s[i].indexCount; ++k) {
+            uint32_t index = 0;
+            if (h->indexSize == 2) { uint16_t v; std::memcpy(&v, indices + size_t(k) * 2, 2); index = v; }
+            else std::memcpy(&index, indices + size_t(k) * 4, 4);
+            lo = std::min(lo, index);
+            hi = std::max(hi, index);
+        }
+        if (int64_t(s[i].vertexOffset) + lo < 0 || int64_t(s[i].vertexOffset) + hi >= int64_t(h->vertexCount))
+            throw std::runtime_error("MeshFile: submesh indices out of vertex range: " + path);
+    }
+
+    hdr = h;
+    subs = s;
+}
+
+void MeshFile::close() {
+    file.close();
+    hdr = nullptr;
+    subs = nullptr;
+}
+
+void MeshFile::write(const std::string& path, const WriteDesc& desc) {
+    if (desc.indexSize != 2 && desc.indexSize != 4) throw std::runtime_error("MeshFile: bad index size");
+    const VertexLayoutInfo& layout = vertexLayoutInfo(desc.vertexFormat);
+    const vtxq::Dequant dq = desc.vertexFormat == VertexFormat::Float32 ? vtxq::Dequant{} : desc.dequant;
+
+    MeshFileHeader h{};
+    h.vertexStride = layout.vertexBytes();
+    h.vertexFormat = static_cast<uint32_t>(desc.vertexFormat);
+    for (int a = 0; a < 3; ++a) h.dequantOffset[a] = dq.offset[a];
+    h.dequantScale = dq.scale;
+    h.indexSize = desc.indexSize;
+    h.vertexCount = desc.vertexCount;
+    h.indexCount = desc.indexCount;
+    h.submeshCount = desc.submeshCount;
+    h.submeshOffset = sizeof(MeshFileHeader);
+    h.vertexBytes = uint64_t(desc.vertexCount) * h.vertexStride;
+    h.vertexOffset = alignUp(h.submeshOffset + uint64_t(desc.submeshCount) * sizeof(MeshSubmesh), kPageAlignment);
+    h.indexBytes = uint64_t(desc.indexCount) * desc.indexSize;
+    h.indexOffset = alignUp(h.vertexOffset + h.vertexBytes, kPageAlignment);
+
+    // Bounds from decoded positions: AABB, then a sphere around its center
+    for (int a = 0; a < 3; ++a) {
+        h.boundsMin[a] = desc.vertexCount ? std::numeric_limits<float>::max() : 0.f;
+        h.boundsMax[a] = desc.vertexCount ? std::numeric_limits<float>::lowest() : 0.f;
+    }
+    for (uint32_t i = 0; i < desc.vertexCount; ++i) {
+        float p[3]; vtxq::decodePosition(desc.vertexFormat, desc.vertices, i, dq, p);
+        for (int a = 0; a < 3; ++a) {
+            h.boundsMin[a] = std::min(h.boundsMin[a], p[a]);
+            h.boundsMax[a] = std::max(h.boundsMax[a], p[a]);
+        }
+    }
+    for (int a = 0; a < 3; ++a) h.sphere[a] = (h.boundsMin[a] + h.boundsMax[a]) * 0.5f;
+    float r2 = 0.f;
+    for (uint32_t i = 0; i < desc.vertexCount; ++i) {
+        float p[3]; vtxq::decodePosition(desc.vertexFormat, desc.vertices, i, dq, p);
+        const float dx = p[0] - h.sphere[0], dy = p[1] - h.sphere[1], dz = p[2] - h.sphere[2];
+        r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+    }
+    h.sphere[3] = std::sqrt(r2);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("MeshFile: cannot write " + path);
+
+    auto pad = [&](uint64_t to) {
+        static const char zeros[64]{};
+        for (uint64_t at = static_cast<uint64_t>(out.tellp()); at < to; ) {
+            const uint64_t n = std::min<uint64_t>(sizeof(zeros), to - at);
+            out.write(zeros, static_cast<std::streamsize>(n));
+            at += n;
+        }
+    };
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(desc.submeshes), static_cast<std::streamsize>(desc.submeshCount * sizeof(MeshSubmesh)));
+    pad(h.vertexOffset);
+    out.write(static_cast<const char*>(desc.vertices), static_cast<std::streamsize>(h.vertexBytes));
+    pad(h.indexOffset);
+    out.write(static_cast<const char*>(desc.indices), static_cast<std::streamsize>(h.indexBytes));
+    // Round the file up so the last blob's page is fully backed
+    pad(alignUp(h.indexOffset + h.indexBytes, kPageAlignment));
+    if (!out) throw std::runtime_error("MeshFile: short write: " + path);
+}
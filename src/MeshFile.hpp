@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "MappedFile.hpp"
+#include "VertexLayout.hpp"
+
+// Binary mesh container (.pmesh), consumed straight from a memory mapping.
+//
+// Layout: MeshFileHeader | MeshSubmesh[submeshCount] | pad | vertex blob | pad | index blob.
+// Both blobs start on a kPageAlignment boundary, so the mapped pages can be handed to the
+// staging uploader as-is: no parse step, no intermediate copies. All fields are little-endian.
+// The vertex blob is stream-major (all of stream 0, then stream 1...) in the layout named by
+// vertexFormat; vertexStride is the sum of the stream strides.
+struct MeshFileHeader {
+    static constexpr uint32_t kMagic = 0x48534D50;  // "PMSH"
+    static constexpr uint32_t kVersion = 2;
+
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint32_t vertexStride = 0;    // bytes per vertex, all streams
+    uint32_t indexSize = 0;       // 2 or 4
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t submeshCount = 0;
+    uint32_t vertexFormat = 0;    // VertexFormat
+    float    boundsMin[3]{};      // object-space AABB
+    float    boundsMax[3]{};
+    float    sphere[4]{};         // object-space bounding sphere (center xyz, radius)
+    float    dequantOffset[3]{};  // quantized formats: pos = q * dequantScale + dequantOffset
+    float    dequantScale = 1.f;
+    uint64_t submeshOffset = 0;   // byte offsets from the start of the file
+    uint64_t vertexOffset = 0;
+    uint64_t vertexBytes = 0;
+    uint64_t indexOffset = 0;
+    uint64_t indexBytes = 0;
+};
+static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader layout is part of the file format");
+
+struct MeshSubmesh {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t  vertexOffset = 0;
+    uint32_t material = 0;
+    float    sphere[4]{};         // object-space bounding sphere (dequantized)
+};
+static_assert(sizeof(MeshSubmesh) == 32, "MeshSubmesh layout is part of the file format");
+
+class MeshFile {
+public:
+    static constexpr uint64_t kPageAlignment = 4096;
+
+    // Maps and validates the file, index values included; throws std::runtime_error("MeshFile: ...")
+    // on bad input.
+    void open(const std::string& path);
+    void close();
+
+    const MeshFileHeader& header() const { return *hdr; }
+    const MeshSubmesh*    submeshes() const { return subs; }
+    uint32_t              submeshCount() const { return hdr->submeshCount; }
+
+    // Point into the mapping; valid until close().
+    const void* vertexData() const { return file.data() + hdr->vertexOffset; }
+    const void* indexData() const { return file.data() + hdr->indexOffset; }
+
+    VertexFormat vertexFormat() const { return static_cast<VertexFormat>(hdr->vertexFormat); }
+
+    // Offline side: writes a file in the layout above. Bounds are computed from the decoded
+    // stream-0 positions; submesh spheres are taken as given.
+    struct WriteDesc {
+        const void*        vertices = nullptr;   // stream-major, see header comment
+        VertexFormat       vertexFormat = VertexFormat::Float32;
+        vtxq::Dequant      dequant{};            // ignored for Float32
+        uint32_t           vertexCount = 0;
+        const void*        indices = nullptr;
+        uint32_t           indexSize = 0;    // 2 or 4
+        uint32_t           indexCount = 0;
+        const MeshSubmesh* submeshes = nullptr;
+        uint32_t           submeshCount = 0;
+    };
+    static void write(const std::string& path, const WriteDesc& desc);
+
+private:
+    MappedFile            file;
+    const MeshFileHeader* hdr = nullptr;
+    const MeshSubmesh*    subs = nullptr;
+};
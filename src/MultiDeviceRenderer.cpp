@@ -0,0 +1,114 @@
+#include "MultiDeviceRenderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+void MultiDeviceRenderer::run(const Config& cfg, const SetupFn& setup) {
+    if (!(cfg.fixedTimestep > 0.f)) throw std::runtime_error("MultiDeviceRenderer: fixedTimestep must be > 0");
+    std::vector<std::unique_ptr<Renderer>> contexts;
+    contexts.push_back(std::make_unique<Renderer>());
+    const std::vector<Renderer::DeviceInfo> devices = contexts[0]->listDevices();
+    uint32_t count = static_cast<uint32_t>(devices.size());
+    if (cfg.maxDevices) count = std::min(count, cfg.maxDevices);
+    if (count == 0) throw std::runtime_error("MultiDeviceRenderer: no suitable GPU found");
+    const VkExtent2D extent = cfg.headless.extent;
+    if (cfg.split == Split::Tiles) count = std::min(count, std::max(extent.height, 1u));   // 1 row per band at least
+
+    deviceStats.assign(count, {});
+    pending.clear();
+    std::mutex outputMutex;   // onFrame and pending
+
+    for (uint32_t d = 0; d < count; ++d) {
+        if (d > 0) contexts.push_back(std::make_unique<Renderer>());
+        Renderer& r = *contexts[d];
+        if (setup) setup(r, d);
+        if (r.workloadConfig().fixedTimestep <= 0.f) {
+            Renderer::WorkloadConfig workload = r.workloadConfig();
+            workload.fixedTimestep = cfg.fixedTimestep;
+            r.setWorkload(workload);
+        }
+        deviceStats[d].name = devices[d].name;
+
+        Renderer::DeviceConfig device;
+        device.index = static_cast<int32_t>(d);
+        device.perDeviceCache = true;
+        r.setDeviceConfig(device);
+        r.setCacheDirectory(cfg.cacheDir);
+
+        Renderer::HeadlessConfig headless = cfg.headless;
+        headless.onFrame = {};
+        if (cfg.split == Split::Frames) {
+            headless.firstFrame = d;
+            headless.frameStride = count;
+            if (cfg.headless.onFrame) {
+                headless.onFrame = [&, fn = cfg.headless.onFrame](const OffscreenTarget::Frame& f) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    fn(f);
+                };
+            }
+        }
+        else {
+            const uint32_t top = static_cast<uint32_t>(uint64_t(extent.height) * d / count);
+            const uint32_t bottom = static_cast<uint32_t>(uint64_t(extent.height) * (d + 1) / count);
+            headless.tile = { { 0, static_cast<int32_t>(top) }, { extent.width, bottom - top } };
+            if (cfg.headless.onFrame) {
+                // Copy the band in; the last one to arrive hands the whole image on
+                headless.onFrame = [&, top, count, fn = cfg.headless.onFrame](const OffscreenTarget::Frame& f) {
+                    const VkDeviceSize imagePitch = f.rowPitch;   // bands are full width
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    auto it = std::find_if(pending.begin(), pending.end(),
+                        [&](const PendingFrame& p) { return p.number == f.number; });
+                    if (it == pending.end()) {
+                        pending.push_back({ f.number, std::vector<unsigned char>(imagePitch * extent.height), 0 });
+                        it = pending.end() - 1;
+                    }
+                    std::memcpy(it->pixels.data() + imagePitch * top, f.pixels, imagePitch * f.extent.height);
+                    if (++it->tiles < count) return;
+
+                    OffscreenTarget::Frame whole = f;
+                    whole.extent = extent;
+                    whole.pixels = it->pixels.data();
+                    fn(whole);
+                    pending.erase(it);
+                };
+            }
+        }
+        r.setHeadless(std::move(headless));
+    }
+
+    // Frames: device d renders the sequence frames d, d + count, ...; Tiles: all of them
+    std::vector<std::string> errors(count);
+    std::vector<std::thread> threads;
+    for (uint32_t d = 0; d < count; ++d) {
+        const uint64_t share = cfg.split == Split::Frames
+            ? (cfg.frames > d ? (cfg.frames - d + count - 1) / count : 0)
+            : cfg.frames;
+        threads.emplace_back([&, d, share] {
+            Renderer& r = *contexts[d];
+            try {
+                r.init(nullptr);
+                const auto start = std::chrono::steady_clock::now();
+                while (r.frameCount() < share) r.drawFrame();
+                r.cleanup();   // delivers the frames still in flight
+                deviceStats[d].frames = share;
+                deviceStats[d].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            catch (const std::exception& e) {
+                errors[d] = e.what();   // the other devices carry on with their shares
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    pending.clear();   // Tiles: bands of frames a failed device never finished
+
+    for (uint32_t d = 0; d < count; ++d)
+        if (!errors[d].empty())
+            throw std::runtime_error("MultiDeviceRenderer: GPU " + std::to_string(d) + " (" + deviceStats[d].name +
+                "): " + errors[d]);
+}
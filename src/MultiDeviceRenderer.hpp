@@ -0,0 +1,65 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Renderer.hpp"
+
+// Explicit multi-GPU for offscreen batch work: one independent headless Renderer per device
+// (its own instance, device, queues, pipeline cache and frame loop), each driven by its own
+// thread. Nothing is shared between the contexts but the output; there is no device group and
+// no cross-device copy, so mixed vendors work as well as identical cards.
+//
+// Split::Frames hands device d of n the frames d, d + n, d + 2n, ... of the sequence; the
+// timestep is always fixed (see Config), so every frame shows the scene at its own sequence
+// time. Split::Tiles renders every frame on every device, each into a horizontal band of the
+// image, and stitches the bands before onFrame sees the frame. Devices are ranked as
+// Renderer::listDevices() does, and every context keeps a per-device pipeline cache and
+// manifest in the shared cache directory.
+//
+// onFrame is called from the device threads, one call at a time. Frames come in order per
+// device but interleave across devices; Frame::number is the position in the sequence.
+//
+// run() blocks until every device has finished its share. Main thread only.
+class MultiDeviceRenderer {
+public:
+    enum class Split { Frames, Tiles };
+
+    struct Config {
+        Split       split = Split::Frames;
+        uint32_t    maxDevices = 0;      // 0 = every suitable device
+        uint64_t    frames = 600;        // of the whole sequence
+        // extent, readbackBuffers and onFrame; the per-device split fields are filled in
+        Renderer::HeadlessConfig headless;
+        std::string cacheDir = "cache";
+        // Scene time per frame when setup leaves WorkloadConfig::fixedTimestep at 0; each
+        // context's wall clock would show bands / interleaved frames at unrelated times. Must be > 0
+        float       fixedTimestep = 1.f / 60.f;
+    };
+    // Before each context's init(): mesh, workload, present config, ...
+    using SetupFn = std::function<void(Renderer& renderer, uint32_t device)>;
+
+    struct DeviceStats {
+        std::string name;
+        uint64_t    frames = 0;
+        double      seconds = 0.0;   // init() done to last frame delivered
+    };
+
+    // Throws std::runtime_error when there is no suitable device or fixedTimestep isn't > 0,
+    // or, once every thread has stopped, with the first device's error
+    void run(const Config& cfg, const SetupFn& setup = {});
+
+    const std::vector<DeviceStats>& stats() const { return deviceStats; }
+
+private:
+    struct PendingFrame {
+        uint64_t                   number = 0;
+        std::vector<unsigned char> pixels;
+        uint32_t                   tiles = 0;   // bands copied in so far
+    };
+
+    std::vector<DeviceStats>  deviceStats;
+    std::vector<PendingFrame> pending;   // Tiles: frames still missing bands (guarded by run()'s mutex)
+};
@@ -0,0 +1,172 @@
+#include "OffscreenTarget.hpp"
+#include "DeletionQueue.hpp"
+#include "FrameTimeline.hpp"
+#include "MemoryBudget.hpp"
+
+#include <stdexcept>
+
+static uint32_t bytesPerPixel(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+void OffscreenTarget::init(VkDevice dev, VmaAllocator alloc, uint32_t imageCount, const Config& cfg,
+    MemoryBudget* budget) {
+    device = dev;
+    allocator = alloc;
+    memory = budget;
+    config = cfg;
+
+    const uint32_t pixelBytes = bytesPerPixel(config.format);
+    if (config.readbackBuffers && pixelBytes == 0)
+        throw std::runtime_error("OffscreenTarget: readback format not supported");
+
+    images.resize(imageCount);
+    for (Image& img : images) {
+        VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+        info.imageType = VK_IMAGE_TYPE_2D;
+        info.extent = { config.extent.width, config.extent.height, 1 };
+        info.mipLevels = 1;
+        info.arrayLayers = 1;
+        info.format = config.format;
+        info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        info.samples = VK_SAMPLE_COUNT_1_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo aci{};
+        aci.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        if (vmaCreateImage(allocator, &info, &aci, &img.image, &img.alloc, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("OffscreenTarget: failed to create image");
+        if (memory) memory->track(img.alloc, MemoryBudget::Category::RenderTargets);
+
+        VkImageViewCreateInfo view{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        view.image = img.image;
+        view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view.format = config.format;
+        view.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        if (vkCreateImageView(device, &view, nullptr, &img.view) != VK_SUCCESS)
+            throw std::runtime_error("OffscreenTarget: failed to create image view");
+    }
+
+    // Cached host memory where there is some: the CPU reads every byte
+    readbacks.resize(config.readbackBuffers);
+    for (Readback& r : readbacks) {
+        VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bi.size = VkDeviceSize(config.extent.width) * config.extent.height * pixelBytes;
+        bi.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo aci{};
+        aci.usage = VMA_MEMORY_USAGE_AUTO;
+        aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+
+        VmaAllocationInfo out{};
+        if (vmaCreateBuffer(allocator, &bi, &aci, &r.buffer, &r.alloc, &out) != VK_SUCCESS)
+            throw std::runtime_error("OffscreenTarget: failed to create readback buffer");
+        if (memory) memory->track(r.alloc, MemoryBudget::Category::Staging);
+        r.mapped = out.pMappedData;
+    }
+    next = 0;
+    acquired = ~0u;
+    delivered = 0;
+}
+
+void OffscreenTarget::destroy() {
+    for (Image& img : images) {
+        if (img.view) vkDestroyImageView(device, img.view, nullptr);
+        if (memory && img.alloc) memory->untrack(img.alloc);
+        if (img.image) vmaDestroyImage(allocator, img.image, img.alloc);
+    }
+    images.clear();
+    for (Readback& r : readbacks) {
+        if (memory && r.alloc) memory->untrack(r.alloc);
+        if (r.buffer) vmaDestroyBuffer(allocator, r.buffer, r.alloc);
+    }
+    readbacks.clear();
+    callback = {};
+    device = VK_NULL_HANDLE;
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+}
+
+void OffscreenTarget::release(DeletionQueue& deletion, uint64_t retireValue) {
+    for (Image& img : images) {
+        deletion.deferImageView(retireValue, img.view);
+        deletion.deferImage(retireValue, img.image, img.alloc);
+    }
+    images.clear();
+    for (Readback& r : readbacks) deletion.deferBuffer(retireValue, r.buffer, r.alloc);
+    readbacks.clear();
+    next = 0;
+    acquired = ~0u;
+}
+
+VkBuffer OffscreenTarget::acquireReadback(FrameTimeline& timeline) {
+    collect(timeline.completed());
+    Readback& r = readbacks[next];
+    if (r.pending) {
+        // Every buffer is in flight: the consumer is behind the GPU, wait for the oldest
+        timeline.wait(r.retireValue);
+        deliver(r);
+    }
+    acquired = next;
+    next = (next + 1) % static_cast<uint32_t>(readbacks.size());
+    return r.buffer;
+}
+
+void OffscreenTarget::submitted(uint64_t retireValue, uint64_t frameNumber) {
+    if (acquired == ~0u) return;
+    Readback& r = readbacks[acquired];
+    r.retireValue = retireValue;
+    r.frameNumber = frameNumber;
+    r.pending = true;
+    acquired = ~0u;
+}
+
+void OffscreenTarget::collect(uint64_t completedValue) {
+    // Ring order from the next buffer to hand out is oldest -> newest
+    const uint32_t n = static_cast<uint32_t>(readbacks.size());
+    for (uint32_t i = 0; i < n; ++i) {
+        Readback& r = readbacks[(next + i) % n];
+        if (!r.pending) continue;
+        if (r.retireValue > completedValue) break;   // in order: later ones wait too
+        deliver(r);
+    }
+}
+
+void OffscreenTarget::drain(FrameTimeline& timeline) {
+    const uint32_t n = static_cast<uint32_t>(readbacks.size());
+    for (uint32_t i = 0; i < n; ++i) {
+        Readback& r = readbacks[(next + i) % n];
+        if (!r.pending) continue;
+        timeline.wait(r.retireValue);
+        deliver(r);
+    }
+}
+
+void OffscreenTarget::deliver(Readback& r) {
+    r.pending = false;
+    ++delivered;
+    if (!callback) return;
+    // No-op on coherent memory; cached non-coherent memory needs it after the GPU write
+    vmaInvalidateAllocation(allocator, r.alloc, 0, VK_WHOLE_SIZE);
+    Frame f{};
+    f.number = r.frameNumber;
+    f.extent = config.extent;
+    f.format = config.format;
+    f.pixels = r.mapped;
+    f.rowPitch = VkDeviceSize(config.extent.width) * bytesPerPixel(config.format);
+    callback(f);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class DeletionQueue;
+class FrameTimeline;
+class MemoryBudget;
+
+// Headless stand-in for the swapchain: color images in device memory plus a ring of
+// host-readable buffers the frame's image is copied into.
+//
+// Image i belongs to frame slot i, so the frame slot's timeline wait already covers its reuse.
+// Readback never stalls the queue: acquireReadback() hands out a free buffer, submitted()
+// tags it with the frame's timeline value and collect() delivers finished frames in order
+// once the GPU is past them. Only when every buffer is still in flight does acquireReadback()
+// block, on the oldest one; that is the back-pressure that keeps a slow consumer from
+// queueing unbounded work. Frames reach the callback in submission order.
+//
+// Main thread only.
+class OffscreenTarget {
+public:
+    struct Config {
+        VkExtent2D extent{ 1280, 720 };
+        VkFormat   format = VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t   readbackBuffers = 0;   // 0 = no readback (pure throughput)
+    };
+
+    // One finished frame, valid for the duration of the callback
+    struct Frame {
+        uint64_t     number;       // as passed to submitted()
+        VkExtent2D   extent;
+        VkFormat     format;
+        const void*  pixels;       // tightly packed rows
+        VkDeviceSize rowPitch;
+    };
+    using ReadbackFn = std::function<void(const Frame&)>;
+
+    void init(VkDevice dev, VmaAllocator alloc, uint32_t imageCount, const Config& cfg,
+        MemoryBudget* budget = nullptr);
+    void destroy();   // immediate; the device must be idle
+    // Resize path: images and buffers go to the deletion queue, the callback stays for the next
+    // init(). drain() first, pending readbacks are dropped.
+    void release(DeletionQueue& deletion, uint64_t retireValue);
+
+    uint32_t    imageCount() const { return static_cast<uint32_t>(images.size()); }
+    VkImage     image(uint32_t i) const { return images[i].image; }
+    VkImageView view(uint32_t i) const { return images[i].view; }
+    VkExtent2D  extent() const { return config.extent; }
+    VkFormat    format() const { return config.format; }
+    bool        readbackEnabled() const { return !readbacks.empty(); }
+
+    void setCallback(ReadbackFn fn) { callback = std::move(fn); }
+
+    // Buffer for this frame's copy. Delivers finished frames first; blocks on the oldest
+    // in-flight buffer only when none is free.
+    VkBuffer acquireReadback(FrameTimeline& timeline);
+    // The buffer from acquireReadback() is written by the submit signalling retireValue
+    void     submitted(uint64_t retireValue, uint64_t frameNumber);
+    // Delivers (in order) every pending frame whose submit has retired
+    void     collect(uint64_t completedValue);
+    // Waits for and delivers everything still pending (shutdown)
+    void     drain(FrameTimeline& timeline);
+
+    uint64_t deliveredFrames() const { return delivered; }
+
+private:
+    struct Image {
+        VkImage       image = VK_NULL_HANDLE;
+        VkImageView   view = VK_NULL_HANDLE;
+        VmaAllocation alloc = VK_NULL_HANDLE;
+    };
+    struct Readback {
+        VkBuffer      buffer = VK_NULL_HANDLE;
+        VmaAllocation alloc = VK_NULL_HANDLE;
+        const void*   mapped = nullptr;
+        uint64_t      retireValue = 0;
+        uint64_t      frameNumber = 0;
+        bool          pending = false;
+    };
+
+    VkDevice      device = VK_NULL_HANDLE;
+    VmaAllocator  allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    Config        config;
+    ReadbackFn    callback;
+
+    std::vector<Image>    images;
+    std::vector<Readback> readbacks;
+    uint32_t              next = 0;       // oldest pending / next to hand out (ring order)
+    uint32_t              acquired = ~0u;
+    uint64_t              delivered = 0;
+
+    void deliver(Readback& r);
+};
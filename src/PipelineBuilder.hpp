@@ -1,8 +1,14 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <array>
 #include <vector>
+#include <string>
+#include <functional>
 #include <stdexcept>
 #include <cstdint>
+#include <cstring>
+
+#include "VertexLayout.hpp"
 
 // Compatibility shim thingy (handles older headers without VK_PIPELINE_CREATE_RENDERING_BIT)
 #ifndef VK_PIPELINE_CREATE_RENDERING_BIT
@@ -14,18 +20,59 @@
 #endif
 
 
+class ShaderObjectPipeline;
+
+// Graphics pipeline state. The builder owns copies of everything it points at (vertex input,
+// entry names, formats), so a copy can be compiled later on another thread; only the shader
+// modules and the layout must stay alive until then.
 class PipelineBuilder {
 public:
+    // VK_EXT_graphics_pipeline_library parts, in link order
+    enum class LibraryPart : uint32_t { VertexInput, PreRasterization, FragmentShader, FragmentOutput };
+    static constexpr uint32_t kLibraryPartCount = 4;
+    using LibrarySet = std::array<VkPipeline, kLibraryPartCount>;
+
+    // Specialization constants of one stage by constant_id; every value is 32 bits (bool as
+    // VkBool32, int, uint, float), so one module covers several permutations
+    struct SpecConstants {
+        std::vector<uint32_t> ids;
+        std::vector<uint32_t> values;
+
+        SpecConstants& set(uint32_t id, uint32_t value);
+        SpecConstants& setBool(uint32_t id, bool value) { return set(id, value ? VK_TRUE : VK_FALSE); }
+        SpecConstants& setFloat(uint32_t id, float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return set(id, bits);
+        }
+        bool empty() const { return ids.empty(); }
+        // Points info at entries and values; valid while both are alive and unmodified
+        void fill(VkSpecializationInfo& info, std::vector<VkSpecializationMapEntry>& entries) const;
+    };
+
     // ----- Lifecycle helpers -----
     PipelineBuilder& reset();                      // clear all state
-    PipelineBuilder& clearStages() { stages.clear(); return *this; }
+    PipelineBuilder& clearStages() {
+        stages.clear(); stageEntries.clear(); stageCodeHashes.clear(); stageSpecs.clear();
+        return *this;
+    }
 
     // ----- Shader Stages -----
-    PipelineBuilder& addStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry = "main");
+    // codeHash identifies the module contents in hash() (e.g. hashBytes(spirv)); 0 = use the
+    // handle, which is only stable while the module lives. spec is copied and part of hash().
+    PipelineBuilder& addStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry = "main",
+        uint64_t codeHash = 0, const SpecConstants& spec = {});
 
     // ----- Vertex Input & Assembly -----
     PipelineBuilder& setVertexInput(const VkVertexInputBindingDescription* bindings, uint32_t bindingCount,
         const VkVertexInputAttributeDescription* attrs, uint32_t attrCount);
+    // From a layout table; positionOnly binds stream 0 / location 0 only (depth, shadow passes)
+    PipelineBuilder& setVertexLayout(const VertexLayoutInfo& layout, bool positionOnly = false);
+    template <VertexFormat F>
+    PipelineBuilder& setVertexLayout(bool positionOnly = false) {
+        static constexpr VertexLayoutInfo info = makeVertexLayoutInfo<F>();
+        return setVertexLayout(info, positionOnly);
+    }
     PipelineBuilder& setInputAssembly(VkPrimitiveTopology topo, VkBool32 primitiveRestart = VK_FALSE);
 
     // ----- Fixed Function States -----
@@ -48,20 +95,90 @@ public:
     PipelineBuilder& setDynamicStates(const std::vector<VkDynamicState>& states);
 
     // ----- Layout / Rendering Formats -----
-    PipelineBuilder& setLayout(VkPipelineLayout layout_);
+    // layoutKey identifies the layout in hash() and across runs (0 = use the handle)
+    PipelineBuilder& setLayout(VkPipelineLayout layout_, uint64_t layoutKey_ = 0);
     PipelineBuilder& setRenderingFormats(const std::vector<VkFormat>& colorFormats,
         VkFormat depthFormat = VK_FORMAT_UNDEFINED);
     PipelineBuilder& setPipelineCache(VkPipelineCache cache_);
 
+    // ----- Identity -----
+    // 64-bit FNV-1a over everything that affects the compiled pipeline: stages, vertex input,
+    // fixed-function state, blend, dynamic states, layout and rendering formats. The cache
+    // handle is not part of it, and viewport/scissor are skipped when dynamic.
+    uint64_t hash() const;
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+    // Hash of only the state that goes into one library part, so pipelines that differ
+    // elsewhere share it (e.g. one vertex-input library for every shader using a layout)
+    uint64_t libraryHash(LibraryPart part) const;
+
+    // ----- Serialization (pipeline manifests) -----
+    // Appends the state to out. Shaders and layout are stored as their codeHash/layoutKey, so
+    // this fails (returns false, out untouched) unless every one of them was given.
+    bool serialize(std::vector<uint8_t>& out) const;
+    // Rebuilds a serialized builder, mapping keys back to live objects. False on a malformed
+    // blob or when a resolver returns VK_NULL_HANDLE.
+    bool deserialize(const void* data, size_t size,
+        const std::function<VkShaderModule(uint64_t codeHash)>& resolveShader,
+        const std::function<VkPipelineLayout(uint64_t layoutKey)>& resolveLayout);
+
     // ----- Final Build -----
+    void validate() const;   // throws what build() would
     VkPipeline build(VkDevice device) const;
 
+    // One vkCreateGraphicsPipelines call for all builders, against cache (their own cache
+    // handles are ignored). Returns the call's result; failed entries are VK_NULL_HANDLE.
+    static VkResult buildBatch(VkDevice device, VkPipelineCache cache,
+        const PipelineBuilder* const* builders, uint32_t count, VkPipeline* out);
+
+    // ----- Graphics pipeline libraries (VK_EXT_graphics_pipeline_library) -----
+    // One part as a library that retains link-time optimization info. Throws on failure.
+    VkPipeline buildLibrary(VkDevice device, VkPipelineCache cache, LibraryPart part) const;
+    // Links the four parts into a pipeline. Without optimize this is the fast link meant for
+    // immediate use; with it the driver runs link-time optimization (as slow as a full build).
+    // Returns VK_NULL_HANDLE on failure.
+    static VkPipeline linkLibraries(VkDevice device, VkPipelineCache cache, const LibrarySet& libraries,
+        VkPipelineLayout layout, bool optimize);
+    VkPipelineLayout pipelineLayout() const { return layout; }
+
 private:
-    // Shader stages
+    friend class ShaderObjectPipeline;   // reads the fixed-function state to set it dynamically
+
+    // Everything VkGraphicsPipelineCreateInfo points at that isn't a builder member
+    struct CreateInfoStorage {
+        std::vector<VkPipelineShaderStageCreateInfo> stages;
+        std::vector<VkSpecializationInfo>            specInfos;     // per stage
+        std::vector<std::vector<VkSpecializationMapEntry>> specEntries;
+        VkPipelineVertexInputStateCreateInfo vertexInput{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+        VkPipelineViewportStateCreateInfo    viewportState{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+        VkPipelineColorBlendStateCreateInfo  colorBlend{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+        VkPipelineDynamicStateCreateInfo     dyn{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+        VkPipelineRenderingCreateInfo        rendering{ VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+        VkGraphicsPipelineCreateInfo         info{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    };
+    // Valid while both the builder and s are alive and unmodified
+    void fillCreateInfo(CreateInfoStorage& s) const;
+    bool isDynamic(VkDynamicState state) const;
+
+    static constexpr uint32_t kSerialVersion = 2;   // 2: specialization constants
+    // Fixed-size state in a stable order, shared by hash() and (de)serialization.
+    // Only scalars, enums and padding-free Vulkan structs.
+    template <class Self, class F> static void visitFixedState(Self& b, F&& f);
+    template <class Self, class F> static void visitAssemblyState(Self& b, F&& f);
+    template <class Self, class F> static void visitRasterState(Self& b, F&& f);
+    template <class Self, class F> static void visitMultisampleState(Self& b, F&& f);
+    template <class Self, class F> static void visitDepthState(Self& b, F&& f);
+    // Hashes the stages for which keep(stage) holds
+    template <class Keep> uint64_t hashStages(uint64_t h, Keep&& keep) const;
+
+    // Shader stages (pName re-pointed at stageEntries when filling)
     std::vector<VkPipelineShaderStageCreateInfo> stages;
+    std::vector<std::string> stageEntries;
+    std::vector<uint64_t>    stageCodeHashes;
+    std::vector<SpecConstants> stageSpecs;
 
     // Vertex input & assembly
-    VkPipelineVertexInputStateCreateInfo   vertexInput{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    std::vector<VkVertexInputBindingDescription>   vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{ VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
 
     // Fixed-function bits
@@ -77,18 +194,20 @@ private:
 
     // Layout / rendering info
     VkPipelineLayout layout = VK_NULL_HANDLE;
+    uint64_t         layoutKey = 0;
     VkPipelineCache  cache = VK_NULL_HANDLE;
 
-    VkPipelineRenderingCreateInfo rendering{ VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
-    std::vector<VkFormat> colorFormatsOwned;
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
 };
 
 // ---------------- Inline definitions ----------------
 
 inline PipelineBuilder& PipelineBuilder::reset() {
-    stages.clear();
+    clearStages();
 
-    vertexInput = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    vertexBindings.clear();
+    vertexAttributes.clear();
     inputAssembly = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
 
     viewport = {};
@@ -103,29 +222,57 @@ inline PipelineBuilder& PipelineBuilder::reset() {
     dynamicStates.clear();
 
     layout = VK_NULL_HANDLE;
+    layoutKey = 0;
     cache = VK_NULL_HANDLE;
 
-    rendering = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
-    colorFormatsOwned.clear();
+    colorFormats.clear();
+    depthFormat = VK_FORMAT_UNDEFINED;
     return *this;
 }
 
-inline PipelineBuilder& PipelineBuilder::addStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry) {
+inline PipelineBuilder::SpecConstants& PipelineBuilder::SpecConstants::set(uint32_t id, uint32_t value) {
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (ids[i] == id) { values[i] = value; return *this; }
+    }
+    ids.push_back(id);
+    values.push_back(value);
+    return *this;
+}
+
+inline void PipelineBuilder::SpecConstants::fill(VkSpecializationInfo& info,
+    std::vector<VkSpecializationMapEntry>& entries) const {
+    entries.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+        entries[i] = { ids[i], static_cast<uint32_t>(i * sizeof(uint32_t)), sizeof(uint32_t) };
+    info.mapEntryCount = static_cast<uint32_t>(entries.size());
+    info.pMapEntries = entries.data();
+    info.dataSize = values.size() * sizeof(uint32_t);
+    info.pData = values.data();
+}
+
+inline PipelineBuilder& PipelineBuilder::addStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry,
+    uint64_t codeHash, const SpecConstants& spec) {
     VkPipelineShaderStageCreateInfo s{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
-    s.stage = stage; s.module = module; s.pName = entry;
+    s.stage = stage; s.module = module;
     stages.push_back(s);
+    stageEntries.emplace_back(entry);
+    stageCodeHashes.push_back(codeHash);
+    stageSpecs.push_back(spec);
     return *this;
 }
 
 inline PipelineBuilder& PipelineBuilder::setVertexInput(const VkVertexInputBindingDescription* bindings, uint32_t bindingCount,
     const VkVertexInputAttributeDescription* attrs, uint32_t attrCount) {
-    vertexInput.vertexBindingDescriptionCount = bindingCount;
-    vertexInput.pVertexBindingDescriptions = bindings;
-    vertexInput.vertexAttributeDescriptionCount = attrCount;
-    vertexInput.pVertexAttributeDescriptions = attrs;
+    vertexBindings.assign(bindings, bindings + bindingCount);
+    vertexAttributes.assign(attrs, attrs + attrCount);
     return *this;
 }
 
+inline PipelineBuilder& PipelineBuilder::setVertexLayout(const VertexLayoutInfo& layout, bool positionOnly) {
+    if (positionOnly) return setVertexInput(layout.positionBinding, 1, layout.positionAttribute, 1);
+    return setVertexInput(layout.bindings, layout.bindingCount, layout.attributes, layout.attributeCount);
+}
+
 inline PipelineBuilder& PipelineBuilder::setInputAssembly(VkPrimitiveTopology topo, VkBool32 primitiveRestart) {
     inputAssembly.topology = topo;
     inputAssembly.primitiveRestartEnable = primitiveRestart;
@@ -157,57 +304,404 @@ inline PipelineBuilder& PipelineBuilder::setColorWriteMask(VkColorComponentFlags
 
 inline PipelineBuilder& PipelineBuilder::setDynamicStates(const std::vector<VkDynamicState>& states) { dynamicStates = states; return *this; }
 
-inline PipelineBuilder& PipelineBuilder::setLayout(VkPipelineLayout layout_) { layout = layout_; return *this; }
-inline PipelineBuilder& PipelineBuilder::setRenderingFormats(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat) {
-    rendering.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
-    colorFormatsOwned = colorFormats;
-    rendering.pColorAttachmentFormats = colorFormatsOwned.empty() ? nullptr : colorFormatsOwned.data();
-    rendering.depthAttachmentFormat = depthFormat;
-    rendering.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+inline PipelineBuilder& PipelineBuilder::setLayout(VkPipelineLayout layout_, uint64_t layoutKey_) {
+    layout = layout_;
+    layoutKey = layoutKey_;
+    return *this;
+}
+inline PipelineBuilder& PipelineBuilder::setRenderingFormats(const std::vector<VkFormat>& colorFormats_, VkFormat depthFormat_) {
+    colorFormats = colorFormats_;
+    depthFormat = depthFormat_;
     return *this;
 }
 inline PipelineBuilder& PipelineBuilder::setPipelineCache(VkPipelineCache cache_) { cache = cache_; return *this; }
 
-inline VkPipeline PipelineBuilder::build(VkDevice device) const {
+inline bool PipelineBuilder::isDynamic(VkDynamicState state) const {
+    for (VkDynamicState d : dynamicStates) if (d == state) return true;
+    return false;
+}
+
+inline uint64_t PipelineBuilder::hashBytes(const void* data, size_t size, uint64_t seed) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) { h ^= p[i]; h *= 0x100000001b3ull; }
+    return h;
+}
+
+template <class Self, class F>
+inline void PipelineBuilder::visitAssemblyState(Self& b, F&& f) {
+    f(b.inputAssembly.topology); f(b.inputAssembly.primitiveRestartEnable);
+}
+
+template <class Self, class F>
+inline void PipelineBuilder::visitRasterState(Self& b, F&& f) {
+    f(b.raster.depthClampEnable); f(b.raster.rasterizerDiscardEnable);
+    f(b.raster.polygonMode); f(b.raster.cullMode); f(b.raster.frontFace);
+    f(b.raster.depthBiasEnable); f(b.raster.depthBiasConstantFactor);
+    f(b.raster.depthBiasClamp); f(b.raster.depthBiasSlopeFactor); f(b.raster.lineWidth);
+}
+
+template <class Self, class F>
+inline void PipelineBuilder::visitMultisampleState(Self& b, F&& f) {
+    f(b.msaa.rasterizationSamples); f(b.msaa.sampleShadingEnable); f(b.msaa.minSampleShading);
+    f(b.msaa.alphaToCoverageEnable); f(b.msaa.alphaToOneEnable);
+}
+
+template <class Self, class F>
+inline void PipelineBuilder::visitDepthState(Self& b, F&& f) {
+    f(b.useDepth);
+    f(b.depth.depthTestEnable); f(b.depth.depthWriteEnable); f(b.depth.depthCompareOp);
+    f(b.depth.depthBoundsTestEnable); f(b.depth.stencilTestEnable);
+    f(b.depth.front); f(b.depth.back);
+    f(b.depth.minDepthBounds); f(b.depth.maxDepthBounds);
+}
+
+template <class Self, class F>
+inline void PipelineBuilder::visitFixedState(Self& b, F&& f) {
+    visitAssemblyState(b, f);
+    visitRasterState(b, f);
+    visitMultisampleState(b, f);
+    visitDepthState(b, f);
+    f(b.depthFormat);
+}
+
+template <class Keep>
+inline uint64_t PipelineBuilder::hashStages(uint64_t h, Keep&& keep) const {
+    auto add = [&h](const auto& v) { h = hashBytes(&v, sizeof(v), h); };
+    uint64_t n = 0;
+    for (const auto& s : stages) if (keep(s.stage)) ++n;
+    add(n);
+    for (size_t i = 0; i < stages.size(); ++i) {
+        if (!keep(stages[i].stage)) continue;
+        add(stages[i].stage);
+        if (stageCodeHashes[i]) add(stageCodeHashes[i]); else add(stages[i].module);
+        h = hashBytes(stageEntries[i].c_str(), stageEntries[i].size() + 1, h);
+        // Only specialized stages hash their constants, so other keys don't change
+        const SpecConstants& spec = stageSpecs[i];
+        if (!spec.empty()) {
+            h = hashBytes(spec.ids.data(), spec.ids.size() * sizeof(uint32_t), h);
+            h = hashBytes(spec.values.data(), spec.values.size() * sizeof(uint32_t), h);
+        }
+    }
+    return h;
+}
+
+inline uint64_t PipelineBuilder::hash() const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto add = [&h](const auto& v) { h = hashBytes(&v, sizeof(v), h); };
+    auto addArray = [&h](const auto& vec) {
+        const uint64_t n = vec.size();
+        h = hashBytes(&n, sizeof(n), h);
+        if (n) h = hashBytes(vec.data(), n * sizeof(vec[0]), h);
+    };
+
+    h = hashStages(h, [](VkShaderStageFlagBits) { return true; });
+
+    addArray(vertexBindings);
+    addArray(vertexAttributes);
+    if (!isDynamic(VK_DYNAMIC_STATE_VIEWPORT)) add(viewport);
+    if (!isDynamic(VK_DYNAMIC_STATE_SCISSOR)) add(scissor);
+    visitFixedState(*this, add);
+
+    addArray(colorAttachments);
+    addArray(dynamicStates);
+    if (layoutKey) add(layoutKey); else add(layout);
+    addArray(colorFormats);
+    return h;
+}
+
+inline uint64_t PipelineBuilder::libraryHash(LibraryPart part) const {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto add = [&h](const auto& v) { h = hashBytes(&v, sizeof(v), h); };
+    auto addArray = [&h](const auto& vec) {
+        const uint64_t n = vec.size();
+        h = hashBytes(&n, sizeof(n), h);
+        if (n) h = hashBytes(vec.data(), n * sizeof(vec[0]), h);
+    };
+    auto addLayout = [&] { if (layoutKey) add(layoutKey); else add(layout); };
+
+    add(part);
+    addArray(dynamicStates);
+    switch (part) {
+    case LibraryPart::VertexInput:
+        addArray(vertexBindings);
+        addArray(vertexAttributes);
+        visitAssemblyState(*this, add);
+        break;
+    case LibraryPart::PreRasterization:
+        h = hashStages(h, [](VkShaderStageFlagBits s) { return s != VK_SHADER_STAGE_FRAGMENT_BIT; });
+        if (!isDynamic(VK_DYNAMIC_STATE_VIEWPORT)) add(viewport);
+        if (!isDynamic(VK_DYNAMIC_STATE_SCISSOR)) add(scissor);
+        visitRasterState(*this, add);
+        addLayout();
+        add(depthFormat);   // the rendering info is part of every library except vertex input
+        addArray(colorFormats);
+        break;
+    case LibraryPart::FragmentShader:
+        h = hashStages(h, [](VkShaderStageFlagBits s) { return s == VK_SHADER_STAGE_FRAGMENT_BIT; });
+        visitMultisampleState(*this, add);
+        visitDepthState(*this, add);
+        addLayout();
+        add(depthFormat);
+        addArray(colorFormats);
+        break;
+    case LibraryPart::FragmentOutput:
+        addArray(colorAttachments);
+        visitMultisampleState(*this, add);
+        add(depthFormat);
+        addArray(colorFormats);
+        break;
+    }
+    return h;
+}
+
+inline bool PipelineBuilder::serialize(std::vector<uint8_t>& out) const {
+    if (layoutKey == 0) return false;
+    for (uint64_t c : stageCodeHashes) if (c == 0) return false;
+
+    auto put = [&out](const auto& v) {
+        const auto* p = reinterpret_cast<const uint8_t*>(&v);
+        out.insert(out.end(), p, p + sizeof(v));
+    };
+    auto putArray = [&](const auto& vec) {
+        put(static_cast<uint32_t>(vec.size()));
+        const auto* p = reinterpret_cast<const uint8_t*>(vec.data());
+        out.insert(out.end(), p, p + vec.size() * sizeof(vec[0]));
+    };
+
+    put(kSerialVersion);
+    put(static_cast<uint32_t>(stages.size()));
+    for (size_t i = 0; i < stages.size(); ++i) {
+        put(stages[i].stage);
+        put(stageCodeHashes[i]);
+        putArray(stageEntries[i]);
+        putArray(stageSpecs[i].ids);
+        putArray(stageSpecs[i].values);
+    }
+    putArray(vertexBindings);
+    putArray(vertexAttributes);
+    put(viewport);
+    put(scissor);
+    visitFixedState(*this, put);
+    putArray(colorAttachments);
+    putArray(dynamicStates);
+    put(layoutKey);
+    putArray(colorFormats);
+    return true;
+}
+
+inline bool PipelineBuilder::deserialize(const void* data, size_t size,
+    const std::function<VkShaderModule(uint64_t)>& resolveShader,
+    const std::function<VkPipelineLayout(uint64_t)>& resolveLayout) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    const auto* end = p + size;
+    bool ok = true;
+
+    auto get = [&](auto& v) {
+        if (!ok || size_t(end - p) < sizeof(v)) { ok = false; return; }
+        std::memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+    };
+    auto getArray = [&](auto& vec) {
+        uint32_t n = 0;
+        get(n);
+        if (!ok || size_t(end - p) / sizeof(vec[0]) < n) { ok = false; return; }
+        vec.resize(n);
+        if (n) std::memcpy(vec.data(), p, n * sizeof(vec[0]));
+        p += n * sizeof(vec[0]);
+    };
+
+    reset();
+    uint32_t version = 0, stageCount = 0;
+    get(version);
+    if (version != kSerialVersion) return false;
+    get(stageCount);
+    for (uint32_t i = 0; ok && i < stageCount; ++i) {
+        VkShaderStageFlagBits stage{};
+        uint64_t codeHash = 0;
+        std::string entry;
+        SpecConstants spec;
+        get(stage);
+        get(codeHash);
+        getArray(entry);
+        getArray(spec.ids);
+        getArray(spec.values);
+        if (!ok || spec.ids.size() != spec.values.size()) return false;
+        const VkShaderModule module = resolveShader(codeHash);
+        if (module == VK_NULL_HANDLE) return false;
+        addStage(stage, module, entry.c_str(), codeHash, spec);
+    }
+    getArray(vertexBindings);
+    getArray(vertexAttributes);
+    get(viewport);
+    get(scissor);
+    visitFixedState(*this, get);
+    getArray(colorAttachments);
+    getArray(dynamicStates);
+    get(layoutKey);
+    getArray(colorFormats);
+    if (!ok || p != end) return false;
+
+    layout = resolveLayout(layoutKey);
+    return layout != VK_NULL_HANDLE;
+}
+
+inline void PipelineBuilder::validate() const {
     if (stages.empty())   throw std::runtime_error("PipelineBuilder: no shader stages added (addStage())");
     if (layout == VK_NULL_HANDLE) throw std::runtime_error("PipelineBuilder: missing layout (setLayout())");
-    if (rendering.colorAttachmentCount == 0 && rendering.depthAttachmentFormat == VK_FORMAT_UNDEFINED)
+    if (colorFormats.empty() && depthFormat == VK_FORMAT_UNDEFINED)
         throw std::runtime_error("PipelineBuilder: no color or depth formats set (setRenderingFormats())");
+}
+
+inline void PipelineBuilder::fillCreateInfo(CreateInfoStorage& s) const {
+    validate();
+
+    s.stages = stages;
+    s.specInfos.assign(stages.size(), VkSpecializationInfo{});
+    s.specEntries.resize(stages.size());
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        s.stages[i].pName = stageEntries[i].c_str();
+        if (stageSpecs[i].empty()) continue;
+        stageSpecs[i].fill(s.specInfos[i], s.specEntries[i]);
+        s.stages[i].pSpecializationInfo = &s.specInfos[i];
+    }
+
+    s.vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindings.size());
+    s.vertexInput.pVertexBindingDescriptions = vertexBindings.empty() ? nullptr : vertexBindings.data();
+    s.vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
+    s.vertexInput.pVertexAttributeDescriptions = vertexAttributes.empty() ? nullptr : vertexAttributes.data();
 
     // Fixed-function groups
-    VkPipelineViewportStateCreateInfo viewportState{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
-    viewportState.viewportCount = 1; viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1; viewportState.pScissors = &scissor;
+    s.viewportState.viewportCount = 1; s.viewportState.pViewports = &viewport;
+    s.viewportState.scissorCount = 1; s.viewportState.pScissors = &scissor;
 
-    VkPipelineColorBlendStateCreateInfo colorBlend{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
-    colorBlend.attachmentCount = static_cast<uint32_t>(colorAttachments.size());
-    colorBlend.pAttachments = colorAttachments.empty() ? nullptr : colorAttachments.data();
+    s.colorBlend.attachmentCount = static_cast<uint32_t>(colorAttachments.size());
+    s.colorBlend.pAttachments = colorAttachments.empty() ? nullptr : colorAttachments.data();
 
-    VkPipelineDynamicStateCreateInfo dyn{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
     if (!dynamicStates.empty()) {
-        dyn.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-        dyn.pDynamicStates = dynamicStates.data();
+        s.dyn.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        s.dyn.pDynamicStates = dynamicStates.data();
     }
 
-    VkGraphicsPipelineCreateInfo info{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
-    info.pNext = &rendering;
+    s.rendering.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+    s.rendering.pColorAttachmentFormats = colorFormats.empty() ? nullptr : colorFormats.data();
+    s.rendering.depthAttachmentFormat = depthFormat;
+    s.rendering.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    VkGraphicsPipelineCreateInfo& info = s.info;
+    info.pNext = &s.rendering;
     info.flags = VK_PIPELINE_CREATE_RENDERING_BIT;
-    info.stageCount = static_cast<uint32_t>(stages.size());
-    info.pStages = stages.data();
-    info.pVertexInputState = &vertexInput;
+    info.stageCount = static_cast<uint32_t>(s.stages.size());
+    info.pStages = s.stages.data();
+    info.pVertexInputState = &s.vertexInput;
     info.pInputAssemblyState = &inputAssembly;
-    info.pViewportState = &viewportState;
+    info.pViewportState = &s.viewportState;
     info.pRasterizationState = &raster;
     info.pMultisampleState = &msaa;
     info.pDepthStencilState = useDepth ? &depth : nullptr;
-    info.pColorBlendState = &colorBlend;
-    info.pDynamicState = dynamicStates.empty() ? nullptr : &dyn;
+    info.pColorBlendState = &s.colorBlend;
+    info.pDynamicState = dynamicStates.empty() ? nullptr : &s.dyn;
     info.layout = layout;
     info.renderPass = VK_NULL_HANDLE;
     info.subpass = 0;
+}
+
+inline VkPipeline PipelineBuilder::build(VkDevice device) const {
+    CreateInfoStorage s;
+    fillCreateInfo(s);
 
     VkPipeline pipe{};
-    if (vkCreateGraphicsPipelines(device, cache, 1, &info, nullptr, &pipe) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, cache, 1, &s.info, nullptr, &pipe) != VK_SUCCESS)
         throw std::runtime_error("PipelineBuilder: vkCreateGraphicsPipelines failed");
     return pipe;
 }
+
+inline VkResult PipelineBuilder::buildBatch(VkDevice device, VkPipelineCache cache,
+    const PipelineBuilder* const* builders, uint32_t count, VkPipeline* out) {
+    if (count == 0) return VK_SUCCESS;
+
+    std::vector<CreateInfoStorage> storage(count);   // sized once: infos point into it
+    std::vector<VkGraphicsPipelineCreateInfo> infos(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        builders[i]->fillCreateInfo(storage[i]);
+        infos[i] = storage[i].info;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) out[i] = VK_NULL_HANDLE;
+    return vkCreateGraphicsPipelines(device, cache, count, infos.data(), nullptr, out);
+}
+
+inline VkPipeline PipelineBuilder::buildLibrary(VkDevice device, VkPipelineCache cache_, LibraryPart part) const {
+    CreateInfoStorage s;
+    fillCreateInfo(s);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT lib{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT };
+    lib.pNext = &s.rendering;
+    VkGraphicsPipelineCreateInfo& info = s.info;
+    info.pNext = &lib;
+    info.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+    auto keepStages = [&](bool fragment) {
+        std::vector<VkPipelineShaderStageCreateInfo> kept;
+        for (const auto& st : s.stages)
+            if ((st.stage == VK_SHADER_STAGE_FRAGMENT_BIT) == fragment) kept.push_back(st);
+        s.stages.swap(kept);
+        info.stageCount = static_cast<uint32_t>(s.stages.size());
+        info.pStages = s.stages.empty() ? nullptr : s.stages.data();
+    };
+
+    // Each part only gets the state the spec assigns to it; the rest must be left out
+    switch (part) {
+    case LibraryPart::VertexInput:
+        lib.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+        info.stageCount = 0; info.pStages = nullptr;
+        info.pViewportState = nullptr; info.pRasterizationState = nullptr;
+        info.pMultisampleState = nullptr; info.pDepthStencilState = nullptr;
+        info.pColorBlendState = nullptr;
+        info.layout = VK_NULL_HANDLE;
+        break;
+    case LibraryPart::PreRasterization:
+        lib.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+        keepStages(false);
+        info.pVertexInputState = nullptr; info.pInputAssemblyState = nullptr;
+        info.pMultisampleState = nullptr; info.pDepthStencilState = nullptr;
+        info.pColorBlendState = nullptr;
+        break;
+    case LibraryPart::FragmentShader:
+        lib.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+        keepStages(true);
+        info.pVertexInputState = nullptr; info.pInputAssemblyState = nullptr;
+        info.pViewportState = nullptr; info.pRasterizationState = nullptr;
+        info.pColorBlendState = nullptr;
+        break;
+    case LibraryPart::FragmentOutput:
+        lib.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+        info.stageCount = 0; info.pStages = nullptr;
+        info.pVertexInputState = nullptr; info.pInputAssemblyState = nullptr;
+        info.pViewportState = nullptr; info.pRasterizationState = nullptr;
+        info.pDepthStencilState = nullptr;
+        info.layout = VK_NULL_HANDLE;
+        break;
+    }
+
+    VkPipeline pipe{};
+    if (vkCreateGraphicsPipelines(device, cache_, 1, &info, nullptr, &pipe) != VK_SUCCESS)
+        throw std::runtime_error("PipelineBuilder: vkCreateGraphicsPipelines failed (library)");
+    return pipe;
+}
+
+inline VkPipeline PipelineBuilder::linkLibraries(VkDevice device, VkPipelineCache cache,
+    const LibrarySet& libraries, VkPipelineLayout layout, bool optimize) {
+    VkPipelineLibraryCreateInfoKHR linkInfo{ VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR };
+    linkInfo.libraryCount = kLibraryPartCount;
+    linkInfo.pLibraries = libraries.data();
+
+    VkGraphicsPipelineCreateInfo info{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    info.pNext = &linkInfo;
+    info.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    info.layout = layout;
+
+    VkPipeline pipe = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &info, nullptr, &pipe) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return pipe;
+}
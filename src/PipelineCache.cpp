@@ -1,7 +1,9 @@
 #include "PipelineCache.hpp"
+#include "MappedFile.hpp"
 
 #include <vector>
 #include <fstream>
+#include <stdexcept>
 #include <filesystem>
 #include <cstdio>
 #include <cstring>
@@ -21,8 +23,9 @@ static std::string toHex(const void* data, size_t bytes) {
     return out;
 }
 
-// Use vendor, device, driver or driverID, api version, and pipelineCacheUUID.
-static std::string makeCachePath(VkPhysicalDevice phys, const std::string& dir) {
+// Use vendor, device, driver or driverID, api version, and pipelineCacheUUID. perDevice adds
+// the deviceUUID, which tells apart identical GPUs in one machine.
+static std::string makeCachePath(VkPhysicalDevice phys, const std::string& dir, bool perDevice) {
     // Properties 1.0
     VkPhysicalDeviceProperties props{};
     vkGetPhysicalDeviceProperties(phys, &props);
@@ -30,8 +33,10 @@ static std::string makeCachePath(VkPhysicalDevice phys, const std::string& dir)
     // Try to fetch driverID (core 1.2) and pipelineCacheUUID (always in props)
     // driverID lives in VkPhysicalDeviceDriverProperties via vkGetPhysicalDeviceProperties2
     uint32_t driverId = 0;
+    VkPhysicalDeviceIDProperties idProps{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
     {
         VkPhysicalDeviceDriverProperties driverProps{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES };
+        driverProps.pNext = &idProps;
         VkPhysicalDeviceProperties2 props2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
         props2.pNext = &driverProps;
         vkGetPhysicalDeviceProperties2(phys, &props2);
@@ -58,60 +63,35 @@ static std::string makeCachePath(VkPhysicalDevice phys, const std::string& dir)
             uuidHex.c_str());
     }
 
+    std::string name = buf;
+    if (perDevice) name.insert(name.size() - 4, "_dev_" + toHex(idProps.deviceUUID, 8));   // before ".bin"
+
     std::error_code ec;
     fs::create_directories(fs::path(dir), ec); // best-effort
-    return (fs::path(dir) / buf).string();
+    return (fs::path(dir) / name).string();
 }
 
-void PipelineCacheManager::init(VkPhysicalDevice phys, VkDevice dev, const std::string& dir) {
-    device = dev;
-    filePath = makeCachePath(phys, dir);
-
-    // Try to load existing cache blob
-    std::vector<char> initialData;
-    std::error_code ec;
-    if (fs::exists(filePath, ec) && !ec) {
-        std::ifstream in(filePath, std::ios::binary | std::ios::ate);
-        if (in) {
-            const auto size = static_cast<size_t>(in.tellg());
-            if (size > 0) {
-                initialData.resize(size);
-                in.seekg(0);
-                in.read(initialData.data(), static_cast<std::streamsize>(size));
-                // If short read, discard
-                if (!in) initialData.clear();
-            }
-        }
-    }
-
-    VkPipelineCacheCreateInfo ci{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
-    if (!initialData.empty()) {
-        ci.initialDataSize = initialData.size();
-        ci.pInitialData = initialData.data();
-    }
-
-    if (vkCreatePipelineCache(device, &ci, nullptr, &cache) != VK_SUCCESS) {
-        cache = VK_NULL_HANDLE; // keep going without cache
-    }
+// Header check before handing a blob to the driver: a truncated or foreign file would at best
+// be rejected by vkCreatePipelineCache and at worst crash a buggy driver.
+static bool isCompatibleBlob(const void* data, size_t size, const VkPhysicalDeviceProperties& props) {
+    VkPipelineCacheHeaderVersionOne h{};
+    if (size < sizeof(h)) return false;
+    std::memcpy(&h, data, sizeof(h));
+    return h.headerSize >= sizeof(h) && h.headerSize <= size &&
+        h.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        h.vendorID == props.vendorID && h.deviceID == props.deviceID &&
+        std::memcmp(h.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
 }
 
-void PipelineCacheManager::save() const {
-    if (!cache || !device || filePath.empty()) return;
-
-    size_t size = 0;
-    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0) return;
-
-    std::vector<char> data(size);
-    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS || size == 0) return;
-
-    // Atomic write: dump to temp, then rename
+// Atomic write: dump to temp, then rename
+static void writeBlob(const std::string& filePath, const std::vector<char>& data) {
     fs::path finalPath(filePath);
     fs::path tempPath = finalPath; tempPath += ".tmp";
 
     {
         std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
         if (!out) return; // best-effort
-        out.write(data.data(), static_cast<std::streamsize>(size));
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
         out.flush();
         if (!out) return;
     }
@@ -126,7 +106,88 @@ void PipelineCacheManager::save() const {
     }
 }
 
+void PipelineCacheManager::init(VkPhysicalDevice phys, VkDevice dev, const std::string& dir, uint32_t threadCacheCount,
+    bool perDevice) {
+    device = dev;
+    filePath = makeCachePath(phys, dir, perDevice);
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(phys, &props);
+
+    // Map the existing blob; the driver copies what it needs out of the mapping
+    MappedFile file;
+    std::error_code ec;
+    if (fs::exists(filePath, ec) && !ec) {
+        try { file.open(filePath); }
+        catch (const std::runtime_error&) { file.close(); }   // empty/unreadable: start fresh
+    }
+
+    VkPipelineCacheCreateInfo ci{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    if (file.isOpen() && isCompatibleBlob(file.data(), file.size(), props)) {
+        ci.initialDataSize = file.size();
+        ci.pInitialData = file.data();
+    }
+
+    if (vkCreatePipelineCache(device, &ci, nullptr, &cache) != VK_SUCCESS) {
+        cache = VK_NULL_HANDLE; // keep going without cache
+        return;
+    }
+    savedSize = ci.initialDataSize;
+
+    // Only ever touched by their own thread (plus merges under the registry's lock)
+    ci.flags = VK_PIPELINE_CACHE_CREATE_EXTERNALLY_SYNCHRONIZED_BIT;
+    for (uint32_t i = 0; i < threadCacheCount; ++i) {
+        VkPipelineCache c = VK_NULL_HANDLE;
+        if (vkCreatePipelineCache(device, &ci, nullptr, &c) != VK_SUCCESS) break;
+        perThread.push_back(c);
+    }
+}
+
+bool PipelineCacheManager::fetch(std::vector<char>& data) const {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0) return false;
+    data.resize(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS || size == 0) return false;
+    data.resize(size);
+    return true;
+}
+
+void PipelineCacheManager::save() {
+    joinWriter();
+    if (!cache || !device || filePath.empty()) return;
+
+    std::vector<char> data;
+    if (!fetch(data)) return;
+    writeBlob(filePath, data);
+    savedSize = data.size();
+}
+
+bool PipelineCacheManager::saveIfGrown(size_t minGrowth) {
+    if (!cache || !device || filePath.empty()) return false;
+    if (writer.joinable()) {
+        if (writing.load(std::memory_order_acquire)) return false;   // previous one still going
+        writer.join();
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) return false;
+    if (size < savedSize + minGrowth) return false;
+
+    std::vector<char> data;
+    if (!fetch(data)) return false;
+    savedSize = data.size();
+    writing.store(true, std::memory_order_release);
+    writer = std::thread([this, path = filePath, blob = std::move(data)] {
+        writeBlob(path, blob);
+        writing.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
 void PipelineCacheManager::destroy() {
+    joinWriter();
+    for (VkPipelineCache c : perThread) vkDestroyPipelineCache(device, c, nullptr);
+    perThread.clear();
     if (cache) {
         save();
         vkDestroyPipelineCache(device, cache, nullptr);
@@ -134,4 +195,5 @@ void PipelineCacheManager::destroy() {
     }
     device = VK_NULL_HANDLE;
     filePath.clear();
+    savedSize = 0;
 }
@@ -1,7 +1,22 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstddef>
 
+// On-disk VkPipelineCache, one file per driver (see makeCachePath), or per device where
+// several GPUs share a cache directory.
+//
+// Load maps the file and checks the VkPipelineCacheHeaderVersionOne against this device before
+// the driver sees it. Compile threads get their own externally synchronized caches
+// (threadCaches()) so they never contend on the main one; their contents are folded back
+// with vkMergePipelineCaches (PipelineRegistry::mergeThreadCaches). saveIfGrown() writes the
+// blob on a background thread once it has grown, so a crash loses at most one interval.
+//
+// Threading: merges into get() and saveIfGrown() must stay on the thread that owns the
+// cache (the render thread); other use of get() is internally synchronized.
 class PipelineCacheManager {
 public:
     PipelineCacheManager() = default;
@@ -16,22 +31,38 @@ public:
         return *this;
     }
 
-    void init(VkPhysicalDevice phys, VkDevice dev, const std::string& dir = "cache");
+    // threadCacheCount caches are created seeded with the loaded blob. perDevice keys the file by
+    // the device UUID too, so identical GPUs keep separate files.
+    void init(VkPhysicalDevice phys, VkDevice dev, const std::string& dir = "cache", uint32_t threadCacheCount = 0,
+        bool perDevice = false);
     void destroy();
 
-    void save() const;
+    void save();   // synchronous; waits for a background save in flight
+    // Kick a background save if the cache grew by at least minGrowth bytes since the last one
+    bool saveIfGrown(size_t minGrowth = 64u << 10);
 
     VkPipelineCache get() const { return cache; }
+    const std::vector<VkPipelineCache>& threadCaches() const { return perThread; }
     const std::string& path() const { return filePath; }
 
 private:
     VkDevice device = VK_NULL_HANDLE;
     VkPipelineCache cache = VK_NULL_HANDLE;
+    std::vector<VkPipelineCache> perThread;
     std::string filePath;
+    size_t savedSize = 0;     // blob size at the last save / load
+    std::thread writer;       // background save in flight
+    std::atomic<bool> writing{ false };
+
+    bool fetch(std::vector<char>& data) const;
+    void joinWriter() { if (writer.joinable()) writer.join(); }
 
     void moveFrom(PipelineCacheManager& other) noexcept {
+        other.joinWriter();
         device = other.device;   other.device = VK_NULL_HANDLE;
         cache = other.cache;    other.cache = VK_NULL_HANDLE;
+        perThread = std::move(other.perThread);
         filePath = std::move(other.filePath);
+        savedSize = other.savedSize;
     }
 };
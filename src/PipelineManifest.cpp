@@ -0,0 +1,121 @@
+#include "PipelineManifest.hpp"
+#include "PipelineBuilder.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+void PipelineManifest::load(const std::string& path) {
+    filePath = path;
+    recs.clear();
+    keys.clear();
+    read(path);
+    dirty = false;
+}
+
+size_t PipelineManifest::merge(const std::string& path) {
+    const size_t added = read(path);
+    if (added) dirty = true;
+    return added;
+}
+
+size_t PipelineManifest::read(const std::string& path) {
+    std::error_code ec;
+    if (path.empty() || !fs::exists(path, ec) || ec) return 0;
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return 0;
+    const auto size = static_cast<size_t>(in.tellg());
+    std::vector<uint8_t> data(size);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+    if (!in) return 0;
+
+    // Validate everything before taking any record
+    uint32_t hdr[3]{};
+    if (size < sizeof(hdr)) return 0;
+    std::memcpy(hdr, data.data(), sizeof(hdr));
+    if (hdr[0] != kMagic || hdr[1] != kVersion) return 0;
+
+    std::vector<Record> parsed;
+    size_t at = (sizeof(hdr) + 7) & ~size_t(7);
+    for (uint32_t i = 0; i < hdr[2]; ++i) {
+        uint64_t key = 0;
+        uint32_t bytes = 0;
+        if (size - std::min(at, size) < sizeof(key) + sizeof(uint32_t) * 2) return 0;
+        std::memcpy(&key, data.data() + at, sizeof(key));
+        std::memcpy(&bytes, data.data() + at + sizeof(key), sizeof(bytes));
+        at += sizeof(key) + sizeof(uint32_t) * 2;
+        if (size - at < bytes) return 0;
+
+        Record r;
+        r.key = key;
+        r.state.assign(data.data() + at, data.data() + at + bytes);
+        parsed.push_back(std::move(r));
+        at = (at + bytes + 7) & ~size_t(7);
+    }
+
+    size_t added = 0;
+    for (Record& r : parsed) {
+        if (!keys.insert(r.key).second) continue;
+        recs.push_back(std::move(r));
+        ++added;
+    }
+    return added;
+}
+
+void PipelineManifest::save() {
+    if (!dirty || filePath.empty()) return;
+
+    std::vector<uint8_t> data;
+    auto put = [&data](const void* p, size_t n) {
+        const auto* b = static_cast<const uint8_t*>(p);
+        data.insert(data.end(), b, b + n);
+    };
+    auto pad = [&data] { data.resize((data.size() + 7) & ~size_t(7), 0); };
+
+    const uint32_t hdr[3] = { kMagic, kVersion, static_cast<uint32_t>(recs.size()) };
+    put(hdr, sizeof(hdr));
+    pad();
+    for (const Record& r : recs) {
+        const uint32_t sizeAndPad[2] = { static_cast<uint32_t>(r.state.size()), 0 };
+        put(&r.key, sizeof(r.key));
+        put(sizeAndPad, sizeof(sizeAndPad));
+        put(r.state.data(), r.state.size());
+        pad();
+    }
+
+    // Atomic write: dump to temp, then rename (same as the cache blob)
+    std::error_code ec;
+    fs::path finalPath(filePath);
+    if (finalPath.has_parent_path()) fs::create_directories(finalPath.parent_path(), ec);
+    fs::path tempPath = finalPath; tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return; // best-effort
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        out.flush();
+        if (!out) return;
+    }
+    fs::rename(tempPath, finalPath, ec);
+    if (ec) {
+        fs::remove(finalPath, ec);
+        fs::rename(tempPath, finalPath, ec);
+    }
+    if (!ec) dirty = false;
+}
+
+bool PipelineManifest::record(uint64_t key, const PipelineBuilder& builder) {
+    if (keys.count(key)) return false;
+    Record r;
+    r.key = key;
+    if (!builder.serialize(r.state)) return false;
+    keys.insert(key);
+    recs.push_back(std::move(r));
+    dirty = true;
+    return true;
+}
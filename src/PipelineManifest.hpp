@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <cstdint>
+
+class PipelineBuilder;
+
+// List of every pipeline the game has built, as serialized PipelineBuilder state keyed by
+// PipelineBuilder::hash(). Unlike the VkPipelineCache blob it does not depend on the driver,
+// so after a driver update (or on a fresh machine, from a manifest shipped with the game) the
+// registry can recompile everything in the background before the first frame asks for it.
+//
+// File: "PMAN" | version | count | { key u64, size u32, pad u32, state[size] padded to 8 }...
+// Not thread-safe; PipelineRegistry calls record() under its own lock.
+class PipelineManifest {
+public:
+    struct Record {
+        uint64_t key = 0;
+        std::vector<uint8_t> state;   // PipelineBuilder::serialize()
+    };
+
+    // Reads path (a missing or invalid file leaves the manifest empty) and remembers it for save()
+    void load(const std::string& path);
+    // Adds the records of another manifest, e.g. the prebuilt one. Returns how many were new.
+    size_t merge(const std::string& path);
+    // Atomic write to the load() path; no-op if nothing changed
+    void save();
+
+    // False if the key is known already or the builder can't be serialized
+    bool record(uint64_t key, const PipelineBuilder& builder);
+
+    const std::vector<Record>& records() const { return recs; }
+    size_t size() const { return recs.size(); }
+    const std::string& path() const { return filePath; }
+
+private:
+    static constexpr uint32_t kMagic = 0x4E414D50;   // "PMAN"
+    static constexpr uint32_t kVersion = 1;
+
+    std::string               filePath;
+    std::vector<Record>       recs;
+    std::unordered_set<uint64_t> keys;
+    bool                      dirty = false;
+
+    size_t read(const std::string& path);
+};
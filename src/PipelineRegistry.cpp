@@ -0,0 +1,364 @@
+#include "PipelineRegistry.hpp"
+#include "PipelineManifest.hpp"
+
+#include <stdexcept>
+
+void PipelineRegistry::init(VkDevice dev, VkPipelineCache cache_, uint32_t compileThreads,
+    const VkPipelineCache* threadCaches) {
+    if (!workers.empty()) return;
+
+    device = dev;
+    cache = cache_;
+    quit = false;
+    if (compileThreads == 0) compileThreads = 1;
+    if (threadCaches) {
+        workerCaches = std::make_unique<WorkerCache[]>(compileThreads);
+        for (uint32_t i = 0; i < compileThreads; ++i) workerCaches[i].cache = threadCaches[i];
+    }
+    workers.reserve(compileThreads);
+    for (uint32_t i = 0; i < compileThreads; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+void PipelineRegistry::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        queue.clear();
+        optimizeQueue.clear();
+    }
+    wake.notify_all();
+    for (auto& t : workers) if (t.joinable()) t.join();
+    workers.clear();
+
+    for (auto& [key, e] : entries) {
+        if (e.pipeline) vkDestroyPipeline(device, e.pipeline, nullptr);
+    }
+    entries.clear();
+    for (VkPipeline p : retired) vkDestroyPipeline(device, p, nullptr);
+    retired.clear();
+    for (auto& [key, lib] : libraries) vkDestroyPipeline(device, lib, nullptr);
+    libraries.clear();
+    pending = 0;
+    workerCaches.reset();   // owned by the caller
+    device = VK_NULL_HANDLE;
+    cache = VK_NULL_HANDLE;
+}
+
+PipelineRegistry::Key PipelineRegistry::request(const PipelineBuilder& builder, VkPipeline fallback) {
+    builder.validate();
+    const Key key = builder.hash();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, inserted] = entries.try_emplace(key);
+        if (!inserted) return key;   // dedupe: queued, compiling or done already
+
+        Entry& e = it->second;
+        e.fallback = fallback;
+        e.builder = std::make_unique<PipelineBuilder>(builder);
+        queue.push_back(key);
+        ++pending;
+        if (manifest) manifest->record(key, builder);
+    }
+    wake.notify_one();
+    return key;
+}
+
+void PipelineRegistry::createBatch(const PipelineBuilder* const* builders, uint32_t count, VkPipeline* out) {
+    std::vector<Key> keys(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        builders[i]->validate();
+        keys[i] = builders[i]->hash();
+    }
+
+    // Claim misses and still-queued requests; anything a worker is compiling we wait for
+    std::vector<Key> mine;
+    std::vector<const PipelineBuilder*> toCompile;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto [it, inserted] = entries.try_emplace(keys[i]);
+            Entry& e = it->second;
+            if (!inserted && e.state != State::Queued) continue;
+            if (inserted) {
+                ++pending;
+                if (manifest) manifest->record(keys[i], *builders[i]);
+            }
+            e.state = State::Compiling;   // workers skip the stale queue key
+            e.builder.reset();
+            mine.push_back(keys[i]);
+            toCompile.push_back(builders[i]);
+        }
+    }
+
+    if (!toCompile.empty()) {
+        const uint32_t n = static_cast<uint32_t>(toCompile.size());
+        std::vector<VkPipeline> made(n, VK_NULL_HANDLE);
+        std::vector<Linked> linked(fastLink ? n : 0);
+        Linked* linkedOut = fastLink ? linked.data() : nullptr;
+        try {
+            compile(cache, toCompile.data(), n, made.data(), linkedOut);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            publish(mine.data(), made.data(), n, nullptr);
+            done.notify_all();
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            publish(mine.data(), made.data(), n, linkedOut);
+        }
+        done.notify_all();
+        if (fastLink) wake.notify_all();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] {
+        for (Key k : keys) {
+            const State s = entries.at(k).state;
+            if (s == State::Queued || s == State::Compiling) return false;
+        }
+        return true;
+    });
+    for (uint32_t i = 0; i < count; ++i) {
+        const Entry& e = entries.at(keys[i]);
+        if (e.state == State::Failed) throw std::runtime_error("PipelineRegistry: vkCreateGraphicsPipelines failed");
+        out[i] = e.pipeline;
+    }
+}
+
+VkPipeline PipelineRegistry::require(const PipelineBuilder& builder) {
+    const PipelineBuilder* b = &builder;
+    VkPipeline pipe = VK_NULL_HANDLE;
+    createBatch(&b, 1, &pipe);
+    return pipe;
+}
+
+uint32_t PipelineRegistry::mergeThreadCaches(bool wait) {
+    if (!workerCaches || !cache) return 0;
+
+    uint32_t merged = 0;
+    for (uint32_t i = 0; i < workers.size(); ++i) {
+        WorkerCache& w = workerCaches[i];
+        std::unique_lock<std::mutex> lock(w.mutex, std::defer_lock);
+        if (wait) lock.lock();
+        else if (!lock.try_lock()) continue;
+        if (vkMergePipelineCaches(device, cache, 1, &w.cache) == VK_SUCCESS) ++merged;
+    }
+    return merged;
+}
+
+void PipelineRegistry::takeRetired(std::vector<VkPipeline>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.insert(out.end(), retired.begin(), retired.end());
+    retired.clear();
+}
+
+void PipelineRegistry::setManifest(PipelineManifest* m) {
+    std::lock_guard<std::mutex> lock(mutex);
+    manifest = m;
+}
+
+size_t PipelineRegistry::prewarm(const PipelineManifest& source,
+    const std::function<VkShaderModule(uint64_t)>& resolveShader,
+    const std::function<VkPipelineLayout(uint64_t)>& resolveLayout) {
+    size_t queued = 0;
+    for (const PipelineManifest::Record& r : source.records()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (entries.count(r.key)) continue;
+        }
+        PipelineBuilder b;
+        if (!b.deserialize(r.state.data(), r.state.size(), resolveShader, resolveLayout)) continue;
+        try {
+            request(b);
+            ++queued;
+        }
+        catch (const std::runtime_error&) {
+            // Stale or hand-edited record: skip it, the pipeline will compile on first use
+        }
+    }
+    return queued;
+}
+
+VkPipeline PipelineRegistry::get(Key key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) return VK_NULL_HANDLE;
+    return it->second.state == State::Ready ? it->second.pipeline : it->second.fallback;
+}
+
+bool PipelineRegistry::ready(Key key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    return it != entries.end() && (it->second.state == State::Ready || it->second.state == State::Failed);
+}
+
+bool PipelineRegistry::failed(Key key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    return it != entries.end() && it->second.state == State::Failed;
+}
+
+bool PipelineRegistry::release(Key key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) return true;
+    if (it->second.state == State::Queued || it->second.state == State::Compiling) return false;
+    if (it->second.pipeline) retired.push_back(it->second.pipeline);
+    entries.erase(it);   // a queued optimized relink finds nothing and is skipped
+    return true;
+}
+
+void PipelineRegistry::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+}
+
+size_t PipelineRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t PipelineRegistry::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+void PipelineRegistry::compile(VkPipelineCache c, const PipelineBuilder* const* builders, uint32_t count,
+    VkPipeline* out, Linked* linked) {
+    if (!linked) {
+        PipelineBuilder::buildBatch(device, c, builders, count, out);
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        out[i] = VK_NULL_HANDLE;
+        try {
+            for (uint32_t part = 0; part < PipelineBuilder::kLibraryPartCount; ++part) {
+                linked[i].libraries[part] =
+                    getLibrary(*builders[i], static_cast<PipelineBuilder::LibraryPart>(part), c);
+            }
+        }
+        catch (const std::runtime_error&) {
+            continue;
+        }
+        linked[i].layout = builders[i]->pipelineLayout();
+        out[i] = PipelineBuilder::linkLibraries(device, c, linked[i].libraries, linked[i].layout, false);
+    }
+}
+
+VkPipeline PipelineRegistry::getLibrary(const PipelineBuilder& builder, PipelineBuilder::LibraryPart part,
+    VkPipelineCache c) {
+    const uint64_t key = builder.libraryHash(part);
+    {
+        std::lock_guard<std::mutex> lock(libraryMutex);
+        auto it = libraries.find(key);
+        if (it != libraries.end()) return it->second;
+    }
+
+    // Built outside the lock; if another thread got there first, keep theirs
+    VkPipeline lib = builder.buildLibrary(device, c, part);
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    auto [it, inserted] = libraries.try_emplace(key, lib);
+    if (!inserted) vkDestroyPipeline(device, lib, nullptr);
+    return it->second;
+}
+
+void PipelineRegistry::publish(const Key* keys, const VkPipeline* pipelines, uint32_t count, const Linked* linked) {
+    for (uint32_t i = 0; i < count; ++i) {
+        Entry& e = entries.at(keys[i]);
+        e.pipeline = pipelines[i];
+        e.state = pipelines[i] ? State::Ready : State::Failed;
+        --pending;
+        if (linked && pipelines[i]) {
+            e.linked = linked[i];
+            optimizeQueue.push_back(keys[i]);
+        }
+    }
+}
+
+void PipelineRegistry::workerLoop(uint32_t index) {
+    for (;;) {
+        std::vector<Key> keys;
+        std::vector<std::unique_ptr<PipelineBuilder>> owned;
+        Key optimizeKey = 0;
+        Linked optimize;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || !queue.empty() || !optimizeQueue.empty(); });
+            if (quit) return;
+
+            while (!queue.empty() && keys.size() < kMaxBatch) {
+                const Key k = queue.front();
+                queue.pop_front();
+                auto it = entries.find(k);
+                if (it == entries.end() || it->second.state != State::Queued) continue;
+                it->second.state = State::Compiling;
+                owned.push_back(std::move(it->second.builder));
+                keys.push_back(k);
+            }
+            // New pipelines first; optimized relinks only when nothing is waiting
+            while (keys.empty() && !optimize.layout && !optimizeQueue.empty()) {
+                optimizeKey = optimizeQueue.front();
+                optimizeQueue.pop_front();
+                auto it = entries.find(optimizeKey);
+                if (it != entries.end()) optimize = it->second.linked;   // else released meanwhile
+            }
+        }
+        if (keys.empty()) {
+            if (!optimize.layout) continue;
+            VkPipeline made = VK_NULL_HANDLE;
+            if (workerCaches) {
+                WorkerCache& w = workerCaches[index];
+                std::lock_guard<std::mutex> cacheLock(w.mutex);
+                made = PipelineBuilder::linkLibraries(device, w.cache, optimize.libraries, optimize.layout, true);
+            }
+            else {
+                made = PipelineBuilder::linkLibraries(device, cache, optimize.libraries, optimize.layout, true);
+            }
+            // On failure the fast-linked pipeline simply stays
+            if (made) {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = entries.find(optimizeKey);
+                if (it == entries.end()) retired.push_back(made);
+                else {
+                    retired.push_back(it->second.pipeline);
+                    it->second.pipeline = made;
+                }
+            }
+            continue;
+        }
+
+        std::vector<const PipelineBuilder*> ptrs;
+        ptrs.reserve(owned.size());
+        for (const auto& b : owned) ptrs.push_back(b.get());
+
+        // Failures leave VK_NULL_HANDLE: the entry keeps serving its fallback
+        const uint32_t n = static_cast<uint32_t>(keys.size());
+        std::vector<VkPipeline> made(n, VK_NULL_HANDLE);
+        std::vector<Linked> linked(fastLink ? n : 0);
+        Linked* linkedOut = fastLink ? linked.data() : nullptr;
+        try {
+            if (workerCaches) {
+                WorkerCache& w = workerCaches[index];
+                std::lock_guard<std::mutex> cacheLock(w.mutex);
+                compile(w.cache, ptrs.data(), n, made.data(), linkedOut);
+            }
+            else {
+                compile(cache, ptrs.data(), n, made.data(), linkedOut);
+            }
+        }
+        catch (...) {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            publish(keys.data(), made.data(), n, linkedOut);
+        }
+        done.notify_all();
+        if (fastLink) wake.notify_one();
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include "PipelineBuilder.hpp"
+
+class PipelineManifest;
+
+// Deduplicating store of graphics pipelines keyed by PipelineBuilder::hash().
+//
+// request() never blocks: a miss copies the builder and queues it for the registry's compile
+// threads, and get() returns the caller's fallback pipeline until the real one is ready.
+// Workers drain the queue in batches, one vkCreateGraphicsPipelines call per batch. Given
+// per-thread caches (PipelineCacheManager::threadCaches()) each worker compiles into its own
+// and mergeThreadCaches() folds them into the main one; otherwise all share the main cache.
+// createBatch() is the blocking path for pipelines needed right away and uses the main cache.
+//
+// In fast-link mode (VK_EXT_graphics_pipeline_library) a miss builds or reuses the four library
+// parts and links them without optimization, which is quick enough to do on first use. The
+// workers then relink each pipeline with link-time optimization and swap it in; get() starts
+// returning the new handle and the old one goes to takeRetired() for deferred destruction.
+//
+// The registry owns every pipeline it creates. Shader modules and layouts of queued requests
+// must stay alive until ready() (or waitIdle()) reports them done.
+class PipelineRegistry {
+public:
+    using Key = uint64_t;
+
+    PipelineRegistry() = default;
+    ~PipelineRegistry() { destroy(); }
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    // threadCaches, if given, holds compileThreads externally synchronized caches
+    void init(VkDevice dev, VkPipelineCache cache, uint32_t compileThreads = 1,
+        const VkPipelineCache* threadCaches = nullptr);
+    // Drops queued requests, waits for running compiles, destroys every pipeline.
+    // The device must be idle.
+    void destroy();
+
+    // Queue a compile on a miss. fallback is what get() returns until the pipeline exists
+    // (and if compiling it fails). Validates the builder on the calling thread.
+    Key request(const PipelineBuilder& builder, VkPipeline fallback = VK_NULL_HANDLE);
+
+    // Blocking: compiles all misses on the calling thread in one vkCreateGraphicsPipelines
+    // call and waits for any already being compiled by a worker. Throws if one fails.
+    void createBatch(const PipelineBuilder* const* builders, uint32_t count, VkPipeline* out);
+    VkPipeline require(const PipelineBuilder& builder);
+
+    // Call before the first request; needs the device extension enabled
+    void setFastLink(bool on) { fastLink = on; }
+    bool fastLinkEnabled() const { return fastLink; }
+    // Appends the pipelines replaced by optimized ones since the last call. The caller destroys
+    // them once no command buffer uses them.
+    void takeRetired(std::vector<VkPipeline>& out);
+
+    // Every new key that can be serialized is recorded here (nullptr = off)
+    void setManifest(PipelineManifest* m);
+    // request() every manifest record whose shaders and layout resolve, so they compile in
+    // the background. The resolved modules must live until waitIdle(). Returns how many
+    // were queued (records already known are skipped).
+    size_t prewarm(const PipelineManifest& manifest,
+        const std::function<VkShaderModule(uint64_t codeHash)>& resolveShader,
+        const std::function<VkPipelineLayout(uint64_t layoutKey)>& resolveLayout);
+
+    // vkMergePipelineCaches of every worker cache into the main one. Caches busy compiling are
+    // skipped unless wait. Call from the thread that owns the main cache, like createBatch().
+    uint32_t mergeThreadCaches(bool wait = false);
+
+    VkPipeline get(Key key) const;     // ready pipeline, else the fallback
+    bool       ready(Key key) const;   // compiled or failed
+    bool       failed(Key key) const;
+    // Forgets a ready() key whose pipeline nothing will request again (e.g. built from a
+    // shader that was reloaded); the pipeline goes to takeRetired(). False while it compiles.
+    bool       release(Key key);
+    void       waitIdle();             // until nothing is queued or compiling
+
+    size_t size() const;
+    size_t pendingCount() const;
+
+private:
+    static constexpr uint32_t kMaxBatch = 8;
+
+    enum class State : uint8_t { Queued, Compiling, Ready, Failed };
+    // What a fast-linked pipeline was made from, for the optimized relink
+    struct Linked {
+        PipelineBuilder::LibrarySet libraries{};
+        VkPipelineLayout            layout = VK_NULL_HANDLE;
+    };
+    struct Entry {
+        State state = State::Queued;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipeline fallback = VK_NULL_HANDLE;
+        std::unique_ptr<PipelineBuilder> builder;   // queued requests only
+        Linked linked;                              // fast-linked entries awaiting optimization
+    };
+
+    VkDevice          device = VK_NULL_HANDLE;
+    VkPipelineCache   cache = VK_NULL_HANDLE;
+    PipelineManifest* manifest = nullptr;   // guarded by mutex
+
+    mutable std::mutex              mutex;
+    std::condition_variable         wake;   // workers: queue non-empty or quit
+    std::condition_variable         done;   // waiters: some compile finished
+    std::unordered_map<Key, Entry>  entries;
+    std::deque<Key>                 queue;  // may hold keys createBatch() took over
+    size_t                          pending = 0;   // entries Queued or Compiling
+    bool                            quit = false;
+    std::vector<std::thread>        workers;
+
+    // Fast link
+    bool                            fastLink = false;
+    std::deque<Key>                 optimizeQueue;   // guarded by mutex
+    std::vector<VkPipeline>         retired;         // guarded by mutex
+    std::mutex                      libraryMutex;
+    std::unordered_map<uint64_t, VkPipeline> libraries;   // PipelineBuilder::libraryHash()
+
+    // Held by a worker while it compiles into its cache, and by merges
+    struct WorkerCache {
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        std::mutex      mutex;
+    };
+    std::unique_ptr<WorkerCache[]> workerCaches;   // one per worker, or null
+
+    void workerLoop(uint32_t index);
+    // buildBatch(), or with linked (fast link) one library link per builder; failures are
+    // VK_NULL_HANDLE
+    void compile(VkPipelineCache c, const PipelineBuilder* const* builders, uint32_t count,
+        VkPipeline* out, Linked* linked);
+    // Shared across pipelines; throws if the library can't be built
+    VkPipeline getLibrary(const PipelineBuilder& builder, PipelineBuilder::LibraryPart part, VkPipelineCache c);
+    // Called with the lock held; results come from one compile() call
+    void publish(const Key* keys, const VkPipeline* pipelines, uint32_t count, const Linked* linked);
+};
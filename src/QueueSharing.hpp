@@ -0,0 +1,33 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// Queue families a resource is used from at the same time.
+//
+// Empty (the default) keeps resources EXCLUSIVE. With async compute on, resources both the
+// graphics and the compute queue touch in one frame (frame uniforms, indirect buffers, the
+// Hi-Z pyramid) are created CONCURRENT over both families instead of moving ownership back
+// and forth every frame. Depth and other attachments stay exclusive: concurrent images can
+// lose compression.
+struct QueueSharing {
+    uint32_t familyCount = 0;
+    uint32_t families[2]{};
+
+    static QueueSharing between(uint32_t a, uint32_t b) {
+        QueueSharing s;
+        if (a == b) return s;
+        s.familyCount = 2;
+        s.families[0] = a;
+        s.families[1] = b;
+        return s;
+    }
+
+    [[nodiscard]] bool concurrent() const { return familyCount > 1; }
+
+    template <class CreateInfo>   // VkBufferCreateInfo / VkImageCreateInfo
+    void apply(CreateInfo& info) const {
+        info.sharingMode = concurrent() ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        info.queueFamilyIndexCount = concurrent() ? familyCount : 0;
+        info.pQueueFamilyIndices = concurrent() ? families : nullptr;
+    }
+};
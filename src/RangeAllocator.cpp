@@ -0,0 +1,89 @@
+#include "RangeAllocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+void RangeAllocator::init(uint64_t capacity) {
+    total = capacity;
+    reset();
+}
+
+void RangeAllocator::reset() {
+    blocks.clear();
+    freeTotal = total;
+    if (total > 0) blocks.emplace(0, total);
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+    if (size == 0) return kInvalid;
+    if (alignment == 0) alignment = 1;
+
+    // Best fit: smallest block that still fits after aligning its start
+    auto best = blocks.end();
+    uint64_t bestWaste = kInvalid;
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        const uint64_t aligned = (it->first + alignment - 1) / alignment * alignment;
+        const uint64_t pad = aligned - it->first;
+        if (it->second < pad || it->second - pad < size) continue;
+        const uint64_t waste = it->second - size;
+        if (waste < bestWaste) {
+            best = it;
+            bestWaste = waste;
+            if (waste == pad) break;   // exact fit
+        }
+    }
+    if (best == blocks.end()) return kInvalid;
+
+    const uint64_t blockOffset = best->first;
+    const uint64_t blockSize = best->second;
+    const uint64_t offset = (blockOffset + alignment - 1) / alignment * alignment;
+    const uint64_t pad = offset - blockOffset;
+    blocks.erase(best);
+
+    // Keep the alignment pad and the tail as free blocks
+    if (pad > 0) blocks.emplace(blockOffset, pad);
+    const uint64_t tail = blockSize - pad - size;
+    if (tail > 0) blocks.emplace(offset + size, tail);
+
+    freeTotal -= size;
+    return offset;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size) {
+    if (size == 0) return;
+    if (offset > total || size > total - offset) throw std::runtime_error("RangeAllocator: free out of range");
+
+    auto next = blocks.lower_bound(offset);
+    if (next != blocks.end() && next->first < offset + size)
+        throw std::runtime_error("RangeAllocator: double free");
+    if (next != blocks.begin() && std::prev(next)->first + std::prev(next)->second > offset)
+        throw std::runtime_error("RangeAllocator: double free");
+
+    freeTotal += size;
+
+    // Coalesce with the following block
+    if (next != blocks.end() && next->first == offset + size) {
+        size += next->second;
+        next = blocks.erase(next);
+    }
+    // Coalesce with the preceding block
+    if (next != blocks.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    blocks.emplace_hint(next, offset, size);
+}
+
+uint64_t RangeAllocator::largestFree() const {
+    uint64_t largest = 0;
+    for (const auto& b : blocks) largest = std::max(largest, b.second);
+    return largest;
+}
+
+float RangeAllocator::fragmentation() const {
+    if (freeTotal == 0) return 0.f;
+    return 1.f - static_cast<float>(largestFree()) / static_cast<float>(freeTotal);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <map>
+
+// Free-list sub-allocator over an abstract [0, capacity) range (bytes, vertices, indices...).
+//
+// Free blocks are kept sorted by offset so free() can coalesce with both neighbours in
+// O(log n). allocate() is best-fit, which keeps large blocks intact for large meshes.
+class RangeAllocator {
+public:
+    static constexpr uint64_t kInvalid = ~0ull;
+
+    void init(uint64_t capacity);
+    void reset();   // everything free again
+
+    // Returns the offset of the block, or kInvalid if no free block fits.
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+    void     free(uint64_t offset, uint64_t size);
+
+    uint64_t capacity() const { return total; }
+    uint64_t used() const { return total - freeTotal; }
+    uint64_t freeSpace() const { return freeTotal; }
+    uint64_t largestFree() const;
+    size_t   freeBlockCount() const { return blocks.size(); }
+
+    // 0 = all free space is one block, -> 1 as it splinters
+    float fragmentation() const;
+
+private:
+    uint64_t total = 0;
+    uint64_t freeTotal = 0;
+    std::map<uint64_t, uint64_t> blocks;   // offset -> size
+};
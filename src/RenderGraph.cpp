@@ -0,0 +1,416 @@
+#include "RenderGraph.hpp"
+#include "GpuProfiler.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+// ---------------- Declaration ----------------
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(Resource r, const Use& use, uint32_t baseLevel, uint32_t levelCount) {
+    graph.passes[pass].accesses.push_back({ r.id, use, baseLevel, levelCount, false, false });
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(Resource r, const Use& use, bool discard,
+    uint32_t baseLevel, uint32_t levelCount) {
+    graph.passes[pass].accesses.push_back({ r.id, use, baseLevel, levelCount, true, discard });
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect() {
+    graph.passes[pass].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::asyncCompute() {
+    graph.passes[pass].async = true;
+    return *this;
+}
+
+void RenderGraph::init(TransientAllocator* transients, GpuProfiler* profiler, bool asyncCompute) {
+    transientAllocator = transients;
+    gpuProfiler = profiler;
+    asyncEnabled = asyncCompute;
+    imageBarriers.reserve(16);
+    bufferBarriers.reserve(16);
+}
+
+void RenderGraph::reset() {
+    resources.clear();
+    passes.clear();
+    schedule.clear();
+    segments.clear();
+}
+
+RenderGraph::Resource RenderGraph::add(const char* name, bool isImage, VkImageAspectFlags aspect, uint32_t levels) {
+    ResourceData r;
+    r.name = name;
+    r.isImage = isImage;
+    r.aspect = aspect;
+    r.levels = std::max(levels, 1u);
+    r.state.assign(r.levels, Level{});
+    resources.push_back(std::move(r));
+    return Resource{ static_cast<uint32_t>(resources.size() - 1) };
+}
+
+RenderGraph::Resource RenderGraph::importImage(const char* name, VkImageAspectFlags aspect, uint32_t levels) {
+    return add(name, true, aspect, levels);
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const char* name) {
+    return add(name, false, 0, 1);
+}
+
+RenderGraph::Resource RenderGraph::createImage(const char* name, const TransientAllocator::Desc& desc) {
+    const Resource r = add(name, true, desc.aspect, 1);
+    resources[r.id].created = true;
+    resources[r.id].desc = desc;
+    return r;
+}
+
+void RenderGraph::resetState(ResourceData& r) {
+    r.state.assign(r.levels, Level{});
+}
+
+void RenderGraph::setImage(Resource r, VkImage image, VkImageView view, uint32_t levels) {
+    ResourceData& d = resources[r.id];
+    if (levels) d.levels = levels;
+    if (d.image != image || d.state.size() != d.levels) resetState(d);
+    d.image = image;
+    d.view = view;
+}
+
+void RenderGraph::setBuffer(Resource r, VkBuffer buffer) {
+    ResourceData& d = resources[r.id];
+    if (d.buffer != buffer) resetState(d);
+    d.buffer = buffer;
+}
+
+void RenderGraph::setInitialState(Resource r, const Use& use) {
+    resources[r.id].hasInitial = true;
+    resources[r.id].initial = use;
+}
+
+void RenderGraph::setFinalState(Resource r, const Use& use) {
+    resources[r.id].hasFinal = true;
+    resources[r.id].final = use;
+    resources[r.id].output = true;
+}
+
+void RenderGraph::markOutput(Resource r) {
+    resources[r.id].output = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name, RecordFn record, bool statistics) {
+    Pass p;
+    p.name = name;
+    p.record = std::move(record);
+    p.statistics = statistics;
+    passes.push_back(std::move(p));
+    return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+// ---------------- Compile ----------------
+
+void RenderGraph::compile() {
+    const size_t passCount = passes.size();
+
+    // Dependencies in declaration order: read-after-write keeps producers alive; write-after-read
+    // and write-after-write only order
+    std::vector<std::vector<uint32_t>> producers(passCount);   // RAW
+    std::vector<std::vector<uint32_t>> before(passCount);      // all edges into the pass
+    {
+        std::vector<uint32_t> lastWriter(resources.size(), ~0u);
+        std::vector<std::vector<uint32_t>> readers(resources.size());
+        for (uint32_t p = 0; p < passCount; ++p) {
+            for (const Access& a : passes[p].accesses) {
+                const uint32_t w = lastWriter[a.resource];
+                if (!a.write) {
+                    if (w != ~0u && w != p) { producers[p].push_back(w); before[p].push_back(w); }
+                    readers[a.resource].push_back(p);
+                    continue;
+                }
+                if (w != ~0u && w != p) before[p].push_back(w);
+                for (uint32_t r : readers[a.resource]) if (r != p) before[p].push_back(r);
+                readers[a.resource].clear();
+                lastWriter[a.resource] = p;
+            }
+        }
+    }
+
+    // Culling: keep side effects, writers of outputs, and whatever they read from
+    std::vector<bool> live(passCount, false);
+    std::vector<uint32_t> stack;
+    for (uint32_t p = 0; p < passCount; ++p) {
+        bool root = passes[p].sideEffect;
+        for (const Access& a : passes[p].accesses) root |= a.write && resources[a.resource].output;
+        if (root) { live[p] = true; stack.push_back(p); }
+    }
+    while (!stack.empty()) {
+        const uint32_t p = stack.back();
+        stack.pop_back();
+        for (uint32_t q : producers[p]) {
+            if (!live[q]) { live[q] = true; stack.push_back(q); }
+        }
+    }
+
+    // Schedule: among ready passes prefer one that doesn't depend on the pass just placed, so a
+    // barrier has other work to hide behind; ties keep declaration order
+    schedule.clear();
+    std::vector<uint32_t> waiting(passCount, 0);
+    for (uint32_t p = 0; p < passCount; ++p) {
+        if (!live[p]) continue;
+        std::sort(before[p].begin(), before[p].end());
+        before[p].erase(std::unique(before[p].begin(), before[p].end()), before[p].end());
+        for (uint32_t q : before[p]) waiting[p] += live[q] ? 1u : 0u;
+    }
+    std::vector<bool> placed(passCount, false);
+    uint32_t last = ~0u;
+    for (;;) {
+        uint32_t pick = ~0u;
+        for (uint32_t p = 0; p < passCount; ++p) {
+            if (!live[p] || placed[p] || waiting[p] != 0) continue;
+            const bool dependsOnLast = std::binary_search(before[p].begin(), before[p].end(), last);
+            if (pick == ~0u) pick = p;
+            if (!dependsOnLast) { pick = p; break; }
+        }
+        if (pick == ~0u) break;
+        placed[pick] = true;
+        schedule.push_back(pick);
+        last = pick;
+        for (uint32_t p = 0; p < passCount; ++p) {
+            if (live[p] && !placed[p] && std::binary_search(before[p].begin(), before[p].end(), pick)) --waiting[p];
+        }
+    }
+
+    // Queues: an async pass only moves if a later pass depends on it (the graphics submit that
+    // waits for it retires it too) and it doesn't touch created images
+    for (Pass& p : passes) p.queue = Queue::Graphics;
+    if (asyncEnabled) {
+        for (uint32_t i = 0; i < schedule.size(); ++i) {
+            Pass& p = passes[schedule[i]];
+            if (!p.async) continue;
+            bool eligible = true;
+            for (const Access& a : p.accesses) eligible &= !resources[a.resource].created;
+            bool joined = false;
+            for (uint32_t j = i + 1; j < schedule.size() && !joined; ++j)
+                joined = std::binary_search(before[schedule[j]].begin(), before[schedule[j]].end(), schedule[i]);
+            if (eligible && joined) p.queue = Queue::Compute;
+        }
+    }
+    segments.clear();
+    for (uint32_t i = 0; i < schedule.size(); ++i) {
+        const Queue q = passes[schedule[i]].queue;
+        if (segments.empty() || segments.back().queue != q) segments.push_back({ q, i, 0 });
+        ++segments.back().count;
+    }
+
+    // Created images: lifetime = first..last scheduled use; unused ones aren't allocated
+    bool anyCreated = false;
+    for (uint32_t id = 0; id < resources.size(); ++id) {
+        ResourceData& r = resources[id];
+        if (!r.created) continue;
+        uint32_t first = ~0u, lastUse = 0;
+        for (uint32_t i = 0; i < schedule.size(); ++i) {
+            for (const Access& a : passes[schedule[i]].accesses) {
+                if (a.resource != id) continue;
+                first = std::min(first, i);
+                lastUse = std::max(lastUse, i);
+            }
+        }
+        if (first == ~0u) continue;
+        if (!transientAllocator) throw std::runtime_error("RenderGraph: created images need a TransientAllocator");
+        r.desc.firstPass = first;
+        r.desc.lastPass = lastUse;
+        r.transient = transientAllocator->declare(r.desc);
+        anyCreated = true;
+    }
+    if (anyCreated) {
+        transientAllocator->build();
+        for (ResourceData& r : resources) {
+            if (!r.transient.valid()) continue;
+            r.image = transientAllocator->image(r.transient);
+            r.view = transientAllocator->view(r.transient);
+            r.aliased = transientAllocator->aliases(r.transient);
+            resetState(r);
+        }
+    }
+}
+
+// ---------------- Execute ----------------
+
+uint32_t RenderGraph::asyncPassCount() const {
+    uint32_t n = 0;
+    for (uint32_t p : schedule) n += passes[p].queue == Queue::Compute ? 1u : 0u;
+    return n;
+}
+
+void RenderGraph::transition(ResourceData& r, const Access& a, Queue queue) {
+    const uint32_t base = std::min(a.baseLevel, r.levels - 1);
+    const uint32_t count = a.levelCount == kAllLevels ? r.levels - base : std::min(a.levelCount, r.levels - base);
+
+    // First use of an aliased image: whatever last used the shared memory must finish first
+    VkPipelineStageFlags2 aliasStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 aliasAccess = 0;
+    if (r.aliased && !r.touched) {
+        for (const ResourceData& o : resources) {
+            if (!o.aliased || &o == &r) continue;
+            for (const Level& l : o.state) { aliasStages |= l.writeStage | l.readStages; aliasAccess |= l.writeAccess; }
+        }
+    }
+    r.touched = true;
+
+    for (uint32_t level = base; level < base + count; ++level) {
+        Level& s = r.state[level];
+        // Last used on the other queue: the submit's semaphore wait orders it and makes its writes
+        // available; a layout change is all that's left, chained to the wait by its stages
+        if (s.queue != queue && (s.writeStage | s.readStages) != VK_PIPELINE_STAGE_2_NONE) {
+            crossQueueStages |= a.use.stage;
+            const bool relayout = r.isImage && (a.discard || s.layout != a.use.layout);
+            s = { relayout ? a.use.stage : VK_PIPELINE_STAGE_2_NONE, 0, VK_PIPELINE_STAGE_2_NONE, 0, s.layout, queue };
+        }
+        s.queue = queue;
+        const bool layoutChange = r.isImage && (a.discard || s.layout != a.use.layout);
+
+        VkPipelineStageFlags2 srcStage = aliasStages;
+        VkAccessFlags2 srcAccess = aliasAccess;
+        if (a.write || layoutChange) {
+            // WAR needs only execution order; WAW / RAW also make the write available
+            srcStage |= s.writeStage | s.readStages;
+            srcAccess |= s.writeAccess;
+            if (srcStage == VK_PIPELINE_STAGE_2_NONE && !layoutChange) {
+                s = { a.use.stage, a.use.access, VK_PIPELINE_STAGE_2_NONE, 0, a.use.layout, queue };
+                continue;
+            }
+        }
+        else {
+            const bool unsynced = (a.use.stage & ~s.readStages) || (a.use.access & ~s.readAccess);
+            if (s.writeStage == VK_PIPELINE_STAGE_2_NONE || !unsynced) {
+                s.readStages |= a.use.stage;
+                s.readAccess |= a.use.access;
+                continue;
+            }
+            srcStage |= s.writeStage;
+            srcAccess |= s.writeAccess;
+        }
+
+        const VkImageLayout oldLayout = a.discard ? VK_IMAGE_LAYOUT_UNDEFINED : s.layout;
+        if (r.isImage) {
+            // Extend the previous barrier when it covers the level below with the same transition
+            VkImageMemoryBarrier2* prev = imageBarriers.empty() ? nullptr : &imageBarriers.back();
+            if (prev && prev->image == r.image && prev->srcStageMask == srcStage && prev->srcAccessMask == srcAccess &&
+                prev->dstStageMask == a.use.stage && prev->dstAccessMask == a.use.access &&
+                prev->oldLayout == oldLayout && prev->newLayout == a.use.layout &&
+                prev->subresourceRange.baseMipLevel + prev->subresourceRange.levelCount == level) {
+                ++prev->subresourceRange.levelCount;
+            }
+            else {
+                VkImageMemoryBarrier2 b{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+                b.srcStageMask = srcStage;
+                b.srcAccessMask = srcAccess;
+                b.dstStageMask = a.use.stage;
+                b.dstAccessMask = a.use.access;
+                b.oldLayout = oldLayout;
+                b.newLayout = a.use.layout;
+                b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.image = r.image;
+                b.subresourceRange.aspectMask = r.aspect;
+                b.subresourceRange.baseMipLevel = level;
+                b.subresourceRange.levelCount = 1;
+                b.subresourceRange.baseArrayLayer = 0;
+                b.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                imageBarriers.push_back(b);
+            }
+        }
+        else {
+            VkBufferMemoryBarrier2 b{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+            b.srcStageMask = srcStage;
+            b.srcAccessMask = srcAccess;
+            b.dstStageMask = a.use.stage;
+            b.dstAccessMask = a.use.access;
+            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.buffer = r.buffer;
+            b.offset = 0;
+            b.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(b);
+        }
+
+        // A layout transition is a write the next reader has to wait for
+        if (a.write || layoutChange)
+            s = { a.use.stage, a.write ? a.use.access : 0, a.write ? VK_PIPELINE_STAGE_2_NONE : a.use.stage,
+                  a.write ? 0 : a.use.access, a.use.layout, queue };
+        else {
+            s.readStages |= a.use.stage;
+            s.readAccess |= a.use.access;
+        }
+    }
+}
+
+void RenderGraph::flushBarriers(VkCommandBuffer cmd) {
+    if (imageBarriers.empty() && bufferBarriers.empty()) return;
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dep.pImageMemoryBarriers = imageBarriers.data();
+    dep.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dep.pBufferMemoryBarriers = bufferBarriers.data();
+    vkCmdPipelineBarrier2(cmd, &dep);
+    imageBarriers.clear();
+    bufferBarriers.clear();
+    ++lastBatches;
+}
+
+const std::vector<RenderGraph::Submission>& RenderGraph::execute(VkCommandBuffer cmd, const BeginFn& begin) {
+    lastBatches = 0;
+    submissions.clear();
+    for (ResourceData& r : resources) {
+        r.touched = false;
+        if (r.hasInitial) {
+            for (Level& l : r.state)
+                l = { r.initial.stage, r.initial.access, VK_PIPELINE_STAGE_2_NONE, 0, r.initial.layout, Queue::Graphics };
+        }
+        else if (r.created) {
+            for (Level& l : r.state) l.layout = VK_IMAGE_LAYOUT_UNDEFINED;   // contents don't survive the frame
+        }
+    }
+
+    bool cmdUsed = false;
+    for (const Segment& seg : segments) {
+        VkCommandBuffer c = cmd;
+        if (seg.queue == Queue::Compute || cmdUsed) {
+            if (!begin) throw std::runtime_error("RenderGraph: more than one submit needs a BeginFn");
+            c = begin(seg.queue);
+        }
+        cmdUsed |= seg.queue == Queue::Graphics;
+
+        crossQueueStages = VK_PIPELINE_STAGE_2_NONE;
+        for (uint32_t i = seg.first; i < seg.first + seg.count; ++i) {
+            const Pass& pass = passes[schedule[i]];
+            auto run = [&] {
+                for (const Access& a : pass.accesses) transition(resources[a.resource], a, seg.queue);
+                flushBarriers(c);
+                if (pass.record) pass.record(c);
+            };
+            if (gpuProfiler && seg.queue == Queue::Graphics) {
+                GpuProfiler::Scope scope(*gpuProfiler, c, pass.name, pass.statistics);
+                run();
+            }
+            else run();
+        }
+        submissions.push_back({ seg.queue, c, crossQueueStages });
+    }
+    // Compute segments are always followed by a graphics one, so this is the frame's last submit
+    if (submissions.empty()) submissions.push_back({ Queue::Graphics, cmd, VK_PIPELINE_STAGE_2_NONE });
+
+    Submission& last = submissions.back();
+    crossQueueStages = VK_PIPELINE_STAGE_2_NONE;
+    for (ResourceData& r : resources) {
+        if (!r.hasFinal) continue;
+        const Access a{ 0, r.final, 0, kAllLevels, false, false };
+        transition(r, a, Queue::Graphics);
+    }
+    flushBarriers(last.cmd);
+    last.waitStages |= crossQueueStages;
+    return submissions;
+}
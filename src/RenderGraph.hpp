@@ -0,0 +1,196 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "TransientAllocator.hpp"
+
+class GpuProfiler;
+
+// Frame graph: passes declare what they read and write, the graph places the barriers.
+//
+// Built once per swapchain (re)creation: import external resources, create pass-local images,
+// add passes, compile(). compile() drops passes whose results nothing needs, schedules the rest
+// (a topological order that puts independent work between producers and consumers), and
+// places the created images in the TransientAllocator by the resulting pass lifetimes.
+//
+// execute() runs every frame. Before each pass it batches the Sync2 barriers its accesses need
+// into one vkCmdPipelineBarrier2, from state tracked per resource and mip level: reads after
+// reads cost nothing, a layout only changes when a use asks for a different one. The state
+// survives frames, so next frame's first use syncs against this frame's last; an imported
+// resource rebound to a new handle starts over (the caller knows its old work has retired, e.g.
+// per-frame-slot buffers after the timeline wait). Created images are discarded at frame
+// start. Barriers inside a pass (mip chains, fill -> dispatch) stay with the pass.
+//
+// Async compute: with init(..., asyncCompute = true), passes marked asyncCompute() run on the
+// compute queue when a later pass in the frame depends on them, so every compute submit is
+// waited on by a graphics one and the frame's last graphics submit still retires the frame.
+// Passes touching created images stay on graphics (transients are exclusive to its family);
+// imported resources an async pass uses must be CONCURRENT (QueueSharing). execute() then
+// returns one Submission per run of same-queue passes; a hazard against the other queue
+// becomes a semaphore wait on its latest signal instead of a barrier. Async passes aren't
+// profiled: the profiler's queries are reset on the graphics queue.
+//
+// Main thread only.
+class RenderGraph {
+public:
+    static constexpr uint32_t kAllLevels = ~0u;
+
+    enum class Queue : uint32_t { Graphics, Compute };
+
+    struct Resource {
+        uint32_t id = ~0u;
+        [[nodiscard]] bool valid() const { return id != ~0u; }
+    };
+
+    struct Use {
+        VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        access = 0;
+        VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;   // images only
+    };
+
+    using RecordFn = std::function<void(VkCommandBuffer)>;
+    // Hands out a begun primary command buffer for another submit on `queue`
+    using BeginFn = std::function<VkCommandBuffer(Queue)>;
+
+    struct Submission {
+        Queue                 queue = Queue::Graphics;
+        VkCommandBuffer       cmd = VK_NULL_HANDLE;
+        // Stages that wait for the other queue's latest timeline signal; NONE = no wait
+        VkPipelineStageFlags2 waitStages = VK_PIPELINE_STAGE_2_NONE;
+    };
+
+    class PassBuilder {
+    public:
+        PassBuilder& read(Resource r, const Use& use, uint32_t baseLevel = 0, uint32_t levelCount = kAllLevels);
+        // discard: previous contents aren't needed (clears), the layout comes from UNDEFINED
+        PassBuilder& write(Resource r, const Use& use, bool discard = false,
+            uint32_t baseLevel = 0, uint32_t levelCount = kAllLevels);
+        // Never culled, even when nothing reads what it writes
+        PassBuilder& sideEffect();
+        // May run on the async compute queue (compute-only work)
+        PassBuilder& asyncCompute();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& g, uint32_t p) : graph(g), pass(p) {}
+        RenderGraph& graph;
+        uint32_t     pass;
+    };
+
+    // transients: where created images live; profiler (optional): one scope per pass;
+    // asyncCompute: the caller submits Compute submissions to a compute-family queue
+    void init(TransientAllocator* transients, GpuProfiler* profiler = nullptr, bool asyncCompute = false);
+    // Drops passes and resources; created images stay with the TransientAllocator's release()
+    void reset();
+
+    Resource importImage(const char* name, VkImageAspectFlags aspect, uint32_t levels = 1);
+    Resource importBuffer(const char* name);
+    // desc's pass range is filled in by compile()
+    Resource createImage(const char* name, const TransientAllocator::Desc& desc);
+
+    // levels: mip count of the new handle (0 keeps the current one)
+    void setImage(Resource r, VkImage image, VkImageView view = VK_NULL_HANDLE, uint32_t levels = 0);
+    void setBuffer(Resource r, VkBuffer buffer);
+    // State the resource is in when each frame starts (e.g. swapchain image after acquire)
+    void setInitialState(Resource r, const Use& use);
+    // Transition after the last pass (e.g. to PRESENT_SRC); marks the resource as an output
+    void setFinalState(Resource r, const Use& use);
+    // Read after the frame (next frame, the host): its writers are never culled
+    void markOutput(Resource r);
+
+    PassBuilder addPass(const char* name, RecordFn record, bool statistics = false);
+
+    void compile();
+    // cmd: the open graphics command buffer, used for the first graphics submit; begin supplies
+    // the others. Returns the submits in order, all still open: the caller ends and submits them.
+    const std::vector<Submission>& execute(VkCommandBuffer cmd, const BeginFn& begin = {});
+
+    VkImage     image(Resource r) const { return resources[r.id].image; }
+    VkImageView view(Resource r) const { return resources[r.id].view; }
+    VkBuffer    buffer(Resource r) const { return resources[r.id].buffer; }
+    uint32_t    passCount() const { return static_cast<uint32_t>(passes.size()); }
+    uint32_t    scheduledPassCount() const { return static_cast<uint32_t>(schedule.size()); }
+    uint32_t    asyncPassCount() const;
+    // Barrier batches recorded by the last execute()
+    uint32_t    barrierBatches() const { return lastBatches; }
+
+private:
+    struct Level {
+        VkPipelineStageFlags2 writeStage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2        writeAccess = 0;
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;   // since the write, already synced
+        VkAccessFlags2        readAccess = 0;
+        VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        Queue                 queue = Queue::Graphics;                  // of the accesses above
+    };
+
+    struct ResourceData {
+        const char*        name = "";
+        bool               isImage = false;
+        bool               created = false;     // pass-local, TransientAllocator-backed
+        bool               output = false;
+        bool               hasInitial = false;
+        bool               hasFinal = false;
+        bool               aliased = false;     // shares memory with another created image
+        bool               touched = false;     // used yet this frame
+        VkImageAspectFlags aspect = 0;
+        uint32_t           levels = 1;
+        TransientAllocator::Desc   desc{};
+        TransientAllocator::Handle transient;
+        Use                initial{};
+        Use                final{};
+        VkImage            image = VK_NULL_HANDLE;
+        VkImageView        view = VK_NULL_HANDLE;
+        VkBuffer           buffer = VK_NULL_HANDLE;
+        std::vector<Level> state;               // per mip level (one for buffers)
+    };
+
+    struct Access {
+        uint32_t resource;
+        Use      use;
+        uint32_t baseLevel;
+        uint32_t levelCount;
+        bool     write;
+        bool     discard;
+    };
+
+    struct Pass {
+        const char*         name;
+        RecordFn            record;
+        bool                statistics = false;
+        bool                sideEffect = false;
+        bool                async = false;     // asked for the compute queue
+        Queue               queue = Queue::Graphics;   // where compile() put it
+        std::vector<Access> accesses;
+    };
+
+    // Consecutive scheduled passes on one queue: one submit
+    struct Segment {
+        Queue    queue;
+        uint32_t first;   // into schedule
+        uint32_t count;
+    };
+
+    TransientAllocator* transientAllocator = nullptr;
+    GpuProfiler*        gpuProfiler = nullptr;
+    bool                asyncEnabled = false;
+
+    std::vector<ResourceData> resources;
+    std::vector<Pass>         passes;
+    std::vector<uint32_t>     schedule;   // pass indices in execution order
+    std::vector<Segment>      segments;
+    std::vector<Submission>   submissions;
+    VkPipelineStageFlags2     crossQueueStages = VK_PIPELINE_STAGE_2_NONE;   // of the segment being recorded
+
+    std::vector<VkImageMemoryBarrier2>  imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    uint32_t                            lastBatches = 0;
+
+    Resource add(const char* name, bool isImage, VkImageAspectFlags aspect, uint32_t levels);
+    void     resetState(ResourceData& r);
+    // One access from `queue` against the tracked state; appends to the pending barrier batch
+    void     transition(ResourceData& r, const Access& a, Queue queue);
+    void     flushBarriers(VkCommandBuffer cmd);
+};
@@ -6,9 +6,10 @@
 #include <stdexcept>
 #include <limits>
 #include <algorithm>
-#include <fstream>
 #include <array>
 #include <cstring>
+#include <cstddef>
+#include <cmath>
 
 // glm for MVP
 #define GLM_FORCE_RADIANS
@@ -36,19 +37,6 @@
 # endif
 #endif
 
-// --------- file loader (safer) ----------
-static std::vector<char> readFile(const std::string& path) {
-    std::ifstream f(path, std::ios::binary | std::ios::ate);
-    if (!f) throw std::runtime_error("Shader open failed: " + path);
-    const auto size = static_cast<size_t>(f.tellg());
-    if (size == 0) throw std::runtime_error("Shader empty or unreadable: " + path);
-    std::vector<char> data(size);
-    f.seekg(0);
-    f.read(data.data(), static_cast<std::streamsize>(size));
-    if (!f) throw std::runtime_error("Shader short read: " + path);
-    return data;
-}
-
 // ---------------- Debug callback ----------------
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -76,12 +64,8 @@ static bool hasLayer(const char* name) {
     return false;
 }
 
-// Device-level debug utils function pointers for naming/markers
-static PFN_vkSetDebugUtilsObjectNameEXT pSetName = nullptr;
-static PFN_vkCmdBeginDebugUtilsLabelEXT pBeginLabel = nullptr;
-static PFN_vkCmdEndDebugUtilsLabelEXT   pEndLabel = nullptr;
-
 // ---------------- Vertex data ----------------
+// Source data for the built-in triangle; quantized to VertexFormat::Snorm16 on load.
 struct Vertex {
     glm::vec3 pos;
     glm::vec3 color;
@@ -93,36 +77,87 @@ static const std::vector<Vertex> gVertices = {
 };
 static const std::vector<uint16_t> gIndices = { 0, 1, 2 };
 
+static constexpr uint64_t kPresentWaitTimeoutNs = 100'000'000;
+
 // ---------------- Public API ----------------
+void Renderer::setPresentConfig(const PresentConfig& config) {
+    present = config;
+    if (swapchain) framebufferResized = true;   // new mode / image count at the next frame
+}
+
 void Renderer::init(GLFWwindow* window) {
     windowHandle = window;
+    headlessMode = window == nullptr;
+    framesInFlight = std::clamp(present.framesInFlight, 1u, kMaxFramesInFlight);
     createInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!headlessMode) createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
     createAllocator();       // VMA
-    createCommandPool();     // needed for staging and one-shot cmds
+    memory.init(allocator, &deletionQueue, MemoryBudget::Config{});
+    deletionQueue.init(device, allocator, &memory);
+    transients.init(device, allocator, &memory);
+    frameGraph.init(&transients, &gpuProfiler, asyncCompute);
+
+    {
+        GpuProfiler::Config cfg;
+        cfg.statistics = profileStatistics;
+        gpuProfiler.init(physicalDevice, device, findQueueFamilies(physicalDevice).graphicsFamily.value(),
+            framesInFlight, cfg);
+    }
+
+    // Async staging uploader on the transfer queue (falls back to graphics)
+    {
+        auto families = findQueueFamilies(physicalDevice);
+        const uint32_t gfx = families.graphicsFamily.value();
+        // Fixed staging budget; larger uploads are chunked through it
+        uploader.init(allocator, device, transferQueue, families.transferFamily.value_or(gfx), gfx, 32ull << 20, &memory);
+    }
+    pipelineCache.init(physicalDevice, device, cacheDir, kPipelineCompileThreads, deviceConfig.perDeviceCache);
+    pipelines.init(device, pipelineCache.get(), kPipelineCompileThreads,
+        pipelineCache.threadCaches().size() == kPipelineCompileThreads ? pipelineCache.threadCaches().data() : nullptr);
+    pipelines.setFastLink(pipelineLibrary);
+    // Next to the cache blob, but not keyed by driver: survives driver updates. The shipped
+    // manifest covers first runs on new machines.
+    // Per-device caches keep their own manifest, seeded from the shared one.
+    if (deviceConfig.perDeviceCache) {
+        pipelineManifest.load(cacheDir + "/pipelines." + std::to_string(std::max(deviceConfig.index, 0)) + ".manifest");
+        pipelineManifest.merge(cacheDir + "/pipelines.manifest");
+    }
+    else pipelineManifest.load(cacheDir + "/pipelines.manifest");
+    pipelineManifest.merge("shaders/pipelines.manifest");
+    pipelines.setManifest(&pipelineManifest);
 
-    // Reusable staging uploader
-    uploader.init(allocator, device, graphicsQueue, commandPool, 1ull << 20);
-    pipelineCache.init(physicalDevice, device, "cache");
+    // Geometry first: the mesh decides the vertex format the pipelines are built for
+    loadGeometry();
+    uploader.flush();            // copies overlap the rest of init; first frame waits on the ticket
+    workload.instances = std::max(workload.instances, 1u);
+    maxInstances = std::max(kMinInstanceCapacity, workload.instances * static_cast<uint32_t>(submeshes.size()));
+    buildScene();
 
     // --- Swapchain-dependent setup (correct order so depthFormat is known) ---
-    createSwapchain();
-    createImageViews();
+    if (headlessMode) createOffscreenTarget();
+    else {
+        createSwapchain();
+        createImageViews();
+    }
     createDepthResources();      // depth before pipeline so formats are known
+    shaderLibrary.init(device, shaderConfig);
     createDescriptorSetLayout(); // created once for lifetime of renderer
+    if (bindless) bindlessSet.init(device, BindlessDescriptors::clampToDevice(physicalDevice, {}));
+    if (bindless)
+        textureStreamer.init(physicalDevice, device, allocator, uploader, bindlessSet, deletionQueue,
+            framesInFlight, textureBC, textureASTC, {}, &memory);
     createGraphicsPipeline();
 
-    // --- Resources not tied to swapchain count ---
-    createVertexBuffer();
-    createIndexBuffer();
-
     // --- Per-swapchain-image resources ---
     createUniformBuffers();
-    descriptorArena.init(device);
+    createIndirectBuffers();
+    frameDescriptors.init(device, framesInFlight,
+        { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f } });
     createDescriptorSets();
+    createCullingStage();
 
     createCommandBuffers();
     createSyncObjects();
@@ -130,25 +165,45 @@ void Renderer::init(GLFWwindow* window) {
 
 void Renderer::cleanup() {
     vkDeviceWaitIdle(device);
+    offscreen.drain(frameTimeline);   // last frames still reach the callback
 
     // global non-swapchain resources
-    if (indexBuffer) { vmaDestroyBuffer(allocator, indexBuffer, indexAlloc); indexBuffer = VK_NULL_HANDLE; }
-    if (vertexBuffer) { vmaDestroyBuffer(allocator, vertexBuffer, vertexAlloc); vertexBuffer = VK_NULL_HANDLE; }
+    geometry.destroy();
+    meshHandle = {};
 
-    destroySwapchainObjects();
+    culling.destroy();
+    gpuProfiler.destroy();
+    textureStreamer.destroy();
 
-    // Kill pipeline objects kept across resizes
-    if (graphicsPipeline) {
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        graphicsPipeline = VK_NULL_HANDLE;
+    // Device is idle: free everything still waiting on a retire value, then the swapchain
+    destroySwapchainObjects();
+    deletionQueue.destroy();
+    frameGraph.reset();
+    transients.destroy();
+    offscreen.destroy();
+    if (swapchain) {
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+        swapchain = VK_NULL_HANDLE;
     }
+
+    // Kill pipeline objects kept across resizes (the registry owns them)
+    pipelines.mergeThreadCaches(true);   // before pipelineCache.destroy() saves
+    pipelines.destroy();
+    pipelineManifest.save();
+    graphicsShaders.destroy();
+    indirectShaders.destroy();
+    shaderLibrary.destroy();   // nothing compiles from the modules any more
+    graphicsPipeline = VK_NULL_HANDLE;
+    indirectPipeline = VK_NULL_HANDLE;
     if (pipelineLayout) {
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         pipelineLayout = VK_NULL_HANDLE;
     }
 
-    descriptorArena.destroy();
+    frameSetTemplate.destroy();
+    frameDescriptors.destroy();
 
+    bindlessSet.destroy();
     if (descriptorSetLayout) {
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
         descriptorSetLayout = VK_NULL_HANDLE;
@@ -157,43 +212,44 @@ void Renderer::cleanup() {
     uploader.destroy();
     pipelineCache.destroy();
 
-    if (commandPool) {
-        vkDestroyCommandPool(device, commandPool, nullptr);
-        commandPool = VK_NULL_HANDLE;
-    }
+    jobs.shutdown();
+    framePools.destroy();
+    computePools.destroy();
 
     // Per-frame sync
-    for (size_t i = 0; i < inFlightFences.size(); ++i) {
-        if (imageAvailableSemaphores[i]) vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-        if (inFlightFences[i])          vkDestroyFence(device, inFlightFences[i], nullptr);
+    for (auto sem : imageAvailableSemaphores) {
+        if (sem) vkDestroySemaphore(device, sem, nullptr);
     }
     imageAvailableSemaphores.clear();
-    inFlightFences.clear();
+    frameTimeline.destroy();
+    computeTimeline.destroy();
+    frameRetireValue = {};
 
     // Per-image semaphores
     for (auto sem : renderFinishedSemaphores) {
         if (sem) vkDestroySemaphore(device, sem, nullptr);
     }
     renderFinishedSemaphores.clear();
-    imagesInFlight.clear();
+    imageRetireValue.clear();
 
-    for (size_t i = 0; i < uniformBuffers.size(); ++i) {
-        if (uniformBuffers[i]) {
-            vmaDestroyBuffer(allocator, uniformBuffers[i], uniformAllocs[i]);
-            uniformBuffers[i] = VK_NULL_HANDLE;
-            uniformAllocs[i] = VK_NULL_HANDLE;
-        }
+    uniforms.destroy();
+
+    for (auto& f : indirectFrames) {
+        if (f.instances) vmaDestroyBuffer(allocator, f.instances, f.instanceAlloc);
+        if (f.commands)  vmaDestroyBuffer(allocator, f.commands, f.commandAlloc);
+        if (f.count)     vmaDestroyBuffer(allocator, f.count, f.countAlloc);
+        if (f.cullInputs) vmaDestroyBuffer(allocator, f.cullInputs, f.cullInputAlloc);
+        f = IndirectFrame{};
     }
-    uniformBuffers.clear();
-    uniformAllocs.clear();
-    uniformMapped.clear();
 
+    memory.destroy();
     if (allocator) {
         vmaDestroyAllocator(allocator);
         allocator = VK_NULL_HANDLE;
     }
 
     if (device) {
+        ShaderObjectPipeline::unloadFunctions(device);
         vkDestroyDevice(device, nullptr);
         device = VK_NULL_HANDLE;
     }
@@ -215,47 +271,188 @@ void Renderer::cleanup() {
 }
 
 void Renderer::drawFrame() {
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-
-    uint32_t imageIndex = 0;
-    VkResult acq = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX,
-        imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    frameTimer.beginFrame();
+
+    // Pacing: input for this frame is sampled only once the frame framesInFlight presents back
+    // is on screen. A timeout (minimized, compositor stall) just runs the frame unpaced.
+    if (presentPacing && presentId >= framesInFlight) {
+        frameTimer.beginPhase(FrameTimer::Phase::PresentWait);
+        pWaitForPresent(device, swapchain, presentId + 1 - framesInFlight, kPresentWaitTimeoutNs);
+        frameTimer.endPhase(FrameTimer::Phase::PresentWait);
+    }
 
-    if (acq == VK_ERROR_OUT_OF_DATE_KHR) { recreateSwapchain(); return; }
-    if (acq != VK_SUCCESS && acq != VK_SUBOPTIMAL_KHR) throw std::runtime_error("Failed to acquire swapchain image");
+    // This frame slot's previous submit must have retired before its pools/sets are reused
+    frameTimer.beginPhase(FrameTimer::Phase::FrameWait);
+    frameTimeline.wait(frameRetireValue[currentFrame]);
+    // Headless: hand finished readbacks over; blocks only when the consumer is behind
+    if (offscreen.readbackEnabled()) frameReadback = offscreen.acquireReadback(frameTimeline);
+    frameTimer.endPhase(FrameTimer::Phase::FrameWait);
+    deletionQueue.collect(frameTimeline.completed());
+    if (bindless) bindlessSet.collect(frameTimeline.completed());
+    // After collect(): a finished defrag pass's old handles are gone before VMA frees their memory
+    memory.update(currentFrame, frameTimeline.completed(), frameTimeline.lastSubmitted() + 1);
+
+    uint32_t imageIndex = currentFrame;   // headless: offscreen image i belongs to frame slot i
+    if (!headlessMode) {
+        frameTimer.beginPhase(FrameTimer::Phase::Acquire);
+        VkResult acq = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX,
+            imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        frameTimer.endPhase(FrameTimer::Phase::Acquire);
+
+        if (acq == VK_ERROR_OUT_OF_DATE_KHR) { recreateSwapchain(); return; }
+        if (acq != VK_SUCCESS && acq != VK_SUBOPTIMAL_KHR) throw std::runtime_error("Failed to acquire swapchain image");
+    }
 
-    if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    // Same image may still be in use by another frame slot's submit (no-op when already retired)
+    frameTimer.beginPhase(FrameTimer::Phase::ImageWait);
+    frameTimeline.wait(imageRetireValue[imageIndex]);
+    frameTimer.endPhase(FrameTimer::Phase::ImageWait);
+
+    frameTimer.beginPhase(FrameTimer::Phase::Prepare);
+
+    // Optimized pipelines replace fast-linked ones and reloaded shaders replace their pipelines
+    // as they finish; older frames may still be using the old handles, so they retire with this
+    // frame's submit. Only once the image is acquired: an out-of-date return submits nothing
+    if (shaderLibrary.watching()) reloadShaders();
+    pipelines.takeRetired(retiredPipelines);
+    for (VkPipeline p : retiredPipelines) deletionQueue.deferPipeline(frameTimeline.lastSubmitted() + 1, p);
+    retiredPipelines.clear();
+    graphicsPipeline = pipelines.get(graphicsPipelineKey);
+    indirectPipeline = pipelines.get(indirectPipelineKey);
+
+    // Repack the geometry pool once free space splinters; offsets change before the draw list
+    // is built, and the copies go into this frame's submit (the value advance() will hand out),
+    // after the acquires of the uploads the flush below sends out
+    geometry.collect(frameTimeline.completed());
+    if (geometry.fragmentation() > 0.5f && !memory.passPending()) {
+        geometry.defragment(deletionQueue, frameTimeline.lastSubmitted() + 1);
+        drawListDirty = true;   // every draw's offsets moved
     }
-    imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    // This slot's feedback is readable now; new texture uploads go out with the flush below
+    if (textureStreamer.enabled()) textureStreamer.update(currentFrame, frameTimeline.lastSubmitted() + 1);
 
     updateUniformBuffer(imageIndex);
+    writeFrameDescriptorSet();
+    animateScene();
+    buildDrawList();
+    writeIndirectCommands();
+    runWorkload();
+
+    // Kick any uploads queued since last frame so their acquires can go into this frame
+    uploader.flush();
+    frameTimer.endPhase(FrameTimer::Phase::Prepare);
+
+    // The timeline wait above retired this frame's last submit: recycle all its pools at once
+    frameTimer.beginPhase(FrameTimer::Phase::Record);
+    framePools.beginFrame(currentFrame);
+    if (asyncCompute) computePools.beginFrame(currentFrame);
+    const std::vector<RenderGraph::Submission>& submits = recordCommandBuffer(framePools.primary(currentFrame), imageIndex);
+    frameTimer.endPhase(FrameTimer::Phase::Record);
+
+    // --- Submit (Sync2), one per graph segment in order: the first graphics submit waits on
+    // acquire + uploads, the last one (always graphics) signals present. Each queue signals its
+    // own timeline; cross-queue hazards wait on the other one's latest value ---
+    uint64_t signalValue = 0;
+    bool firstGraphics = true;
+    frameTimer.beginPhase(FrameTimer::Phase::Submit);
+    for (size_t i = 0; i < submits.size(); ++i) {
+        const RenderGraph::Submission& s = submits[i];
+        const bool compute = s.queue == RenderGraph::Queue::Compute;
+        FrameTimeline& own = compute ? computeTimeline : frameTimeline;
+        FrameTimeline& other = compute ? frameTimeline : computeTimeline;
+
+        std::array<VkSemaphoreSubmitInfo, 3> waits{};
+        uint32_t waitCount = 0;
+        auto wait = [&](VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stages) {
+            VkSemaphoreSubmitInfo& w = waits[waitCount++];
+            w = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+            w.semaphore = semaphore;
+            w.value = value;
+            w.stageMask = stages;
+        };
+        if (!compute && firstGraphics) {
+            if (!headlessMode)
+                wait(imageAvailableSemaphores[currentFrame], 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+            if (frameUploadWait) wait(uploader.timeline(), frameUploadWait, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        }
+        if (s.waitStages != VK_PIPELINE_STAGE_2_NONE && other.lastSubmitted())
+            wait(other.semaphore(), other.lastSubmitted(), s.waitStages);
+
+        const uint64_t value = own.advance();
+        std::array<VkSemaphoreSubmitInfo, 2> signals{};
+        signals[0] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+        signals[0].semaphore = own.semaphore();
+        signals[0].value = value;
+        signals[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        const bool present = !headlessMode && i + 1 == submits.size();
+        if (present) {
+            signals[1] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+            signals[1].semaphore = renderFinishedSemaphores[imageIndex];
+            signals[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        }
 
-    vkResetCommandBuffer(commandBuffers[imageIndex], 0);
-    recordCommandBuffer(commandBuffers[imageIndex], imageIndex);
+        VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+        cmdInfo.commandBuffer = s.cmd;
+
+        VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+        submitInfo.waitSemaphoreInfoCount = waitCount;
+        submitInfo.pWaitSemaphoreInfos = waits.data();
+        submitInfo.commandBufferInfoCount = 1;
+        submitInfo.pCommandBufferInfos = &cmdInfo;
+        submitInfo.signalSemaphoreInfoCount = present ? 2u : 1u;
+        submitInfo.pSignalSemaphoreInfos = signals.data();
+
+        if (vkQueueSubmit2(compute ? computeQueue : graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit draw");
+        if (!compute) {
+            firstGraphics = false;
+            signalValue = value;
+        }
+    }
+    frameTimer.endPhase(FrameTimer::Phase::Submit);
+
+    frameRetireValue[currentFrame] = signalValue;
+    imageRetireValue[imageIndex] = signalValue;
+    if (headlessMode) {
+        offscreen.submitted(signalValue, sequenceFrame());
+        if (framebufferResized) {
+            framebufferResized = false;
+            recreateSwapchain();
+        }
+    }
+    else presentImage(imageIndex);
+    ++frameNumber;
+
+    // Fold the compile threads' caches back and persist if they grew (crash safety)
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastCacheFlush > std::chrono::seconds(5)) {
+        lastCacheFlush = now;
+        pipelines.mergeThreadCaches();
+        pipelineCache.saveIfGrown();
+    }
 
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &imageAvailableSemaphores[currentFrame];
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &renderFinishedSemaphores[imageIndex];
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    frameTimer.endFrame();
+}
 
-    vkResetFences(device, 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
-        throw std::runtime_error("Failed to submit draw");
+void Renderer::presentImage(uint32_t imageIndex) {
+    const uint64_t nextPresentId = presentId + 1;
+    VkPresentIdKHR presentIdInfo{ VK_STRUCTURE_TYPE_PRESENT_ID_KHR };
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &nextPresentId;
 
     VkPresentInfoKHR presentInfo{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+    presentInfo.pNext = presentPacing ? &presentIdInfo : nullptr;
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = &renderFinishedSemaphores[imageIndex];
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &swapchain;
     presentInfo.pImageIndices = &imageIndex;
 
+    frameTimer.beginPhase(FrameTimer::Phase::Present);
     VkResult pres = vkQueuePresentKHR(presentQueue, &presentInfo);
+    frameTimer.endPhase(FrameTimer::Phase::Present);
+    if (presentPacing) presentId = nextPresentId;
     if (pres == VK_ERROR_OUT_OF_DATE_KHR || pres == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
         recreateSwapchain();
@@ -263,8 +460,19 @@ void Renderer::drawFrame() {
     else if (pres != VK_SUCCESS) {
         throw std::runtime_error("Failed to present");
     }
+}
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+std::string Renderer::deviceName() const {
+    if (!physicalDevice) return {};
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    return props.deviceName;
+}
+
+TextureStreamer::Handle Renderer::loadTexture(const std::string& path) {
+    if (!textureStreamer.enabled())
+        throw std::runtime_error("Renderer: texture streaming needs descriptor indexing");
+    return textureStreamer.load(path);
 }
 
 // ---------------- Internals ----------------
@@ -276,9 +484,13 @@ void Renderer::createInstance() {
     appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
     appInfo.apiVersion = VK_API_VERSION_1_3;
 
-    uint32_t glfwExtCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtCount);
+    // Headless needs no surface extensions (and GLFW may not even be initialized)
+    std::vector<const char*> extensions;
+    if (!headlessMode) {
+        uint32_t glfwExtCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtCount);
+    }
 
     bool wantDebug = hasLayer("VK_LAYER_KHRONOS_validation") && hasInstanceExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     if (wantDebug) {
@@ -347,13 +559,31 @@ Renderer::QueueFamilyIndices Renderer::findQueueFamilies(VkPhysicalDevice dev) {
         if (props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
             indices.graphicsFamily = i;
 
+        // Headless: nothing is presented, the graphics family stands in
         VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, surface, &presentSupport);
+        if (surface) vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, surface, &presentSupport);
+        else presentSupport = indices.graphicsFamily == i ? VK_TRUE : VK_FALSE;
         if (presentSupport)
             indices.presentFamily = i;
 
         if (indices.isComplete()) break;
     }
+
+    // Transfer: prefer a pure DMA family (no graphics/compute), else any non-graphics transfer family
+    for (uint32_t i = 0; i < count; ++i) {
+        const VkQueueFlags f = props[i].queueFlags;
+        if (!(f & VK_QUEUE_TRANSFER_BIT) || (f & VK_QUEUE_GRAPHICS_BIT)) continue;
+        if (!(f & VK_QUEUE_COMPUTE_BIT)) { indices.transferFamily = i; break; }
+        if (!indices.transferFamily) indices.transferFamily = i;
+    }
+
+    // Async compute: any family with compute but no graphics, preferably not the transfer one
+    for (uint32_t i = 0; i < count; ++i) {
+        const VkQueueFlags f = props[i].queueFlags;
+        if (!(f & VK_QUEUE_COMPUTE_BIT) || (f & VK_QUEUE_GRAPHICS_BIT)) continue;
+        if (indices.transferFamily != i) { indices.computeFamily = i; break; }
+        if (!indices.computeFamily) indices.computeFamily = i;
+    }
     return indices;
 }
 
@@ -374,53 +604,214 @@ Renderer::SwapSupportDetails Renderer::querySwapSupport(VkPhysicalDevice dev) {
     return details;
 }
 
+bool Renderer::hasDeviceExtension(VkPhysicalDevice dev, const char* name) {
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(dev, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> exts(count);
+    vkEnumerateDeviceExtensionProperties(dev, nullptr, &count, exts.data());
+    for (const auto& e : exts) if (std::strcmp(e.extensionName, name) == 0) return true;
+    return false;
+}
+
 bool Renderer::isDeviceSuitable(VkPhysicalDevice dev) {
     auto indices = findQueueFamilies(dev);
     if (!indices.isComplete()) return false;
+    if (!surface) return true;   // headless
 
     auto support = querySwapSupport(dev);
     bool swapAdequate = !support.formats.empty() && !support.presentModes.empty();
     return swapAdequate;
 }
 
-void Renderer::pickPhysicalDevice() {
+// Type first, then device-local memory (MiB), then the extra queue families the uploader and
+// async culling use
+std::vector<Renderer::DeviceInfo> Renderer::rankDevices() {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-    if (deviceCount == 0) throw std::runtime_error("No Vulkan-compatible GPU found");
-
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    for (auto dev : devices) {
-        if (isDeviceSuitable(dev)) { physicalDevice = dev; break; }
+    std::vector<DeviceInfo> ranked;
+    for (VkPhysicalDevice dev : devices) {
+        if (!isDeviceSuitable(dev)) continue;
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(dev, &props);
+        VkPhysicalDeviceMemoryProperties mem{};
+        vkGetPhysicalDeviceMemoryProperties(dev, &mem);
+        const QueueFamilyIndices families = findQueueFamilies(dev);
+
+        DeviceInfo info;
+        info.device = dev;
+        info.name = props.deviceName;
+        info.type = props.deviceType;
+        for (uint32_t h = 0; h < mem.memoryHeapCount; ++h)
+            if (mem.memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) info.localBytes += mem.memoryHeaps[h].size;
+        info.transferQueue = families.transferFamily.has_value();
+        info.computeQueue = families.computeFamily.has_value();
+
+        uint64_t typeRank = 0;
+        switch (props.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   typeRank = 4; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeRank = 3; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    typeRank = 2; break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:            typeRank = 1; break;
+        default: break;
+        }
+        const uint64_t localMiB = std::min<uint64_t>(info.localBytes >> 20, (1ull << 40) - 1);
+        info.score = (typeRank << 48) | (localMiB << 8) | (info.transferQueue ? 2u : 0u) | (info.computeQueue ? 1u : 0u);
+        ranked.push_back(std::move(info));
     }
-    if (physicalDevice == VK_NULL_HANDLE) throw std::runtime_error("No suitable GPU found");
+    // Stable: equal devices keep the enumeration order, so every Renderer agrees on the ranks
+    std::stable_sort(ranked.begin(), ranked.end(),
+        [](const DeviceInfo& a, const DeviceInfo& b) { return a.score > b.score; });
+    return ranked;
+}
+
+std::vector<Renderer::DeviceInfo> Renderer::listDevices() {
+    if (instance) return rankDevices();
+    const bool wasHeadless = headlessMode;
+    headlessMode = true;   // no surface extensions: GLFW may not be initialized
+    createInstance();
+    std::vector<DeviceInfo> ranked = rankDevices();
+    vkDestroyInstance(instance, nullptr);
+    instance = VK_NULL_HANDLE;
+    headlessMode = wasHeadless;
+    for (DeviceInfo& d : ranked) d.device = VK_NULL_HANDLE;   // the instance is gone
+    return ranked;
+}
+
+void Renderer::pickPhysicalDevice() {
+    const std::vector<DeviceInfo> ranked = rankDevices();
+    if (ranked.empty()) throw std::runtime_error("No suitable GPU found");
+    const uint32_t index = deviceConfig.index < 0 ? 0u : static_cast<uint32_t>(deviceConfig.index);
+    if (index >= ranked.size())
+        throw std::runtime_error("Renderer: device index " + std::to_string(index) + " out of range (" +
+            std::to_string(ranked.size()) + " suitable)");
+
+    physicalDevice = ranked[index].device;
 }
 
 void Renderer::createLogicalDevice() {
     auto indices = findQueueFamilies(physicalDevice);
 
-    std::vector<VkDeviceQueueCreateInfo> queueInfos;
-    float priority = 1.0f;
-    std::vector<uint32_t> uniqueFamilies;
-    if (indices.graphicsFamily.value() == indices.presentFamily.value())
-        uniqueFamilies = { indices.graphicsFamily.value() };
-    else
-        uniqueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> familyProps(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, familyProps.data());
+
+    // Each role takes the next queue of its family while the family has one left, else shares
+    // the family's last; present shares the graphics queue when the families match. One create
+    // info per family, covering every queue index taken from it.
+    std::vector<uint32_t> queuesTaken(familyCount, 0);
+    auto takeQueue = [&](uint32_t family) {
+        const uint32_t index = std::min(queuesTaken[family], familyProps[family].queueCount - 1);
+        queuesTaken[family] = std::max(queuesTaken[family], index + 1);
+        return index;
+    };
+    const uint32_t graphicsQueueIndex = takeQueue(indices.graphicsFamily.value());
+    const uint32_t presentQueueIndex = indices.presentFamily == indices.graphicsFamily
+        ? graphicsQueueIndex : takeQueue(indices.presentFamily.value());
+    const uint32_t transferQueueIndex = indices.transferFamily ? takeQueue(indices.transferFamily.value()) : 0;
+    const uint32_t computeQueueIndex = indices.computeFamily ? takeQueue(indices.computeFamily.value()) : 0;
 
-    for (uint32_t fam : uniqueFamilies) {
+    std::vector<VkDeviceQueueCreateInfo> queueInfos;
+    const std::vector<float> priorities(*std::max_element(queuesTaken.begin(), queuesTaken.end()), 1.0f);
+    for (uint32_t fam = 0; fam < familyCount; ++fam) {
+        if (!queuesTaken[fam]) continue;
         VkDeviceQueueCreateInfo q{ VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
         q.queueFamilyIndex = fam;
-        q.queueCount = 1;
-        q.pQueuePriorities = &priority;
+        q.queueCount = queuesTaken[fam];
+        q.pQueuePriorities = priorities.data();
         queueInfos.push_back(q);
     }
 
+    // Optional features for the GPU-driven path
+    VkPhysicalDeviceVulkan12Features supported12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 supported{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    supported.pNext = &supported12;
+
+    // Extension features are only queried when the device has the extension
+    const bool hasPipelineLibrary = hasDeviceExtension(physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    const bool hasShaderObject = hasDeviceExtension(physicalDevice, VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supportedGpl{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT
+    };
+    VkPhysicalDeviceShaderObjectFeaturesEXT supportedShaderObject{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT
+    };
+    const bool hasPresentWait = !headlessMode && present.presentWait &&
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+    void** supportedTail = &supported12.pNext;
+    if (hasPipelineLibrary) { *supportedTail = &supportedGpl; supportedTail = &supportedGpl.pNext; }
+    if (hasShaderObject) { *supportedTail = &supportedShaderObject; supportedTail = &supportedShaderObject.pNext; }
+    if (hasPresentWait) {
+        *supportedTail = &supportedPresentId; supportedTail = &supportedPresentId.pNext;
+        *supportedTail = &supportedPresentWait; supportedTail = &supportedPresentWait.pNext;
+    }
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
     VkPhysicalDeviceFeatures features{}; // default
+    gpuDriven = supported.features.multiDrawIndirect && supported.features.drawIndirectFirstInstance;
+    features.multiDrawIndirect = supported.features.multiDrawIndirect;
+    features.drawIndirectFirstInstance = supported.features.drawIndirectFirstInstance;
+    // Statistics scopes around the draw pass are active while secondaries execute
+    profileStatistics = profileStatistics && supported.features.pipelineStatisticsQuery && supported.features.inheritedQueries;
+    features.pipelineStatisticsQuery = profileStatistics ? VK_TRUE : VK_FALSE;
+    features.inheritedQueries = profileStatistics ? VK_TRUE : VK_FALSE;
+    textureBC = supported.features.textureCompressionBC;
+    textureASTC = supported.features.textureCompressionASTC_LDR;
+    features.textureCompressionBC = supported.features.textureCompressionBC;
+    features.textureCompressionASTC_LDR = supported.features.textureCompressionASTC_LDR;
+    drawIndirectCount = gpuDriven && supported12.drawIndirectCount;
+    gpuCulling = drawIndirectCount;   // culled count only exists on the GPU
+    samplerMinmax = gpuCulling && supported12.samplerFilterMinmax;
+    bindless = supported12.descriptorIndexing && supported12.runtimeDescriptorArray &&
+        supported12.descriptorBindingPartiallyBound && supported12.descriptorBindingVariableDescriptorCount &&
+        supported12.descriptorBindingUpdateUnusedWhilePending &&
+        supported12.descriptorBindingSampledImageUpdateAfterBind && supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+        supported12.shaderSampledImageArrayNonUniformIndexing && supported12.shaderStorageBufferArrayNonUniformIndexing;
+    pipelineLibrary = hasPipelineLibrary && supportedGpl.graphicsPipelineLibrary;
+    shaderObjects = preferShaderObjects && hasShaderObject && supportedShaderObject.shaderObject;
+    presentPacing = hasPresentWait && supportedPresentId.presentId && supportedPresentWait.presentWait;
+
+    std::vector<const char*> deviceExtensions;
+    if (!headlessMode) deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (pipelineLibrary) {
+        deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+    if (shaderObjects) deviceExtensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    // Real per-heap budgets from the driver instead of VMA's heap-size estimate
+    memoryBudgetExt = hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudgetExt) deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (presentPacing) {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
 
-    const char* deviceExtensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    // --- Features chain: Timeline semaphores (core 1.2), Dynamic Rendering + Synchronization2 (core in 1.3) ---
+    VkPhysicalDeviceVulkan12Features vk12{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+    vk12.timelineSemaphore = VK_TRUE;
+    vk12.drawIndirectCount = drawIndirectCount ? VK_TRUE : VK_FALSE;
+    vk12.samplerFilterMinmax = samplerMinmax ? VK_TRUE : VK_FALSE;
+    if (bindless) {
+        vk12.descriptorIndexing = VK_TRUE;
+        vk12.runtimeDescriptorArray = VK_TRUE;
+        vk12.descriptorBindingPartiallyBound = VK_TRUE;
+        vk12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        vk12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vk12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vk12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        vk12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vk12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    }
 
-    // --- Features chain: Dynamic Rendering + Synchronization2 (core in 1.3) ---
     VkPhysicalDeviceDynamicRenderingFeatures dyn{
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES
     };
@@ -431,34 +822,74 @@ void Renderer::createLogicalDevice() {
     };
     sync2.synchronization2 = VK_TRUE;
 
+    // Optional: fast-linked pipeline libraries, shader objects
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT gpl{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT
+    };
+    gpl.graphicsPipelineLibrary = VK_TRUE;
+
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObject{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT
+    };
+    shaderObject.shaderObject = VK_TRUE;
+
+    // Optional: present pacing
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+    presentIdFeatures.presentId = VK_TRUE;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+    presentWaitFeatures.presentWait = VK_TRUE;
+
     // chain head -> next
+    vk12.pNext = &dyn;
     dyn.pNext = &sync2;
+    void** tail = &sync2.pNext;
+    if (pipelineLibrary) { *tail = &gpl; tail = &gpl.pNext; }
+    if (shaderObjects) { *tail = &shaderObject; tail = &shaderObject.pNext; }
+    if (presentPacing) {
+        *tail = &presentIdFeatures; tail = &presentIdFeatures.pNext;
+        *tail = &presentWaitFeatures; tail = &presentWaitFeatures.pNext;
+    }
 
     VkDeviceCreateInfo createInfo{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
-    createInfo.pNext = &dyn;  // head of the chain
+    createInfo.pNext = &vk12;  // head of the chain
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
     createInfo.pQueueCreateInfos = queueInfos.data();
     createInfo.pEnabledFeatures = &features;
-    createInfo.enabledExtensionCount = 1;
-    createInfo.ppEnabledExtensionNames = deviceExtensions;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
     createInfo.enabledLayerCount = 0;
     createInfo.ppEnabledLayerNames = nullptr;
 
     if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS)
         throw std::runtime_error("Failed to create logical device");
 
-    vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, indices.graphicsFamily.value(), graphicsQueueIndex, &graphicsQueue);
+    vkGetDeviceQueue(device, indices.presentFamily.value(), presentQueueIndex, &presentQueue);
+    if (indices.transferFamily)
+        vkGetDeviceQueue(device, indices.transferFamily.value(), transferQueueIndex, &transferQueue);
+    else
+        transferQueue = graphicsQueue;
+
+    // Culling is the only async work; without it the compute queue would sit idle
+    asyncCompute = gpuCulling && indices.computeFamily.has_value();
+    if (asyncCompute) {
+        vkGetDeviceQueue(device, indices.computeFamily.value(), computeQueueIndex, &computeQueue);
+        computeSharing = QueueSharing::between(indices.graphicsFamily.value(), indices.computeFamily.value());
+    }
 
     // Load device-level debug utils (Safe if extension missing)
     pSetName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetDeviceProcAddr(device, "vkSetDebugUtilsObjectNameEXT");
-    pBeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetDeviceProcAddr(device, "vkCmdBeginDebugUtilsLabelEXT");
-    pEndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetDeviceProcAddr(device, "vkCmdEndDebugUtilsLabelEXT");
+
+    if (shaderObjects) shaderObjects = ShaderObjectPipeline::loadFunctions(device);
+    if (presentPacing) {
+        pWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+        presentPacing = pWaitForPresent != nullptr;
+    }
 }
 
 void Renderer::createAllocator() {
     VmaAllocatorCreateInfo info{};
-    info.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    info.flags = memoryBudgetExt ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
     info.instance = instance;
     info.physicalDevice = physicalDevice;
     info.device = device;
@@ -485,7 +916,8 @@ VkSurfaceFormatKHR Renderer::chooseSwapSurfaceFormat(const std::vector<VkSurface
 }
 
 VkPresentModeKHR Renderer::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& modes) {
-    for (auto m : modes) if (m == VK_PRESENT_MODE_MAILBOX_KHR) return m;
+    for (auto m : modes) if (m == present.mode) return m;
+    // FIFO is the one mode every surface supports; presentMode() tells callers which one they got
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -506,9 +938,11 @@ void Renderer::createSwapchain() {
 
     auto surfaceFormat = chooseSwapSurfaceFormat(support.formats);
     auto presentMode = chooseSwapPresentMode(support.presentModes);
+    swapchainPresentMode = presentMode;
     auto extent = chooseSwapExtent(support.capabilities);
 
-    uint32_t imageCount = support.capabilities.minImageCount + 1;
+    uint32_t imageCount = present.imageCount ? present.imageCount : support.capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, support.capabilities.minImageCount);
     if (support.capabilities.maxImageCount > 0 && imageCount > support.capabilities.maxImageCount)
         imageCount = support.capabilities.maxImageCount;
 
@@ -537,11 +971,17 @@ void Renderer::createSwapchain() {
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Hand the old swapchain over so presentation continues during the rebuild
+    VkSwapchainKHR oldSwapchain = swapchain;
+    createInfo.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
         throw std::runtime_error("Failed to create swapchain");
 
+    // Retired now; freed once every frame that may have presented from it is done
+    deletionQueue.deferSwapchain(frameTimeline.lastSubmitted(), oldSwapchain);
+    presentId = 0;   // ids are per swapchain
+
     // Name the swapchain for sanity in RenderDoc
     if (pSetName) {
         VkDebugUtilsObjectNameInfoEXT n{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
@@ -591,6 +1031,33 @@ void Renderer::createImageViews() {
     }
 }
 
+void Renderer::createOffscreenTarget() {
+    OffscreenTarget::Config cfg;
+    const VkRect2D& tile = headlessConfig.tile;
+    cfg.extent = tile.extent.width && tile.extent.height ? tile.extent : headlessConfig.extent;
+    if (headlessConfig.onFrame)
+        cfg.readbackBuffers = headlessConfig.readbackBuffers ? headlessConfig.readbackBuffers : framesInFlight + 1;
+    offscreen.init(device, allocator, framesInFlight, cfg, &memory);
+    offscreen.setCallback(headlessConfig.onFrame);
+
+    swapchainImages.clear();
+    swapchainImageViews.clear();
+    for (uint32_t i = 0; i < offscreen.imageCount(); ++i) {
+        swapchainImages.push_back(offscreen.image(i));
+        swapchainImageViews.push_back(offscreen.view(i));
+        if (pSetName) {
+            VkDebugUtilsObjectNameInfoEXT n{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
+            n.objectType = VK_OBJECT_TYPE_IMAGE;
+            n.objectHandle = (uint64_t)swapchainImages[i];
+            char label[32]; std::snprintf(label, sizeof(label), "Offscreen[%u]", i);
+            n.pObjectName = label;
+            pSetName(device, &n);
+        }
+    }
+    swapchainImageFormat = offscreen.format();
+    swapchainExtent = offscreen.extent();
+}
+
 VkFormat Renderer::findDepthFormat() {
     // Prefer stencil-less unless need stencil later?
     const VkFormat candidates[] = {
@@ -612,7 +1079,7 @@ bool Renderer::hasStencilComponent(VkFormat format) {
 }
 
 void Renderer::createImage(uint32_t w, uint32_t h, VkFormat format, VkImageUsageFlags usage,
-    VkImage& image, VmaAllocation& alloc) {
+    VkImage& image, VmaAllocation& alloc, MemoryBudget::Category category) {
     VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
     info.imageType = VK_IMAGE_TYPE_2D;
     info.extent = { w, h, 1 };
@@ -627,9 +1094,16 @@ void Renderer::createImage(uint32_t w, uint32_t h, VkFormat format, VkImageUsage
 
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    allocInfo.flags = memory.allocationFlags(category);
 
+    VkDeviceImageMemoryRequirements query{ VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS };
+    query.pCreateInfo = &info;
+    VkMemoryRequirements2 req{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+    vkGetDeviceImageMemoryRequirements(device, &query, &req);
+    memory.reserve(req.memoryRequirements.size, frameTimeline.lastSubmitted() + 1);
     if (vmaCreateImage(allocator, &info, &allocInfo, &image, &alloc, nullptr) != VK_SUCCESS)
         throw std::runtime_error("Failed to create image");
+    memory.track(alloc, category);
 }
 
 VkImageView Renderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect) {
@@ -651,12 +1125,12 @@ VkImageView Renderer::createImageView(VkImage image, VkFormat format, VkImageAsp
 
 void Renderer::createDepthResources() {
     depthFormat = findDepthFormat();
-    createImage(
-        swapchainExtent.width, swapchainExtent.height,
-        depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT /* | VK_IMAGE_USAGE_SAMPLED_BIT */,
-        depthImage, depthAlloc
-    );
-    depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    // Hi-Z samples the depth buffer after the pass
+    occlusionCulling = gpuCulling && GpuCulling::supportsOcclusion(physicalDevice, depthFormat, samplerMinmax);
+
+    buildFrameGraph();
+    depthImage = frameGraph.image(rgDepth);
+    depthImageView = frameGraph.view(rgDepth);
 
     // Debug names
     if (pSetName) {
@@ -669,50 +1143,166 @@ void Renderer::createDepthResources() {
     }
 }
 
-void Renderer::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding ubo{};
-    ubo.binding = 0;
-    ubo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    ubo.descriptorCount = 1;
-    ubo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+// Passes in frame order. Depth is pass-local: cleared every frame and, without Hi-Z, never
+// stored (lazy memory on tilers). Everything else is imported and rebound per frame.
+void Renderer::buildFrameGraph() {
+    using Use = RenderGraph::Use;
+    constexpr Use kColorTarget{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    constexpr Use kDepthTarget{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL };
+    constexpr Use kCullWrite{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+    constexpr Use kIndirectRead{ VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT };
+    constexpr Use kPyramidRead{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL };
+    constexpr Use kPyramidWrite{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL };
+    constexpr Use kDepthSampled{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL };
+    constexpr Use kCopySrc{ VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    constexpr Use kCopyDst{ VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+    constexpr Use kHostRead{ VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT };
+
+    frameGraph.reset();
+
+    // Acquired images come out of the semaphore wait at COLOR_ATTACHMENT_OUTPUT, leave as PRESENT_SRC.
+    // Offscreen images were last used by this frame slot's previous submit, which the host waited on.
+    rgBackbuffer = frameGraph.importImage("Backbuffer", VK_IMAGE_ASPECT_COLOR_BIT);
+    rgReadback = {};
+    if (headlessMode) {
+        frameGraph.setInitialState(rgBackbuffer, { VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED });
+        if (offscreen.readbackEnabled()) {
+            rgReadback = frameGraph.importBuffer("Readback");
+            frameGraph.setFinalState(rgReadback, kHostRead);   // made visible before the timeline signal
+        }
+        else frameGraph.markOutput(rgBackbuffer);
+    }
+    else {
+        frameGraph.setInitialState(rgBackbuffer, { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED });
+        frameGraph.setFinalState(rgBackbuffer, { VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR });
+    }
+
+    TransientAllocator::Desc depth;
+    depth.format = depthFormat;
+    depth.extent = swapchainExtent;
+    depth.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusionCulling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    depth.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    rgDepth = frameGraph.createImage("Depth", depth);
+
+    rgPyramid = rgCommands = rgCount = {};
+    if (gpuCulling) {
+        rgPyramid = frameGraph.importImage("HiZ", VK_IMAGE_ASPECT_COLOR_BIT);
+        rgCommands = frameGraph.importBuffer("IndirectCommands");
+        rgCount = frameGraph.importBuffer("DrawCount");
+        frameGraph.markOutput(rgPyramid);   // next frame's occluders
+
+        // Overlaps the prologue's copies and, without Hi-Z, the previous frame's draw
+        frameGraph.addPass("Cull", [this](VkCommandBuffer cmd) {
+            culling.recordCull(cmd, currentFrame, frameViewProj, indirectDrawCount, frameUniformOffset);
+        }, true)
+            .asyncCompute()
+            .read(rgPyramid, kPyramidRead)
+            .write(rgCommands, kCullWrite)
+            .write(rgCount, kCullWrite);
+    }
 
-    VkDescriptorSetLayoutCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-    info.bindingCount = 1;
-    info.pBindings = &ubo;
+    auto draw = frameGraph.addPass("Draw", [this](VkCommandBuffer cmd) { recordDrawPass(cmd); }, true);
+    draw.write(rgBackbuffer, kColorTarget, true).write(rgDepth, kDepthTarget, true);
+    if (gpuCulling) draw.read(rgCommands, kIndirectRead).read(rgCount, kIndirectRead);
 
-    if (vkCreateDescriptorSetLayout(device, &info, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create descriptor set layout");
-}
+    if (occlusionCulling) {
+        frameGraph.addPass("DepthPyramid", [this](VkCommandBuffer cmd) { culling.recordDepthPyramid(cmd); })
+            .read(rgDepth, kDepthSampled)
+            .write(rgPyramid, kPyramidWrite);
+    }
 
-VkShaderModule Renderer::createShaderModule(const std::vector<char>& code) {
-    VkShaderModuleCreateInfo info{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-    info.codeSize = code.size();
-    info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    if (rgReadback.valid()) {
+        frameGraph.addPass("Readback", [this](VkCommandBuffer cmd) {
+            VkBufferImageCopy region{};
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+            vkCmdCopyImageToBuffer(cmd, frameGraph.image(rgBackbuffer), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                frameGraph.buffer(rgReadback), 1, &region);
+        })
+            .read(rgBackbuffer, kCopySrc)
+            .write(rgReadback, kCopyDst);
+    }
 
-    VkShaderModule module{};
-    if (vkCreateShaderModule(device, &info, nullptr, &module) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create shader module");
-    return module;
+    frameGraph.compile();
 }
 
-void Renderer::createGraphicsPipeline() {
-    const std::string base = "shaders/";
-    auto vertCode = readFile(base + "triangle.vert.spv");
-    auto fragCode = readFile(base + "triangle.frag.spv");
+// Set 0 and the push constants come from the shaders' reflection: every shader drawn with
+// pipelineLayout goes into mainLayout, so a binding added to a shader shows up here.
+void Renderer::createDescriptorSetLayout() {
+    const ShaderLibrary::Shader* shaders[] = {
+        &shaderLibrary.get("mesh.vert"),
+        &shaderLibrary.get("triangle.frag"),
+        bindless ? &shaderLibrary.get("indirect_bindless.vert") : nullptr,
+    };
+    if (!shaders[0]->reflection.hasSpecConstant(kMeshInstanceBuffer))
+        throw std::runtime_error("Renderer: mesh.vert lacks the instance buffer specialization constant");
+    mainLayout = ShaderLibrary::mergeLayout(shaders, bindless ? 3u : 2u);
+
+    // Set 1 is the bindless table, whose layout BindlessDescriptors owns
+    for (const ShaderLibrary::Binding& b : mainLayout.bindings)
+        if (b.set > (bindless ? 1u : 0u))
+            throw std::runtime_error("Renderer: shaders use descriptor set " + std::to_string(b.set) +
+                ", which the main pipeline layout doesn't have");
+
+    descriptorSetLayout = shaderLibrary.createSetLayout(mainLayout, 0, true);
+}
 
-    VkShaderModule vertModule = createShaderModule(vertCode);
-    VkShaderModule fragModule = createShaderModule(fragCode);
+void Renderer::addMeshStages(PipelineBuilder& builder, bool indirect) {
+    const ShaderLibrary::Shader& frag = shaderLibrary.get("triangle.frag");
+    builder.clearStages();
+    if (indirect && bindless) {
+        const ShaderLibrary::Shader& vert = shaderLibrary.get("indirect_bindless.vert");
+        builder.addStage(VK_SHADER_STAGE_VERTEX_BIT, vert.module, "main", vert.codeHash);
+    } else {
+        const ShaderLibrary::Shader& vert = shaderLibrary.get("mesh.vert");
+        PipelineBuilder::SpecConstants spec;
+        spec.setBool(kMeshInstanceBuffer, indirect);
+        builder.addStage(VK_SHADER_STAGE_VERTEX_BIT, vert.module, "main", vert.codeHash, spec);
+    }
+    builder.addStage(VK_SHADER_STAGE_FRAGMENT_BIT, frag.module, "main", frag.codeHash);
+}
 
-    // Vertex input layout
-    VkVertexInputBindingDescription bind{};
-    bind.binding = 0;
-    bind.stride = sizeof(Vertex);
-    bind.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+// Shader objects take SPIR-V rather than modules, so they are created straight from the
+// library's code with the same specialization as addMeshStages()
+void Renderer::createShaderObjects() {
+    const VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, bindlessSet.layout() };
+    const uint32_t setLayoutCount = bindless ? 2u : 1u;
+    const uint32_t pcCount = mainLayout.pushConstants.size ? 1u : 0u;
+
+    const ShaderLibrary::Shader& mesh = shaderLibrary.get("mesh.vert");
+    const ShaderLibrary::Shader& frag = shaderLibrary.get("triangle.frag");
+    PipelineBuilder::SpecConstants specs[2];
+    VkSpecializationInfo specInfos[2]{};
+    std::vector<VkSpecializationMapEntry> specEntries[2];
+    for (uint32_t i = 0; i < 2; ++i) {
+        specs[i].setBool(kMeshInstanceBuffer, i == 1);
+        specs[i].fill(specInfos[i], specEntries[i]);
+    }
 
-    VkVertexInputAttributeDescription attrs[2]{};
-    attrs[0].location = 0; attrs[0].binding = 0; attrs[0].format = VK_FORMAT_R32G32B32_SFLOAT; attrs[0].offset = offsetof(Vertex, pos);
-    attrs[1].location = 1; attrs[1].binding = 0; attrs[1].format = VK_FORMAT_R32G32B32_SFLOAT; attrs[1].offset = offsetof(Vertex, color);
+    ShaderObjectPipeline::Stage stages[] = {
+        { VK_SHADER_STAGE_VERTEX_BIT, mesh.code.data(), mesh.code.size() * sizeof(uint32_t), "main", &specInfos[0] },
+        { VK_SHADER_STAGE_FRAGMENT_BIT, frag.code.data(), frag.code.size() * sizeof(uint32_t) },
+    };
+    graphicsShaders.create(device, graphicsBuilder, stages, 2, setLayouts, setLayoutCount,
+        &mainLayout.pushConstants, pcCount);
+
+    if (bindless) {
+        const ShaderLibrary::Shader& vert = shaderLibrary.get("indirect_bindless.vert");
+        stages[0] = { VK_SHADER_STAGE_VERTEX_BIT, vert.code.data(), vert.code.size() * sizeof(uint32_t) };
+    } else {
+        stages[0].specialization = &specInfos[1];
+    }
+    indirectShaders.create(device, indirectBuilder, stages, 2, setLayouts, setLayoutCount,
+        &mainLayout.pushConstants, pcCount);
+}
 
+void Renderer::createGraphicsPipeline() {
     // Fixed states
     VkPipelineRasterizationStateCreateInfo raster{ VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
     raster.depthClampEnable = VK_FALSE;
@@ -739,27 +1329,31 @@ void Renderer::createGraphicsPipeline() {
         VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     colorAttachment.blendEnable = VK_FALSE;
 
-    // Pipeline layout with push constants
-    VkPushConstantRange pc{};
-    pc.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pc.offset = 0;
-    pc.size = sizeof(glm::mat4);
+    // Set 0: frame UBO + instances; set 1 (bindless only): the global descriptor set
+    const VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, bindlessSet.layout() };
+    const uint32_t setLayoutCount = bindless ? 2u : 1u;
 
     VkPipelineLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-    layoutInfo.setLayoutCount = 1;
-    layoutInfo.pSetLayouts = &descriptorSetLayout;
-    layoutInfo.pushConstantRangeCount = 1;
-    layoutInfo.pPushConstantRanges = &pc;
+    layoutInfo.setLayoutCount = setLayoutCount;
+    layoutInfo.pSetLayouts = setLayouts;
+    layoutInfo.pushConstantRangeCount = mainLayout.pushConstants.size ? 1u : 0u;
+    layoutInfo.pPushConstantRanges = &mainLayout.pushConstants;
 
     if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
         throw std::runtime_error("Failed to create pipeline layout");
+    // The reflected interface names the layout: manifests stay valid until a shader's
+    // resources change
+    const uint64_t mainLayoutKey = mainLayout.hash;
+
+    // Replay earlier runs' pipelines on the compile threads while we build the ones we need.
+    // Modules live as long as the library, so replays need no wait.
+    pipelines.prewarm(pipelineManifest,
+        [&](uint64_t codeHash) { return shaderLibrary.find(codeHash); },
+        [&](uint64_t layoutKey) { return layoutKey == mainLayoutKey ? pipelineLayout : VkPipelineLayout(VK_NULL_HANDLE); });
 
     // Build via PipelineBuilder
     PipelineBuilder pb;
-    pb.clearStages()
-        .addStage(VK_SHADER_STAGE_VERTEX_BIT, vertModule, "main")
-        .addStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule, "main")
-        .setVertexInput(&bind, 1, attrs, 2)
+    pb.setVertexLayout(vertexLayoutInfo(vertexFormat))
         .setInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE)
         .setViewport(0.f, 0.f, (float)swapchainExtent.width, (float)swapchainExtent.height)  // ignored if dynamic
         .setScissor(0, 0, swapchainExtent.width, swapchainExtent.height)                      // ignored if dynamic
@@ -767,12 +1361,29 @@ void Renderer::createGraphicsPipeline() {
         .setMultisample(msaa)
         .setDepthStencil(depthStencil)
         .setColorBlendAttachments({ colorAttachment })
-        .setLayout(pipelineLayout)
+        .setLayout(pipelineLayout, mainLayoutKey)
         .setRenderingFormats({ swapchainImageFormat }, depthFormat)
-        .setPipelineCache(pipelineCache.get())
         .setDynamicStates({ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR });
 
-    graphicsPipeline = pb.build(device);
+    // Indirect variant: same state, transforms from the instance buffer
+    PipelineBuilder indirect = pb;
+    addMeshStages(pb, false);
+    addMeshStages(indirect, true);
+
+    // Both are needed for the first frame: one blocking batch
+    const PipelineBuilder* builders[] = { &pb, &indirect };
+    VkPipeline built[2]{};
+    pipelines.createBatch(builders, 2, built);
+    graphicsPipeline = built[0];
+    indirectPipeline = built[1];
+    graphicsPipelineKey = pb.hash();
+    indirectPipelineKey = indirect.hash();
+    graphicsBuilder = pb;
+    indirectBuilder = indirect;
+    stormRaster = raster;
+
+    // Shader objects carry the same state; the pipelines above stay as the fallback
+    if (shaderObjects) createShaderObjects();
 
     // Name pipeline & layout
     if (pSetName) {
@@ -780,85 +1391,253 @@ void Renderer::createGraphicsPipeline() {
         n.objectType = VK_OBJECT_TYPE_PIPELINE; n.objectHandle = (uint64_t)graphicsPipeline; n.pObjectName = "TrianglePipeline";
         pSetName(device, &n);
         n = { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
+        n.objectType = VK_OBJECT_TYPE_PIPELINE; n.objectHandle = (uint64_t)indirectPipeline; n.pObjectName = "IndirectPipeline";
+        pSetName(device, &n);
+        n = { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
         n.objectType = VK_OBJECT_TYPE_PIPELINE_LAYOUT; n.objectHandle = (uint64_t)pipelineLayout; n.pObjectName = "MainLayout";
         pSetName(device, &n);
     }
+}
 
-    vkDestroyShaderModule(device, fragModule, nullptr);
-    vkDestroyShaderModule(device, vertModule, nullptr);
+// A changed mesh shader rebuilds both pipelines in the background from the saved builders.
+// The old pipeline keeps drawing until its replacement is ready; a replacement that fails to
+// compile is dropped and the old one stays. Changes arriving while a rebuild compiles wait for
+// it, so a fallback is never a pipeline that is being released. Shader objects have no
+// background path and are recreated on the spot.
+void Renderer::reloadShaders() {
+    const std::vector<std::string>& changed = shaderLibrary.poll();
+    shaderLibrary.takeRejected(reloadErrors);
+    for (const std::string& name : changed)
+        if (name == "mesh.vert" || name == "triangle.frag" || name == "indirect_bindless.vert")
+            shaderReloadPending = true;
+
+    // get(to) serves the old pipeline until the new one is in, so the keys switch right away
+    // and `from` is released once `to` can stand on its own
+    for (auto it = pipelineSwaps.begin(); it != pipelineSwaps.end();) {
+        if (!pipelines.ready(it->to)) { ++it; continue; }
+        if (pipelines.failed(it->to)) {
+            reloadErrors.push_back({ it->to == graphicsPipelineKey ? "graphics pipeline" : "indirect pipeline",
+                "failed to compile, keeping the old one" });
+            pipelines.release(it->to);
+            if (graphicsPipelineKey == it->to) graphicsPipelineKey = it->from;
+            if (indirectPipelineKey == it->to) indirectPipelineKey = it->from;
+        } else {
+            pipelines.release(it->from);
+        }
+        it = pipelineSwaps.erase(it);
+    }
+
+    if (shaderReloadPending && pipelineSwaps.empty()) {
+        shaderReloadPending = false;
+        PipelineBuilder* builders[] = { &graphicsBuilder, &indirectBuilder };
+        PipelineRegistry::Key* keys[] = { &graphicsPipelineKey, &indirectPipelineKey };
+        for (uint32_t i = 0; i < 2; ++i) {
+            addMeshStages(*builders[i], i == 1);
+            const PipelineRegistry::Key to = builders[i]->hash();
+            if (to == *keys[i]) continue;   // only the other pipeline's shaders changed
+            pipelines.request(*builders[i], pipelines.get(*keys[i]));
+            pipelineSwaps.push_back({ *keys[i], to });
+            *keys[i] = to;
+        }
+        if (shaderObjects) {
+            // Earlier frames may still be bound to the old objects; they go with this frame's submit
+            graphicsShaders.retire(deletionQueue, frameTimeline.lastSubmitted() + 1);
+            indirectShaders.retire(deletionQueue, frameTimeline.lastSubmitted() + 1);
+            createShaderObjects();
+        }
+    }
+    if (pipelineSwaps.empty() && pipelines.pendingCount() == 0) shaderLibrary.releaseRetired();
 }
 
-void Renderer::createCommandPool() {
+void Renderer::createCommandBuffers() {
+    // Recording threads = caller + workers; each gets its own pool per frame in flight
+    jobs.init();
     auto indices = findQueueFamilies(physicalDevice);
-    VkCommandPoolCreateInfo info{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
-    info.queueFamilyIndex = indices.graphicsFamily.value();
-    info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    if (vkCreateCommandPool(device, &info, nullptr, &commandPool) != VK_SUCCESS)
-        throw std::runtime_error("Failed to create command pool");
+    framePools.init(device, indices.graphicsFamily.value(), framesInFlight, jobs.threadCount());
+    if (asyncCompute) computePools.init(device, indices.computeFamily.value(), framesInFlight, 1);
 }
 
-void Renderer::createCommandBuffers() {
-    commandBuffers.resize(swapchainImages.size());
-    VkCommandBufferAllocateInfo info{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    info.commandPool = commandPool;
-    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    info.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-    if (vkAllocateCommandBuffers(device, &info, commandBuffers.data()) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate command buffers");
+// workload.instances copies of the mesh on a square grid in the XY plane. The first
+// animatedInstances spin in place (animateScene()); the rest keep this transform for good.
+void Renderer::buildScene() {
+    const uint32_t n = workload.instances;
+    transforms.init(n, framesInFlight);
+    instanceOrigins.resize(size_t(n) * 3);
+    animatedInstances = static_cast<uint32_t>(std::lround(std::clamp(workload.animatedFraction, 0.f, 1.f) * static_cast<float>(n)));
+
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+    const float spacing = meshRadius * 2.5f;
+    const float origin = -0.5f * spacing * static_cast<float>(side - 1);
+
+    // Quantized positions -> object space: uniform scale, then the dequant offset
+    const float identity[4] = { 0.f, 0.f, 0.f, 1.f };
+    for (uint32_t i = 0; i < n; ++i) {
+        float* at = &instanceOrigins[size_t(i) * 3];
+        at[0] = origin + spacing * static_cast<float>(i % side);
+        at[1] = origin + spacing * static_cast<float>(i / side);
+        at[2] = 0.f;
+        const float position[3] = { at[0] + meshDequant[0], at[1] + meshDequant[1], at[2] + meshDequant[2] };
+        transforms.create(position, identity, meshDequant[3]);
+    }
+    drawListDirty = true;
+}
+
+// Spin about Z by the scene time; the dequant offset turns with the mesh
+void Renderer::animateScene() {
+    if (animatedInstances == 0) return;
+
+    const float t = sceneTime();
+    const float c = std::cos(t), s = std::sin(t);
+    const float rotation[4] = { 0.f, 0.f, std::sin(0.5f * t), std::cos(0.5f * t) };
+    const float offset[3] = {
+        meshDequant[0] * c - meshDequant[1] * s,
+        meshDequant[0] * s + meshDequant[1] * c,
+        meshDequant[2],
+    };
+    for (uint32_t i = 0; i < animatedInstances; ++i) {
+        const float* at = &instanceOrigins[size_t(i) * 3];
+        const float position[3] = { at[0] + offset[0], at[1] + offset[1], at[2] + offset[2] };
+        transforms.setPosition(i, position);
+        transforms.setRotation(i, rotation);
+    }
+}
+
+// One draw per (submesh, instance), submesh-major so each submesh's instances are one run
+void Renderer::buildDrawList() {
+    if (!drawListDirty) return;
+    drawListDirty = false;
+    ++drawListVersion;
+
+    drawList.clear();
+    instancedDraws.clear();
+    const GeometryPool::Range& mesh = geometry.range(meshHandle);
+    for (const MeshSubmesh& sm : submeshes) {
+        for (uint32_t i = 0; i < transforms.size(); ++i) {
+            DrawItem item{};
+            item.instance = i;
+            item.indexCount = sm.indexCount;
+            item.firstIndex = mesh.firstIndex + sm.firstIndex;
+            item.vertexOffset = mesh.vertexOffset + sm.vertexOffset;
+            std::memcpy(item.bounds, sm.sphere, sizeof(item.bounds));
+            drawList.push_back(item);
+        }
+    }
+
+    for (const DrawItem& d : drawList) {
+        if (!instancedDraws.empty()) {
+            VkDrawIndexedIndirectCommand& run = instancedDraws.back();
+            if (run.indexCount == d.indexCount && run.firstIndex == d.firstIndex && run.vertexOffset == d.vertexOffset
+                && run.firstInstance + run.instanceCount == d.instance) {
+                ++run.instanceCount;
+                continue;
+            }
+        }
+        instancedDraws.push_back({ d.indexCount, 1, d.firstIndex, d.vertexOffset, d.instance });
+    }
 }
 
 // ==================== Renderer::recordCommandBuffer (Sync2 barriers + dynamic viewport/scissor) ====================
-void Renderer::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex) {
+const std::vector<RenderGraph::Submission>& Renderer::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex) {
     VkCommandBufferBeginInfo begin{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     if (vkBeginCommandBuffer(cmd, &begin) != VK_SUCCESS)
         throw std::runtime_error("Failed to begin command buffer");
+    gpuProfiler.beginFrame(cmd, currentFrame);
 
-    // --- Sync2: begin-of-pass image layout transitions ---
-    VkImageMemoryBarrier2 colorBarrier2{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-    colorBarrier2.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
-    colorBarrier2.srcAccessMask = 0;
-    colorBarrier2.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-    colorBarrier2.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-    colorBarrier2.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;              // discard on clear
-    colorBarrier2.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorBarrier2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    colorBarrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    colorBarrier2.image = swapchainImages[imageIndex];
-    colorBarrier2.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    colorBarrier2.subresourceRange.baseMipLevel = 0;
-    colorBarrier2.subresourceRange.levelCount = 1;
-    colorBarrier2.subresourceRange.baseArrayLayer = 0;
-    colorBarrier2.subresourceRange.layerCount = 1;
-
-    VkImageMemoryBarrier2 depthBarrier2{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-    depthBarrier2.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
-    depthBarrier2.srcAccessMask = 0;
-    depthBarrier2.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
-    depthBarrier2.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    depthBarrier2.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthBarrier2.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL; // core 1.3 name
-    depthBarrier2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    depthBarrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    depthBarrier2.image = depthImage;
-    depthBarrier2.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    depthBarrier2.subresourceRange.baseMipLevel = 0;
-    depthBarrier2.subresourceRange.levelCount = 1;
-    depthBarrier2.subresourceRange.baseArrayLayer = 0;
-    depthBarrier2.subresourceRange.layerCount = 1;
-
-    std::array<VkImageMemoryBarrier2, 2> imgBarriers{ colorBarrier2, depthBarrier2 };
-    VkDependencyInfo depBegin{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
-    depBegin.imageMemoryBarrierCount = static_cast<uint32_t>(imgBarriers.size());
-    depBegin.pImageMemoryBarriers = imgBarriers.data();
-    // no memory/buffer barriers in this batch
-    vkCmdPipelineBarrier2(cmd, &depBegin);
+    // --- Take ownership of freshly uploaded buffers (no-op when nothing is pending) ---
+    frameUploadWait = uploader.recordAcquireBarriers(cmd);
 
+    // --- Pending geometry pool defragment copies, then one VMA defragmentation pass ---
+    geometry.recordCopies(cmd);
+    memory.recordDefragmentation(cmd, frameTimeline.lastSubmitted() + 1);
+
+    // --- Cull -> Draw -> DepthPyramid; the graph places the barriers between them ---
+    frameGraph.setImage(rgBackbuffer, swapchainImages[imageIndex], swapchainImageViews[imageIndex]);
+    if (gpuCulling) {
+        frameGraph.setImage(rgPyramid, culling.pyramidImage(), VK_NULL_HANDLE, culling.pyramidLevels());
+        frameGraph.setBuffer(rgCommands, indirectFrames[currentFrame].commands);
+        frameGraph.setBuffer(rgCount, indirectFrames[currentFrame].count);
+    }
+    if (rgReadback.valid()) frameGraph.setBuffer(rgReadback, frameReadback);
+    // Prologue work stays in cmd, invisible to async passes (nothing they read comes from it)
+    bool computeUsed = false;
+    auto beginSubmit = [&](RenderGraph::Queue queue) {
+        VkCommandBuffer c = VK_NULL_HANDLE;
+        if (queue == RenderGraph::Queue::Compute) {
+            c = computeUsed ? computePools.acquirePrimary(currentFrame) : computePools.primary(currentFrame);
+            computeUsed = true;
+        }
+        else c = framePools.acquirePrimary(currentFrame);
+        if (vkBeginCommandBuffer(c, &begin) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin command buffer");
+        return c;
+    };
+    const std::vector<RenderGraph::Submission>& submits = frameGraph.execute(cmd, beginSubmit);
+
+    if (textureStreamer.enabled()) textureStreamer.recordFeedbackBarrier(submits.back().cmd);
+    gpuProfiler.endFrame(submits.back().cmd);
+    for (const RenderGraph::Submission& s : submits) {
+        if (vkEndCommandBuffer(s.cmd) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record command buffer");
+    }
+    return submits;
+}
+
+// Begins a secondary inside the frame's dynamic rendering and binds the shared draw state.
+// Called from job threads: only reads renderer state.
+void Renderer::beginDrawSecondary(VkCommandBuffer cmd, VkPipeline pipeline, const ShaderObjectPipeline& shaders) {
+    VkCommandBufferInheritanceRenderingInfo inheritRendering{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO };
+    inheritRendering.colorAttachmentCount = 1;
+    inheritRendering.pColorAttachmentFormats = &swapchainImageFormat;
+    inheritRendering.depthAttachmentFormat = depthFormat;
+    inheritRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inherit{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    inherit.pNext = &inheritRendering;
+    inherit.pipelineStatistics = gpuProfiler.inheritedStatistics();   // Draw scope's query is active
+
+    VkCommandBufferBeginInfo begin{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    begin.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin.pInheritanceInfo = &inherit;
+    if (vkBeginCommandBuffer(cmd, &begin) != VK_SUCCESS)
+        throw std::runtime_error("Failed to begin secondary command buffer");
+
+    // --- Pipeline (or shader objects) + dynamic viewport/scissor (state is not inherited) ---
+    VkViewport vp{};
+    vp.x = 0.f; vp.y = 0.f;
+    vp.width = static_cast<float>(swapchainExtent.width);
+    vp.height = static_cast<float>(swapchainExtent.height);
+    vp.minDepth = 0.f; vp.maxDepth = 1.f;
+    VkRect2D sc{ {0, 0}, swapchainExtent };
+
+    if (shaders.valid()) {
+        shaders.bind(cmd);
+        vkCmdSetViewportWithCount(cmd, 1, &vp);
+        vkCmdSetScissorWithCount(cmd, 1, &sc);
+    }
+    else {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdSetViewport(cmd, 0, 1, &vp);
+        vkCmdSetScissor(cmd, 0, 1, &sc);
+    }
+
+    // --- Bind geometry & descriptors ---
+    const VkDeviceSize offsets[VertexLayoutInfo::kMaxStreams]{};
+    vkCmdBindVertexBuffers(cmd, 0, geometry.streamCount(), geometry.vertexBuffers(), offsets);
+    vkCmdBindIndexBuffer(cmd, geometry.indexBuffer(), 0, GeometryPool::kIndexType);
+
+    const VkDescriptorSet sets[] = { descriptorSets[currentFrame], bindlessSet.set() };
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, bindless ? 2u : 1u,
+        sets, 1, &frameUniformOffset);
+}
+
+// Main pass body; the graph has moved the backbuffer and depth into attachment layouts
+void Renderer::recordDrawPass(VkCommandBuffer cmd) {
     // --- Dynamic rendering begin ---
     VkClearValue clearColor{}; clearColor.color = { { 0.00f, 0.00f, 0.00f, 1.0f } };
     VkClearValue clearDepth{}; clearDepth.depthStencil = { 1.0f, 0 };
 
     VkRenderingAttachmentInfo colorAtt{ VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO };
-    colorAtt.imageView = swapchainImageViews[imageIndex];
+    colorAtt.imageView = frameGraph.view(rgBackbuffer);
     colorAtt.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -868,7 +1647,7 @@ void Renderer::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex) {
     depthAtt.imageView = depthImageView;
     depthAtt.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
     depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAtt.storeOp = occlusionCulling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAtt.clearValue = clearDepth;
 
     VkRenderingInfo rendering{ VK_STRUCTURE_TYPE_RENDERING_INFO };
@@ -878,82 +1657,91 @@ void Renderer::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex) {
     rendering.colorAttachmentCount = 1;
     rendering.pColorAttachments = &colorAtt;
     rendering.pDepthAttachment = &depthAtt;
+    rendering.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT; // draws live in secondaries
 
     vkCmdBeginRendering(cmd, &rendering);
 
-    // --- Pipeline + dynamic viewport/scissor ---
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-    VkViewport vp{};
-    vp.x = 0.f; vp.y = 0.f;
-    vp.width = static_cast<float>(swapchainExtent.width);
-    vp.height = static_cast<float>(swapchainExtent.height);
-    vp.minDepth = 0.f; vp.maxDepth = 1.f;
-    vkCmdSetViewport(cmd, 0, 1, &vp);
-
-    VkRect2D sc{ {0, 0}, swapchainExtent };
-    vkCmdSetScissor(cmd, 0, 1, &sc);
-
-    // --- Bind geometry & descriptors ---
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, offsets);
-    vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    // --- Draws ---
+    if (gpuDriven) {
+        // Whole draw list in one indirect call per pipeline; a single secondary is enough
+        VkCommandBuffer sec = framePools.acquireSecondary(currentFrame, 0);
+        recordIndirectDraws(sec);
+        vkCmdExecuteCommands(cmd, 1, &sec);
+    }
+    else {
+        // Partitions recorded in parallel into secondaries, executed in order
+        const uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+        const uint32_t partitions = (drawCount + kDrawsPerJob - 1) / kDrawsPerJob;
+        secondaryCmds.assign(partitions, VK_NULL_HANDLE);
+
+        jobs.parallelFor(partitions, [&](uint32_t job, uint32_t thread) {
+            VkCommandBuffer sec = framePools.acquireSecondary(currentFrame, thread);
+            const uint32_t first = job * kDrawsPerJob;
+            recordDrawPartition(sec, first, std::min(kDrawsPerJob, drawCount - first));
+            secondaryCmds[job] = sec;
+        });
+
+        if (!secondaryCmds.empty())
+            vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaryCmds.size()), secondaryCmds.data());
+    }
 
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-        &descriptorSets[currentFrame], 0, nullptr);
+    vkCmdEndRendering(cmd);
+}
 
-    // --- Push constants (per-object model) ---
-    float t = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
-    glm::mat4 model = glm::rotate(glm::mat4(1.0f), t, glm::vec3(0.f, 0.f, 1.f));
-    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+// Runs on a job thread: only reads renderer state and writes its own secondary buffer.
+void Renderer::recordDrawPartition(VkCommandBuffer cmd, uint32_t firstDraw, uint32_t drawCount) {
+    beginDrawSecondary(cmd, graphicsPipeline, graphicsShaders);
+
+    // --- Per-object push constants + draws ---
+    for (uint32_t i = firstDraw; i < firstDraw + drawCount; ++i) {
+        const DrawItem& d = drawList[i];
+        float model[16];
+        transforms.world(d.instance, model);
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(model), model);
+        vkCmdDrawIndexed(cmd, d.indexCount, 1, d.firstIndex, d.vertexOffset, 0);
+    }
 
-    // --- Draw ---
-    vkCmdDrawIndexed(cmd, static_cast<uint32_t>(gIndices.size()), 1, 0, 0, 0);
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record secondary command buffer");
+}
 
-    vkCmdEndRendering(cmd);
+void Renderer::recordIndirectDraws(VkCommandBuffer cmd) {
+    beginDrawSecondary(cmd, indirectPipeline, indirectShaders);
+    if (bindless) {
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t),
+            &instanceSlots[currentFrame]);
+    }
 
-    // --- Sync2: transition color to PRESENT ---
-    VkImageMemoryBarrier2 toPresent2{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-    toPresent2.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-    toPresent2.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-    toPresent2.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
-    toPresent2.dstAccessMask = 0;
-    toPresent2.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    toPresent2.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    toPresent2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toPresent2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toPresent2.image = swapchainImages[imageIndex];
-    toPresent2.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    toPresent2.subresourceRange.baseMipLevel = 0;
-    toPresent2.subresourceRange.levelCount = 1;
-    toPresent2.subresourceRange.baseArrayLayer = 0;
-    toPresent2.subresourceRange.layerCount = 1;
-
-    VkDependencyInfo depEnd{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
-    depEnd.imageMemoryBarrierCount = 1;
-    depEnd.pImageMemoryBarriers = &toPresent2;
-
-    vkCmdPipelineBarrier2(cmd, &depEnd);
+    const IndirectFrame& f = indirectFrames[currentFrame];
+    if (drawIndirectCount) {
+        vkCmdDrawIndexedIndirectCount(cmd, f.commands, 0, f.count, 0, maxInstances,
+            sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else if (indirectDrawCount > 0) {
+        // No count buffer support: fall back to the CPU-side count
+        vkCmdDrawIndexedIndirect(cmd, f.commands, 0, indirectDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
 
     if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
-        throw std::runtime_error("Failed to record command buffer");
+        throw std::runtime_error("Failed to record secondary command buffer");
 }
 
 
 void Renderer::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    // Headless: no acquire / present semaphores, only the timelines
+    imageAvailableSemaphores.resize(headlessMode ? 0 : framesInFlight);
 
     renderFinishedSemaphores.resize(swapchainImages.size());
-    imagesInFlight.resize(swapchainImages.size(), VK_NULL_HANDLE);
+    imageRetireValue.assign(swapchainImages.size(), 0);
+
+    frameTimeline.init(device);
+    if (asyncCompute) computeTimeline.init(device);
+    frameRetireValue = {};
 
     VkSemaphoreCreateInfo sem{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-    VkFenceCreateInfo fence{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-    fence.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        if (vkCreateSemaphore(device, &sem, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fence, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+    for (uint32_t i = 0; i < imageAvailableSemaphores.size(); ++i) {
+        if (vkCreateSemaphore(device, &sem, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create per-frame sync objects");
         }
 
@@ -961,23 +1749,27 @@ void Renderer::createSyncObjects() {
         if (pSetName) {
             VkDebugUtilsObjectNameInfoEXT n{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
             n.objectType = VK_OBJECT_TYPE_SEMAPHORE; n.objectHandle = (uint64_t)imageAvailableSemaphores[i];
-            char labelA[32]; std::snprintf(labelA, sizeof(labelA), "ImgAvail[%d]", i); n.pObjectName = labelA; pSetName(device, &n);
-            n = { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
-            n.objectType = VK_OBJECT_TYPE_FENCE; n.objectHandle = (uint64_t)inFlightFences[i];
-            char labelF[32]; std::snprintf(labelF, sizeof(labelF), "InFlight[%d]", i); n.pObjectName = labelF; pSetName(device, &n);
+            char labelA[32]; std::snprintf(labelA, sizeof(labelA), "ImgAvail[%u]", i); n.pObjectName = labelA; pSetName(device, &n);
         }
     }
 
+    if (pSetName) {
+        VkDebugUtilsObjectNameInfoEXT n{ VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
+        n.objectType = VK_OBJECT_TYPE_SEMAPHORE; n.objectHandle = (uint64_t)frameTimeline.semaphore();
+        n.pObjectName = "FrameTimeline"; pSetName(device, &n);
+    }
+
     recreatePerImageSemaphores();
 }
 
 void Renderer::recreatePerImageSemaphores() {
-    for (auto s : renderFinishedSemaphores) if (s) vkDestroySemaphore(device, s, nullptr);
+    // A pending present may still wait on these
+    for (auto s : renderFinishedSemaphores) deletionQueue.deferSemaphore(frameTimeline.lastSubmitted(), s);
     renderFinishedSemaphores.clear();
-    renderFinishedSemaphores.resize(swapchainImages.size());
+    renderFinishedSemaphores.resize(headlessMode ? 0 : swapchainImages.size());
 
     VkSemaphoreCreateInfo sem{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-    for (size_t i = 0; i < swapchainImages.size(); ++i) {
+    for (size_t i = 0; i < renderFinishedSemaphores.size(); ++i) {
         if (vkCreateSemaphore(device, &sem, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
             throw std::runtime_error("Failed to create per-image renderFinished semaphore");
 
@@ -991,319 +1783,361 @@ void Renderer::recreatePerImageSemaphores() {
             pSetName(device, &n);
         }
     }
-    imagesInFlight.assign(swapchainImages.size(), VK_NULL_HANDLE);
+    imageRetireValue.assign(swapchainImages.size(), 0);
 }
 
+// Swapchain-sized resources go to the deletion queue, keyed to the last submit that could use
+// them. The swapchain handle stays alive for the oldSwapchain handoff in createSwapchain().
 void Renderer::destroySwapchainObjects() {
-    if (!commandBuffers.empty()) {
-        vkFreeCommandBuffers(device, commandPool,
-            static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-        commandBuffers.clear();
-    }
+    const uint64_t retire = frameTimeline.lastSubmitted();
 
-    if (depthImageView) { vkDestroyImageView(device, depthImageView, nullptr); depthImageView = VK_NULL_HANDLE; }
-    if (depthImage) { vmaDestroyImage(allocator, depthImage, depthAlloc); depthImage = VK_NULL_HANDLE; depthAlloc = VK_NULL_HANDLE; }
+    transients.release(deletionQueue, retire);
+    depthImageView = VK_NULL_HANDLE;
+    depthImage = VK_NULL_HANDLE;
 
-    for (auto view : swapchainImageViews) vkDestroyImageView(device, view, nullptr);
+    // Headless views belong to offscreen
+    if (!headlessMode) for (auto view : swapchainImageViews) deletionQueue.deferImageView(retire, view);
     swapchainImageViews.clear();
     swapchainImages.clear();
-
-    if (swapchain) {
-        vkDestroySwapchainKHR(device, swapchain, nullptr);
-        swapchain = VK_NULL_HANDLE;
-    }
 }
 
 void Renderer::recreateSwapchain() {
-    int width = 0, height = 0;
-    do {
-        glfwGetFramebufferSize(windowHandle, &width, &height);
-        if (width == 0 || height == 0) glfwWaitEvents();
-    } while (width == 0 || height == 0);
-
-    vkDeviceWaitIdle(device);
-
-    destroySwapchainObjects();
-
-    // --- Rebuild in the correct order ---
-    createSwapchain();
-    createImageViews();
+    if (headlessMode) {
+        // Pending readbacks carry the old size: hand them over before their buffers go
+        offscreen.drain(frameTimeline);
+        destroySwapchainObjects();
+        offscreen.release(deletionQueue, frameTimeline.lastSubmitted());
+        createOffscreenTarget();
+    }
+    else {
+        int width = 0, height = 0;
+        do {
+            glfwGetFramebufferSize(windowHandle, &width, &height);
+            if (width == 0 || height == 0) glfwWaitEvents();
+        } while (width == 0 || height == 0);
+
+        // No vkDeviceWaitIdle: frames in flight keep running against the old objects
+        destroySwapchainObjects();
+
+        // --- Rebuild in the correct order ---
+        createSwapchain();           // oldSwapchain handoff
+        createImageViews();
+    }
     createDepthResources();      // depth before pipeline if rebuild here
+    if (gpuCulling) culling.resize(depthImageView, swapchainExtent, deletionQueue, frameTimeline.lastSubmitted());
 
-    createCommandBuffers();
     recreatePerImageSemaphores();
 }
 
 
 // ---------------- Buffer helpers (VMA) ----------------
-void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-    VkBuffer& buffer, VmaAllocation& alloc, void** mapped) {
+void Renderer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryBudget::Category category,
+    VkBuffer& buffer, VmaAllocation& alloc, void** mapped, const QueueSharing& sharing) {
     VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     bi.size = size;
     bi.usage = usage;
-    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    sharing.apply(bi);
 
     VmaAllocationCreateInfo aci{};
     aci.usage = VMA_MEMORY_USAGE_AUTO;
+    aci.flags = memory.allocationFlags(category);
     if (mapped) {
-        aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+        aci.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT |
             VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
     }
 
+    memory.reserve(size, frameTimeline.lastSubmitted() + 1);
     VmaAllocationInfo out{};
     if (vmaCreateBuffer(allocator, &bi, &aci, &buffer, &alloc, &out) != VK_SUCCESS)
         throw std::runtime_error("Failed to create buffer");
+    memory.track(alloc, category);
     if (mapped) *mapped = out.pMappedData;
 }
 
-VkCommandBuffer Renderer::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo alloc{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    alloc.commandPool = commandPool;
-    alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc.commandBufferCount = 1;
-
-    VkCommandBuffer cmd{};
-    vkAllocateCommandBuffers(device, &alloc, &cmd);
-
-    VkCommandBufferBeginInfo begin{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    vkBeginCommandBuffer(cmd, &begin);
-    return cmd;
-}
-
-void Renderer::endSingleTimeCommands(VkCommandBuffer cmd) {
-    vkEndCommandBuffer(cmd);
-    VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &cmd;
-    vkQueueSubmit(graphicsQueue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-    vkFreeCommandBuffers(device, commandPool, 1, &cmd);
-}
-
-// ================== StagingUploader implementation ==================
-void Renderer::StagingUploader::init(VmaAllocator alloc, VkDevice dev, VkQueue q, VkCommandPool pool, VkDeviceSize initialCapacity) {
-    allocator = alloc;
-    device = dev;
-    queue = q;
-    cmdPool = pool;
-
-    // Create fence once
-    VkFenceCreateInfo fi{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-    if (vkCreateFence(device, &fi, nullptr, &copyFence) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: failed to create fence");
+// ---------------- Resource creation ----------------
+// Mesh files are mapped and copied page by page from the mapping into the staging ring;
+// nothing is parsed or buffered on the heap. The mapping can close once upload() returns.
+void Renderer::loadGeometry() {
+    submeshes.clear();
+
+    if (meshPath.empty()) {
+        // Built-in triangle: one submesh, sphere around the AABB center
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+        for (const auto& v : gVertices) { lo = glm::min(lo, v.pos); hi = glm::max(hi, v.pos); }
+        const glm::vec3 center = (lo + hi) * 0.5f;
+        float radius = 0.f;
+        for (const auto& v : gVertices) radius = std::max(radius, glm::length(v.pos - center));
+
+        MeshSubmesh sm{};
+        sm.indexCount = static_cast<uint32_t>(gIndices.size());
+        sm.sphere[0] = center.x; sm.sphere[1] = center.y; sm.sphere[2] = center.z; sm.sphere[3] = radius;
+        submeshes.push_back(sm);
+
+        // Quantize into the same stream-major layout a Snorm16 .pmesh carries
+        const vtxq::Dequant dq = vtxq::dequantForBounds(&lo.x, &hi.x);
+        const uint32_t vertexCount = static_cast<uint32_t>(gVertices.size());
+        std::vector<PositionSnorm16> positions(vertexCount);
+        std::vector<VertexAttribsPacked> attribs(vertexCount);
+        const float normal[3] = { 0.f, 0.f, 1.f };
+        for (uint32_t i = 0; i < vertexCount; ++i) {
+            const Vertex& v = gVertices[i];
+            for (int a = 0; a < 3; ++a) {
+                positions[i].xyzw[a] = vtxq::encodeSnorm16((v.pos[a] - dq.offset[a]) / dq.scale);
+                attribs[i].color[a] = vtxq::encodeUnorm8(v.color[a]);
+            }
+            positions[i].xyzw[3] = 0;
+            attribs[i].color[3] = 255;
+            vtxq::encodeOctahedral(normal, attribs[i].normalOct);
+        }
+        std::vector<unsigned char> blob(vertexCount * (sizeof(PositionSnorm16) + sizeof(VertexAttribsPacked)));
+        std::memcpy(blob.data(), positions.data(), positions.size() * sizeof(PositionSnorm16));
+        std::memcpy(blob.data() + positions.size() * sizeof(PositionSnorm16), attribs.data(),
+            attribs.size() * sizeof(VertexAttribsPacked));
+
+        vertexFormat = VertexFormat::Snorm16;
+        setMeshDequant(dq);
+        const uint32_t indexCount = static_cast<uint32_t>(gIndices.size());
+        geometry.init(allocator, device, vertexLayoutInfo(vertexFormat), kPoolVertices, kPoolIndices, &memory);
+        meshHandle = geometry.allocate(vertexCount, indexCount);
+        geometry.upload(meshHandle, uploader, blob.data(), gIndices.data(), sizeof(uint16_t));
+        return;
     }
 
-    // Allocate initial staging buffer
-    ensureCapacity(initialCapacity);
-}
-
-void Renderer::StagingUploader::destroy() {
-    if (stagingBuffer) {
-        vmaDestroyBuffer(allocator, stagingBuffer, stagingAlloc);
-        stagingBuffer = VK_NULL_HANDLE;
-        stagingAlloc = VK_NULL_HANDLE;
-        mapped = nullptr;
-        capacity = 0;
+    MeshFile mesh;
+    mesh.open(meshPath);   // validates format + stride
+    const MeshFileHeader& h = mesh.header();
+
+    submeshes.assign(mesh.submeshes(), mesh.submeshes() + mesh.submeshCount());
+    if (submeshes.empty()) {
+        // Whole mesh as one draw
+        MeshSubmesh sm{};
+        sm.indexCount = h.indexCount;
+        std::memcpy(sm.sphere, h.sphere, sizeof(sm.sphere));
+        submeshes.push_back(sm);
     }
-    if (copyFence) {
-        vkDestroyFence(device, copyFence, nullptr);
-        copyFence = VK_NULL_HANDLE;
-    }
-    allocator = VK_NULL_HANDLE;
-    device = VK_NULL_HANDLE;
-    queue = VK_NULL_HANDLE;
-    cmdPool = VK_NULL_HANDLE;
-}
-
-void Renderer::StagingUploader::ensureCapacity(VkDeviceSize requiredBytes) {
-    if (requiredBytes <= capacity && stagingBuffer != VK_NULL_HANDLE) return;
 
-    // Destroy old
-    if (stagingBuffer) {
-        vmaDestroyBuffer(allocator, stagingBuffer, stagingAlloc);
-        stagingBuffer = VK_NULL_HANDLE;
-        stagingAlloc = VK_NULL_HANDLE;
-        mapped = nullptr;
+    vertexFormat = mesh.vertexFormat();
+    vtxq::Dequant dq{};
+    if (vertexFormat != VertexFormat::Float32) {
+        std::memcpy(dq.offset, h.dequantOffset, sizeof(dq.offset));
+        dq.scale = h.dequantScale;
     }
+    setMeshDequant(dq);
 
-    // Grow with a little headroom to reduce reallocs
-    capacity = std::max<VkDeviceSize>(requiredBytes, capacity ? capacity * 2 : (1ull << 20)); // min 1 MB
-
-    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    bi.size = capacity;
-    bi.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    VmaAllocationCreateInfo aci{};
-    aci.usage = VMA_MEMORY_USAGE_AUTO;
-    aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-
-    VmaAllocationInfo out{};
-    if (vmaCreateBuffer(allocator, &bi, &aci, &stagingBuffer, &stagingAlloc, &out) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: failed to create staging buffer");
-    }
-    mapped = out.pMappedData;
+    geometry.init(allocator, device, vertexLayoutInfo(vertexFormat),
+        std::max(kPoolVertices, h.vertexCount), std::max(kPoolIndices, h.indexCount), &memory);
+    meshHandle = geometry.allocate(h.vertexCount, h.indexCount);
+    geometry.upload(meshHandle, uploader, mesh.vertexData(), mesh.indexData(), h.indexSize);
 }
 
-VkCommandBuffer Renderer::StagingUploader::allocateOneShotCmd() const {
-    VkCommandBufferAllocateInfo ai{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-    ai.commandPool = cmdPool;
-    ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    ai.commandBufferCount = 1;
-
-    VkCommandBuffer cmd{};
-    if (vkAllocateCommandBuffers(device, &ai, &cmd) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: failed to allocate command buffer");
+// Submesh spheres are stored dequantized; draws carry them in quantized space because the
+// dequant is part of the model matrix.
+void Renderer::setMeshDequant(const vtxq::Dequant& dq) {
+    std::memcpy(meshDequant, dq.offset, sizeof(dq.offset));
+    meshDequant[3] = dq.scale;
+    meshRadius = 0.f;
+    for (MeshSubmesh& sm : submeshes) {
+        const float c[3] = { sm.sphere[0], sm.sphere[1], sm.sphere[2] };
+        meshRadius = std::max(meshRadius, std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]) + sm.sphere[3]);
+        for (int a = 0; a < 3; ++a) sm.sphere[a] = (sm.sphere[a] - dq.offset[a]) / dq.scale;
+        sm.sphere[3] /= dq.scale;
     }
-    VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    if (vkBeginCommandBuffer(cmd, &bi) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: failed to begin command buffer");
-    }
-    return cmd;
+    if (meshRadius <= 0.f) meshRadius = 1.f;
 }
 
-void Renderer::StagingUploader::submitAndWait(VkCommandBuffer cmd) {
-    if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: failed to end command buffer");
-    }
-    // Reset fence to unsignaled for this submit
-    vkResetFences(device, 1, &copyFence);
+void Renderer::createUniformBuffers() {
+    uniforms.init(allocator, physicalDevice, framesInFlight, kUniformBytesPerFrame, &memory, computeSharing);
+}
 
-    VkSubmitInfo si{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-    si.commandBufferCount = 1;
-    si.pCommandBuffers = &cmd;
+// The frame slot has retired: rewind its uniform region and push this frame's UBO
+void Renderer::updateUniformBuffer(uint32_t /*imageIndex*/) {
+    uniforms.beginFrame(currentFrame);
 
-    if (vkQueueSubmit(queue, 1, &si, copyFence) != VK_SUCCESS) {
-        throw std::runtime_error("StagingUploader: queue submit failed");
+    // Camera: backs off until the whole instance grid fits the 60 degree frustum
+    const float side = std::ceil(std::sqrt(static_cast<float>(workload.instances)));
+    const float distance = workload.instances > 1 ? side * meshRadius * 2.5f : 1.5f;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, distance),
+        glm::vec3(0.f, 0.f, 0.f),
+        glm::vec3(0.f, 1.f, 0.f));
+    // A headless tile keeps the whole image's frustum and scales its rectangle up to NDC
+    const VkRect2D& tile = headlessConfig.tile;
+    const bool tiled = headlessMode && tile.extent.width && tile.extent.height;
+    const VkExtent2D image = tiled ? headlessConfig.extent : swapchainExtent;
+    float aspect = image.width / static_cast<float>(std::max(1u, image.height));
+    glm::mat4 proj = glm::perspective(glm::radians(60.f), aspect, 0.01f,
+        workload.instances > 1 ? distance + 4.f * meshRadius : 10.f);
+    proj[1][1] *= -1.f;
+    if (tiled) {
+        const float sx = image.width / static_cast<float>(tile.extent.width);
+        const float sy = image.height / static_cast<float>(tile.extent.height);
+        const float cx = (tile.offset.x + 0.5f * tile.extent.width) / image.width * 2.f - 1.f;
+        const float cy = (tile.offset.y + 0.5f * tile.extent.height) / image.height * 2.f - 1.f;
+        glm::mat4 crop(1.f);
+        crop[0][0] = sx;
+        crop[1][1] = sy;
+        crop[3][0] = -sx * cx;
+        crop[3][1] = -sy * cy;
+        proj = crop * proj;
     }
 
-    // Wait only for this upload instead of stalling the whole queue with vkQueueWaitIdle
-    vkWaitForFences(device, 1, &copyFence, VK_TRUE, UINT64_MAX);
-
-    vkFreeCommandBuffers(device, cmdPool, 1, &cmd);
-}
-
-void Renderer::StagingUploader::upload(const void* src, VkDeviceSize sizeBytes, VkBuffer dst, VkDeviceSize dstOffset) {
-    if (sizeBytes == 0) return;
-    ensureCapacity(sizeBytes);
-
-    // Copy to mapped staging, then flush the written range
-    std::memcpy(mapped, src, static_cast<size_t>(sizeBytes));
-    vmaFlushAllocation(allocator, stagingAlloc, 0, sizeBytes);
+    glm::mat4 vp = proj * view;
+    std::memcpy(frameViewProj, &vp[0][0], sizeof(frameViewProj));
 
-    // Record copy
-    VkCommandBuffer cmd = allocateOneShotCmd();
-    VkBufferCopy region{ 0, dstOffset, sizeBytes };
-    vkCmdCopyBuffer(cmd, stagingBuffer, dst, 1, &region);
+    UniformBufferObject u{};
+    std::memcpy(u.vp, &vp[0][0], sizeof(u.vp));
 
-    // Submit and wait for completion
-    submitAndWait(cmd);
+    frameUniformOffset = uniforms.push(u);
+    uniforms.flush();   // no-op on coherent memory
 }
 
-void Renderer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) {
-    VkCommandBuffer cmd = beginSingleTimeCommands();
-    VkBufferCopy copy{ 0, 0, size };
-    vkCmdCopyBuffer(cmd, src, dst, 1, &copy);
-    endSingleTimeCommands(cmd);
+void Renderer::createDescriptorSets() {
+    // FrameSetWrites -> set 0
+    std::array<VkDescriptorUpdateTemplateEntry, 2> entries{};
+    entries[0].dstBinding = 0;
+    entries[0].descriptorCount = 1;
+    entries[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    entries[0].offset = offsetof(FrameSetWrites, ubo);
+    entries[0].stride = sizeof(VkDescriptorBufferInfo);
+
+    entries[1].dstBinding = 1;
+    entries[1].descriptorCount = 1;
+    entries[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    entries[1].offset = offsetof(FrameSetWrites, instances);
+    entries[1].stride = sizeof(VkDescriptorBufferInfo);
+
+    frameSetTemplate.create(device, descriptorSetLayout, entries.data(), static_cast<uint32_t>(entries.size()));
+    descriptorSets.assign(framesInFlight, VK_NULL_HANDLE);
+
+    if (bindless) {
+        for (uint32_t i = 0; i < framesInFlight; ++i)
+            instanceSlots[i] = bindlessSet.addStorageBuffer(indirectFrames[i].instances);
+    }
 }
 
-void Renderer::createDeviceLocalBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-    VkBuffer& buffer, VmaAllocation& alloc) {
-    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    bi.size = size;
-    bi.usage = usage;
-    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+// The frame slot has retired (drawFrame waited on it): recycle its pools and write a fresh set 0
+void Renderer::writeFrameDescriptorSet() {
+    frameDescriptors.beginFrame(currentFrame);
+    descriptorSets[currentFrame] = frameDescriptors.allocate(currentFrame, descriptorSetLayout);
 
-    VmaAllocationCreateInfo aci{};
-    aci.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    FrameSetWrites w{};
+    w.ubo = { uniforms.buffer(), 0, sizeof(UniformBufferObject) };   // offset is dynamic
+    w.instances = { indirectFrames[currentFrame].instances, 0, VK_WHOLE_SIZE };
+    frameSetTemplate.update(descriptorSets[currentFrame], &w);
+}
 
-    if (vmaCreateBuffer(allocator, &bi, &aci, &buffer, &alloc, nullptr) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create device-local buffer");
+void Renderer::createIndirectBuffers() {
+    constexpr auto kFrameData = MemoryBudget::Category::FrameData;
+    for (uint32_t i = 0; i < framesInFlight; ++i) {
+        IndirectFrame& f = indirectFrames[i];
+        // Cull reads and writes all of them, on the compute queue with async compute
+        createBuffer(sizeof(InstanceData) * maxInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, kFrameData,
+            f.instances, f.instanceAlloc, &f.instanceMapped, computeSharing);
+        createBuffer(sizeof(VkDrawIndexedIndirectCommand) * maxInstances,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, kFrameData,
+            f.commands, f.commandAlloc, &f.commandMapped, computeSharing);
+        createBuffer(sizeof(uint32_t),
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, kFrameData,
+            f.count, f.countAlloc, &f.countMapped, computeSharing);
+        if (gpuCulling) {
+            createBuffer(sizeof(GpuCulling::CullInput) * maxInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, kFrameData,
+                f.cullInputs, f.cullInputAlloc, &f.cullInputMapped, computeSharing);
+        }
     }
 }
 
-// ---------------- Resource creation ----------------
-void Renderer::createVertexBuffer() {
-    const VkDeviceSize size = sizeof(decltype(gVertices)::value_type) * gVertices.size();
+// Stale transforms, and the draw list when this slot has an older one; the frame slot is free
+// (timeline waited).
+void Renderer::writeIndirectCommands() {
+    if (!gpuDriven) return;
+
+    IndirectFrame& f = indirectFrames[currentFrame];
+    for (const TransformSystem::Range& r : transforms.writeFrame(currentFrame, static_cast<float*>(f.instanceMapped), jobs))
+        vmaFlushAllocation(allocator, f.instanceAlloc, sizeof(InstanceData) * r.first, sizeof(InstanceData) * r.count);
+
+    const uint32_t drawCount = std::min<uint32_t>(static_cast<uint32_t>(drawList.size()), maxInstances);
+    const uint32_t count = gpuCulling ? drawCount : static_cast<uint32_t>(instancedDraws.size());
+    indirectDrawCount = count;
+    if (slotDrawListVersion[currentFrame] == drawListVersion) return;
+    slotDrawListVersion[currentFrame] = drawListVersion;
+
+    if (gpuCulling) {
+        // Culling emits the commands and the count; the CPU only provides candidates
+        auto* inputs = static_cast<GpuCulling::CullInput*>(f.cullInputMapped);
+        for (uint32_t i = 0; i < count; ++i) {
+            const DrawItem& d = drawList[i];
+            GpuCulling::CullInput& c = inputs[i];
+            c.indexCount = d.indexCount;
+            c.firstIndex = d.firstIndex;
+            c.vertexOffset = d.vertexOffset;
+            c.instance = d.instance;
+            std::memcpy(c.sphere, d.bounds, sizeof(c.sphere));
+        }
+        vmaFlushAllocation(allocator, f.cullInputAlloc, 0, sizeof(GpuCulling::CullInput) * count);
+        return;
+    }
 
-    // Device-local vertex buffer
-    createDeviceLocalBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        vertexBuffer, vertexAlloc);
+    // gl_InstanceIndex = firstInstance + instance -> transform index
+    std::memcpy(f.commandMapped, instancedDraws.data(), sizeof(VkDrawIndexedIndirectCommand) * count);
+    std::memcpy(f.countMapped, &count, sizeof(count));
 
-    // Upload from reusable staging
-    uploader.upload(gVertices.data(), size, vertexBuffer, 0);
+    vmaFlushAllocation(allocator, f.commandAlloc, 0, sizeof(VkDrawIndexedIndirectCommand) * count);
+    vmaFlushAllocation(allocator, f.countAlloc, 0, sizeof(uint32_t));
 }
 
-void Renderer::createIndexBuffer() {
-    const VkDeviceSize size = sizeof(uint16_t) * gIndices.size();
-
-    // Device-local index buffer
-    createDeviceLocalBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        indexBuffer, indexAlloc);
-
-    // Upload from reusable staging
-    uploader.upload(gIndices.data(), size, indexBuffer, 0);
+float Renderer::sceneTime() const {
+    if (workload.fixedTimestep > 0.f) return static_cast<float>(sequenceFrame()) * workload.fixedTimestep;
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
 }
 
-void Renderer::createUniformBuffers() {
-    const VkDeviceSize size = sizeof(UniformBufferObject);
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformAllocs.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        void* mapped = nullptr;
-        createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uniformBuffers[i], uniformAllocs[i], &mapped);
-        uniformMapped[i] = mapped;
+// Benchmark load on top of the scene. Streamed meshes are never drawn: each is uploaded and
+// freed against this frame's submit, so its ranges come back once the frame retires.
+void Renderer::runWorkload() {
+    if (workload.uploadBytesPerFrame) {
+        const uint32_t vertexBytes = vertexLayoutInfo(vertexFormat).vertexBytes();
+        constexpr uint32_t kChunkVertices = 1u << 14;
+        // framesInFlight frames of chunks live at once; leave the pool room for the mesh
+        const uint32_t maxChunks = kPoolVertices / (kChunkVertices * (framesInFlight + 1));
+        const uint32_t chunks = std::min<uint32_t>(maxChunks, static_cast<uint32_t>(
+            (workload.uploadBytesPerFrame + kChunkVertices * vertexBytes - 1) / (kChunkVertices * vertexBytes)));
+        streamScratch.resize(static_cast<size_t>(kChunkVertices) * (vertexBytes + sizeof(uint32_t)));
+        const unsigned char* indices = streamScratch.data() + static_cast<size_t>(kChunkVertices) * vertexBytes;
+        for (uint32_t i = 0; i < chunks; ++i) {
+            const GeometryPool::Handle h = geometry.allocate(kChunkVertices, kChunkVertices);
+            geometry.upload(h, uploader, streamScratch.data(), indices, sizeof(uint32_t));
+            geometry.free(h, frameTimeline.lastSubmitted() + 1);
+        }
     }
-}
 
-void Renderer::updateUniformBuffer(uint32_t /*imageIndex*/) {
-    // Use currentFrame for per-frame UBO indexing
-    const uint32_t idx = currentFrame;
-
-    // Time
-    float t = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
-
-    // Camera
-    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, 1.5f),
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(0.f, 1.f, 0.f));
-    float aspect = swapchainExtent.width / static_cast<float>(std::max(1u, swapchainExtent.height));
-    glm::mat4 proj = glm::perspective(glm::radians(60.f), aspect, 0.01f, 10.f);
-    proj[1][1] *= -1.f;
-
-    glm::mat4 vp = proj * view;
-
-    UniformBufferObject u{};
-    std::memcpy(u.vp, &vp[0][0], sizeof(u.vp));
-
-    std::memcpy(uniformMapped[idx], &u, sizeof(u));
-    vmaFlushAllocation(allocator, uniformAllocs[idx], 0, sizeof(u));
+    // Depth bias is baked state, so every constant factor is a new pipeline
+    for (uint32_t i = 0; i < workload.pipelineVariantsPerFrame; ++i) {
+        VkPipelineRasterizationStateCreateInfo r = stormRaster;
+        r.depthBiasEnable = VK_TRUE;
+        r.depthBiasConstantFactor = static_cast<float>(++stormVariant);
+        PipelineBuilder variant = graphicsBuilder;
+        variant.setRasterization(r);
+        pipelines.request(variant, graphicsPipeline);
+    }
 }
 
-void Renderer::createDescriptorSets() {
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        descriptorSets[i] = descriptorArena.allocate(descriptorSetLayout);
-
-        VkDescriptorBufferInfo buf{};
-        buf.buffer = uniformBuffers[i];
-        buf.offset = 0;
-        buf.range = sizeof(UniformBufferObject);
-
-        VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-        write.dstSet = descriptorSets[i];
-        write.dstBinding = 0;
-        write.dstArrayElement = 0;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        write.descriptorCount = 1;
-        write.pBufferInfo = &buf;
-
-        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+// Culling reads the frame UBO + instance SSBO and writes the indirect/count buffers of each slot.
+void Renderer::createCullingStage() {
+    if (!gpuCulling) return;
+
+    VkShaderModule cullModule = shaderLibrary.get("cull.comp").module;
+    VkShaderModule hizModule = occlusionCulling ? shaderLibrary.get("hiz.comp").module : VK_NULL_HANDLE;
+
+    culling.init(device, allocator, pipelineCache.get(), cullModule, hizModule, framesInFlight, occlusionCulling,
+        &memory, computeSharing);
+
+    for (uint32_t i = 0; i < framesInFlight; ++i) {
+        GpuCulling::FrameBuffers fb{};
+        fb.frameUbo = uniforms.buffer();
+        fb.uboRange = sizeof(UniformBufferObject);
+        fb.instances = indirectFrames[i].instances;
+        fb.inputs = indirectFrames[i].cullInputs;
+        fb.commands = indirectFrames[i].commands;
+        fb.count = indirectFrames[i].count;
+        culling.setFrameBuffers(i, fb);
     }
+    culling.resize(depthImageView, swapchainExtent, deletionQueue, frameTimeline.lastSubmitted());
 }
-
@@ -9,18 +9,154 @@
 #include <string>
 
 #include "PipelineCache.hpp"
+#include "PipelineRegistry.hpp"
+#include "PipelineManifest.hpp"
+#include "ShaderObjectPipeline.hpp"
+#include "BindlessDescriptors.hpp"
+#include "FrameDescriptorAllocator.hpp"
+#include "DescriptorUpdateTemplate.hpp"
+#include "LinearUniformAllocator.hpp"
+#include "StagingUploader.hpp"
+#include "JobSystem.hpp"
+#include "ThreadCommandPools.hpp"
+#include "FrameTimeline.hpp"
+#include "DeletionQueue.hpp"
+#include "MemoryBudget.hpp"
+#include "QueueSharing.hpp"
+#include "TransientAllocator.hpp"
+#include "RenderGraph.hpp"
+#include "GpuCulling.hpp"
+#include "GpuProfiler.hpp"
+#include "FrameTimer.hpp"
+#include "MeshFile.hpp"
+#include "GeometryPool.hpp"
+#include "OffscreenTarget.hpp"
+#include "TransformSystem.hpp"
+#include "TextureStreamer.hpp"
+#include "ShaderLibrary.hpp"
 
 struct GLFWwindow;
 
 class Renderer {
 public:
+    static constexpr uint32_t kMaxFramesInFlight = 3;
+
+    // Presentation policy. framesInFlight and presentWait are read by init(); mode and imageCount
+    // apply from the next swapchain (re)creation, so they can change at any time.
+    struct PresentConfig {
+        VkPresentModeKHR mode = VK_PRESENT_MODE_MAILBOX_KHR;   // FIFO if the surface lacks it
+        uint32_t framesInFlight = 2;   // 1..kMaxFramesInFlight; 1 = the CPU never runs a frame ahead
+        uint32_t imageCount = 0;       // swapchain images, clamped to the surface; 0 = minImageCount + 1
+        // VK_KHR_present_id + present_wait: a frame starts once the frame framesInFlight
+        // presents back is on screen, so no frames queue up behind the display
+        bool     presentWait = true;
+    };
+
+    // Rendering without a window or surface, into OffscreenTarget images (before init(nullptr)).
+    // Frames stay pipelined framesInFlight deep; finished ones reach onFrame in order.
+    struct HeadlessConfig {
+        VkExtent2D extent{ 1280, 720 };
+        uint32_t   readbackBuffers = 0;         // 0 = framesInFlight + 1
+        OffscreenTarget::ReadbackFn onFrame;    // empty = no readback (throughput only)
+        // Share of a split sequence (MultiDeviceRenderer): frame k here is frame
+        // firstFrame + k * frameStride of the sequence, which readbacks and fixed-timestep scene
+        // time both use. A non-empty tile renders only that rectangle of the extent-sized image,
+        // into tile-sized offscreen images.
+        uint64_t   firstFrame = 0;
+        uint32_t   frameStride = 1;
+        VkRect2D   tile{};
+    };
+
+    // Physical device choice (before init()). Suitable devices are ranked by listDevices();
+    // index takes the nth best, so independent Renderers can be given one GPU each.
+    struct DeviceConfig {
+        int32_t index = -1;          // rank among suitable devices; -1 = the best
+        // Key the pipeline cache and manifest by the device too, for several GPUs sharing a
+        // cache directory (identical GPUs would otherwise share and race on one file)
+        bool    perDeviceCache = false;
+    };
+    struct DeviceInfo {
+        VkPhysicalDevice     device = VK_NULL_HANDLE;
+        std::string          name;
+        VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+        VkDeviceSize         localBytes = 0;   // DEVICE_LOCAL heaps
+        bool                 transferQueue = false;   // dedicated transfer family
+        bool                 computeQueue = false;    // async compute family
+        uint64_t             score = 0;
+    };
+
+    // Synthetic load for benchmarks (before init()). Everything off reproduces the normal scene.
+    struct WorkloadConfig {
+        uint32_t     instances = 1;                 // copies of the mesh on a square grid
+        VkDeviceSize uploadBytesPerFrame = 0;       // geometry streamed through the uploader, freed next frame
+        uint32_t     pipelineVariantsPerFrame = 0;  // never-seen pipelines requested per frame
+        float        fixedTimestep = 0.f;           // > 0: scene time advances this much per frame
+        float        animatedFraction = 1.f;        // instances that spin; the rest never re-upload
+    };
+
+    // window == nullptr runs headless (setHeadless())
     void init(GLFWwindow* window);
     void cleanup();
     void drawFrame();
 
     void setFramebufferResized(bool v) { framebufferResized = v; }
+    // .pmesh to load at init(); empty = built-in triangle
+    void setMeshPath(std::string path) { meshPath = std::move(path); }
+    // Draw with VK_EXT_shader_object instead of pipelines where supported (before init())
+    void setPreferShaderObjects(bool on) { preferShaderObjects = on; }
+    // GPU scope timings (toggle any time); statistics need device features, so only before init()
+    void setGpuProfiling(bool on, bool statistics = false) {
+        gpuProfiler.setEnabled(on);
+        profileStatistics = statistics;
+    }
+    GpuProfiler& profiler() { return gpuProfiler; }
+    // CPU phases of drawFrame(); always recording
+    const FrameTimer& frameTimes() const { return frameTimer; }
+    // Heap budgets, per-category usage, defragmentation
+    MemoryBudget& memoryBudget() { return memory; }
+    void setPresentConfig(const PresentConfig& config);
+    const PresentConfig& presentConfig() const { return present; }
+    // Mode of the current swapchain: presentConfig().mode, or FIFO when the surface lacks it
+    VkPresentModeKHR presentMode() const { return swapchainPresentMode; }
+    void setHeadless(HeadlessConfig config) { headlessConfig = std::move(config); }
+    bool headless() const { return headlessMode; }
+    // Headless: new offscreen size from the next frame (rebuilds like a swapchain resize)
+    void resizeHeadless(VkExtent2D extent) {
+        headlessConfig.extent = extent;
+        framebufferResized = true;
+    }
+    void setWorkload(const WorkloadConfig& config) { workload = config; }
+    const WorkloadConfig& workloadConfig() const { return workload; }
+    // Pipeline cache blob + manifest (before init()); benchmarks point this at a fresh directory
+    void setCacheDirectory(std::string dir) { cacheDir = std::move(dir); }
+    // SPIR-V directory and hot reload (before init()); reloads rebuild pipelines in the background
+    void setShaderConfig(const ShaderLibrary::Config& config) { shaderConfig = config; }
+    // Hot reloads that were not applied since the last call (refused shaders, pipelines that
+    // failed to compile); the previous version stays in use
+    void takeReloadErrors(std::vector<ShaderLibrary::Rejected>& out) {
+        out.insert(out.end(), reloadErrors.begin(), reloadErrors.end());
+        reloadErrors.clear();
+    }
+    void setDeviceConfig(const DeviceConfig& config) { deviceConfig = config; }
+    // Suitable devices, best first: discrete over integrated over virtual/CPU, then more
+    // device-local memory, then dedicated transfer / async compute families. Before init() it
+    // uses a temporary instance and headless suitability.
+    std::vector<DeviceInfo> listDevices();
+    std::string deviceName() const;
+    // Frames submitted so far; readbacks carry their sequence numbers (HeadlessConfig::firstFrame)
+    uint64_t frameCount() const { return frameNumber; }
+    // KTX2 texture, streamed in from its mip tail (after init()). Needs descriptor indexing;
+    // throws std::runtime_error otherwise or on a bad file.
+    TextureStreamer::Handle loadTexture(const std::string& path);
+    TextureStreamer& textures() { return textureStreamer; }
 
 private:
+    PresentConfig  present;
+    uint32_t       framesInFlight = 2;   // present.framesInFlight, clamped at init()
+    WorkloadConfig workload;
+    std::string    cacheDir = "cache";
+    DeviceConfig   deviceConfig;
+
     // ---------------- Core ----------------
     VkInstance instance{};
     VkDebugUtilsMessengerEXT debugMessenger{};
@@ -30,58 +166,207 @@ private:
     VmaAllocator allocator = VK_NULL_HANDLE;
     VkQueue graphicsQueue{};
     VkQueue presentQueue{};
+    VkQueue transferQueue{};   // dedicated DMA queue when available, else graphicsQueue
+    VkQueue computeQueue{};    // compute family without graphics, if the device has one
+    bool    asyncCompute = false;     // GPU culling runs on computeQueue
+    QueueSharing computeSharing;      // graphics + compute families, for what both queues touch
     GLFWwindow* windowHandle = nullptr;
+    bool        headlessMode = false;   // no window: offscreen stands in for the swapchain
 
     // ---------------- Swapchain ----------------
     VkSwapchainKHR swapchain{};
     VkFormat       swapchainImageFormat{};
     VkExtent2D     swapchainExtent{};
+    VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
     std::vector<VkImage>     swapchainImages;
     std::vector<VkImageView> swapchainImageViews;
 
+    // ---------------- Headless ----------------
+    // Images + views are mirrored into swapchainImages / swapchainImageViews (one per frame slot)
+    HeadlessConfig  headlessConfig;
+    OffscreenTarget offscreen;
+    VkBuffer        frameReadback = VK_NULL_HANDLE;   // this frame's copy target, when reading back
+
+    // ---------------- Transient render targets ----------------
+    TransientAllocator transients;   // swapchain-sized, placed by frameGraph, rebuilt on resize
+
+    // ---------------- Frame graph ----------------
+    // Cull -> Draw -> DepthPyramid (-> Readback headless), rebuilt with the swapchain; handles are
+    // rebound every frame
+    RenderGraph           frameGraph;
+    RenderGraph::Resource rgBackbuffer;
+    RenderGraph::Resource rgDepth;
+    RenderGraph::Resource rgPyramid;     // gpuCulling only
+    RenderGraph::Resource rgCommands;
+    RenderGraph::Resource rgCount;
+    RenderGraph::Resource rgReadback;    // headless readback only
+
     // ---------------- Depth ----------------
-    VkImage       depthImage{};
-    VmaAllocation depthAlloc{};
+    VkImage       depthImage{};       // owned by transients
     VkImageView   depthImageView{};
     VkFormat      depthFormat{};
+    bool          occlusionCulling = false;   // depth is stored + sampled into the Hi-Z pyramid
 
     // ---------------- Pipeline ----------------
+    // Every module comes from the library; set 0 and the push constants are reflected from
+    // the mesh shaders (mainLayout)
+    ShaderLibrary         shaderLibrary;
+    ShaderLibrary::Config shaderConfig;
+    std::vector<ShaderLibrary::Rejected> reloadErrors;   // for takeReloadErrors()
+    ShaderLibrary::Layout mainLayout;
+    static constexpr uint32_t kMeshInstanceBuffer = 0;   // mesh.vert constant_id: transforms from set 0 binding 1
     VkDescriptorSetLayout descriptorSetLayout{};
     VkPipelineLayout      pipelineLayout{};
+    // Descriptor indexing: set 1 of the main layout; the indirect path reads its instance
+    // buffer through a slot index in push constants
+    bool                  bindless = false;
+    BindlessDescriptors   bindlessSet;
+    std::array<uint32_t, kMaxFramesInFlight> instanceSlots{};
+    // Sampled through bindless slots; BC / ASTC enabled when the device has them
+    TextureStreamer       textureStreamer;
+    bool                  textureBC = false;
+    bool                  textureASTC = false;
     VkPipeline            graphicsPipeline{};
-
-    // ---------------- Geometry buffers ----------------
-    VkBuffer      vertexBuffer{};
-    VmaAllocation vertexAlloc{};
-    VkBuffer      indexBuffer{};
-    VmaAllocation indexAlloc{};
-
-    // ---------------- Uniforms (per swapchain image) ----------------
+    VkPipeline            indirectPipeline{};   // same layout; transforms from the instance SSBO
+    PipelineRegistry::Key graphicsPipelineKey = 0;   // handles re-read each frame: fast-linked
+    PipelineRegistry::Key indirectPipelineKey = 0;   // pipelines get swapped for optimized ones
+    std::vector<VkPipeline> retiredPipelines;        // scratch for PipelineRegistry::takeRetired()
+    // Kept for shader reloads, which swap the stages and request the result
+    PipelineBuilder       graphicsBuilder;
+    PipelineBuilder       indirectBuilder;
+    // A reloaded pipeline replaces `from` once `to` is ready; `from` serves until then
+    struct PipelineSwap { PipelineRegistry::Key from = 0; PipelineRegistry::Key to = 0; };
+    std::vector<PipelineSwap> pipelineSwaps;
+    bool                  shaderReloadPending = false;   // waits for pipelineSwaps to drain
+    bool pipelineLibrary = false;       // VK_EXT_graphics_pipeline_library: fast link on misses
+    bool shaderObjects = false;         // VK_EXT_shader_object enabled and preferred
+    bool preferShaderObjects = false;
+    ShaderObjectPipeline  graphicsShaders;   // no-pipeline path, same state as the pipelines
+    ShaderObjectPipeline  indirectShaders;
+
+    // ---------------- Geometry ----------------
+    // Every mesh lives in the pool's shared buffers; draws offset into them.
+    static constexpr uint32_t kPoolVertices = 1u << 20;
+    static constexpr uint32_t kPoolIndices = 1u << 22;
+    GeometryPool         geometry;
+    GeometryPool::Handle meshHandle;
+    std::string          meshPath;
+    std::vector<MeshSubmesh> submeshes;   // mesh-relative, quantized space; one draw each, spheres feed culling
+    VertexFormat         vertexFormat = VertexFormat::Snorm16;   // chosen by loadGeometry()
+    float                meshDequant[4] = { 0.f, 0.f, 0.f, 1.f };  // offset xyz, scale; folded into the model matrix
+    float                meshRadius = 1.f;     // object space, around the origin: instance grid spacing
+
+    // ---------------- Benchmark workload ----------------
+    std::vector<unsigned char> streamScratch;   // source of streamed uploads (contents don't matter)
+    VkPipelineRasterizationStateCreateInfo stormRaster{};   // graphicsBuilder's; variants differ in depth bias
+    uint32_t             stormVariant = 0;
+
+    // ---------------- Uniforms (per frame in flight) ----------------
+    // Bump-allocated from one mapped buffer; binding 0 is UNIFORM_BUFFER_DYNAMIC over it and
+    // frameUniformOffset is this frame's dynamic offset (graphics set 0 and the cull set).
     struct UniformBufferObject { float vp[16]; };
-    std::vector<VkBuffer>      uniformBuffers;
-    std::vector<VmaAllocation> uniformAllocs;
-    std::vector<void*>         uniformMapped;
-
-    std::vector<VkDescriptorSet> descriptorSets;
+    float frameViewProj[16]{};   // CPU copy of this frame's vp (frustum planes for culling)
+    static constexpr VkDeviceSize kUniformBytesPerFrame = 64 * 1024;
+    LinearUniformAllocator uniforms;
+    uint32_t               frameUniformOffset = 0;
+
+    std::vector<VkDescriptorSet> descriptorSets;   // per frame in flight, reallocated each frame
+
+    // ---------------- GPU-driven draws (per frame in flight) ----------------
+    // Instance transforms are read by gl_InstanceIndex (firstInstance = instance slot), draw
+    // commands live in an indirect buffer and the draw count in a separate count buffer.
+    struct InstanceData { float model[16]; };   // std430 mirror of mesh.vert
+    static constexpr uint32_t kMinInstanceCapacity = 16384;
+    uint32_t maxInstances = kMinInstanceCapacity;   // per frame slot; grows with workload.instances at init()
+    struct IndirectFrame {
+        VkBuffer      instances{};  VmaAllocation instanceAlloc{}; void* instanceMapped = nullptr;
+        VkBuffer      commands{};   VmaAllocation commandAlloc{};  void* commandMapped = nullptr;
+        VkBuffer      count{};      VmaAllocation countAlloc{};    void* countMapped = nullptr;
+        VkBuffer      cullInputs{}; VmaAllocation cullInputAlloc{}; void* cullInputMapped = nullptr;
+    };
+    std::array<IndirectFrame, kMaxFramesInFlight> indirectFrames{};   // first framesInFlight used
+    uint32_t indirectDrawCount = 0;  // CPU copy of this frame's count (fallback path)
+    bool gpuDriven = false;          // multiDrawIndirect + drawIndirectFirstInstance available
+    bool drawIndirectCount = false;  // vkCmdDrawIndexedIndirectCount available
+    bool gpuCulling = false;         // compute culling fills commands + count (needs drawIndirectCount)
+    bool samplerMinmax = false;      // samplerFilterMinmax enabled (Hi-Z occlusion)
+    GpuCulling culling;
+
+    // ---------------- Profiling ----------------
+    // Scopes in recordCommandBuffer(); readback happens when the frame slot comes around again
+    GpuProfiler gpuProfiler;
+    bool        profileStatistics = false;   // pipelineStatisticsQuery + inheritedQueries enabled
+    FrameTimer  frameTimer;                  // CPU side: where drawFrame() blocks
 
     // ---------------- Commands ----------------
-    VkCommandPool commandPool{};
-    std::vector<VkCommandBuffer> commandBuffers;
+    ThreadCommandPools framePools;         // per frame in flight x recording thread
+    ThreadCommandPools computePools;       // per frame in flight, compute family (async compute only)
+    JobSystem jobs;
+
+    // ---------------- Scene ----------------
+    // One transform per instance; draws reference them by index. Only the instances that
+    // spin are touched per frame, the others stay in the frame slots' instance buffers.
+    TransformSystem transforms;
+    std::vector<float> instanceOrigins;   // grid position per instance, xyz
+    uint32_t animatedInstances = 0;       // the first animatedInstances transforms spin
+
+    // ---------------- Draw list ----------------
+    // Unchanged while the scene and the geometry pool layout are: rebuilt when drawListDirty,
+    // written to a frame slot's buffers when that slot last saw an older drawListVersion.
+    // Without the indirect path: recorded into secondary buffers in partitions of kDrawsPerJob,
+    // one job each.
+    struct DrawItem {
+        uint32_t instance = 0;  // transform index
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t  vertexOffset = 0;
+        float    bounds[4]{};   // object-space bounding sphere
+    };
+    static constexpr uint32_t kDrawsPerJob = 128;
+    std::vector<DrawItem>        drawList;
+    // Indirect path without culling: runs of draws with the same geometry and consecutive
+    // instances, one instanced command each
+    std::vector<VkDrawIndexedIndirectCommand> instancedDraws;
+    bool     drawListDirty = true;
+    uint64_t drawListVersion = 0;
+    std::array<uint64_t, kMaxFramesInFlight> slotDrawListVersion{};   // 0 = never written
+    std::vector<VkCommandBuffer> secondaryCmds;  // one per partition, in draw order
 
     // ---------------- Sync ----------------
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-    std::vector<VkSemaphore> imageAvailableSemaphores;  // per-frame
-    std::vector<VkSemaphore> renderFinishedSemaphores;  // per-swapchain-image
-    std::vector<VkFence>     inFlightFences;            // per-frame
-    std::vector<VkFence>     imagesInFlight;            // per-swapchain-image
+    std::vector<VkSemaphore> imageAvailableSemaphores;  // per-frame (binary; acquire needs one)
+    std::vector<VkSemaphore> renderFinishedSemaphores;  // per-swapchain-image (binary; present needs one)
+    FrameTimeline            frameTimeline;             // signalled by every graphics submit
+    FrameTimeline            computeTimeline;           // signalled by every async compute submit
+    std::array<uint64_t, kMaxFramesInFlight> frameRetireValue{}; // timeline value of each frame slot's last submit
+    std::vector<uint64_t>    imageRetireValue;          // per-swapchain-image, same meaning
     uint32_t currentFrame = 0;
+    uint64_t frameUploadWait = 0;   // uploader timeline value this frame's submit waits on
+    uint64_t frameNumber = 0;       // frames submitted
+    // Position of frame frameNumber in the (split) headless sequence
+    uint64_t sequenceFrame() const { return headlessConfig.firstFrame + frameNumber * headlessConfig.frameStride; }
+
+    // Present pacing (VK_KHR_present_id + VK_KHR_present_wait)
+    bool                    presentPacing = false;
+    PFN_vkWaitForPresentKHR pWaitForPresent = nullptr;
+    uint64_t                presentId = 0;   // last id presented on the current swapchain
+
+    // Debug names; per renderer, since several may run on different devices
+    PFN_vkSetDebugUtilsObjectNameEXT pSetName = nullptr;
 
     bool framebufferResized = false;
 
-    PipelineCacheManager pipelineCache;
+    DeletionQueue deletionQueue;    // handles retired against frameTimeline values
+    MemoryBudget  memory;           // polled once per frame; defrag copies go into the frame's submit
+    bool          memoryBudgetExt = false;   // VK_EXT_memory_budget enabled (else VMA estimates)
+
+    static constexpr uint32_t kPipelineCompileThreads = 2;
+    PipelineCacheManager pipelineCache;   // + one thread cache per compile thread
+    PipelineRegistry     pipelines;       // owns every graphics pipeline; compiles against pipelineCache
+    PipelineManifest     pipelineManifest; // every pipeline built so far, replayed at startup
 
     // ---------------- Time ----------------
     std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastCacheFlush = startTime;   // thread-cache merge + save
 
 private:
     // ==================== Setup ====================
@@ -96,19 +381,28 @@ private:
     // ==================== Swapchain pipeline ====================
     void createSwapchain();
     void createImageViews();
+    void createOffscreenTarget();       // headless: replaces createSwapchain() + createImageViews()
     void createDescriptorSetLayout();   // swapchain-independent
-    void createDepthResources();
+    void createDepthResources();        // builds the frame graph, which owns depth
+    void buildFrameGraph();
     void createGraphicsPipeline();      // survives resizes (dynamic viewport/scissor)
+    void addMeshStages(PipelineBuilder& builder, bool indirect);   // current library modules
+    void createShaderObjects();         // from graphicsBuilder / indirectBuilder
+    void reloadShaders();               // per frame with hot reload: swaps in rebuilt pipelines
 
     // ==================== Resources ====================
-    void createVertexBuffer();
-    void createIndexBuffer();
+    void loadGeometry();                // mesh file (mapped) or built-in triangle, into the pool
+    void setMeshDequant(const vtxq::Dequant& dq);   // stores the dequant, moves submesh spheres to quantized space
     void createUniformBuffers();
     void updateUniformBuffer(uint32_t imageIndex);
     void createDescriptorSets();
+    void createIndirectBuffers();
+    void writeIndirectCommands();
+    void createCullingStage();
+    float sceneTime() const;            // wall clock, or sequenceFrame() * workload.fixedTimestep
+    void  runWorkload();                // per-frame streamed uploads + pipeline requests
 
     // ==================== Commands ====================
-    void createCommandPool();
     void createCommandBuffers();
 
     // ==================== Sync ====================
@@ -119,6 +413,8 @@ private:
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // transfer-only family, if the device has one
+        std::optional<uint32_t> computeFamily;  // compute family without graphics, if any
         [[nodiscard]] bool isComplete() const { return graphicsFamily.has_value() && presentFamily.has_value(); }
     };
     struct SwapSupportDetails {
@@ -128,119 +424,36 @@ private:
     };
 
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice dev);
+    static bool        hasDeviceExtension(VkPhysicalDevice dev, const char* name);
     [[nodiscard]] bool isDeviceSuitable(VkPhysicalDevice dev);
+    std::vector<DeviceInfo> rankDevices();   // suitable devices of instance, best first
     SwapSupportDetails querySwapSupport(VkPhysicalDevice dev);
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>&);
     VkPresentModeKHR   chooseSwapPresentMode(const std::vector<VkPresentModeKHR>&);
     VkExtent2D         chooseSwapExtent(const VkSurfaceCapabilitiesKHR&);
-    void               recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex);
-    VkShaderModule     createShaderModule(const std::vector<char>& code);
+    void               buildScene();      // transforms for workload.instances, at init()
+    void               animateScene();
+    void               buildDrawList();
+    // Returns the frame's submits (graph segments) in order, all ended
+    const std::vector<RenderGraph::Submission>& recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex);
+    void               recordDrawPass(VkCommandBuffer cmd);
+    void               beginDrawSecondary(VkCommandBuffer cmd, VkPipeline pipeline, const ShaderObjectPipeline& shaders);
+    void               recordDrawPartition(VkCommandBuffer cmd, uint32_t firstDraw, uint32_t drawCount);
+    void               recordIndirectDraws(VkCommandBuffer cmd);
 
     // ==================== Staging uploader ====================
-    struct StagingUploader {
-        // External deps
-        VmaAllocator allocator = VK_NULL_HANDLE;
-        VkDevice device = VK_NULL_HANDLE;
-        VkQueue queue = VK_NULL_HANDLE;
-        VkCommandPool cmdPool = VK_NULL_HANDLE;
-
-        // Reusable staging buffer
-        VkBuffer      stagingBuffer = VK_NULL_HANDLE;
-        VmaAllocation stagingAlloc = VK_NULL_HANDLE;
-        void* mapped = nullptr;
-        VkDeviceSize  capacity = 0;
-
-        // Per-upload fence
-        VkFence copyFence = VK_NULL_HANDLE;
-
-        void init(VmaAllocator alloc, VkDevice dev, VkQueue q, VkCommandPool pool, VkDeviceSize initialCapacity);
-        void destroy();
-
-        // Ensure capacity >= requiredBytes; reallocates if needed while keeping mapping persistent.
-        void ensureCapacity(VkDeviceSize requiredBytes);
-
-        // Blocking upload: memcpy to staging, flush, record copy, submit, wait on fence.
-        void upload(const void* src, VkDeviceSize sizeBytes, VkBuffer dst, VkDeviceSize dstOffset);
-
-    private:
-        VkCommandBuffer allocateOneShotCmd() const;
-        void submitAndWait(VkCommandBuffer cmd);
-    };
-
     StagingUploader uploader;
 
-    // Device-local buffer creation helper (no mapping)
-    void createDeviceLocalBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-        VkBuffer& buffer, VmaAllocation& alloc);
-
-    // ==================== Descriptor arena (auto-growing pools) ====================
-    struct DescriptorArena {
-        VkDevice device = VK_NULL_HANDLE;
-        uint32_t maxSetsPerPool = 256; // grow in chunks
-        std::vector<VkDescriptorPool> pools;
-
-        void init(VkDevice dev) { device = dev; }
-        void destroy() {
-            for (auto p : pools) if (p) vkDestroyDescriptorPool(device, p, nullptr);
-            pools.clear();
-            device = VK_NULL_HANDLE;
-        }
-        // Reset all pools so their sets become invalid, ready for re-allocation.
-        void reset() {
-            for (auto p : pools) if (p) vkResetDescriptorPool(device, p, 0);
-        }
-
-        VkDescriptorSet allocate(VkDescriptorSetLayout layout) {
-            if (pools.empty()) pools.push_back(createPool());
-
-            VkDescriptorSetAllocateInfo ai{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-            ai.descriptorPool = pools.back();
-            ai.descriptorSetCount = 1;
-            ai.pSetLayouts = &layout;
-
-            VkDescriptorSet set{};
-            VkResult r = vkAllocateDescriptorSets(device, &ai, &set);
-            if (r == VK_ERROR_OUT_OF_POOL_MEMORY || r == VK_ERROR_FRAGMENTED_POOL) {
-                pools.push_back(createPool());
-                ai.descriptorPool = pools.back();
-                VK_CHECK(vkAllocateDescriptorSets(device, &ai, &set));
-            }
-            else {
-                VK_CHECK(r);
-            }
-            return set;
-        }
-
-    private:
-        static void VK_CHECK(VkResult res) {
-            if (res != VK_SUCCESS) throw std::runtime_error("DescriptorArena: VkResult != VK_SUCCESS");
-        }
-
-        VkDescriptorPool createPool() {
-            // Generous defaults; tune later if needed.
-            std::array<VkDescriptorPoolSize, 5> sizes{ {
-                { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         maxSetsPerPool },
-                { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSetsPerPool },
-                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         maxSetsPerPool / 2 },
-                { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   maxSetsPerPool / 4 },
-                { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          maxSetsPerPool / 4 },
-            } };
-
-            VkDescriptorPoolCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-            info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-            info.maxSets = maxSetsPerPool * 2; // headroom
-            info.poolSizeCount = static_cast<uint32_t>(sizes.size());
-            info.pPoolSizes = sizes.data();
-
-            VkDescriptorPool pool{};
-            if (vkCreateDescriptorPool(device, &info, nullptr, &pool) != VK_SUCCESS) {
-                throw std::runtime_error("DescriptorArena: failed to create descriptor pool");
-            }
-            return pool;
-        }
+    // ==================== Per-frame descriptors ====================
+    // Set 0 is transient: allocated from the frame slot's pools every frame and written
+    // through one update template from a FrameSetWrites.
+    struct FrameSetWrites {
+        VkDescriptorBufferInfo ubo;         // binding 0
+        VkDescriptorBufferInfo instances;   // binding 1
     };
-
-    DescriptorArena descriptorArena;
+    FrameDescriptorAllocator frameDescriptors;
+    DescriptorUpdateTemplate frameSetTemplate;
+    void writeFrameDescriptorSet();
 
     // ==================== Images & buffers ====================
     VkFormat findDepthFormat();
@@ -248,17 +461,14 @@ private:
 
     // VMA wrappers
     void createImage(uint32_t w, uint32_t h, VkFormat format, VkImageUsageFlags usage,
-        VkImage& image, VmaAllocation& alloc);
+        VkImage& image, VmaAllocation& alloc, MemoryBudget::Category category);
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect);
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-        VkBuffer& buffer, VmaAllocation& alloc, void** mapped = nullptr);
-
-    void           copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
-    VkCommandBuffer beginSingleTimeCommands();
-    void            endSingleTimeCommands(VkCommandBuffer cmd);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryBudget::Category category,
+        VkBuffer& buffer, VmaAllocation& alloc, void** mapped = nullptr, const QueueSharing& sharing = {});
 
     // ==================== Resize handling ====================
     void recreateSwapchain();
+    void presentImage(uint32_t imageIndex);   // present + rebuild when out of date
     void destroySwapchainObjects();
 };
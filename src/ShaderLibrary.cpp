@@ -0,0 +1,478 @@
+#include "ShaderLibrary.hpp"
+#include "PipelineBuilder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// SPIR-V opcodes, decorations and storage classes the reflection reads
+namespace spv {
+constexpr uint32_t kMagic = 0x07230203;
+constexpr uint32_t kHeaderWords = 5;
+
+enum Op : uint32_t {
+    OpEntryPoint = 15,
+    OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24,
+    OpTypeImage = 25, OpTypeSampler = 26, OpTypeSampledImage = 27, OpTypeArray = 28,
+    OpTypeRuntimeArray = 29, OpTypeStruct = 30, OpTypePointer = 32,
+    OpConstant = 43,
+    OpVariable = 59,
+    OpDecorate = 71, OpMemberDecorate = 72,
+    OpTypeAccelerationStructureKHR = 5341,
+};
+enum Decoration : uint32_t {
+    SpecId = 1, Block = 2, BufferBlock = 3, ArrayStride = 6, MatrixStride = 7,
+    Binding = 33, DescriptorSet = 34, Offset = 35,
+};
+enum StorageClass : uint32_t { UniformConstant = 0, Uniform = 2, PushConstant = 9, StorageBuffer = 12 };
+constexpr uint32_t kDimBuffer = 5, kDimSubpassData = 6;
+}   // namespace spv
+
+VkShaderStageFlagBits stageOf(uint32_t executionModel) {
+    switch (executionModel) {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default: return VK_SHADER_STAGE_ALL;
+    }
+}
+
+// Reads a whole .spv; false (out untouched) when missing, empty or not word-sized
+bool readSpirv(const std::string& path, std::vector<uint32_t>& out) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) return false;
+    const auto size = static_cast<size_t>(f.tellg());
+    if (size == 0 || size % sizeof(uint32_t) != 0) return false;
+    std::vector<uint32_t> code(size / sizeof(uint32_t));
+    f.seekg(0);
+    f.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+    if (!f || code[0] != spv::kMagic) return false;
+    out.swap(code);
+    return true;
+}
+
+bool sameBindings(const std::vector<ShaderLibrary::Binding>& a, const std::vector<ShaderLibrary::Binding>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].set != b[i].set || a[i].binding != b[i].binding || a[i].type != b[i].type ||
+            a[i].count != b[i].count)
+            return false;
+    }
+    return true;
+}
+
+}   // namespace
+
+bool ShaderLibrary::Reflection::hasSpecConstant(uint32_t id) const {
+    return std::find(specConstants.begin(), specConstants.end(), id) != specConstants.end();
+}
+
+void ShaderLibrary::init(VkDevice dev, const Config& cfg) {
+    device = dev;
+    config = cfg;
+    if (!config.spirvDir.empty() && config.spirvDir.back() != '/') config.spirvDir += '/';
+    if (!config.sourceDir.empty() && config.sourceDir.back() != '/') config.sourceDir += '/';
+    quit = false;
+    if (config.watch) watcher = std::thread(&ShaderLibrary::watchLoop, this);
+}
+
+void ShaderLibrary::destroy() {
+    if (watcher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        watcher.join();
+    }
+    watches.clear();
+    reloaded.clear();
+
+    releaseRetired();
+    for (auto& [name, s] : shaders)
+        if (s->module) vkDestroyShaderModule(device, s->module, nullptr);
+    shaders.clear();
+    device = VK_NULL_HANDLE;
+}
+
+const ShaderLibrary::Shader& ShaderLibrary::get(const std::string& name) {
+    auto it = shaders.find(name);
+    if (it != shaders.end()) return *it->second;
+
+    auto s = std::make_unique<Shader>();
+    s->name = name;
+    const std::string path = spirvPath(name);
+    if (!readSpirv(path, s->code)) throw std::runtime_error("ShaderLibrary: missing or malformed SPIR-V: " + path);
+    if (!reflect(s->code.data(), s->code.size(), s->reflection))
+        throw std::runtime_error("ShaderLibrary: can't reflect " + path);
+    s->codeHash = PipelineBuilder::hashBytes(s->code.data(), s->code.size() * sizeof(uint32_t));
+    s->module = createModule(s->code);
+    if (!s->module) throw std::runtime_error("ShaderLibrary: vkCreateShaderModule failed for " + path);
+
+    if (watcher.joinable()) {
+        Watch w;
+        w.name = name;
+        w.path = config.sourceDir.empty() ? path : config.sourceDir + name;
+        std::error_code ec;
+        w.time = std::filesystem::last_write_time(w.path, ec);
+        std::lock_guard<std::mutex> lock(mutex);
+        watches.push_back(std::move(w));
+    }
+    return *shaders.emplace(name, std::move(s)).first->second;
+}
+
+VkShaderModule ShaderLibrary::find(uint64_t codeHash) const {
+    for (const auto& [name, s] : shaders)
+        if (s->codeHash == codeHash) return s->module;
+    return VK_NULL_HANDLE;
+}
+
+ShaderLibrary::Layout ShaderLibrary::mergeLayout(const Shader* const* list, uint32_t count) {
+    Layout out;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Reflection& r = list[i]->reflection;
+        for (const Binding& b : r.bindings) {
+            auto it = std::find_if(out.bindings.begin(), out.bindings.end(),
+                [&](const Binding& o) { return o.set == b.set && o.binding == b.binding; });
+            if (it == out.bindings.end()) {
+                out.bindings.push_back(b);
+                continue;
+            }
+            if (it->type != b.type || it->count != b.count)
+                throw std::runtime_error("ShaderLibrary: set " + std::to_string(b.set) + " binding " +
+                    std::to_string(b.binding) + " declared differently in " + list[i]->name);
+            it->stages |= b.stages;
+        }
+        if (r.pushConstantBytes) {
+            out.pushConstants.stageFlags |= r.stage;
+            out.pushConstants.size = std::max(out.pushConstants.size, r.pushConstantBytes);
+        }
+    }
+    std::sort(out.bindings.begin(), out.bindings.end(), [](const Binding& a, const Binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const Binding& b : out.bindings) {
+        const uint32_t fields[] = { b.set, b.binding, static_cast<uint32_t>(b.type), b.count, b.stages };
+        h = PipelineBuilder::hashBytes(fields, sizeof(fields), h);
+    }
+    const uint32_t push[] = { out.pushConstants.stageFlags, out.pushConstants.size };
+    out.hash = PipelineBuilder::hashBytes(push, sizeof(push), h);
+    return out;
+}
+
+VkDescriptorSetLayout ShaderLibrary::createSetLayout(const Layout& layout, uint32_t set, bool dynamicUniforms) const {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (const Binding& b : layout.bindings) {
+        if (b.set != set) continue;
+        if (b.count == 0)
+            throw std::runtime_error("ShaderLibrary: runtime array in set " + std::to_string(set) + " needs a bindless layout");
+        VkDescriptorSetLayoutBinding lb{};
+        lb.binding = b.binding;
+        lb.descriptorType = dynamicUniforms && b.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+            ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : b.type;
+        lb.descriptorCount = b.count;
+        lb.stageFlags = b.stages;
+        bindings.push_back(lb);
+    }
+
+    VkDescriptorSetLayoutCreateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    info.bindingCount = static_cast<uint32_t>(bindings.size());
+    info.pBindings = bindings.empty() ? nullptr : bindings.data();
+    VkDescriptorSetLayout out = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(device, &info, nullptr, &out) != VK_SUCCESS)
+        throw std::runtime_error("ShaderLibrary: failed to create descriptor set layout");
+    return out;
+}
+
+const std::vector<std::string>& ShaderLibrary::poll() {
+    changed.clear();
+    std::vector<Reloaded> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(reloaded);
+    }
+
+    for (Reloaded& r : batch) {
+        Shader& s = *shaders.at(r.name);
+        Reflection refl;
+        if (!reflect(r.code.data(), r.code.size(), refl)) {
+            rejected.push_back({ r.name, "malformed SPIR-V" });
+            continue;
+        }
+        if (refl.stage != s.reflection.stage || !sameBindings(refl.bindings, s.reflection.bindings) ||
+            refl.pushConstantBytes != s.reflection.pushConstantBytes) {
+            rejected.push_back({ r.name, "resources changed, restart to apply" });
+            continue;
+        }
+        const VkShaderModule module = createModule(r.code);
+        if (!module) {
+            rejected.push_back({ r.name, "vkCreateShaderModule failed" });
+            continue;
+        }
+
+        retired.push_back(s.module);
+        s.module = module;
+        s.code.swap(r.code);
+        s.codeHash = PipelineBuilder::hashBytes(s.code.data(), s.code.size() * sizeof(uint32_t));
+        s.reflection = std::move(refl);
+        ++s.generation;
+        changed.push_back(s.name);
+    }
+    return changed;
+}
+
+void ShaderLibrary::takeRejected(std::vector<Rejected>& out) {
+    out.insert(out.end(), std::make_move_iterator(rejected.begin()), std::make_move_iterator(rejected.end()));
+    rejected.clear();
+}
+
+void ShaderLibrary::releaseRetired() {
+    for (VkShaderModule m : retired) vkDestroyShaderModule(device, m, nullptr);
+    retired.clear();
+}
+
+// Polls file times; a change is read (after compiling, for sources) and queued for poll().
+// Files are only touched outside the lock.
+void ShaderLibrary::watchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!quit) {
+        wake.wait_for(lock, std::chrono::milliseconds(config.pollMilliseconds), [this] { return quit; });
+        if (quit) break;
+        std::vector<Watch> snapshot = watches;
+        lock.unlock();
+
+        std::vector<Watch>    seen;
+        std::vector<Reloaded> loaded;
+        for (const Watch& w : snapshot) {
+            std::error_code ec;
+            const auto time = std::filesystem::last_write_time(w.path, ec);
+            if (ec || time == w.time) continue;
+            seen.push_back({ w.name, w.path, time });
+
+            // A failed compile leaves the old module; the compiler has printed why
+            if (!config.sourceDir.empty() && !compileSource(w)) continue;
+            Reloaded r;
+            r.name = w.name;
+            if (readSpirv(spirvPath(w.name), r.code)) loaded.push_back(std::move(r));
+        }
+
+        lock.lock();
+        for (const Watch& s : seen) {
+            for (Watch& w : watches)
+                if (w.name == s.name) w.time = s.time;
+        }
+        for (Reloaded& r : loaded) reloaded.push_back(std::move(r));
+    }
+}
+
+bool ShaderLibrary::compileSource(const Watch& w) const {
+    if (config.compiler.empty()) return true;   // someone else rebuilds the .spv
+    std::string cmd = "\"" + config.compiler + "\" \"" + w.path + "\" -o \"" + spirvPath(w.name) + "\"";
+#ifdef _WIN32
+    cmd = "\"" + cmd + "\"";   // cmd.exe strips one level of quotes
+#endif
+    return std::system(cmd.c_str()) == 0;
+}
+
+VkShaderModule ShaderLibrary::createModule(const std::vector<uint32_t>& code) const {
+    VkShaderModuleCreateInfo info{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    info.codeSize = code.size() * sizeof(uint32_t);
+    info.pCode = code.data();
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(device, &info, nullptr, &module) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return module;
+}
+
+// One pass collects types, decorations and variables by id; resources are resolved after.
+// Only what pipeline layouts need: descriptor variables, the push constant block's size and
+// specialization constant ids. Offsets, strides and array lengths come from decorations and
+// OpConstant, as glslang and DXC emit them.
+bool ShaderLibrary::reflect(const uint32_t* code, size_t words, Reflection& out) {
+    if (words < spv::kHeaderWords || code[0] != spv::kMagic) return false;
+    const uint32_t bound = code[3];
+    if (bound == 0 || bound > (1u << 22)) return false;
+
+    struct Id {
+        uint32_t op = 0;
+        std::vector<uint32_t> operands;   // after the result id
+        uint32_t set = ~0u, binding = ~0u, arrayStride = 0;
+        bool     block = false, bufferBlock = false;
+        uint32_t constant = 0;
+        std::vector<uint32_t> memberOffsets, memberMatrixStrides;
+    };
+    std::vector<Id> ids(bound);
+    std::vector<uint32_t> variables;
+    out = {};
+
+    auto valid = [&](uint32_t id) { return id != 0 && id < bound; };
+    size_t i = spv::kHeaderWords;
+    while (i < words) {
+        const uint32_t count = code[i] >> 16;
+        const uint32_t op = code[i] & 0xFFFF;
+        if (count == 0 || i + count > words) return false;
+        const uint32_t* w = code + i;
+
+        switch (op) {
+        case spv::OpEntryPoint:
+            if (count >= 2 && out.stage == VK_SHADER_STAGE_ALL) out.stage = stageOf(w[1]);
+            break;
+        case spv::OpDecorate:
+            if (count >= 3 && valid(w[1])) {
+                Id& t = ids[w[1]];
+                const uint32_t value = count >= 4 ? w[3] : 0;
+                switch (w[2]) {
+                case spv::SpecId:        out.specConstants.push_back(value); break;
+                case spv::Block:         t.block = true; break;
+                case spv::BufferBlock:   t.bufferBlock = true; break;
+                case spv::ArrayStride:   t.arrayStride = value; break;
+                case spv::Binding:       t.binding = value; break;
+                case spv::DescriptorSet: t.set = value; break;
+                default: break;
+                }
+            }
+            break;
+        case spv::OpMemberDecorate:
+            if (count >= 5 && valid(w[1]) && w[2] < 4096) {
+                Id& t = ids[w[1]];
+                const uint32_t member = w[2];
+                if (w[3] == spv::Offset) {
+                    if (t.memberOffsets.size() <= member) t.memberOffsets.resize(member + 1, 0);
+                    t.memberOffsets[member] = w[4];
+                }
+                else if (w[3] == spv::MatrixStride) {
+                    if (t.memberMatrixStrides.size() <= member) t.memberMatrixStrides.resize(member + 1, 0);
+                    t.memberMatrixStrides[member] = w[4];
+                }
+            }
+            break;
+        case spv::OpTypeBool: case spv::OpTypeInt: case spv::OpTypeFloat: case spv::OpTypeVector:
+        case spv::OpTypeMatrix: case spv::OpTypeImage: case spv::OpTypeSampler: case spv::OpTypeSampledImage:
+        case spv::OpTypeArray: case spv::OpTypeRuntimeArray: case spv::OpTypeStruct: case spv::OpTypePointer:
+        case spv::OpTypeAccelerationStructureKHR:
+            if (count >= 2 && valid(w[1])) {
+                ids[w[1]].op = op;
+                ids[w[1]].operands.assign(w + 2, w + count);
+            }
+            break;
+        case spv::OpConstant:
+            if (count >= 4 && valid(w[2])) {
+                ids[w[2]].op = op;
+                ids[w[2]].constant = w[3];   // low word: enough for array lengths
+            }
+            break;
+        case spv::OpVariable:
+            if (count >= 4 && valid(w[2])) {
+                ids[w[2]].op = op;
+                ids[w[2]].operands = { w[1], w[3] };   // pointer type, storage class
+                variables.push_back(w[2]);
+            }
+            break;
+        default:
+            break;
+        }
+        i += count;
+    }
+
+    // Byte size of a type inside a block; matrixStride applies to a matrix member
+    auto sizeOf = [&](auto& self, uint32_t type, uint32_t matrixStride, int depth) -> uint32_t {
+        if (!valid(type) || depth > 16) return 0;
+        const Id& t = ids[type];
+        switch (t.op) {
+        case spv::OpTypeBool:  return 4;
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat: return t.operands.empty() ? 0 : t.operands[0] / 8;
+        case spv::OpTypeVector:
+            return t.operands.size() < 2 ? 0 : t.operands[1] * self(self, t.operands[0], 0, depth + 1);
+        case spv::OpTypeMatrix:
+            if (t.operands.size() < 2) return 0;
+            return t.operands[1] * (matrixStride ? matrixStride : self(self, t.operands[0], 0, depth + 1));
+        case spv::OpTypeArray: {
+            if (t.operands.size() < 2 || !valid(t.operands[1])) return 0;
+            const uint32_t length = ids[t.operands[1]].constant;
+            const uint32_t stride = t.arrayStride ? t.arrayStride : self(self, t.operands[0], matrixStride, depth + 1);
+            return length * stride;
+        }
+        case spv::OpTypeStruct: {
+            uint32_t size = 0;
+            for (size_t m = 0; m < t.operands.size(); ++m) {
+                const uint32_t offset = m < t.memberOffsets.size() ? t.memberOffsets[m] : 0;
+                const uint32_t stride = m < t.memberMatrixStrides.size() ? t.memberMatrixStrides[m] : 0;
+                size = std::max(size, offset + self(self, t.operands[m], stride, depth + 1));
+            }
+            return size;
+        }
+        default: return 0;   // runtime arrays add nothing
+        }
+    };
+
+    for (uint32_t var : variables) {
+        const Id& v = ids[var];
+        const uint32_t storage = v.operands[1];
+        const uint32_t pointer = v.operands[0];
+        if (!valid(pointer) || ids[pointer].op != spv::OpTypePointer || ids[pointer].operands.size() < 2) continue;
+        uint32_t type = ids[pointer].operands[1];
+
+        if (storage == spv::PushConstant) {
+            out.pushConstantBytes = std::max(out.pushConstantBytes, sizeOf(sizeOf, type, 0, 0));
+            continue;
+        }
+        if (storage != spv::UniformConstant && storage != spv::Uniform && storage != spv::StorageBuffer) continue;
+        if (v.set == ~0u || v.binding == ~0u) continue;
+
+        Binding b;
+        b.set = v.set;
+        b.binding = v.binding;
+        b.stages = out.stage;
+        // Arrays of resources: fixed length, or 0 for runtime arrays
+        if (valid(type) && ids[type].op == spv::OpTypeArray && ids[type].operands.size() >= 2) {
+            b.count = valid(ids[type].operands[1]) ? ids[ids[type].operands[1]].constant : 1;
+            type = ids[type].operands[0];
+        }
+        else if (valid(type) && ids[type].op == spv::OpTypeRuntimeArray && !ids[type].operands.empty()) {
+            b.count = 0;
+            type = ids[type].operands[0];
+        }
+        if (!valid(type)) continue;
+        const Id& t = ids[type];
+
+        switch (t.op) {
+        case spv::OpTypeSampler:      b.type = VK_DESCRIPTOR_TYPE_SAMPLER; break;
+        case spv::OpTypeSampledImage: b.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; break;
+        case spv::OpTypeAccelerationStructureKHR: b.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR; break;
+        case spv::OpTypeImage: {
+            // sampledType, dim, depth, arrayed, ms, sampled (1 = with a sampler, 2 = storage), format
+            if (t.operands.size() < 6) continue;
+            const uint32_t dim = t.operands[1], sampled = t.operands[5];
+            if (dim == spv::kDimSubpassData) b.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            else if (dim == spv::kDimBuffer)
+                b.type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            else b.type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            break;
+        }
+        case spv::OpTypeStruct:
+            // Uniform + BufferBlock is how pre-1.3 SPIR-V spells a storage buffer
+            if (storage == spv::StorageBuffer || t.bufferBlock) b.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            else if (storage == spv::Uniform && t.block) b.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            else continue;
+            break;
+        default:
+            continue;
+        }
+        out.bindings.push_back(b);
+    }
+
+    std::sort(out.bindings.begin(), out.bindings.end(), [](const Binding& a, const Binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    return out.stage != VK_SHADER_STAGE_ALL;
+}
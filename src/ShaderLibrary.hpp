@@ -0,0 +1,144 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// SPIR-V modules by name ("mesh.vert" -> <spirvDir>/mesh.vert.spv), each loaded and created
+// once and kept for the library's lifetime, so pipelines can be (re)built from them at any
+// time without reading files again.
+//
+// Every module is reflected on load: its stage, descriptor bindings, push constant block size
+// and specialization constant ids. mergeLayout() combines the shaders of one pipeline (or of
+// pipelines sharing a layout) into a Layout, and createSetLayout() builds descriptor set
+// layouts from it. Permutations are meant to be specialization constants of one module
+// (PipelineBuilder::SpecConstants) rather than separate files.
+//
+// With Config::watch a background thread polls the files of every loaded shader. Given a
+// source directory and a compiler it watches the GLSL and recompiles it into spirvDir,
+// otherwise it watches the .spv files themselves (e.g. rebuilt by the Shaders target). poll()
+// swaps reloaded code in under the same name with a new module, codeHash and generation and
+// returns the names that changed; callers rebuild the pipelines using them. A reload whose
+// resource interface differs from the loaded one is refused, since layouts built from the old
+// reflection stay in use; refused and failed reloads are queued for takeRejected(). Replaced
+// modules are kept until releaseRetired().
+//
+// Main thread only, apart from the watcher.
+class ShaderLibrary {
+public:
+    struct Config {
+        std::string spirvDir = "shaders/";
+        bool        watch = false;           // hot reload
+        std::string sourceDir;               // watch GLSL here and recompile; empty = watch the .spv
+        std::string compiler;                // glslc, run as: compiler <source> -o <spirv>
+        uint32_t    pollMilliseconds = 250;
+    };
+
+    struct Binding {
+        uint32_t           set = 0;
+        uint32_t           binding = 0;
+        VkDescriptorType   type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        uint32_t           count = 1;        // 0 = runtime array (bindless)
+        VkShaderStageFlags stages = 0;
+    };
+    struct Reflection {
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+        std::vector<Binding>  bindings;            // sorted by (set, binding)
+        uint32_t              pushConstantBytes = 0;
+        std::vector<uint32_t> specConstants;       // constant_ids
+
+        bool hasSpecConstant(uint32_t id) const;
+    };
+    struct Shader {
+        std::string           name;
+        std::vector<uint32_t> code;
+        uint64_t              codeHash = 0;   // PipelineBuilder::hashBytes(code)
+        VkShaderModule        module = VK_NULL_HANDLE;
+        Reflection            reflection;
+        uint32_t              generation = 0; // reloads so far
+    };
+    // A reload poll() did not apply; the loaded version stays in use
+    struct Rejected {
+        std::string name;
+        const char* reason;   // static string
+    };
+    // Union of several shaders' resources; push constants start at offset 0 in every stage
+    struct Layout {
+        std::vector<Binding> bindings;        // sorted by (set, binding)
+        VkPushConstantRange  pushConstants{}; // size 0 = none
+        uint64_t             hash = 0;        // of the above; a stable PipelineBuilder layout key
+
+        uint32_t setCount() const { return bindings.empty() ? 0 : bindings.back().set + 1; }
+    };
+
+    ShaderLibrary() = default;
+    ~ShaderLibrary() { destroy(); }
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    void init(VkDevice dev, const Config& cfg);
+    // Stops the watcher and destroys every module; nothing may still be compiling from them
+    void destroy();
+
+    // Loads on first use. Throws std::runtime_error("ShaderLibrary: ...") on a missing or
+    // malformed file. The reference stays valid until destroy(); reloads update it in place.
+    const Shader& get(const std::string& name);
+    // Module of a loaded shader by codeHash (pipeline manifests), VK_NULL_HANDLE if none
+    VkShaderModule find(uint64_t codeHash) const;
+
+    // Throws when two shaders declare the same set/binding differently
+    static Layout mergeLayout(const Shader* const* shaders, uint32_t count);
+    // Set `set` of layout; dynamicUniforms makes uniform buffers UNIFORM_BUFFER_DYNAMIC. The
+    // caller owns the result. Runtime arrays need a bindless layout and throw here.
+    VkDescriptorSetLayout createSetLayout(const Layout& layout, uint32_t set, bool dynamicUniforms) const;
+
+    bool watching() const { return watcher.joinable(); }
+    // Swaps in what the watcher reloaded since the last call; returns the names (valid until
+    // the next call)
+    const std::vector<std::string>& poll();
+    // Appends the reloads poll() refused since the last call
+    void takeRejected(std::vector<Rejected>& out);
+    // Destroys replaced modules; call once no pipeline compile can still be using them
+    void releaseRetired();
+
+    // SPIR-V -> Reflection; false if code isn't a well-formed module
+    static bool reflect(const uint32_t* code, size_t words, Reflection& out);
+
+private:
+    struct Watch {
+        std::string                     name;
+        std::string                     path;   // source or .spv
+        std::filesystem::file_time_type time;
+    };
+    struct Reloaded {
+        std::string           name;
+        std::vector<uint32_t> code;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    Config   config;
+    std::unordered_map<std::string, std::unique_ptr<Shader>> shaders;
+    std::vector<VkShaderModule> retired;
+    std::vector<std::string>    changed;
+    std::vector<Rejected>       rejected;
+
+    // Watcher
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::vector<Watch>      watches;    // guarded by mutex
+    std::vector<Reloaded>   reloaded;   // guarded by mutex
+    bool                    quit = false;
+    std::thread             watcher;
+
+    void watchLoop();
+    std::string spirvPath(const std::string& name) const { return config.spirvDir + name + ".spv"; }
+    bool compileSource(const Watch& w) const;
+    VkShaderModule createModule(const std::vector<uint32_t>& code) const;
+};
@@ -0,0 +1,191 @@
+#include "ShaderObjectPipeline.hpp"
+#include "DeletionQueue.hpp"
+
+#include <stdexcept>
+
+// VK_EXT_shader_object entry points; the core 1.3 dynamic state ones are linked directly
+static PFN_vkCreateShadersEXT               pCreateShaders = nullptr;
+static PFN_vkDestroyShaderEXT               pDestroyShader = nullptr;
+static PFN_vkCmdBindShadersEXT              pBindShaders = nullptr;
+static PFN_vkCmdSetVertexInputEXT           pSetVertexInput = nullptr;
+static PFN_vkCmdSetPolygonModeEXT           pSetPolygonMode = nullptr;
+static PFN_vkCmdSetRasterizationSamplesEXT  pSetRasterizationSamples = nullptr;
+static PFN_vkCmdSetSampleMaskEXT            pSetSampleMask = nullptr;
+static PFN_vkCmdSetAlphaToCoverageEnableEXT pSetAlphaToCoverage = nullptr;
+static PFN_vkCmdSetColorBlendEnableEXT      pSetColorBlendEnable = nullptr;
+static PFN_vkCmdSetColorBlendEquationEXT    pSetColorBlendEquation = nullptr;
+static PFN_vkCmdSetColorWriteMaskEXT        pSetColorWriteMask = nullptr;
+static VkDevice                             loadedDevice = VK_NULL_HANDLE;
+
+bool ShaderObjectPipeline::loadFunctions(VkDevice device) {
+    // Device-level pointers: another device (a second Renderer) can't use them
+    if (loadedDevice && loadedDevice != device) return false;
+    loadedDevice = device;
+    pCreateShaders = (PFN_vkCreateShadersEXT)vkGetDeviceProcAddr(device, "vkCreateShadersEXT");
+    pDestroyShader = (PFN_vkDestroyShaderEXT)vkGetDeviceProcAddr(device, "vkDestroyShaderEXT");
+    pBindShaders = (PFN_vkCmdBindShadersEXT)vkGetDeviceProcAddr(device, "vkCmdBindShadersEXT");
+    pSetVertexInput = (PFN_vkCmdSetVertexInputEXT)vkGetDeviceProcAddr(device, "vkCmdSetVertexInputEXT");
+    pSetPolygonMode = (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetPolygonModeEXT");
+    pSetRasterizationSamples = (PFN_vkCmdSetRasterizationSamplesEXT)vkGetDeviceProcAddr(device, "vkCmdSetRasterizationSamplesEXT");
+    pSetSampleMask = (PFN_vkCmdSetSampleMaskEXT)vkGetDeviceProcAddr(device, "vkCmdSetSampleMaskEXT");
+    pSetAlphaToCoverage = (PFN_vkCmdSetAlphaToCoverageEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetAlphaToCoverageEnableEXT");
+    pSetColorBlendEnable = (PFN_vkCmdSetColorBlendEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT");
+    pSetColorBlendEquation = (PFN_vkCmdSetColorBlendEquationEXT)vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEquationEXT");
+    pSetColorWriteMask = (PFN_vkCmdSetColorWriteMaskEXT)vkGetDeviceProcAddr(device, "vkCmdSetColorWriteMaskEXT");
+
+    return pCreateShaders && pDestroyShader && pBindShaders && pSetVertexInput && pSetPolygonMode &&
+        pSetRasterizationSamples && pSetSampleMask && pSetAlphaToCoverage &&
+        pSetColorBlendEnable && pSetColorBlendEquation && pSetColorWriteMask;
+}
+
+void ShaderObjectPipeline::unloadFunctions(VkDevice device) {
+    if (loadedDevice == device) loadedDevice = VK_NULL_HANDLE;
+}
+
+void ShaderObjectPipeline::create(VkDevice dev, const PipelineBuilder& state_, const Stage* stages, uint32_t stageCount,
+    const VkDescriptorSetLayout* setLayouts, uint32_t setLayoutCount,
+    const VkPushConstantRange* pushConstants, uint32_t pushConstantCount) {
+    destroy();
+    if (!pCreateShaders) throw std::runtime_error("ShaderObjectPipeline: functions not loaded (loadFunctions())");
+    if (stageCount == 0) throw std::runtime_error("ShaderObjectPipeline: no shader stages");
+
+    device = dev;
+    state = state_;
+
+    // One linked set: each stage names the next so the driver can optimize across them
+    std::vector<VkShaderCreateInfoEXT> infos(stageCount);
+    for (uint32_t i = 0; i < stageCount; ++i) {
+        VkShaderCreateInfoEXT& info = infos[i];
+        info = { VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT };
+        info.flags = stageCount > 1 ? VK_SHADER_CREATE_LINK_STAGE_BIT_EXT : 0;
+        info.stage = stages[i].stage;
+        info.nextStage = stages[i].stage == VK_SHADER_STAGE_VERTEX_BIT ? VK_SHADER_STAGE_FRAGMENT_BIT : 0;
+        info.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+        info.codeSize = stages[i].codeSize;
+        info.pCode = stages[i].code;
+        info.pName = stages[i].entry;
+        info.pSpecializationInfo = stages[i].specialization;
+        info.setLayoutCount = setLayoutCount;
+        info.pSetLayouts = setLayouts;
+        info.pushConstantRangeCount = pushConstantCount;
+        info.pPushConstantRanges = pushConstants;
+        stageFlags.push_back(stages[i].stage);
+    }
+    shaders.assign(stageCount, VK_NULL_HANDLE);
+    if (pCreateShaders(device, stageCount, infos.data(), nullptr, shaders.data()) != VK_SUCCESS) {
+        for (VkShaderEXT s : shaders) if (s) pDestroyShader(device, s, nullptr);
+        shaders.clear();
+        stageFlags.clear();
+        throw std::runtime_error("ShaderObjectPipeline: vkCreateShadersEXT failed");
+    }
+
+    for (const auto& b : state.vertexBindings) {
+        VkVertexInputBindingDescription2EXT d{ VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT };
+        d.binding = b.binding;
+        d.stride = b.stride;
+        d.inputRate = b.inputRate;
+        d.divisor = 1;
+        bindings.push_back(d);
+    }
+    for (const auto& a : state.vertexAttributes) {
+        VkVertexInputAttributeDescription2EXT d{ VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT };
+        d.location = a.location;
+        d.binding = a.binding;
+        d.format = a.format;
+        d.offset = a.offset;
+        attributes.push_back(d);
+    }
+    for (const auto& a : state.colorAttachments) {
+        blendEnables.push_back(a.blendEnable);
+        writeMasks.push_back(a.colorWriteMask);
+        VkColorBlendEquationEXT eq{};
+        eq.srcColorBlendFactor = a.srcColorBlendFactor;
+        eq.dstColorBlendFactor = a.dstColorBlendFactor;
+        eq.colorBlendOp = a.colorBlendOp;
+        eq.srcAlphaBlendFactor = a.srcAlphaBlendFactor;
+        eq.dstAlphaBlendFactor = a.dstAlphaBlendFactor;
+        eq.alphaBlendOp = a.alphaBlendOp;
+        blendEquations.push_back(eq);
+    }
+}
+
+void ShaderObjectPipeline::destroy() {
+    if (device) {
+        for (VkShaderEXT s : shaders) if (s) pDestroyShader(device, s, nullptr);
+    }
+    shaders.clear();
+    stageFlags.clear();
+    bindings.clear();
+    attributes.clear();
+    blendEnables.clear();
+    writeMasks.clear();
+    blendEquations.clear();
+    device = VK_NULL_HANDLE;
+}
+
+void ShaderObjectPipeline::retire(DeletionQueue& deletion, uint64_t retireValue) {
+    for (VkShaderEXT s : shaders) deletion.deferShader(retireValue, s);
+    shaders.clear();
+    destroy();
+}
+
+void ShaderObjectPipeline::bind(VkCommandBuffer cmd) const {
+    pBindShaders(cmd, static_cast<uint32_t>(shaders.size()), stageFlags.data(), shaders.data());
+
+    // Vertex input & assembly
+    pSetVertexInput(cmd, static_cast<uint32_t>(bindings.size()), bindings.data(),
+        static_cast<uint32_t>(attributes.size()), attributes.data());
+    vkCmdSetPrimitiveTopology(cmd, state.inputAssembly.topology);
+    vkCmdSetPrimitiveRestartEnable(cmd, state.inputAssembly.primitiveRestartEnable);
+
+    if (!state.isDynamic(VK_DYNAMIC_STATE_VIEWPORT)) vkCmdSetViewportWithCount(cmd, 1, &state.viewport);
+    if (!state.isDynamic(VK_DYNAMIC_STATE_SCISSOR)) vkCmdSetScissorWithCount(cmd, 1, &state.scissor);
+
+    // Rasterization
+    const VkPipelineRasterizationStateCreateInfo& r = state.raster;
+    vkCmdSetRasterizerDiscardEnable(cmd, r.rasterizerDiscardEnable);
+    pSetPolygonMode(cmd, r.polygonMode);
+    vkCmdSetCullMode(cmd, r.cullMode);
+    vkCmdSetFrontFace(cmd, r.frontFace);
+    vkCmdSetDepthBiasEnable(cmd, r.depthBiasEnable);
+    if (r.depthBiasEnable) vkCmdSetDepthBias(cmd, r.depthBiasConstantFactor, r.depthBiasClamp, r.depthBiasSlopeFactor);
+    vkCmdSetLineWidth(cmd, r.lineWidth);
+
+    // Multisample (one mask word covers up to 32 samples)
+    const VkSampleMask sampleMask = ~0u;
+    const VkSampleCountFlagBits samples =
+        state.msaa.rasterizationSamples ? state.msaa.rasterizationSamples : VK_SAMPLE_COUNT_1_BIT;
+    pSetRasterizationSamples(cmd, samples);
+    pSetSampleMask(cmd, samples, &sampleMask);
+    pSetAlphaToCoverage(cmd, state.msaa.alphaToCoverageEnable);
+
+    // Depth / stencil; a builder without depth state means both tests off
+    const VkPipelineDepthStencilStateCreateInfo& d = state.depth;
+    const bool depthOn = state.useDepth;
+    vkCmdSetDepthTestEnable(cmd, depthOn && d.depthTestEnable);
+    vkCmdSetDepthWriteEnable(cmd, depthOn && d.depthWriteEnable);
+    vkCmdSetDepthCompareOp(cmd, d.depthCompareOp);
+    vkCmdSetStencilTestEnable(cmd, depthOn && d.stencilTestEnable);
+    if (depthOn && d.stencilTestEnable) {
+        vkCmdSetStencilOp(cmd, VK_STENCIL_FACE_FRONT_BIT, d.front.failOp, d.front.passOp, d.front.depthFailOp, d.front.compareOp);
+        vkCmdSetStencilOp(cmd, VK_STENCIL_FACE_BACK_BIT, d.back.failOp, d.back.passOp, d.back.depthFailOp, d.back.compareOp);
+        vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FACE_FRONT_BIT, d.front.compareMask);
+        vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FACE_BACK_BIT, d.back.compareMask);
+        vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FACE_FRONT_BIT, d.front.writeMask);
+        vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FACE_BACK_BIT, d.back.writeMask);
+        vkCmdSetStencilReference(cmd, VK_STENCIL_FACE_FRONT_BIT, d.front.reference);
+        vkCmdSetStencilReference(cmd, VK_STENCIL_FACE_BACK_BIT, d.back.reference);
+    }
+    if (depthOn && d.depthBoundsTestEnable) {
+        vkCmdSetDepthBoundsTestEnable(cmd, VK_TRUE);
+        vkCmdSetDepthBounds(cmd, d.minDepthBounds, d.maxDepthBounds);
+    }
+
+    // Color blend
+    if (!blendEnables.empty()) {
+        const uint32_t n = static_cast<uint32_t>(blendEnables.size());
+        pSetColorBlendEnable(cmd, 0, n, blendEnables.data());
+        pSetColorWriteMask(cmd, 0, n, writeMasks.data());
+        pSetColorBlendEquation(cmd, 0, n, blendEquations.data());
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+#include "PipelineBuilder.hpp"
+
+class DeletionQueue;
+
+// No-pipeline path for VK_EXT_shader_object: linked vertex + fragment shader objects and the
+// PipelineBuilder state that would have been baked into a pipeline, replayed as dynamic state
+// by bind(). Creating one costs a shader compile, never a pipeline compile, so there is
+// nothing to cache or prewarm.
+//
+// Viewport and scissor are only set by bind() when the builder has them static; dynamic ones
+// must be set with vkCmdSetViewportWithCount / vkCmdSetScissorWithCount after binding.
+class ShaderObjectPipeline {
+public:
+    struct Stage {
+        VkShaderStageFlagBits stage;
+        const void*           code;       // SPIR-V
+        size_t                codeSize;   // bytes
+        const char*           entry = "main";
+        const VkSpecializationInfo* specialization = nullptr;
+    };
+
+    // Device-level entry points; false if the extension isn't enabled on device. They are
+    // process-wide, so only the first device to load them gets shader objects.
+    static bool loadFunctions(VkDevice device);
+    // Before destroying device, so a later device can load them
+    static void unloadFunctions(VkDevice device);
+
+    ShaderObjectPipeline() = default;
+    ~ShaderObjectPipeline() { destroy(); }
+
+    ShaderObjectPipeline(const ShaderObjectPipeline&) = delete;
+    ShaderObjectPipeline& operator=(const ShaderObjectPipeline&) = delete;
+
+    // state supplies vertex input, fixed-function state and blend; its stages and layout
+    // are ignored in favour of stages and the set layouts / push constants here
+    void create(VkDevice dev, const PipelineBuilder& state, const Stage* stages, uint32_t stageCount,
+        const VkDescriptorSetLayout* setLayouts, uint32_t setLayoutCount,
+        const VkPushConstantRange* pushConstants, uint32_t pushConstantCount);
+    void destroy();
+    // Like destroy(), but the shaders go to deletion until retireValue (hot reload while in use)
+    void retire(DeletionQueue& deletion, uint64_t retireValue);
+
+    // Binds the shaders and sets every piece of state they need
+    void bind(VkCommandBuffer cmd) const;
+
+    bool valid() const { return !shaders.empty(); }
+
+private:
+    VkDevice                           device = VK_NULL_HANDLE;
+    std::vector<VkShaderStageFlagBits> stageFlags;
+    std::vector<VkShaderEXT>           shaders;
+    PipelineBuilder                    state;
+
+    // bind() inputs converted once at create()
+    std::vector<VkVertexInputBindingDescription2EXT>   bindings;
+    std::vector<VkVertexInputAttributeDescription2EXT> attributes;
+    std::vector<VkBool32>                blendEnables;
+    std::vector<VkColorComponentFlags>   writeMasks;
+    std::vector<VkColorBlendEquationEXT> blendEquations;
+};
@@ -0,0 +1,470 @@
+#include "StagingUploader.hpp"
+#include "MemoryBudget.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+static VkDeviceSize alignUp(VkDeviceSize v, VkDeviceSize a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+void StagingUploader::init(VmaAllocator alloc, VkDevice dev,
+    VkQueue transferQueue, uint32_t transferFamily_, uint32_t graphicsFamily_,
+    VkDeviceSize budgetBytes, MemoryBudget* memoryBudget) {
+    allocator = alloc;
+    memory = memoryBudget;
+    device = dev;
+    queue = transferQueue;
+    transferFamily = transferFamily_;
+    graphicsFamily = graphicsFamily_;
+
+    VkCommandPoolCreateInfo pi{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    pi.queueFamilyIndex = transferFamily;
+    pi.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(device, &pi, nullptr, &cmdPool) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to create command pool");
+    }
+
+    // One command buffer per partition, allocated up front
+    std::array<VkCommandBuffer, kMaxBatches> cmds{};
+    VkCommandBufferAllocateInfo ai{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    ai.commandPool = cmdPool;
+    ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    ai.commandBufferCount = kMaxBatches;
+    if (vkAllocateCommandBuffers(device, &ai, cmds.data()) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to allocate command buffers");
+    }
+    for (uint32_t i = 0; i < kMaxBatches; ++i) batches[i].cmd = cmds[i];
+
+    VkSemaphoreTypeCreateInfo type{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+    type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type.initialValue = 0;
+    VkSemaphoreCreateInfo si{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    si.pNext = &type;
+    if (vkCreateSemaphore(device, &si, nullptr, &timelineSem) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to create timeline semaphore");
+    }
+
+    // Fixed-budget staging ring; never reallocated
+    capacity = std::max<VkDeviceSize>(alignUp(budgetBytes, kCopyAlignment), 1ull << 20); // min 1 MB
+
+    VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bi.size = capacity;
+    bi.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_AUTO;
+    aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    VmaAllocationInfo out{};
+    if (vmaCreateBuffer(allocator, &bi, &aci, &stagingBuffer, &stagingAlloc, &out) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to create staging buffer");
+    }
+    if (memory) memory->track(stagingAlloc, MemoryBudget::Category::Staging);
+    mapped = static_cast<unsigned char*>(out.pMappedData);
+
+    // Bookkeeping storage is reserved once; clear() keeps the capacity afterwards
+    releases.reserve(256);
+    acquires.reserve(256);
+    barrierScratch.reserve(256);
+    imageReleases.reserve(64);
+    imageAcquires.reserve(64);
+    imageBarrierScratch.reserve(64);
+}
+
+void StagingUploader::destroy() {
+    if (!device) return;
+
+    // Everything we submitted must be done before freeing the ring.
+    wait(Ticket{ lastSubmitted });
+
+    if (stagingBuffer) {
+        if (memory) memory->untrack(stagingAlloc);
+        vmaDestroyBuffer(allocator, stagingBuffer, stagingAlloc);
+        stagingBuffer = VK_NULL_HANDLE;
+        stagingAlloc = VK_NULL_HANDLE;
+        mapped = nullptr;
+        capacity = 0;
+    }
+    if (cmdPool) {
+        vkDestroyCommandPool(device, cmdPool, nullptr); // frees batch command buffers
+        cmdPool = VK_NULL_HANDLE;
+    }
+    if (timelineSem) {
+        vkDestroySemaphore(device, timelineSem, nullptr);
+        timelineSem = VK_NULL_HANDLE;
+    }
+    batches = {};
+    firstBatch = batchCount = 0;
+    open = false;
+    releases.clear();
+    acquires.clear();
+    imageReleases.clear();
+    imageAcquires.clear();
+    head = tail = ringUsed = 0;
+    lastSubmitted = openValue = acquiredValue = 0;
+
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+    device = VK_NULL_HANDLE;
+    queue = VK_NULL_HANDLE;
+}
+
+uint64_t StagingUploader::completedValue() const {
+    uint64_t v = 0;
+    vkGetSemaphoreCounterValue(device, timelineSem, &v);
+    return v;
+}
+
+bool StagingUploader::isComplete(Ticket t) const {
+    return t.value == 0 || completedValue() >= t.value;
+}
+
+void StagingUploader::wait(Ticket t) const {
+    if (t.value == 0 || !timelineSem) return;
+    VkSemaphoreWaitInfo wi{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+    wi.semaphoreCount = 1;
+    wi.pSemaphores = &timelineSem;
+    wi.pValues = &t.value;
+    vkWaitSemaphores(device, &wi, UINT64_MAX);
+}
+
+// ---------------- Staging ring ----------------
+void StagingUploader::reclaim() {
+    const uint64_t done = completedValue();
+    while (batchCount > 0) {
+        if (open && batchCount == 1) break; // the open batch is always the newest
+        const Batch& b = batches[firstBatch];
+        if (b.value > done) break;
+
+        tail = (tail + b.bytes) % capacity;
+        ringUsed -= b.bytes;
+        firstBatch = (firstBatch + 1) % kMaxBatches;
+        --batchCount;
+    }
+    if (ringUsed == 0) head = tail = 0;
+}
+
+bool StagingUploader::tryAllocate(VkDeviceSize sizeBytes, VkDeviceSize alignment, VkDeviceSize& outOffset) {
+    if (ringUsed == 0) head = tail = 0;      // empty ring: restart at the front
+    else if (head == tail) return false;     // completely full
+
+    VkDeviceSize start = alignUp(head, alignment);
+    if (head >= tail) {
+        // Free space is [head, capacity) and, after wrapping, [0, tail)
+        if (start + sizeBytes > capacity) {
+            if (sizeBytes > tail) return false;
+            start = 0; // wrap; [head, capacity) is wasted until this partition retires
+        }
+    }
+    else if (start + sizeBytes > tail) {
+        return false;
+    }
+
+    // Padding and wrap waste are charged to the open partition so reclaim() can advance tail exactly.
+    const VkDeviceSize consumed = (start >= head) ? (start + sizeBytes - head)
+                                                  : (capacity - head) + sizeBytes;
+    head = start + sizeBytes;
+    ringUsed += consumed;
+    batches[(firstBatch + batchCount - 1) % kMaxBatches].bytes += consumed;
+    outOffset = start;
+    return true;
+}
+
+StagingUploader::Allocation StagingUploader::allocate(VkDeviceSize sizeBytes, VkDeviceSize alignment) {
+    if (sizeBytes > maxChunkSize()) {
+        throw std::runtime_error("StagingUploader: allocation exceeds max chunk size");
+    }
+
+    beginBatch();
+    VkDeviceSize offset = 0;
+    for (;;) {
+        reclaim();
+        if (tryAllocate(sizeBytes, alignment, offset)) break;
+
+        // Out of ring space. If only the open batch holds bytes, submit it so there is
+        // something to wait for, then block on the oldest partition.
+        if (open && batchCount == 1) {
+            flush();
+            beginBatch();
+        }
+        wait(Ticket{ batches[firstBatch].value });
+    }
+
+    Allocation a{};
+    a.offset = offset;
+    a.size = sizeBytes;
+    a.ptr = mapped + offset;
+    a.value = openValue;
+    return a;
+}
+
+// ---------------- Batches ----------------
+StagingUploader::Batch& StagingUploader::beginBatch() {
+    if (open) return batches[(firstBatch + batchCount - 1) % kMaxBatches];
+
+    // Every command buffer is in flight: wait for the oldest partition to retire.
+    if (batchCount == kMaxBatches) {
+        wait(Ticket{ batches[firstBatch].value });
+        reclaim();
+    }
+
+    Batch& b = batches[(firstBatch + batchCount) % kMaxBatches];
+    ++batchCount;
+    b.bytes = 0;
+    b.value = openValue = lastSubmitted + 1;
+    open = true;
+
+    vkResetCommandBuffer(b.cmd, 0);
+    VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(b.cmd, &bi) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to begin command buffer");
+    }
+    return b;
+}
+
+StagingUploader::Ticket StagingUploader::recordCopy(const Allocation& src, VkBuffer dst, VkDeviceSize dstOffset,
+    const BufferUse& use) {
+    if (!open || src.value != openValue) {
+        throw std::runtime_error("StagingUploader: allocation recorded outside its batch");
+    }
+
+    // Flush the written range (no-op on coherent memory)
+    vmaFlushAllocation(allocator, stagingAlloc, src.offset, src.size);
+
+    VkCommandBuffer cmd = batches[(firstBatch + batchCount - 1) % kMaxBatches].cmd;
+    VkBufferCopy region{ src.offset, dstOffset, src.size };
+    vkCmdCopyBuffer(cmd, stagingBuffer, dst, 1, &region);
+
+    if (transfersOwnership()) {
+        // Consecutive chunks of one destination collapse into a single release
+        if (!releases.empty()) {
+            auto& last = releases.back();
+            if (last.buffer == dst && last.offset + last.size == dstOffset &&
+                last.use.stage == use.stage && last.use.access == use.access) {
+                last.size += src.size;
+                return Ticket{ openValue };
+            }
+        }
+        releases.push_back({ dst, dstOffset, src.size, use, openValue });
+    }
+    return Ticket{ openValue };
+}
+
+StagingUploader::Ticket StagingUploader::enqueue(const void* src, VkDeviceSize sizeBytes,
+    VkBuffer dst, VkDeviceSize dstOffset, const BufferUse& use) {
+    if (sizeBytes == 0) return Ticket{};
+
+    // Oversized uploads are split instead of growing the ring. Chunks may land in different
+    // batches; the last chunk's ticket covers all earlier ones.
+    const auto* bytes = static_cast<const unsigned char*>(src);
+    Ticket t{};
+    VkDeviceSize done = 0;
+    while (done < sizeBytes) {
+        const VkDeviceSize chunk = std::min(sizeBytes - done, maxChunkSize());
+        Allocation a = allocate(chunk);
+        std::memcpy(a.ptr, bytes + done, static_cast<size_t>(chunk));
+        t = recordCopy(a, dst, dstOffset + done, use);
+        done += chunk;
+    }
+    return t;
+}
+
+VkImageMemoryBarrier2 StagingUploader::imageBarrier(const PendingImage& p, VkImageLayout oldLayout,
+    VkImageLayout newLayout) const {
+    VkImageMemoryBarrier2 b{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    b.oldLayout = oldLayout;
+    b.newLayout = newLayout;
+    b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.image = p.image;
+    b.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, p.mipLevel, 1, 0, 1 };
+    return b;
+}
+
+StagingUploader::Ticket StagingUploader::enqueueImage(const void* src, const ImageLevel& level, const ImageUse& use) {
+    const uint32_t rows = (level.extent.height + level.blockHeight - 1) / level.blockHeight;
+    if (rows == 0 || level.rowBytes == 0) return Ticket{};
+    if (level.rowBytes > maxChunkSize()) {
+        throw std::runtime_error("StagingUploader: image row exceeds max chunk size");
+    }
+    const uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(rows, maxChunkSize() / level.rowBytes));
+
+    // Bands may land in different batches; the level stays TRANSFER_DST_OPTIMAL in between
+    const auto* bytes = static_cast<const unsigned char*>(src);
+    const PendingImage target{ level.image, level.mipLevel, use, 0 };
+    Ticket t{};
+    for (uint32_t row = 0; row < rows; row += rowsPerChunk) {
+        const uint32_t n = std::min(rowsPerChunk, rows - row);
+        Allocation a = allocate(level.rowBytes * n);
+        std::memcpy(a.ptr, bytes + level.rowBytes * row, static_cast<size_t>(a.size));
+        vmaFlushAllocation(allocator, stagingAlloc, a.offset, a.size);
+
+        VkCommandBuffer cmd = openCommandBuffer();
+        if (row == 0) {
+            VkImageMemoryBarrier2 b = imageBarrier(target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            b.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            b.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+            b.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+            dep.imageMemoryBarrierCount = 1;
+            dep.pImageMemoryBarriers = &b;
+            vkCmdPipelineBarrier2(cmd, &dep);
+        }
+
+        const uint32_t y = row * level.blockHeight;
+        VkBufferImageCopy region{};
+        region.bufferOffset = a.offset;   // tightly packed: row length / image height stay 0
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level.mipLevel, 0, 1 };
+        region.imageOffset = { 0, static_cast<int32_t>(y), 0 };
+        region.imageExtent = { level.extent.width, std::min(n * level.blockHeight, level.extent.height - y), 1 };
+        vkCmdCopyBufferToImage(cmd, stagingBuffer, level.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        t = Ticket{ openValue };
+    }
+
+    imageReleases.push_back({ level.image, level.mipLevel, use, openValue });
+    return t;
+}
+
+StagingUploader::Ticket StagingUploader::flush() {
+    if (!open) return Ticket{ lastSubmitted };
+
+    Batch& b = batches[(firstBatch + batchCount - 1) % kMaxBatches];
+
+    // Release ownership to the graphics family: the matching acquire happens in recordAcquireBarriers().
+    if (!releases.empty()) {
+        barrierScratch.clear();
+        for (const auto& r : releases) {
+            VkBufferMemoryBarrier2 br{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+            br.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+            br.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            br.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+            br.dstAccessMask = 0;
+            br.srcQueueFamilyIndex = transferFamily;
+            br.dstQueueFamilyIndex = graphicsFamily;
+            br.buffer = r.buffer;
+            br.offset = r.offset;
+            br.size = r.size;
+            barrierScratch.push_back(br);
+        }
+        VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+        dep.bufferMemoryBarrierCount = static_cast<uint32_t>(barrierScratch.size());
+        dep.pBufferMemoryBarriers = barrierScratch.data();
+        vkCmdPipelineBarrier2(b.cmd, &dep);
+
+        acquires.insert(acquires.end(), releases.begin(), releases.end());
+        releases.clear();
+    }
+
+    // Finished image levels go to their final layout here. Without an ownership transfer the
+    // barrier's second scope only has to reach the timeline signal (ALL_TRANSFER); the
+    // graphics queue's semaphore wait does the rest.
+    if (!imageReleases.empty()) {
+        imageBarrierScratch.clear();
+        for (const auto& r : imageReleases) {
+            VkImageMemoryBarrier2 br = imageBarrier(r, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, r.use.layout);
+            br.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+            br.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            if (transfersOwnership()) {
+                br.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+                br.srcQueueFamilyIndex = transferFamily;
+                br.dstQueueFamilyIndex = graphicsFamily;
+            }
+            else br.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+            imageBarrierScratch.push_back(br);
+        }
+        VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+        dep.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarrierScratch.size());
+        dep.pImageMemoryBarriers = imageBarrierScratch.data();
+        vkCmdPipelineBarrier2(b.cmd, &dep);
+
+        if (transfersOwnership()) imageAcquires.insert(imageAcquires.end(), imageReleases.begin(), imageReleases.end());
+        imageReleases.clear();
+    }
+
+    if (vkEndCommandBuffer(b.cmd) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: failed to end command buffer");
+    }
+
+    VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+    cmdInfo.commandBuffer = b.cmd;
+
+    VkSemaphoreSubmitInfo signal{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+    signal.semaphore = timelineSem;
+    signal.value = openValue;
+    signal.stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+
+    VkSubmitInfo2 submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+    submit.commandBufferInfoCount = 1;
+    submit.pCommandBufferInfos = &cmdInfo;
+    submit.signalSemaphoreInfoCount = 1;
+    submit.pSignalSemaphoreInfos = &signal;
+
+    if (vkQueueSubmit2(queue, 1, &submit, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("StagingUploader: queue submit failed");
+    }
+
+    lastSubmitted = openValue;
+    open = false;
+    return Ticket{ lastSubmitted };
+}
+
+void StagingUploader::upload(const void* src, VkDeviceSize sizeBytes, VkBuffer dst, VkDeviceSize dstOffset,
+    const BufferUse& use) {
+    if (sizeBytes == 0) return;
+    enqueue(src, sizeBytes, dst, dstOffset, use);
+    wait(flush());
+}
+
+uint64_t StagingUploader::recordAcquireBarriers(VkCommandBuffer graphicsCmd) {
+    // Same family: the semaphore wait alone orders the copies before graphics work.
+    if (!transfersOwnership()) {
+        if (lastSubmitted <= acquiredValue) return 0;
+        acquiredValue = lastSubmitted;
+        return acquiredValue;
+    }
+    if (acquires.empty() && imageAcquires.empty()) return 0;
+
+    barrierScratch.clear();
+    uint64_t waitValue = 0;
+    for (const auto& a : acquires) {
+        VkBufferMemoryBarrier2 br{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+        br.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        br.srcAccessMask = 0;
+        br.dstStageMask = a.use.stage;
+        br.dstAccessMask = a.use.access;
+        br.srcQueueFamilyIndex = transferFamily;
+        br.dstQueueFamilyIndex = graphicsFamily;
+        br.buffer = a.buffer;
+        br.offset = a.offset;
+        br.size = a.size;
+        barrierScratch.push_back(br);
+        waitValue = std::max(waitValue, a.value);
+    }
+    acquires.clear();
+
+    imageBarrierScratch.clear();
+    for (const auto& a : imageAcquires) {
+        VkImageMemoryBarrier2 br = imageBarrier(a, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, a.use.layout);
+        br.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        br.dstStageMask = a.use.stage;
+        br.dstAccessMask = a.use.access;
+        br.srcQueueFamilyIndex = transferFamily;
+        br.dstQueueFamilyIndex = graphicsFamily;
+        imageBarrierScratch.push_back(br);
+        waitValue = std::max(waitValue, a.value);
+    }
+    imageAcquires.clear();
+
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.bufferMemoryBarrierCount = static_cast<uint32_t>(barrierScratch.size());
+    dep.pBufferMemoryBarriers = barrierScratch.data();
+    dep.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarrierScratch.size());
+    dep.pImageMemoryBarriers = imageBarrierScratch.data();
+    vkCmdPipelineBarrier2(graphicsCmd, &dep);
+    return waitValue;
+}
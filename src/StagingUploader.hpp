@@ -0,0 +1,165 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+class MemoryBudget;
+
+// Batched, asynchronous host -> device buffer and image uploads.
+//
+// Copies are recorded into one open command buffer per batch and submitted on a
+// (preferably dedicated) transfer queue. Each batch signals a value on the uploader's
+// timeline semaphore; that value is the Ticket handed back to callers. When the transfer
+// family differs from the graphics family, buffers are released on the transfer queue and
+// acquired on the graphics queue via recordAcquireBarriers(). Image levels are moved to their
+// final layout on the transfer queue, as part of that release when there is one.
+//
+// Staging memory is one fixed-budget, persistently mapped buffer used as a linear ring.
+// Every batch owns one contiguous partition of the ring (in steady state: one per frame,
+// since the renderer flushes once per frame). A partition is reclaimed when its timeline
+// value retires. Uploads larger than maxChunkSize() are split, so the ring never grows and
+// the steady-state path does no allocations.
+class StagingUploader {
+public:
+    static constexpr uint32_t kMaxBatches = 8;         // partitions/command buffers in flight
+    static constexpr VkDeviceSize kCopyAlignment = 16;
+
+    struct Ticket {
+        uint64_t value = 0; // 0 = nothing to wait for
+    };
+
+    // Where the uploaded bytes will be consumed on the graphics queue.
+    struct BufferUse {
+        VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        VkAccessFlags2        access = VK_ACCESS_2_MEMORY_READ_BIT;
+    };
+
+    // Where an uploaded image level will be read on the graphics queue, and in which layout.
+    struct ImageUse {
+        VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        VkAccessFlags2        access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        VkImageLayout         layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    };
+
+    // One mip level of tightly packed texel blocks (block-compressed or not), color aspect.
+    struct ImageLevel {
+        VkImage      image = VK_NULL_HANDLE;
+        uint32_t     mipLevel = 0;
+        VkExtent2D   extent{};          // texels
+        uint32_t     blockHeight = 1;   // texel rows per block row
+        VkDeviceSize rowBytes = 0;      // bytes per block row
+    };
+
+    // A sub-allocation of the staging ring inside the open batch.
+    struct Allocation {
+        VkDeviceSize offset = 0;  // offset into the staging buffer
+        VkDeviceSize size = 0;
+        void*        ptr = nullptr;
+        uint64_t     value = 0;   // batch it belongs to
+    };
+
+    void init(VmaAllocator alloc, VkDevice dev,
+        VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily,
+        VkDeviceSize budgetBytes, MemoryBudget* memoryBudget = nullptr);
+    void destroy();
+
+    // Blocking upload: enqueue + flush + wait. Kept for one-off init-time copies.
+    void upload(const void* src, VkDeviceSize sizeBytes, VkBuffer dst, VkDeviceSize dstOffset,
+        const BufferUse& use);
+
+    // Async upload: copy into the staging ring and record into the open batch, split into
+    // maxChunkSize() pieces if needed. The returned ticket completes once every chunk has executed.
+    Ticket enqueue(const void* src, VkDeviceSize sizeBytes, VkBuffer dst, VkDeviceSize dstOffset,
+        const BufferUse& use);
+
+    // Async image upload: the level's old contents are discarded (UNDEFINED ->
+    // TRANSFER_DST_OPTIMAL), it is copied in bands of whole block rows of at most maxChunkSize()
+    // and ends up in use.layout. As with buffers, the last band's ticket covers the level.
+    Ticket enqueueImage(const void* src, const ImageLevel& level, const ImageUse& use);
+
+    // Zero-copy path: reserve ring space, write into Allocation::ptr, then recordCopy() it
+    // before the next allocate(). sizeBytes must not exceed maxChunkSize().
+    Allocation allocate(VkDeviceSize sizeBytes, VkDeviceSize alignment = kCopyAlignment);
+    Ticket recordCopy(const Allocation& src, VkBuffer dst, VkDeviceSize dstOffset, const BufferUse& use);
+
+    // Submit the open batch (no-op if empty). Returns the ticket of the last submitted batch.
+    Ticket flush();
+
+    [[nodiscard]] bool isComplete(Ticket t) const;
+    void wait(Ticket t) const;
+
+    // Graphics side: emit queue-ownership acquire barriers for every submitted upload that has
+    // not been consumed yet. Returns the timeline value the graphics submit must wait on (0 = none).
+    uint64_t recordAcquireBarriers(VkCommandBuffer graphicsCmd);
+
+    VkSemaphore timeline() const { return timelineSem; }
+    [[nodiscard]] bool transfersOwnership() const { return transferFamily != graphicsFamily; }
+    VkDeviceSize budget() const { return capacity; }
+    VkDeviceSize maxChunkSize() const { return capacity / 4; }
+
+private:
+    // External deps
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t transferFamily = 0;
+    uint32_t graphicsFamily = 0;
+
+    VkCommandPool cmdPool = VK_NULL_HANDLE;
+
+    // Staging ring (persistently mapped, fixed size)
+    VkBuffer      stagingBuffer = VK_NULL_HANDLE;
+    VmaAllocation stagingAlloc = VK_NULL_HANDLE;
+    unsigned char* mapped = nullptr;
+    VkDeviceSize  capacity = 0;
+    VkDeviceSize  head = 0;   // next free byte
+    VkDeviceSize  tail = 0;   // first byte of the oldest live partition
+    VkDeviceSize  ringUsed = 0; // live bytes, including alignment padding and wrap waste
+
+    // Completion timeline
+    VkSemaphore timelineSem = VK_NULL_HANDLE;
+    uint64_t    lastSubmitted = 0;
+    uint64_t    acquiredValue = 0;    // highest value already handed to the graphics queue
+
+    // Batches form a ring in submission order; each owns the `bytes` of staging ring that
+    // follow its predecessor's partition, so reclaiming the oldest batch just advances tail.
+    struct Batch {
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        VkDeviceSize    bytes = 0;
+        uint64_t        value = 0;
+    };
+    std::array<Batch, kMaxBatches> batches{};
+    uint32_t firstBatch = 0;   // oldest live batch
+    uint32_t batchCount = 0;   // live batches (submitted + the open one)
+    bool     open = false;     // newest live batch is still recording
+    uint64_t openValue = 0;    // value the open batch will signal
+
+    // Ownership transfers
+    struct PendingTransfer {
+        VkBuffer buffer; VkDeviceSize offset; VkDeviceSize size;
+        BufferUse use; uint64_t value;
+    };
+    std::vector<PendingTransfer> releases;  // recorded into the open batch at flush
+    std::vector<PendingTransfer> acquires;  // waiting for the graphics queue
+    std::vector<VkBufferMemoryBarrier2> barrierScratch;
+
+    // Image levels whose last band is in the open batch: layout change (+ release) at flush
+    struct PendingImage {
+        VkImage image; uint32_t mipLevel;
+        ImageUse use; uint64_t value;
+    };
+    std::vector<PendingImage> imageReleases;
+    std::vector<PendingImage> imageAcquires;
+    std::vector<VkImageMemoryBarrier2> imageBarrierScratch;
+
+    bool tryAllocate(VkDeviceSize sizeBytes, VkDeviceSize alignment, VkDeviceSize& outOffset);
+    void reclaim();
+
+    Batch& beginBatch();
+    VkCommandBuffer openCommandBuffer() const { return batches[(firstBatch + batchCount - 1) % kMaxBatches].cmd; }
+    VkImageMemoryBarrier2 imageBarrier(const PendingImage& p, VkImageLayout oldLayout, VkImageLayout newLayout) const;
+    uint64_t completedValue() const;
+};
@@ -0,0 +1,436 @@
+#include "TextureStreamer.hpp"
+#include "BindlessDescriptors.hpp"
+#include "DeletionQueue.hpp"
+#include "MemoryBudget.hpp"
+#include "TextureTranscoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr uint64_t kRetryUpdates = 60;   // after an image allocation failed
+}
+
+void TextureStreamer::init(VkPhysicalDevice phys, VkDevice dev, VmaAllocator alloc, StagingUploader& staging,
+    BindlessDescriptors& table, DeletionQueue& deletion, uint32_t framesInFlight,
+    bool compressionBC, bool compressionASTC, const Config& cfg, MemoryBudget* budget) {
+    physicalDevice = phys;
+    device = dev;
+    allocator = alloc;
+    uploader = &staging;
+    bindless = &table;
+    deletionQueue = &deletion;
+    memory = budget;
+    config = cfg;
+    frameSlots = framesInFlight;
+    formatBC = compressionBC;
+    formatASTC = compressionASTC;
+    tick = 0;
+    resident = 0;
+    quit = false;
+
+    // One trilinear repeat sampler; textures carry no sampler state of their own yet
+    VkSamplerCreateInfo si{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    si.magFilter = VK_FILTER_LINEAR;
+    si.minFilter = VK_FILTER_LINEAR;
+    si.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    si.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    si.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    si.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    si.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &si, nullptr, &sampler.sampler) != VK_SUCCESS)
+        throw std::runtime_error("TextureStreamer: failed to create sampler");
+    sampler.slot = bindless->addSampler(sampler.sampler);
+
+    // Host-visible and read back whole: the GPU writes a few entries, the CPU scans them all
+    feedback.assign(frameSlots, {});
+    for (Feedback& f : feedback) {
+        VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        bi.size = sizeof(uint32_t) * config.maxTextures;
+        bi.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        VmaAllocationCreateInfo aci{};
+        aci.usage = VMA_MEMORY_USAGE_AUTO;
+        aci.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        VmaAllocationInfo info{};
+        if (vmaCreateBuffer(allocator, &bi, &aci, &f.buffer, &f.alloc, &info) != VK_SUCCESS)
+            throw std::runtime_error("TextureStreamer: failed to create feedback buffer");
+        if (memory) memory->track(f.alloc, MemoryBudget::Category::FrameData);
+        f.mapped = static_cast<uint32_t*>(info.pMappedData);
+        std::memset(f.mapped, 0xFF, bi.size);
+        vmaFlushAllocation(allocator, f.alloc, 0, bi.size);
+        f.slot = bindless->addStorageBuffer(f.buffer);
+    }
+
+    if (memory)
+        memory->addEvictor(MemoryBudget::Category::Textures,
+            [this](VkDeviceSize bytes, uint64_t) { return evict(bytes); });
+
+    if (TextureTranscoder::available()) TextureTranscoder::initGlobal();
+    const uint32_t threads = std::max(1u, config.workerThreads);
+    for (uint32_t i = 0; i < threads; ++i) workers.emplace_back(&TextureStreamer::workerLoop, this);
+}
+
+void TextureStreamer::destroy() {
+    if (!device) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (std::thread& t : workers)
+        if (t.joinable()) t.join();
+    workers.clear();
+    results.clear();
+    finished.clear();
+
+    // Bindless slots go with the table, which is destroyed after us
+    for (Texture& t : textures) {
+        destroyImage(t.current);
+        destroyImage(t.incoming);
+    }
+    textures.clear();
+    for (Feedback& f : feedback) {
+        if (memory) memory->untrack(f.alloc);
+        vmaDestroyBuffer(allocator, f.buffer, f.alloc);
+    }
+    feedback.clear();
+    if (sampler.sampler) vkDestroySampler(device, sampler.sampler, nullptr);
+    sampler = {};
+
+    resident = 0;
+    memory = nullptr;
+    deletionQueue = nullptr;
+    bindless = nullptr;
+    uploader = nullptr;
+    device = VK_NULL_HANDLE;
+}
+
+TextureStreamer::Handle TextureStreamer::load(const std::string& path) {
+    if (textures.size() >= config.maxTextures)
+        throw std::runtime_error("TextureStreamer: texture limit reached loading " + path);
+
+    Texture t;
+    t.path = path;
+    t.file = std::make_unique<KtxFile>();
+    t.file->open(path);
+    const KtxFile& f = *t.file;
+
+    if (f.payload() == KtxFile::Payload::Native) {
+        t.format = f.format();
+    }
+    else {
+        if (!TextureTranscoder::available())
+            throw std::runtime_error("TextureStreamer: " + path + " needs Basis transcoding (PANGAEA_BASISU is off)");
+        t.format = transcodeTarget(f.srgb());
+        t.transcode = true;
+    }
+    if (!sampleable(t.format))
+        throw std::runtime_error("TextureStreamer: " + path + ": format not sampleable on this device");
+    t.block = formatBlock(t.format);
+
+    // The tail: the smallest levels that fit tailBytes together, at least the last one
+    t.tailBase = f.levelCount() - 1;
+    while (t.tailBase > 0 && imageBytes(t, t.tailBase - 1) <= config.tailBytes) --t.tailBase;
+
+    const uint32_t id = textureCount();
+    textures.push_back(std::move(t));
+    queue(id, textures.back().tailBase);
+    return Handle{ id };
+}
+
+uint32_t TextureStreamer::descriptorSlot(Handle h) const {
+    return textures[h.id].slot;
+}
+
+uint32_t TextureStreamer::residentLevel(Handle h) const {
+    return textures[h.id].current.base;
+}
+
+const std::string& TextureStreamer::error(Handle h) const {
+    return textures[h.id].error;
+}
+
+void TextureStreamer::request(Handle h, uint32_t mip) {
+    Texture& t = textures[h.id];
+    t.wanted = std::min(t.wanted, mip);
+    t.lastRequested = tick;
+}
+
+void TextureStreamer::update(uint32_t frame, uint64_t nextRetireValue) {
+    ++tick;
+    readFeedback(frame);
+    swapCompleted(nextRetireValue);
+    uploadFinished(nextRetireValue);
+    schedule();
+}
+
+void TextureStreamer::recordFeedbackBarrier(VkCommandBuffer cmd) const {
+    VkMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    VkDependencyInfo dep{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void TextureStreamer::workerLoop() {
+    for (;;) {
+        Job job{};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || !jobs.empty(); });
+            if (quit) return;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        Result r;
+        r.id = job.id;
+        r.base = job.base;
+        if (job.target != VK_FORMAT_UNDEFINED) {
+            try {
+                TextureTranscoder::transcode(*job.file, job.base, job.target, r.data, r.offsets);
+            }
+            catch (const std::exception& e) {
+                r.error = e.what();
+            }
+        }
+        else {
+            // Native levels upload straight from the mapping; fault its pages in here so the
+            // main thread's copy into staging doesn't wait on the disk
+            volatile unsigned char sink = 0;
+            for (uint32_t level = job.base; level < job.file->levelCount(); ++level) {
+                const unsigned char* p = job.file->levelData(level);
+                const VkDeviceSize n = job.file->levelBytes(level);
+                for (VkDeviceSize o = 0; o < n; o += 4096) sink = sink + p[o];
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(r));
+    }
+}
+
+void TextureStreamer::readFeedback(uint32_t frame) {
+    Feedback& f = feedback[frame];
+    const VkDeviceSize bytes = sizeof(uint32_t) * textureCount();
+    if (bytes == 0) return;
+    vmaInvalidateAllocation(allocator, f.alloc, 0, bytes);
+
+    for (uint32_t i = 0; i < textureCount(); ++i) {
+        const uint32_t v = f.mapped[i];
+        if (v == kNoFeedback) continue;
+        f.mapped[i] = kNoFeedback;
+
+        // The slot's last frame sampled what was resident frameSlots updates ago; a swap since
+        // then means v is relative to a different base
+        Texture& t = textures[i];
+        if (t.current.base == kNone || t.swappedAt + frameSlots > tick) continue;
+        const int64_t level = std::clamp<int64_t>(int64_t(t.current.base) + int64_t(v) - int64_t(kFeedbackBias),
+            0, int64_t(t.file->levelCount()) - 1);
+        request(Handle{ i }, static_cast<uint32_t>(level));
+    }
+    vmaFlushAllocation(allocator, f.alloc, 0, bytes);
+}
+
+void TextureStreamer::swapCompleted(uint64_t retireValue) {
+    for (Texture& t : textures) {
+        if (!t.incoming.image || !uploader->isComplete(t.ticket)) continue;
+
+        if (t.slot != BindlessDescriptors::kInvalidSlot)
+            bindless->release(BindlessDescriptors::Kind::SampledImage, t.slot, retireValue);
+        if (t.current.image) {
+            resident -= t.current.bytes;
+            deletionQueue->deferImageView(retireValue, t.current.view);
+            deletionQueue->deferImage(retireValue, t.current.image, t.current.alloc);
+        }
+        t.current = t.incoming;
+        t.incoming = {};
+        t.slot = bindless->addSampledImage(t.current.view);
+        t.jobBase = kNone;
+        t.swappedAt = tick;
+        resident += t.current.bytes;
+    }
+}
+
+void TextureStreamer::uploadFinished(uint64_t retireValue) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(results);
+    }
+
+    for (Result& r : finished) {
+        Texture& t = textures[r.id];
+        if (!r.error.empty()) {
+            t.jobBase = kNone;
+            t.failed = true;
+            t.error = t.path + ": " + r.error;
+            continue;
+        }
+
+        Image img;
+        if (!createImage(t, r.base, img, retireValue)) {
+            t.jobBase = kNone;
+            t.retryAt = tick + kRetryUpdates;
+            continue;
+        }
+
+        const KtxFile& f = *t.file;
+        for (uint32_t level = r.base; level < f.levelCount(); ++level) {
+            StagingUploader::ImageLevel l;
+            l.image = img.image;
+            l.mipLevel = level - r.base;
+            l.extent = { f.levelWidth(level), f.levelHeight(level) };
+            l.blockHeight = t.block.height;
+            l.rowBytes = VkDeviceSize(t.block.blocksX(l.extent.width)) * t.block.bytes;
+            const void* src = r.data.empty() ? static_cast<const void*>(f.levelData(level))
+                                             : r.data.data() + r.offsets[level - r.base];
+            t.ticket = uploader->enqueueImage(src, l, {});
+        }
+        t.incoming = img;
+    }
+    finished.clear();
+}
+
+void TextureStreamer::schedule() {
+    const bool pressure = memory && memory->underPressure();
+    VkDeviceSize budget = config.uploadBytesPerFrame;
+    bool started = false;
+
+    for (uint32_t id = 0; id < textureCount(); ++id) {
+        Texture& t = textures[id];
+        const uint32_t wanted = t.wanted;
+        const bool demote = t.demote;
+        t.wanted = kNone;
+        t.demote = false;
+        if (t.failed || t.jobBase != kNone || tick < t.retryAt) continue;
+
+        const uint32_t base = t.current.base;
+        uint32_t target = base;
+        if (base == kNone) target = t.tailBase;   // the tail's allocation failed: again
+        else if (demote) target = std::min(base + 1, t.tailBase);
+        else if (base < t.tailBase && tick - t.lastRequested > config.idleFrames) target = t.tailBase;
+        else if (wanted < base && !pressure) target = wanted;
+        if (target == base) continue;
+
+        // Promotions are paced; the first always starts so a big level can't stall forever
+        if (base != kNone && target < base) {
+            const VkDeviceSize bytes = imageBytes(t, target);
+            if (started && bytes > budget) continue;
+            budget -= std::min(budget, bytes);
+            started = true;
+        }
+        queue(id, target);
+    }
+}
+
+void TextureStreamer::queue(uint32_t id, uint32_t base) {
+    Texture& t = textures[id];
+    t.jobBase = base;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({ id, base, t.file.get(), t.transcode ? t.format : VK_FORMAT_UNDEFINED });
+    }
+    wake.notify_one();
+}
+
+bool TextureStreamer::createImage(Texture& t, uint32_t base, Image& out, uint64_t retireValue) {
+    const KtxFile& f = *t.file;
+    const VkDeviceSize bytes = imageBytes(t, base);
+    if (memory) memory->reserve(bytes, retireValue);
+
+    VkImageCreateInfo ii{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    ii.imageType = VK_IMAGE_TYPE_2D;
+    ii.format = t.format;
+    ii.extent = { f.levelWidth(base), f.levelHeight(base), 1 };
+    ii.mipLevels = f.levelCount() - base;
+    ii.arrayLayers = 1;
+    ii.samples = VK_SAMPLE_COUNT_1_BIT;
+    ii.tiling = VK_IMAGE_TILING_OPTIMAL;
+    ii.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    ii.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    ii.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    if (memory) aci.flags = memory->allocationFlags(MemoryBudget::Category::Textures);
+    // WITHIN_BUDGET makes this fail rather than over-commit; the caller retries later
+    if (vmaCreateImage(allocator, &ii, &aci, &out.image, &out.alloc, nullptr) != VK_SUCCESS) {
+        out = {};
+        return false;
+    }
+    if (memory) memory->track(out.alloc, MemoryBudget::Category::Textures);
+
+    VkImageViewCreateInfo vi{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    vi.image = out.image;
+    vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vi.format = t.format;
+    vi.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, ii.mipLevels, 0, 1 };
+    if (vkCreateImageView(device, &vi, nullptr, &out.view) != VK_SUCCESS) {
+        destroyImage(out);
+        throw std::runtime_error("TextureStreamer: failed to create image view");
+    }
+    out.base = base;
+    out.bytes = bytes;
+    return true;
+}
+
+void TextureStreamer::destroyImage(Image& img) {
+    if (img.view) vkDestroyImageView(device, img.view, nullptr);
+    if (img.image) {
+        if (memory) memory->untrack(img.alloc);
+        vmaDestroyImage(allocator, img.image, img.alloc);
+    }
+    img = {};
+}
+
+VkDeviceSize TextureStreamer::imageBytes(const Texture& t, uint32_t base) const {
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = base; level < t.file->levelCount(); ++level)
+        bytes += t.block.levelBytes(t.file->levelWidth(level), t.file->levelHeight(level));
+    return bytes;
+}
+
+// Marks the least recently requested textures above their tail to drop their finest level.
+// Nothing is freed here: the memory comes back once the smaller image is swapped in and the
+// old one retires, which is what reserve() expects of an evictor.
+VkDeviceSize TextureStreamer::evict(VkDeviceSize bytes) {
+    std::vector<Texture*> candidates;
+    for (Texture& t : textures)
+        if (t.current.base != kNone && t.current.base < t.tailBase && t.jobBase == kNone && !t.demote)
+            candidates.push_back(&t);
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Texture* a, const Texture* b) { return a->lastRequested < b->lastRequested; });
+
+    VkDeviceSize freed = 0;
+    for (Texture* t : candidates) {
+        if (freed >= bytes) break;
+        t->demote = true;
+        freed += t->current.bytes - imageBytes(*t, t->current.base + 1);
+    }
+    return freed;
+}
+
+// Best block format the device samples for Basis payloads, uncompressed as the last resort
+VkFormat TextureStreamer::transcodeTarget(bool srgb) const {
+    VkFormat f = TextureTranscoder::pickFormat(formatBC, formatASTC, srgb);
+    if (!sampleable(f)) f = TextureTranscoder::pickFormat(false, formatASTC, srgb);
+    if (!sampleable(f)) f = TextureTranscoder::pickFormat(false, false, srgb);
+    return f;
+}
+
+bool TextureStreamer::sampleable(VkFormat format) const {
+    if (formatBlock(format).bytes == 0) return false;
+    VkFormatProperties props{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+    const VkFormatFeatureFlags need = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (props.optimalTilingFeatures & need) == need;
+}
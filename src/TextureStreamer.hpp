@@ -0,0 +1,189 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KtxFile.hpp"
+#include "StagingUploader.hpp"
+
+class BindlessDescriptors;
+class DeletionQueue;
+class MemoryBudget;
+
+// Streaming KTX2 textures: the coarse mip tail at load, finer levels on demand.
+//
+// load() maps the file and queues its mip tail (the smallest levels totalling at most
+// Config::tailBytes) for the worker threads, which transcode Basis payloads to the device's
+// block format (TextureTranscoder) or point straight into the mapping for GPU formats.
+// update() hands finished work to the staging uploader and, once the upload has completed,
+// swaps the texture to the new image, holding file levels [base, levelCount), under a new
+// bindless slot. The old image and slot retire through the deletion queue and the bindless
+// table. Residency only changes by replacing the image, so a texture is always complete and
+// sampled with plain normalized coordinates; the coarser levels are uploaded again with it
+// (at most a third of the new level's size).
+//
+// Finer levels are asked for by screen-space feedback: fragment shaders atomicMin the level
+// they would like, relative to the resident base plus kFeedbackBias, into this frame slot's
+// feedback buffer at the texture's index (shaders/texture_feedback.glsl). update() reads the
+// slot's buffer once the slot's previous frame has retired; request() is the CPU-side
+// equivalent. Promotions start while they fit in Config::uploadBytesPerFrame and the memory
+// budget is not under pressure. Under pressure the Textures evictor drops the finest level of
+// the least recently requested textures, and a texture nobody asked for in Config::idleFrames
+// falls back to its tail.
+//
+// Main thread only, apart from the workers.
+class TextureStreamer {
+public:
+    static constexpr uint32_t kFeedbackBias = 16;
+    static constexpr uint32_t kNoFeedback = ~0u;
+
+    struct Config {
+        uint32_t     workerThreads = 2;
+        uint32_t     maxTextures = 1024;                // feedback entries = loadable textures
+        VkDeviceSize tailBytes = 64 * 1024;             // resident from load on
+        VkDeviceSize uploadBytesPerFrame = 8ull << 20;  // new image bytes started per update()
+        uint32_t     idleFrames = 600;                  // unrequested updates before dropping to the tail
+    };
+
+    struct Handle {
+        uint32_t id = ~0u;
+        [[nodiscard]] bool valid() const { return id != ~0u; }
+    };
+
+    // compressionBC / compressionASTC: textureCompressionBC / textureCompressionASTC_LDR enabled
+    void init(VkPhysicalDevice phys, VkDevice dev, VmaAllocator alloc, StagingUploader& staging,
+        BindlessDescriptors& table, DeletionQueue& deletion, uint32_t framesInFlight,
+        bool compressionBC, bool compressionASTC, const Config& cfg, MemoryBudget* budget = nullptr);
+    // Stops the workers and frees everything immediately; the device must be idle
+    void destroy();
+    bool enabled() const { return device != VK_NULL_HANDLE; }
+
+    // Validates the file and queues its mip tail. Throws std::runtime_error on bad input, on a
+    // format the device can't sample, or when maxTextures are loaded.
+    Handle load(const std::string& path);
+
+    // Bindless sampled-image slot of the resident image; kInvalidSlot until the tail is in
+    uint32_t descriptorSlot(Handle h) const;
+    uint32_t samplerSlot() const { return sampler.slot; }
+    uint32_t residentLevel(Handle h) const;   // finest file level resident, ~0u = none yet
+    // Why transcoding h failed (it then stays at what is resident); empty while it hasn't
+    const std::string& error(Handle h) const;
+    // Bindless storage buffer the frame's shaders write their feedback to
+    uint32_t feedbackSlot(uint32_t frame) const { return feedback[frame].slot; }
+
+    // Ask for file level mip (or finer) of h this frame, as feedback would
+    void request(Handle h, uint32_t mip);
+
+    // Once per frame, after the frame slot's wait: reads the slot's feedback, swaps in
+    // completed uploads, uploads finished transcodes and starts new work. nextRetireValue is
+    // the value this frame's submit will signal.
+    void update(uint32_t frame, uint64_t nextRetireValue);
+    // End of the frame's last graphics command buffer: feedback writes -> host reads
+    void recordFeedbackBarrier(VkCommandBuffer cmd) const;
+
+    VkDeviceSize residentBytes() const { return resident; }
+    uint32_t     textureCount() const { return static_cast<uint32_t>(textures.size()); }
+
+private:
+    static constexpr uint32_t kNone = ~0u;
+
+    struct Image {
+        VkImage       image = VK_NULL_HANDLE;
+        VmaAllocation alloc = VK_NULL_HANDLE;
+        VkImageView   view = VK_NULL_HANDLE;
+        uint32_t      base = kNone;   // file level of mip 0
+        VkDeviceSize  bytes = 0;
+    };
+    struct Texture {
+        std::string               path;
+        std::unique_ptr<KtxFile>  file;    // workers read it through the job
+        VkFormat                  format = VK_FORMAT_UNDEFINED;   // what the image holds
+        FormatBlock               block;
+        bool                      transcode = false;
+        uint32_t                  tailBase = 0;
+
+        Image                     current;
+        uint32_t                  slot = ~0u;
+        Image                     incoming;       // uploading; swapped in once ticket completes
+        StagingUploader::Ticket   ticket{};
+        uint32_t                  jobBase = kNone; // queued / transcoding / uploading
+
+        uint32_t                  wanted = kNone;  // finest level asked for this update
+        uint64_t                  lastRequested = 0;
+        uint64_t                  swappedAt = 0;
+        uint64_t                  retryAt = 0;      // after an allocation failed
+        bool                      demote = false;   // evictor: drop the finest level
+        bool                      failed = false;   // transcode error: stays as it is
+        std::string               error;            // of the failed transcode
+    };
+    struct Job {
+        uint32_t       id;
+        uint32_t       base;
+        const KtxFile* file;
+        VkFormat       target;   // transcode target, UNDEFINED = native levels
+    };
+    struct Result {
+        uint32_t                   id = 0;
+        uint32_t                   base = 0;
+        std::vector<unsigned char> data;      // transcoded levels, empty for native files
+        std::vector<VkDeviceSize>  offsets;
+        std::string                error;
+    };
+    struct Feedback {
+        VkBuffer      buffer = VK_NULL_HANDLE;
+        VmaAllocation alloc = VK_NULL_HANDLE;
+        uint32_t*     mapped = nullptr;
+        uint32_t      slot = ~0u;
+    };
+    struct Sampler {
+        VkSampler sampler = VK_NULL_HANDLE;
+        uint32_t  slot = ~0u;
+    };
+
+    VkPhysicalDevice     physicalDevice = VK_NULL_HANDLE;
+    VkDevice             device = VK_NULL_HANDLE;
+    VmaAllocator         allocator = VK_NULL_HANDLE;
+    StagingUploader*     uploader = nullptr;
+    BindlessDescriptors* bindless = nullptr;
+    DeletionQueue*       deletionQueue = nullptr;
+    MemoryBudget*        memory = nullptr;
+    Config               config;
+    uint32_t             frameSlots = 0;
+    bool                 formatBC = false;
+    bool                 formatASTC = false;
+
+    std::deque<Texture>  textures;   // index = Handle::id
+    std::vector<Feedback> feedback;   // per frame in flight
+    Sampler              sampler;
+    uint64_t             tick = 0;   // update() calls
+    VkDeviceSize         resident = 0;   // swapped-in images, not uploads in flight
+
+    // Workers
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::deque<Job>         jobs;      // guarded by mutex
+    std::vector<Result>     results;   // guarded by mutex
+    std::vector<Result>     finished;  // main thread scratch
+    bool                    quit = false;
+    std::vector<std::thread> workers;
+
+    void workerLoop();
+    void readFeedback(uint32_t frame);
+    void swapCompleted(uint64_t retireValue);
+    void uploadFinished(uint64_t retireValue);
+    void schedule();
+    void queue(uint32_t id, uint32_t base);
+    bool createImage(Texture& t, uint32_t base, Image& out, uint64_t retireValue);
+    void destroyImage(Image& img);
+    VkDeviceSize imageBytes(const Texture& t, uint32_t base) const;
+    VkDeviceSize evict(VkDeviceSize bytes);
+    VkFormat transcodeTarget(bool srgb) const;
+    bool sampleable(VkFormat format) const;
+};
@@ -0,0 +1,66 @@
+#include "TextureTranscoder.hpp"
+#include "KtxFile.hpp"
+
+#include <stdexcept>
+
+#if PANGAEA_BASISU
+#include <basisu_transcoder.h>
+#include <mutex>
+
+static basist::transcoder_texture_format basisFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:       return basist::transcoder_texture_format::cTFBC7_RGBA;
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:  return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+    default:                             return basist::transcoder_texture_format::cTFRGBA32;
+    }
+}
+
+bool TextureTranscoder::available() { return true; }
+
+void TextureTranscoder::initGlobal() {
+    static std::once_flag once;
+    std::call_once(once, [] { basist::basisu_transcoder_init(); });
+}
+
+void TextureTranscoder::transcode(const KtxFile& file, uint32_t firstLevel, VkFormat target,
+    std::vector<unsigned char>& out, std::vector<VkDeviceSize>& offsets) {
+    // One transcoder per call: it holds the per-file ETC1S codebooks and decode state
+    basist::ktx2_transcoder transcoder;
+    if (!transcoder.init(file.data(), static_cast<uint32_t>(file.size())) || !transcoder.start_transcoding())
+        throw std::runtime_error("TextureTranscoder: bad Basis payload");
+
+    const FormatBlock block = formatBlock(target);
+    const basist::transcoder_texture_format fmt = basisFormat(target);
+    out.clear();
+    offsets.clear();
+    for (uint32_t level = firstLevel; level < file.levelCount(); ++level) {
+        const uint32_t w = file.levelWidth(level), h = file.levelHeight(level);
+        offsets.push_back(out.size());
+        out.resize(out.size() + static_cast<size_t>(block.levelBytes(w, h)));
+        // Capacity is in blocks for compressed targets, in pixels for RGBA32
+        const uint32_t capacity = block.blocksX(w) * block.blocksY(h);
+        if (!transcoder.transcode_image_level(level, 0, 0, out.data() + offsets.back(), capacity, fmt))
+            throw std::runtime_error("TextureTranscoder: failed to transcode a level");
+    }
+}
+
+#else
+
+bool TextureTranscoder::available() { return false; }
+
+void TextureTranscoder::initGlobal() {}
+
+void TextureTranscoder::transcode(const KtxFile&, uint32_t, VkFormat, std::vector<unsigned char>&,
+    std::vector<VkDeviceSize>&) {
+    throw std::runtime_error("TextureTranscoder: built without Basis Universal (PANGAEA_BASISU=OFF)");
+}
+
+#endif
+
+VkFormat TextureTranscoder::pickFormat(bool bc, bool astc, bool srgb) {
+    if (bc) return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    if (astc) return srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+    return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
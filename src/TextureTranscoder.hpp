@@ -0,0 +1,24 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+class KtxFile;
+
+// Basis Universal (ETC1S / UASTC) -> GPU block format transcoding of KTX2 payloads.
+//
+// Built on the basisu transcoder when PANGAEA_BASISU is on; otherwise available() is false and
+// transcode() throws, so only GPU-format KTX2 files load. The target format is chosen per
+// device: BC7 with textureCompressionBC, else ASTC 4x4 with textureCompressionASTC_LDR, else
+// RGBA8. transcode() keeps no shared state, so any number of worker threads may run it.
+class TextureTranscoder {
+public:
+    static bool     available();
+    static void     initGlobal();   // transcoder tables; once, before the first transcode
+    static VkFormat pickFormat(bool bc, bool astc, bool srgb);
+
+    // Levels [firstLevel, file.levelCount()) of file into out, one after the other and tightly
+    // packed; offsets gets each level's start. Throws std::runtime_error("TextureTranscoder: ...").
+    static void transcode(const KtxFile& file, uint32_t firstLevel, VkFormat target,
+        std::vector<unsigned char>& out, std::vector<VkDeviceSize>& offsets);
+};
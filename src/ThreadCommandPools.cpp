@@ -0,0 +1,88 @@
+#include "ThreadCommandPools.hpp"
+
+#include <stdexcept>
+
+void ThreadCommandPools::init(VkDevice dev, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadCount) {
+    device = dev;
+    frames = framesInFlight;
+    threads = threadCount;
+    pools.resize(static_cast<size_t>(frames) * threads);
+
+    VkCommandPoolCreateInfo info{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    info.queueFamilyIndex = queueFamily;
+    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole, never per buffer
+
+    for (auto& p : pools) {
+        if (vkCreateCommandPool(device, &info, nullptr, &p.pool) != VK_SUCCESS) {
+            throw std::runtime_error("ThreadCommandPools: failed to create command pool");
+        }
+        p.secondaries.reserve(8);
+    }
+
+    for (uint32_t f = 0; f < frames; ++f) {
+        VkCommandBufferAllocateInfo ai{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        ai.commandPool = at(f, 0).pool;
+        ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        ai.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device, &ai, &at(f, 0).primary) != VK_SUCCESS) {
+            throw std::runtime_error("ThreadCommandPools: failed to allocate primary command buffer");
+        }
+    }
+}
+
+void ThreadCommandPools::destroy() {
+    if (!device) return;
+    for (auto& p : pools) {
+        if (p.pool) vkDestroyCommandPool(device, p.pool, nullptr); // frees its buffers
+    }
+    pools.clear();
+    frames = threads = 0;
+    device = VK_NULL_HANDLE;
+}
+
+void ThreadCommandPools::beginFrame(uint32_t frame) {
+    for (uint32_t t = 0; t < threads; ++t) {
+        Pool& p = at(frame, t);
+        vkResetCommandPool(device, p.pool, 0);
+        p.usedSecondaries = 0;
+        p.usedPrimaries = 0;
+    }
+}
+
+VkCommandBuffer ThreadCommandPools::primary(uint32_t frame) {
+    return at(frame, 0).primary;
+}
+
+VkCommandBuffer ThreadCommandPools::acquirePrimary(uint32_t frame) {
+    Pool& p = at(frame, 0);
+    if (p.usedPrimaries == p.extraPrimaries.size()) {
+        VkCommandBufferAllocateInfo ai{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        ai.commandPool = p.pool;
+        ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        ai.commandBufferCount = 1;
+
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(device, &ai, &cmd) != VK_SUCCESS) {
+            throw std::runtime_error("ThreadCommandPools: failed to allocate primary command buffer");
+        }
+        p.extraPrimaries.push_back(cmd);
+    }
+    return p.extraPrimaries[p.usedPrimaries++];
+}
+
+VkCommandBuffer ThreadCommandPools::acquireSecondary(uint32_t frame, uint32_t thread) {
+    Pool& p = at(frame, thread);
+    if (p.usedSecondaries == p.secondaries.size()) {
+        VkCommandBufferAllocateInfo ai{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        ai.commandPool = p.pool;
+        ai.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        ai.commandBufferCount = 1;
+
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(device, &ai, &cmd) != VK_SUCCESS) {
+            throw std::runtime_error("ThreadCommandPools: failed to allocate secondary command buffer");
+        }
+        p.secondaries.push_back(cmd);
+    }
+    return p.secondaries[p.usedSecondaries++];
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// One transient command pool per (frame in flight, recording thread).
+//
+// Pools are only ever touched by their owning thread while recording, so no locking is needed.
+// beginFrame() resets every pool of a frame with vkResetCommandPool, which recycles all of its
+// command buffers at once; buffers handed out earlier are reused, not freed.
+class ThreadCommandPools {
+public:
+    void init(VkDevice dev, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadCount);
+    void destroy();
+
+    // Caller guarantees the GPU has retired every submission that used `frame`.
+    void beginFrame(uint32_t frame);
+
+    // Primary buffer for `frame` (lives in thread 0's pool).
+    VkCommandBuffer primary(uint32_t frame);
+
+    // Next unused additional primary of `frame` (thread 0's pool), for frames split over
+    // several submits; grows like the secondaries.
+    VkCommandBuffer acquirePrimary(uint32_t frame);
+
+    // Next unused secondary buffer of (frame, thread); grows the pool's list on demand.
+    VkCommandBuffer acquireSecondary(uint32_t frame, uint32_t thread);
+
+    uint32_t threadCount() const { return threads; }
+
+private:
+    struct Pool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        VkCommandBuffer primary = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> secondaries;
+        uint32_t usedSecondaries = 0;
+        std::vector<VkCommandBuffer> extraPrimaries;
+        uint32_t usedPrimaries = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t frames = 0;
+    uint32_t threads = 0;
+    std::vector<Pool> pools; // [frame * threads + thread]
+
+    Pool& at(uint32_t frame, uint32_t thread) { return pools[frame * threads + thread]; }
+};
@@ -0,0 +1,188 @@
+#include "TransformSystem.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PANGAEA_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#else
+#define PANGAEA_TRANSFORM_SSE 0
+#endif
+
+void TransformSystem::init(uint32_t capacity, uint32_t frameSlots) {
+    if (frameSlots == 0 || frameSlots > kMaxFrameSlots)
+        throw std::runtime_error("TransformSystem: unsupported frame slot count");
+
+    cap = capacity;
+    slots = frameSlots;
+    allSlots = frameSlots == 32 ? ~0u : (1u << frameSlots) - 1;
+
+    const uint32_t blocks = (capacity + kBlockSize - 1) / kBlockSize;
+    const size_t padded = size_t(blocks) * kBlockSize;
+    for (std::vector<float>* v : { &px, &py, &pz, &qx, &qy, &qz, &qw, &scale })
+        v->assign(padded, 0.f);
+    stale.assign(blocks, 0);
+    staleBlocks.reserve(blocks);
+    count = 0;
+}
+
+void TransformSystem::clear() {
+    count = 0;
+    std::fill(stale.begin(), stale.end(), 0u);
+    ranges.clear();
+    written = 0;
+}
+
+uint32_t TransformSystem::create(const float position[3], const float rotation[4], float s) {
+    if (count == cap)
+        throw std::runtime_error("TransformSystem: out of capacity");
+    const uint32_t i = count++;
+    setPosition(i, position);
+    setRotation(i, rotation);
+    setScale(i, s);
+    return i;
+}
+
+void TransformSystem::setPosition(uint32_t i, const float position[3]) {
+    px[i] = position[0];
+    py[i] = position[1];
+    pz[i] = position[2];
+    markDirty(i);
+}
+
+void TransformSystem::setRotation(uint32_t i, const float rotation[4]) {
+    qx[i] = rotation[0];
+    qy[i] = rotation[1];
+    qz[i] = rotation[2];
+    qw[i] = rotation[3];
+    markDirty(i);
+}
+
+void TransformSystem::setScale(uint32_t i, float s) {
+    scale[i] = s;
+    markDirty(i);
+}
+
+void TransformSystem::markAllDirty() {
+    const uint32_t blocks = (count + kBlockSize - 1) / kBlockSize;
+    std::fill(stale.begin(), stale.begin() + blocks, allSlots);
+}
+
+const std::vector<TransformSystem::Range>& TransformSystem::writeFrame(uint32_t slot, float* dst, JobSystem& jobs) {
+    ranges.clear();
+    staleBlocks.clear();
+    written = 0;
+
+    const uint32_t bit = 1u << slot;
+    const uint32_t blocks = (count + kBlockSize - 1) / kBlockSize;
+    for (uint32_t b = 0; b < blocks; ++b) {
+        if (!(stale[b] & bit)) continue;
+        stale[b] &= ~bit;
+        staleBlocks.push_back(b);
+
+        // Adjacent stale blocks merge into one flush range
+        const uint32_t first = b * kBlockSize;
+        const uint32_t n = std::min(kBlockSize, count - first);
+        if (!ranges.empty() && ranges.back().first + ranges.back().count == first) ranges.back().count += n;
+        else ranges.push_back({ first, n });
+        written += n;
+    }
+
+    const uint32_t jobCount = (static_cast<uint32_t>(staleBlocks.size()) + kBlocksPerJob - 1) / kBlocksPerJob;
+    jobs.parallelFor(jobCount, [&](uint32_t job, uint32_t) {
+        const uint32_t first = job * kBlocksPerJob;
+        const uint32_t last = std::min(first + kBlocksPerJob, static_cast<uint32_t>(staleBlocks.size()));
+        for (uint32_t i = first; i < last; ++i) writeBlock(staleBlocks[i], dst);
+    });
+    return ranges;
+}
+
+// Unit quaternion -> rotation, times uniform scale; column-major with translation in column 3
+void TransformSystem::world(uint32_t i, float m[16]) const {
+    const float x = qx[i], y = qy[i], z = qz[i], w = qw[i], s = scale[i];
+    m[0]  = (1.f - 2.f * (y * y + z * z)) * s;
+    m[1]  = 2.f * (x * y + z * w) * s;
+    m[2]  = 2.f * (x * z - y * w) * s;
+    m[3]  = 0.f;
+    m[4]  = 2.f * (x * y - z * w) * s;
+    m[5]  = (1.f - 2.f * (x * x + z * z)) * s;
+    m[6]  = 2.f * (y * z + x * w) * s;
+    m[7]  = 0.f;
+    m[8]  = 2.f * (x * z + y * w) * s;
+    m[9]  = 2.f * (y * z - x * w) * s;
+    m[10] = (1.f - 2.f * (x * x + y * y)) * s;
+    m[11] = 0.f;
+    m[12] = px[i];
+    m[13] = py[i];
+    m[14] = pz[i];
+    m[15] = 1.f;
+}
+
+void TransformSystem::writeBlock(uint32_t block, float* dst) const {
+    const uint32_t first = block * kBlockSize;
+    const uint32_t last = std::min(first + kBlockSize, count);
+
+#if PANGAEA_TRANSFORM_SSE
+    // Four objects per iteration: every matrix element is computed for all four at once, then
+    // each column quadruple is transposed into four object columns. A partial last group goes
+    // through a local so nothing past count is written.
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 two = _mm_set1_ps(2.f);
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t i = first; i < last; i += 4) {
+        const __m128 x = _mm_loadu_ps(&qx[i]), y = _mm_loadu_ps(&qy[i]);
+        const __m128 z = _mm_loadu_ps(&qz[i]), w = _mm_loadu_ps(&qw[i]);
+        const __m128 s = _mm_loadu_ps(&scale[i]);
+        const __m128 s2 = _mm_mul_ps(two, s);
+
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+        __m128 c0x = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+        __m128 c0y = _mm_mul_ps(s2, _mm_add_ps(xy, zw));
+        __m128 c0z = _mm_mul_ps(s2, _mm_sub_ps(xz, yw));
+        __m128 c0w = zero;
+        __m128 c1x = _mm_mul_ps(s2, _mm_sub_ps(xy, zw));
+        __m128 c1y = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+        __m128 c1z = _mm_mul_ps(s2, _mm_add_ps(yz, xw));
+        __m128 c1w = zero;
+        __m128 c2x = _mm_mul_ps(s2, _mm_add_ps(xz, yw));
+        __m128 c2y = _mm_mul_ps(s2, _mm_sub_ps(yz, xw));
+        __m128 c2z = _mm_mul_ps(s, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+        __m128 c2w = zero;
+        __m128 c3x = _mm_loadu_ps(&px[i]);
+        __m128 c3y = _mm_loadu_ps(&py[i]);
+        __m128 c3z = _mm_loadu_ps(&pz[i]);
+        __m128 c3w = one;
+
+        _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+        _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+        _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+        _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+        // Lane k of the four column sets is object i + k
+        const __m128 cols[4][4] = {
+            { c0x, c1x, c2x, c3x }, { c0y, c1y, c2y, c3y },
+            { c0z, c1z, c2z, c3z }, { c0w, c1w, c2w, c3w },
+        };
+
+        const uint32_t n = std::min(4u, last - i);
+        if (n == 4) {
+            float* out = dst + size_t(i) * 16;
+            for (uint32_t k = 0; k < 4; ++k)
+                for (uint32_t c = 0; c < 4; ++c) _mm_storeu_ps(out + k * 16 + c * 4, cols[k][c]);
+        }
+        else {
+            alignas(16) float tmp[4 * 16];
+            for (uint32_t k = 0; k < 4; ++k)
+                for (uint32_t c = 0; c < 4; ++c) _mm_store_ps(tmp + k * 16 + c * 4, cols[k][c]);
+            std::memcpy(dst + size_t(i) * 16, tmp, sizeof(float) * 16 * n);
+        }
+    }
+#else
+    for (uint32_t i = first; i < last; ++i) world(i, dst + size_t(i) * 16);
+#endif
+}
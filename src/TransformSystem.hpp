@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Scene object transforms in structure-of-arrays form, written straight into per-frame
+// instance buffers.
+//
+// Each object is a position, a unit quaternion (xyzw) and a uniform scale, stored component by
+// component so writeFrame() builds world matrices four objects at a time with SSE (scalar
+// elsewhere). Matrices are written column-major, 16 floats per object at the object's index:
+// the std430 layout of InstanceData in mesh.vert.
+//
+// Dirty tracking is per block of kBlockSize objects and per frame slot. A setter marks its
+// block stale in every slot; writeFrame(slot) rebuilds only that slot's stale blocks, directly
+// into the slot's mapped buffer, and returns the merged object ranges it wrote so the caller
+// flushes just those. An object that stops changing costs nothing once every slot has it.
+//
+// Setters are main thread only and must not overlap writeFrame().
+class TransformSystem {
+public:
+    static constexpr uint32_t kBlockSize = 64;       // objects per dirty bit (multiple of 4)
+    static constexpr uint32_t kBlocksPerJob = 16;    // writeFrame() work split
+    static constexpr uint32_t kMaxFrameSlots = 32;
+
+    struct Range { uint32_t first = 0; uint32_t count = 0; };   // in objects
+
+    void init(uint32_t capacity, uint32_t frameSlots);
+    void clear();   // drops every object; capacity stays
+
+    // Index of the new object (dense, in creation order). Throws when full.
+    uint32_t create(const float position[3], const float rotation[4], float scale);
+
+    uint32_t size() const { return count; }
+    uint32_t capacity() const { return cap; }
+
+    void setPosition(uint32_t i, const float position[3]);
+    void setRotation(uint32_t i, const float rotation[4]);
+    void setScale(uint32_t i, float scale);
+    void markAllDirty();   // e.g. the instance buffers were recreated
+
+    // Writes the world matrix of every object stale in this slot into dst (16 floats per
+    // object), split across the job system. The ranges stay valid until the next call.
+    const std::vector<Range>& writeFrame(uint32_t slot, float* dst, JobSystem& jobs);
+
+    // One object's world matrix, for paths that don't go through an instance buffer
+    void world(uint32_t i, float out[16]) const;
+
+    uint32_t lastWrittenObjects() const { return written; }
+
+private:
+    uint32_t cap = 0;
+    uint32_t count = 0;
+    uint32_t slots = 0;
+    uint32_t allSlots = 0;    // mask with one bit per frame slot
+
+    // Padded to whole blocks so the SIMD path reads full groups of four
+    std::vector<float> px, py, pz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> scale;
+
+    std::vector<uint32_t> stale;          // per block: frame slots still holding old matrices
+    std::vector<uint32_t> staleBlocks;    // scratch, this writeFrame()
+    std::vector<Range>    ranges;
+    uint32_t              written = 0;
+
+    void markDirty(uint32_t i) { stale[i / kBlockSize] = allSlots; }
+    void writeBlock(uint32_t block, float* dst) const;
+};
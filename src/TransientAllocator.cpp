@@ -0,0 +1,177 @@
+#include "TransientAllocator.hpp"
+#include "DeletionQueue.hpp"
+#include "MemoryBudget.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+static VkDeviceSize alignUp(VkDeviceSize v, VkDeviceSize a) { return (v + a - 1) / a * a; }
+
+static constexpr VkImageUsageFlags kAttachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+static bool livesOverlap(const TransientAllocator::Desc& a, const TransientAllocator::Desc& b) {
+    return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+void TransientAllocator::init(VkDevice dev, VmaAllocator alloc, MemoryBudget* budget) {
+    device = dev;
+    allocator = alloc;
+    memory = budget;
+
+    const VkPhysicalDeviceMemoryProperties* props = nullptr;
+    vmaGetMemoryProperties(allocator, &props);
+    hasLazyMemory = false;
+    for (uint32_t i = 0; i < props->memoryTypeCount; ++i)
+        hasLazyMemory |= (props->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+}
+
+void TransientAllocator::destroy() {
+    for (Target& t : targets) {
+        if (t.view) vkDestroyImageView(device, t.view, nullptr);
+        if (memory && t.lazyAlloc) memory->untrack(t.lazyAlloc);
+        if (t.image) vmaDestroyImage(allocator, t.image, t.lazyAlloc);   // shared targets: image only
+    }
+    targets.clear();
+    if (block) {
+        if (memory) memory->untrack(block);
+        vmaFreeMemory(allocator, block);
+    }
+    block = VK_NULL_HANDLE;
+    blockSize = requestedBytes = 0;
+    device = VK_NULL_HANDLE;
+    allocator = VK_NULL_HANDLE;
+    memory = nullptr;
+}
+
+TransientAllocator::Handle TransientAllocator::declare(const Desc& desc) {
+    if (desc.lastPass < desc.firstPass) throw std::runtime_error("TransientAllocator: lastPass before firstPass");
+    Target t;
+    t.desc = desc;
+    targets.push_back(t);
+    return Handle{ static_cast<uint32_t>(targets.size() - 1) };
+}
+
+VkImageCreateInfo TransientAllocator::imageInfo(const Desc& d, bool transient) const {
+    VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.extent = { d.extent.width, d.extent.height, 1 };
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.format = d.format;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    info.usage = d.usage | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    return info;
+}
+
+void TransientAllocator::createLazy(Target& t) {
+    const VkImageCreateInfo info = imageInfo(t.desc, true);
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+    if (vmaCreateImage(allocator, &info, &aci, &t.image, &t.lazyAlloc, nullptr) != VK_SUCCESS) {
+        t.image = VK_NULL_HANDLE;   // placeShared() takes it
+        t.lazyAlloc = VK_NULL_HANDLE;
+        return;
+    }
+    t.lazy = true;
+    if (memory) memory->track(t.lazyAlloc, MemoryBudget::Category::RenderTargets);
+}
+
+void TransientAllocator::build() {
+    if (hasLazyMemory) {
+        for (Target& t : targets) {
+            if (!t.image && (t.desc.usage & ~kAttachmentUsage) == 0) createLazy(t);
+        }
+    }
+    placeShared();
+
+    for (Target& t : targets) {
+        if (t.view) continue;
+        VkImageViewCreateInfo view{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        view.image = t.image;
+        view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view.format = t.desc.format;
+        view.subresourceRange.aspectMask = t.desc.aspect;
+        view.subresourceRange.baseMipLevel = 0;
+        view.subresourceRange.levelCount = 1;
+        view.subresourceRange.baseArrayLayer = 0;
+        view.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(device, &view, nullptr, &t.view) != VK_SUCCESS)
+            throw std::runtime_error("TransientAllocator: failed to create image view");
+    }
+}
+
+void TransientAllocator::placeShared() {
+    if (block) throw std::runtime_error("TransientAllocator: build() twice without release()");
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < targets.size(); ++i) {
+        Target& t = targets[i];
+        if (t.image) continue;   // lazy
+        const VkImageCreateInfo info = imageInfo(t.desc, false);
+        if (vkCreateImage(device, &info, nullptr, &t.image) != VK_SUCCESS)
+            throw std::runtime_error("TransientAllocator: failed to create image");
+        vkGetImageMemoryRequirements(device, t.image, &t.req);
+        order.push_back(i);
+    }
+    if (order.empty()) return;
+
+    // Largest first; each goes to the lowest offset clear of every placed target it lives with
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return targets[a].req.size > targets[b].req.size; });
+    VkMemoryRequirements combined{ 0, 1, ~0u };
+    struct Interval { VkDeviceSize begin, end; };
+    std::vector<Interval> busy;
+    for (size_t n = 0; n < order.size(); ++n) {
+        Target& t = targets[order[n]];
+        if ((combined.memoryTypeBits & t.req.memoryTypeBits) == 0)
+            throw std::runtime_error("TransientAllocator: targets share no memory type");
+        combined.memoryTypeBits &= t.req.memoryTypeBits;
+        combined.alignment = std::max(combined.alignment, t.req.alignment);
+        requestedBytes += t.req.size;
+
+        busy.clear();
+        for (size_t p = 0; p < n; ++p) {
+            const Target& o = targets[order[p]];
+            if (livesOverlap(t.desc, o.desc)) busy.push_back({ o.offset, o.offset + o.req.size });
+        }
+        std::sort(busy.begin(), busy.end(), [](const Interval& a, const Interval& b) { return a.begin < b.begin; });
+        VkDeviceSize offset = 0;
+        for (const Interval& b : busy) {
+            if (alignUp(offset, t.req.alignment) + t.req.size <= b.begin) break;
+            offset = std::max(offset, b.end);
+        }
+        t.offset = alignUp(offset, t.req.alignment);
+        combined.size = std::max(combined.size, t.offset + t.req.size);
+
+        for (size_t p = 0; p < n; ++p) {
+            Target& o = targets[order[p]];
+            if (t.offset < o.offset + o.req.size && o.offset < t.offset + t.req.size) t.aliased = o.aliased = true;
+        }
+    }
+
+    VmaAllocationCreateInfo aci{};
+    aci.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (vmaAllocateMemory(allocator, &combined, &aci, &block, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("TransientAllocator: failed to allocate shared block");
+    blockSize = combined.size;
+    if (memory) memory->track(block, MemoryBudget::Category::RenderTargets);
+
+    for (uint32_t id : order) {
+        if (vmaBindImageMemory2(allocator, block, targets[id].offset, targets[id].image, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("TransientAllocator: failed to bind image");
+    }
+}
+
+void TransientAllocator::release(DeletionQueue& deletion, uint64_t retireValue) {
+    for (const Target& t : targets) {
+        deletion.deferImageView(retireValue, t.view);
+        deletion.deferImage(retireValue, t.image, t.lazyAlloc);
+    }
+    deletion.deferAllocation(retireValue, block);
+    targets.clear();
+    block = VK_NULL_HANDLE;
+    blockSize = requestedBytes = 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <vector>
+
+class DeletionQueue;
+class MemoryBudget;
+
+// Pass-local render targets, placed by lifetime.
+//
+// Each target is declared with the range of passes (frame-order indices) that touch it; build()
+// then creates them all at once. Attachment-only targets go to LAZILY_ALLOCATED memory with
+// TRANSIENT_ATTACHMENT usage where the device has it (tilers keep them in tile memory). The
+// rest share one VMA allocation: targets whose pass ranges don't overlap get overlapping
+// offsets, largest first.
+//
+// Contents never survive a frame. The first barrier of each target in a frame must start from
+// UNDEFINED and wait on the stages of every target it may alias (aliases()).
+// Main thread only; rebuilt on resize.
+class TransientAllocator {
+public:
+    struct Handle {
+        uint32_t id = ~0u;
+        [[nodiscard]] bool valid() const { return id != ~0u; }
+    };
+
+    struct Desc {
+        VkFormat           format = VK_FORMAT_UNDEFINED;
+        VkExtent2D         extent{};
+        VkImageUsageFlags  usage = 0;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        uint32_t           firstPass = 0;   // inclusive
+        uint32_t           lastPass = 0;
+    };
+
+    void init(VkDevice dev, VmaAllocator alloc, MemoryBudget* budget = nullptr);
+    void destroy();   // immediate; the device must be idle
+
+    Handle declare(const Desc& desc);
+    // Creates images + views for everything declared since the last release()
+    void build();
+    // Hands the images, views and the shared block to the deletion queue; declarations are cleared
+    void release(DeletionQueue& deletion, uint64_t retireValue);
+
+    VkImage     image(Handle h) const { return targets[h.id].image; }
+    VkImageView view(Handle h) const { return targets[h.id].view; }
+    bool        lazy(Handle h) const { return targets[h.id].lazy; }
+    // Placed in the shared block with a target whose pass range it doesn't overlap
+    bool        aliases(Handle h) const { return targets[h.id].aliased; }
+
+    VkDeviceSize blockBytes() const { return blockSize; }        // shared block, after aliasing
+    VkDeviceSize unaliasedBytes() const { return requestedBytes; } // the same targets, one allocation each
+
+private:
+    struct Target {
+        Desc          desc;
+        VkImage       image = VK_NULL_HANDLE;
+        VkImageView   view = VK_NULL_HANDLE;
+        VmaAllocation lazyAlloc = VK_NULL_HANDLE;   // lazy targets own their memory
+        VkDeviceSize  offset = 0;
+        VkMemoryRequirements req{};
+        bool          lazy = false;
+        bool          aliased = false;
+    };
+
+    VkDevice      device = VK_NULL_HANDLE;
+    VmaAllocator  allocator = VK_NULL_HANDLE;
+    MemoryBudget* memory = nullptr;
+    bool          hasLazyMemory = false;
+
+    std::vector<Target> targets;
+    VmaAllocation       block = VK_NULL_HANDLE;
+    VkDeviceSize        blockSize = 0;
+    VkDeviceSize        requestedBytes = 0;
+
+    VkImageCreateInfo imageInfo(const Desc& d, bool transient) const;
+    void createLazy(Target& t);
+    void placeShared();
+};
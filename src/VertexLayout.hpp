@@ -0,0 +1,224 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Vertex formats and their pipeline vertex-input descriptions.
+//
+// Every format keeps position in stream (binding) 0 so depth/shadow passes can bind that
+// stream alone (VertexLayoutInfo::position*). Quantized formats store positions relative to a
+// per-mesh box: pos = q * dequantScale + dequantOffset, with the dequant folded into the
+// instance transform, so shaders read plain vec3 positions.
+//
+// Shader locations: 0 = position, 1 = color, 2 = octahedral normal.
+enum class VertexFormat : uint32_t {
+    Float32 = 0,   // interleaved pos.xyz f32 + color.rgb f32, 24 B
+    Snorm16 = 1,   // stream 0: pos snorm16x4 (8 B), stream 1: oct normal snorm16x2 + color rgba8 (8 B)
+    Half16 = 2,    // stream 0: pos float16x4 (8 B), stream 1 as Snorm16
+};
+
+struct VertexFloat {
+    float pos[3];
+    float color[3];
+};
+struct PositionSnorm16 { int16_t xyzw[4]; };
+struct PositionHalf { uint16_t xyzw[4]; };
+struct VertexAttribsPacked {
+    int16_t normalOct[2];  // octahedral-encoded unit normal, snorm16
+    uint8_t color[4];      // rgba8 unorm
+};
+static_assert(sizeof(VertexFloat) == 24 && sizeof(PositionSnorm16) == 8 &&
+    sizeof(PositionHalf) == 8 && sizeof(VertexAttribsPacked) == 8, "vertex structs must be tightly packed");
+
+// Runtime view of a layout; arrays point at the static tables below.
+struct VertexLayoutInfo {
+    static constexpr uint32_t kMaxStreams = 2;
+
+    VertexFormat format;
+    uint32_t streamCount;
+    std::array<uint32_t, kMaxStreams> streamStrides;
+    const VkVertexInputBindingDescription*   bindings;
+    uint32_t                                 bindingCount;
+    const VkVertexInputAttributeDescription* attributes;
+    uint32_t                                 attributeCount;
+    // Position-only subset (binding 0, location 0)
+    const VkVertexInputBindingDescription*   positionBinding;
+    const VkVertexInputAttributeDescription* positionAttribute;
+
+    uint32_t vertexBytes() const {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < streamCount; ++i) n += streamStrides[i];
+        return n;
+    }
+};
+
+// ---------------- Compile-time layout tables ----------------
+
+template <VertexFormat F> struct VertexLayout;
+
+template <> struct VertexLayout<VertexFormat::Float32> {
+    static constexpr std::array<VkVertexInputBindingDescription, 1> bindings{ {
+        { 0, sizeof(VertexFloat), VK_VERTEX_INPUT_RATE_VERTEX },
+    } };
+    static constexpr std::array<VkVertexInputAttributeDescription, 2> attributes{ {
+        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexFloat, pos) },
+        { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexFloat, color) },
+    } };
+};
+
+template <VkFormat PositionFormat> struct PackedVertexLayout {
+    static constexpr std::array<VkVertexInputBindingDescription, 2> bindings{ {
+        { 0, 8, VK_VERTEX_INPUT_RATE_VERTEX },
+        { 1, sizeof(VertexAttribsPacked), VK_VERTEX_INPUT_RATE_VERTEX },
+    } };
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> attributes{ {
+        { 0, 0, PositionFormat, 0 },
+        { 1, 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(VertexAttribsPacked, color) },
+        { 2, 1, VK_FORMAT_R16G16_SNORM, offsetof(VertexAttribsPacked, normalOct) },
+    } };
+};
+
+template <> struct VertexLayout<VertexFormat::Snorm16> : PackedVertexLayout<VK_FORMAT_R16G16B16A16_SNORM> {};
+template <> struct VertexLayout<VertexFormat::Half16> : PackedVertexLayout<VK_FORMAT_R16G16B16A16_SFLOAT> {};
+
+template <VertexFormat F>
+constexpr VertexLayoutInfo makeVertexLayoutInfo() {
+    using L = VertexLayout<F>;
+    VertexLayoutInfo info{};
+    info.format = F;
+    info.streamCount = static_cast<uint32_t>(L::bindings.size());
+    for (uint32_t i = 0; i < info.streamCount; ++i) info.streamStrides[i] = L::bindings[i].stride;
+    info.bindings = L::bindings.data();
+    info.bindingCount = static_cast<uint32_t>(L::bindings.size());
+    info.attributes = L::attributes.data();
+    info.attributeCount = static_cast<uint32_t>(L::attributes.size());
+    info.positionBinding = &L::bindings[0];
+    info.positionAttribute = &L::attributes[0];
+    return info;
+}
+
+inline const VertexLayoutInfo& vertexLayoutInfo(VertexFormat f) {
+    static constexpr std::array<VertexLayoutInfo, 3> table{ {
+        makeVertexLayoutInfo<VertexFormat::Float32>(),
+        makeVertexLayoutInfo<VertexFormat::Snorm16>(),
+        makeVertexLayoutInfo<VertexFormat::Half16>(),
+    } };
+    const auto i = static_cast<uint32_t>(f);
+    if (i >= table.size()) throw std::runtime_error("VertexLayout: unknown vertex format");
+    return table[i];
+}
+
+// ---------------- Quantization helpers ----------------
+
+namespace vtxq {
+
+inline int16_t encodeSnorm16(float v) {
+    return static_cast<int16_t>(std::lround(std::clamp(v, -1.f, 1.f) * 32767.f));
+}
+inline float decodeSnorm16(int16_t v) { return std::max(static_cast<float>(v) / 32767.f, -1.f); }
+
+inline uint8_t encodeUnorm8(float v) {
+    return static_cast<uint8_t>(std::lround(std::clamp(v, 0.f, 1.f) * 255.f));
+}
+
+// IEEE binary16, round-to-nearest-even (F. Giesen's float_to_half_fast3_rtne)
+inline uint16_t encodeHalf(float value) {
+    uint32_t f; std::memcpy(&f, &value, sizeof(f));
+    const uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+
+    uint32_t o;
+    if (f >= 0x47800000u) {
+        o = f > 0x7F800000u ? 0x7E00u : 0x7C00u;   // NaN stays NaN, overflow -> inf
+    }
+    else if (f < 0x38800000u) {
+        // Subnormal/zero: let the FPU align the mantissa by adding a magic constant
+        constexpr uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+        float fv, magic;
+        std::memcpy(&fv, &f, sizeof(fv));
+        std::memcpy(&magic, &denormMagicBits, sizeof(magic));
+        fv += magic;
+        std::memcpy(&o, &fv, sizeof(o));
+        o -= denormMagicBits;
+    }
+    else {
+        const uint32_t mantOdd = (f >> 13) & 1u;
+        f += (uint32_t(15 - 127) << 23) + 0xFFFu;
+        f += mantOdd;
+        o = f >> 13;
+    }
+    return static_cast<uint16_t>(o | (sign >> 16));
+}
+
+inline float decodeHalf(uint16_t h) {
+    const uint32_t sign = (h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1Fu;
+    const uint32_t m = h & 0x3FFu;
+    float f;
+    if (e == 0) f = std::ldexp(static_cast<float>(m), -24);
+    else if (e == 31) f = m ? NAN : INFINITY;
+    else f = std::ldexp(static_cast<float>(m | 0x400u), static_cast<int>(e) - 25);
+    uint32_t x; std::memcpy(&x, &f, sizeof(x));
+    x |= sign;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// Octahedral unit-vector encoding (Cigolle et al.), two snorm16 components
+inline void encodeOctahedral(const float n[3], int16_t out[2]) {
+    const float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float x = l1 > 0.f ? n[0] / l1 : 0.f;
+    float y = l1 > 0.f ? n[1] / l1 : 0.f;
+    if (n[2] < 0.f) {
+        const float ox = (1.f - std::fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+        const float oy = (1.f - std::fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = ox; y = oy;
+    }
+    out[0] = encodeSnorm16(x);
+    out[1] = encodeSnorm16(y);
+}
+
+// Uniform box around the mesh: q in [-1, 1]^3 covers offset +- scale on every axis
+struct Dequant {
+    float offset[3]{};   // pos = q * scale + offset, q in [-1, 1]
+    float scale = 1.f;
+};
+
+inline Dequant dequantForBounds(const float lo[3], const float hi[3]) {
+    Dequant d{};
+    float extent = 0.f;
+    for (int a = 0; a < 3; ++a) {
+        d.offset[a] = (lo[a] + hi[a]) * 0.5f;
+        extent = std::max(extent, (hi[a] - lo[a]) * 0.5f);
+    }
+    d.scale = extent > 0.f ? extent : 1.f;
+    return d;
+}
+
+// Stream-0 position of vertex i in object space
+inline void decodePosition(VertexFormat f, const void* stream0, uint32_t i, const Dequant& d, float out[3]) {
+    const auto* base = static_cast<const unsigned char*>(stream0);
+    switch (f) {
+    case VertexFormat::Float32: {
+        std::memcpy(out, base + size_t(i) * sizeof(VertexFloat), sizeof(float) * 3);
+        return;
+    }
+    case VertexFormat::Snorm16: {
+        PositionSnorm16 p; std::memcpy(&p, base + size_t(i) * sizeof(p), sizeof(p));
+        for (int a = 0; a < 3; ++a) out[a] = decodeSnorm16(p.xyzw[a]) * d.scale + d.offset[a];
+        return;
+    }
+    case VertexFormat::Half16: {
+        PositionHalf p; std::memcpy(&p, base + size_t(i) * sizeof(p), sizeof(p));
+        for (int a = 0; a < 3; ++a) out[a] = decodeHalf(p.xyzw[a]) * d.scale + d.offset[a];
+        return;
+    }
+    }
+    throw std::runtime_error("VertexLayout: unknown vertex format");
+}
+
+} // namespace vtxq
@@ -1,6 +1,41 @@
 #include <GLFW/glfw3.h>
 #include "Renderer.hpp"
+#include "MultiDeviceRenderer.hpp"
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <vector>
+
+// --present=fifo|relaxed|mailbox|immediate
+static bool parsePresentMode(const std::string& name, VkPresentModeKHR& mode) {
+    if (name == "fifo") mode = VK_PRESENT_MODE_FIFO_KHR;
+    else if (name == "relaxed") mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    else if (name == "mailbox") mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    else if (name == "immediate") mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    else return false;
+    return true;
+}
+
+// Headless readback: one binary PPM per frame (RGBA in, alpha dropped)
+static void writeFramePpm(const std::string& dir, const OffscreenTarget::Frame& f) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/frame_%05llu.ppm", static_cast<unsigned long long>(f.number));
+    FILE* out = std::fopen((dir + name).c_str(), "wb");
+    if (!out) return;
+    std::fprintf(out, "P6\n%u %u\n255\n", f.extent.width, f.extent.height);
+    std::string row(f.extent.width * 3, '\0');
+    for (uint32_t y = 0; y < f.extent.height; ++y) {
+        const auto* src = static_cast<const unsigned char*>(f.pixels) + y * f.rowPitch;
+        for (uint32_t x = 0; x < f.extent.width; ++x) {
+            row[x * 3 + 0] = static_cast<char>(src[x * 4 + 0]);
+            row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+            row[x * 3 + 2] = static_cast<char>(src[x * 4 + 2]);
+        }
+        std::fwrite(row.data(), 1, row.size(), out);
+    }
+    std::fclose(out);
+}
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
     (void)width; (void)height;
@@ -8,20 +43,184 @@ static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
     if (renderer) renderer->setFramebufferResized(true);
 }
 
-int main() {
+// --texture=path.ktx2, repeatable; a file that won't load is reported and skipped
+static std::vector<TextureStreamer::Handle> loadTextures(Renderer& renderer, const std::vector<std::string>& paths) {
+    std::vector<TextureStreamer::Handle> handles;
+    for (const std::string& path : paths) {
+        try {
+            handles.push_back(renderer.loadTexture(path));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Texture error: " << e.what() << "\n";
+        }
+    }
+    return handles;
+}
+
+// Transcodes run in the background; the ones that failed left their texture as it was
+static void reportTextureErrors(Renderer& renderer, const std::vector<TextureStreamer::Handle>& handles) {
+    for (TextureStreamer::Handle h : handles) {
+        const std::string& error = renderer.textures().error(h);
+        if (!error.empty()) std::cerr << "Texture error: " << error << "\n";
+    }
+}
+
+// --list-gpus: the ranking --gpu=N indexes
+static void listGpus(Renderer& renderer) {
+    const std::vector<Renderer::DeviceInfo> devices = renderer.listDevices();
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const Renderer::DeviceInfo& d = devices[i];
+        const char* type = d.type == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? "discrete"
+            : d.type == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? "integrated"
+            : d.type == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU ? "virtual"
+            : d.type == VK_PHYSICAL_DEVICE_TYPE_CPU ? "cpu" : "other";
+        std::printf("%zu: %s (%s, %llu MiB device-local%s%s)\n", i, d.name.c_str(), type,
+            static_cast<unsigned long long>(d.localBytes >> 20),
+            d.transferQueue ? ", transfer queue" : "", d.computeQueue ? ", compute queue" : "");
+    }
+}
+
+// --multi-gpu=frames|tiles: the headless frames split across every suitable GPU
+static int runMultiGpu(MultiDeviceRenderer::Config cfg, const MultiDeviceRenderer::SetupFn& setup) {
+    MultiDeviceRenderer multi;
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        multi.run(cfg, setup);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("Headless: %llu frames on %zu GPUs in %.3f s (%.1f fps)\n",
+            static_cast<unsigned long long>(cfg.frames), multi.stats().size(), seconds,
+            seconds > 0.0 ? cfg.frames / seconds : 0.0);
+        for (const MultiDeviceRenderer::DeviceStats& d : multi.stats())
+            std::printf("  %s: %llu frames in %.3f s\n", d.name.c_str(), static_cast<unsigned long long>(d.frames), d.seconds);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Headless error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Renderer renderer;
+    Renderer::PresentConfig present;
+    Renderer::HeadlessConfig headlessConfig;
+    bool profile = false;
+    bool headless = false;
+    uint64_t headlessFrames = 600;
+    std::string readbackDir;
+    std::vector<std::string> texturePaths;
+    ShaderLibrary::Config shaders;
+    Renderer::DeviceConfig device;
+    bool multiGpu = false;
+    MultiDeviceRenderer::Split split = MultiDeviceRenderer::Split::Frames;
+    bool preferShaderObjects = false;
+    std::string meshPath;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--shader-objects") preferShaderObjects = true;
+        else if (arg == "--headless") headless = true;
+        else if (arg.rfind("--headless=", 0) == 0) {   // --headless=WIDTHxHEIGHT
+            headless = true;
+            unsigned w = 0, h = 0;
+            if (std::sscanf(arg.c_str() + 11, "%ux%u", &w, &h) == 2 && w && h) headlessConfig.extent = { w, h };
+            else std::cerr << "Bad headless size: " << arg << "\n";
+        }
+        else if (arg.rfind("--frames=", 0) == 0) headlessFrames = std::stoull(arg.substr(9));
+        else if (arg.rfind("--readback=", 0) == 0) readbackDir = arg.substr(11);
+        else if (arg.rfind("--present=", 0) == 0) {
+            if (!parsePresentMode(arg.substr(10), present.mode)) std::cerr << "Unknown present mode: " << arg << "\n";
+        }
+        else if (arg.rfind("--frames-in-flight=", 0) == 0) present.framesInFlight = std::stoul(arg.substr(19));
+        else if (arg.rfind("--swapchain-images=", 0) == 0) present.imageCount = std::stoul(arg.substr(19));
+        else if (arg == "--no-present-wait") present.presentWait = false;
+        else if (arg.rfind("--texture=", 0) == 0) texturePaths.push_back(arg.substr(10));
+        else if (arg == "--hot-reload") {
+            shaders.watch = true;
+#ifdef PANGAEA_SHADER_SOURCE_DIR
+            // Edit the GLSL in the source tree; without glslc the rebuilt .spv are watched
+            shaders.sourceDir = PANGAEA_SHADER_SOURCE_DIR;
+            shaders.compiler = PANGAEA_GLSLC;
+#endif
+        }
+        else if (arg.rfind("--gpu=", 0) == 0) device.index = std::stoi(arg.substr(6));
+        else if (arg.rfind("--multi-gpu=", 0) == 0) {
+            multiGpu = true;
+            if (arg.substr(12) == "tiles") split = MultiDeviceRenderer::Split::Tiles;
+            else if (arg.substr(12) != "frames") std::cerr << "Unknown GPU split: " << arg << "\n";
+        }
+        else if (arg == "--list-gpus") {
+            listGpus(renderer);
+            return 0;
+        }
+        else if (arg == "--profile" || arg == "--profile-stats") {
+            profile = true;
+            renderer.setGpuProfiling(true, arg == "--profile-stats");
+        }
+        else meshPath = arg;  // optional .pmesh
+    }
+    auto configure = [&](Renderer& r) {
+        r.setPreferShaderObjects(preferShaderObjects);
+        if (!meshPath.empty()) r.setMeshPath(meshPath);
+        r.setPresentConfig(present);
+        r.setShaderConfig(shaders);
+    };
+    configure(renderer);
+    renderer.setDeviceConfig(device);
+
+    if (headless && multiGpu) {
+        // Textures and profiling stay single-GPU: both need the context after init()
+        MultiDeviceRenderer::Config cfg;
+        cfg.split = split;
+        cfg.frames = headlessFrames;
+        cfg.headless = headlessConfig;
+        if (!readbackDir.empty())
+            cfg.headless.onFrame = [&](const OffscreenTarget::Frame& f) { writeFramePpm(readbackDir, f); };
+        return runMultiGpu(std::move(cfg), [&](Renderer& r, uint32_t) { configure(r); });
+    }
+
+    if (headless) {
+        if (!readbackDir.empty())
+            headlessConfig.onFrame = [&](const OffscreenTarget::Frame& f) { writeFramePpm(readbackDir, f); };
+        renderer.setHeadless(std::move(headlessConfig));
+        try {
+            renderer.init(nullptr);
+            const std::vector<TextureStreamer::Handle> textures = loadTextures(renderer, texturePaths);
+            if (profile) renderer.profiler().setDump(5.0, "gpu_profile.csv");
+            const auto start = std::chrono::steady_clock::now();
+            while (renderer.frameCount() < headlessFrames) renderer.drawFrame();
+            reportTextureErrors(renderer, textures);
+            renderer.cleanup();   // waits for and delivers the frames still in flight
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("Headless: %llu frames in %.3f s (%.1f fps)\n",
+                static_cast<unsigned long long>(headlessFrames), seconds, seconds > 0.0 ? headlessFrames / seconds : 0.0);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Headless error: " << e.what() << "\n";
+            return 1;
+        }
+        if (profile) {
+            renderer.frameTimes().logReport(stdout);
+            renderer.frameTimes().writeChromeTrace("frame_trace.json");
+        }
+        return 0;
+    }
+
     if (!glfwInit()) {
         std::cerr << "Failed to init GLFW\n";
         return 1;
     }
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     GLFWwindow* window = glfwCreateWindow(1280, 720, "Pangaea 2.0", nullptr, nullptr);
-
-    Renderer renderer;
     glfwSetWindowUserPointer(window, &renderer);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
 
+    std::vector<TextureStreamer::Handle> textures;
     try {
         renderer.init(window);
+        if (renderer.presentMode() != present.mode)
+            std::cerr << "Present mode unsupported by the surface, using FIFO\n";
+        textures = loadTextures(renderer, texturePaths);
+        if (profile) renderer.profiler().setDump(5.0, "gpu_profile.csv");
     }
     catch (const std::exception& e) {
         std::cerr << "Init error: " << e.what() << "\n";
@@ -30,11 +229,21 @@ int main() {
         return 1;
     }
 
+    std::vector<ShaderLibrary::Rejected> reloadErrors;
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
         renderer.drawFrame();
+        renderer.takeReloadErrors(reloadErrors);
+        for (const ShaderLibrary::Rejected& r : reloadErrors) std::cerr << "Hot reload: " << r.name << ": " << r.reason << "\n";
+        reloadErrors.clear();
     }
 
+    if (profile) {
+        renderer.frameTimes().logReport(stdout);
+        renderer.frameTimes().writeChromeTrace("frame_trace.json");
+        renderer.memoryBudget().logReport(stdout);
+    }
+    reportTextureErrors(renderer, textures);
     renderer.cleanup();
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,286 @@
+// Pangaea2_0_meshconv: Wavefront OBJ -> .pmesh (MeshFile::write).
+//
+//   Pangaea2_0_meshconv input.obj output.pmesh [--format=snorm16|half16|float32]
+//
+// Reads positions, optional per-vertex colors ("v x y z r g b") and normals; faces are
+// triangulated as fans. Every o / g / usemtl starts a new submesh, usemtl names become material
+// ids in order of appearance. Without normals in the file, face normals are accumulated per
+// vertex; without colors, the normal is shown as a color.
+#include "MeshFile.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Vec3 { float x = 0.f, y = 0.f, z = 0.f; };
+
+Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+Vec3 cross(Vec3 a, Vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+Vec3 normalize(Vec3 v) {
+    const float l = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    return l > 0.f ? Vec3{ v.x / l, v.y / l, v.z / l } : Vec3{ 0.f, 0.f, 1.f };
+}
+
+struct Mesh {
+    std::vector<Vec3>        positions;
+    std::vector<Vec3>        colors;
+    std::vector<Vec3>        normals;
+    std::vector<uint32_t>    indices;
+    std::vector<MeshSubmesh> submeshes;
+};
+
+// OBJ indices are 1-based, negative = relative to the end
+int resolve(long i, size_t count) {
+    const long r = i < 0 ? static_cast<long>(count) + i : i - 1;
+    if (r < 0 || r >= static_cast<long>(count)) throw std::runtime_error("index out of range");
+    return static_cast<int>(r);
+}
+
+Mesh readObj(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open " + path);
+
+    std::vector<Vec3> v, vc, vn;
+    bool anyColor = false;
+    Mesh mesh;
+    std::unordered_map<uint64_t, uint32_t> unique;    // (position, normal) -> output vertex
+    std::unordered_map<std::string, uint32_t> materials;
+    uint32_t material = 0;
+    bool faceNormals = false;   // some face had no vn: accumulate
+
+    auto startSubmesh = [&] {
+        if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0) {
+            mesh.submeshes.back().material = material;
+            return;
+        }
+        MeshSubmesh sm{};
+        sm.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+        sm.material = material;
+        mesh.submeshes.push_back(sm);
+    };
+    startSubmesh();
+
+    std::string line;
+    for (size_t lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream ls(line);
+        std::string tag;
+        ls >> tag;
+        try {
+            if (tag == "v") {
+                Vec3 p, c{ -1.f, -1.f, -1.f };
+                ls >> p.x >> p.y >> p.z;
+                if (ls >> c.x >> c.y >> c.z) anyColor = true;
+                v.push_back(p);
+                vc.push_back(c);
+            }
+            else if (tag == "vn") {
+                Vec3 n;
+                ls >> n.x >> n.y >> n.z;
+                vn.push_back(normalize(n));
+            }
+            else if (tag == "o" || tag == "g") startSubmesh();
+            else if (tag == "usemtl") {
+                std::string name;
+                ls >> name;
+                material = materials.emplace(name, static_cast<uint32_t>(materials.size())).first->second;
+                startSubmesh();
+            }
+            else if (tag == "f") {
+                std::vector<uint32_t> face;
+                std::string corner;
+                while (ls >> corner) {
+                    // v, v/vt, v//vn, v/vt/vn
+                    const int pi = resolve(std::stol(corner), v.size());
+                    int ni = -1;
+                    const size_t slash = corner.find('/');
+                    if (slash != std::string::npos) {
+                        const size_t second = corner.find('/', slash + 1);
+                        if (second != std::string::npos && second + 1 < corner.size())
+                            ni = resolve(std::stol(corner.substr(second + 1)), vn.size());
+                    }
+                    if (ni < 0) faceNormals = true;
+
+                    const uint64_t key = (uint64_t(uint32_t(pi)) << 32) | uint32_t(ni);
+                    auto [it, inserted] = unique.try_emplace(key, static_cast<uint32_t>(mesh.positions.size()));
+                    if (inserted) {
+                        mesh.positions.push_back(v[pi]);
+                        mesh.colors.push_back(vc[pi]);
+                        mesh.normals.push_back(ni >= 0 ? vn[ni] : Vec3{});
+                    }
+                    face.push_back(it->second);
+                }
+                for (size_t k = 2; k < face.size(); ++k) {
+                    mesh.indices.insert(mesh.indices.end(), { face[0], face[k - 1], face[k] });
+                    mesh.submeshes.back().indexCount += 3;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": " + e.what());
+        }
+    }
+
+    mesh.submeshes.erase(std::remove_if(mesh.submeshes.begin(), mesh.submeshes.end(),
+        [](const MeshSubmesh& sm) { return sm.indexCount == 0; }), mesh.submeshes.end());
+    if (mesh.indices.empty()) throw std::runtime_error(path + ": no faces");
+
+    if (faceNormals) {
+        for (Vec3& n : mesh.normals) n = {};
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+            const uint32_t* tri = &mesh.indices[t];
+            const Vec3 fn = cross(mesh.positions[tri[1]] - mesh.positions[tri[0]],
+                mesh.positions[tri[2]] - mesh.positions[tri[0]]);   // area-weighted
+            for (int k = 0; k < 3; ++k) {
+                Vec3& n = mesh.normals[tri[k]];
+                n = { n.x + fn.x, n.y + fn.y, n.z + fn.z };
+            }
+        }
+        for (Vec3& n : mesh.normals) n = normalize(n);
+    }
+    for (size_t i = 0; i < mesh.colors.size(); ++i) {
+        const Vec3& n = mesh.normals[i];
+        if (!anyColor || mesh.colors[i].x < 0.f)
+            mesh.colors[i] = { n.x * 0.5f + 0.5f, n.y * 0.5f + 0.5f, n.z * 0.5f + 0.5f };
+    }
+    return mesh;
+}
+
+// Sphere around the AABB center of the vertices a submesh draws
+void boundSubmesh(const Mesh& mesh, MeshSubmesh& sm) {
+    float lo[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float hi[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (uint32_t k = sm.firstIndex; k < sm.firstIndex + sm.indexCount; ++k) {
+        const Vec3& p = mesh.positions[mesh.indices[k]];
+        lo[0] = std::min(lo[0], p.x); lo[1] = std::min(lo[1], p.y); lo[2] = std::min(lo[2], p.z);
+        hi[0] = std::max(hi[0], p.x); hi[1] = std::max(hi[1], p.y); hi[2] = std::max(hi[2], p.z);
+    }
+    for (int a = 0; a < 3; ++a) sm.sphere[a] = (lo[a] + hi[a]) * 0.5f;
+    float r2 = 0.f;
+    for (uint32_t k = sm.firstIndex; k < sm.firstIndex + sm.indexCount; ++k) {
+        const Vec3& p = mesh.positions[mesh.indices[k]];
+        const float dx = p.x - sm.sphere[0], dy = p.y - sm.sphere[1], dz = p.z - sm.sphere[2];
+        r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+    }
+    sm.sphere[3] = std::sqrt(r2);
+}
+
+// Stream-major vertex blob in format's layout
+std::vector<unsigned char> encodeVertices(const Mesh& mesh, VertexFormat format, vtxq::Dequant& dq) {
+    const size_t n = mesh.positions.size();
+    std::vector<unsigned char> blob;
+    if (format == VertexFormat::Float32) {
+        std::vector<VertexFloat> verts(n);
+        for (size_t i = 0; i < n; ++i) {
+            verts[i] = { { mesh.positions[i].x, mesh.positions[i].y, mesh.positions[i].z },
+                         { mesh.colors[i].x, mesh.colors[i].y, mesh.colors[i].z } };
+        }
+        blob.resize(n * sizeof(VertexFloat));
+        std::memcpy(blob.data(), verts.data(), blob.size());
+        return blob;
+    }
+
+    float lo[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float hi[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (const Vec3& p : mesh.positions) {
+        lo[0] = std::min(lo[0], p.x); lo[1] = std::min(lo[1], p.y); lo[2] = std::min(lo[2], p.z);
+        hi[0] = std::max(hi[0], p.x); hi[1] = std::max(hi[1], p.y); hi[2] = std::max(hi[2], p.z);
+    }
+    dq = vtxq::dequantForBounds(lo, hi);
+
+    // Stream 0 positions (8 B in both formats), stream 1 normal + color
+    static_assert(sizeof(PositionSnorm16) == sizeof(PositionHalf));
+    blob.resize(n * (sizeof(PositionSnorm16) + sizeof(VertexAttribsPacked)));
+    unsigned char* attribs = blob.data() + n * sizeof(PositionSnorm16);
+    for (size_t i = 0; i < n; ++i) {
+        const float p[3] = { mesh.positions[i].x, mesh.positions[i].y, mesh.positions[i].z };
+        if (format == VertexFormat::Snorm16) {
+            PositionSnorm16 q{};
+            for (int a = 0; a < 3; ++a) q.xyzw[a] = vtxq::encodeSnorm16((p[a] - dq.offset[a]) / dq.scale);
+            std::memcpy(blob.data() + i * sizeof(q), &q, sizeof(q));
+        }
+        else {
+            PositionHalf q{};
+            for (int a = 0; a < 3; ++a) q.xyzw[a] = vtxq::encodeHalf((p[a] - dq.offset[a]) / dq.scale);
+            std::memcpy(blob.data() + i * sizeof(q), &q, sizeof(q));
+        }
+
+        VertexAttribsPacked va{};
+        const float nrm[3] = { mesh.normals[i].x, mesh.normals[i].y, mesh.normals[i].z };
+        vtxq::encodeOctahedral(nrm, va.normalOct);
+        va.color[0] = vtxq::encodeUnorm8(mesh.colors[i].x);
+        va.color[1] = vtxq::encodeUnorm8(mesh.colors[i].y);
+        va.color[2] = vtxq::encodeUnorm8(mesh.colors[i].z);
+        va.color[3] = 255;
+        std::memcpy(attribs + i * sizeof(VertexAttribsPacked), &va, sizeof(va));
+    }
+    return blob;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string input, output;
+    VertexFormat format = VertexFormat::Snorm16;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--format=snorm16") format = VertexFormat::Snorm16;
+        else if (arg == "--format=half16") format = VertexFormat::Half16;
+        else if (arg == "--format=float32") format = VertexFormat::Float32;
+        else if (arg.rfind("--", 0) == 0) { std::cerr << "Unknown option: " << arg << "\n"; return 2; }
+        else if (input.empty()) input = arg;
+        else output = arg;
+    }
+    if (input.empty() || output.empty()) {
+        std::cerr << "usage: Pangaea2_0_meshconv input.obj output.pmesh [--format=snorm16|half16|float32]\n";
+        return 2;
+    }
+
+    try {
+        Mesh mesh = readObj(input);
+        for (MeshSubmesh& sm : mesh.submeshes) boundSubmesh(mesh, sm);
+
+        vtxq::Dequant dq{};
+        const std::vector<unsigned char> vertices = encodeVertices(mesh, format, dq);
+        const uint32_t vertexCount = static_cast<uint32_t>(mesh.positions.size());
+
+        // 16-bit indices when every vertex fits
+        std::vector<uint16_t> indices16;
+        const bool small = vertexCount <= std::numeric_limits<uint16_t>::max();
+        if (small) indices16.assign(mesh.indices.begin(), mesh.indices.end());
+
+        MeshFile::WriteDesc desc;
+        desc.vertices = vertices.data();
+        desc.vertexFormat = format;
+        desc.dequant = dq;
+        desc.vertexCount = vertexCount;
+        desc.indices = small ? static_cast<const void*>(indices16.data()) : mesh.indices.data();
+        desc.indexSize = small ? 2 : 4;
+        desc.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        desc.submeshes = mesh.submeshes.data();
+        desc.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+        MeshFile::write(output, desc);
+
+        // Read it back: the loader's validation is the point of the exercise
+        MeshFile check;
+        check.open(output);
+        std::printf("%s: %u vertices, %u triangles, %u submeshes\n", output.c_str(), vertexCount,
+            desc.indexCount / 3, desc.submeshCount);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Mesh error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}